@@ -1,13 +1,15 @@
 #ifndef GEMINI_FLATMAP_1_H_INCLUDED
 #define GEMINI_FLATMAP_1_H_INCLUDED
 
-#include <immintrin.h>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <new>
 
+#include "TraceProbe.h"
+#include "IsaDispatch.h"
+
 // --- CACHE-LINE ORDER BLOCK (EXACTLY 64 BYTES) ---
 struct alignas(64) CondensedOrderBlock {
     struct CondensedOrder {
@@ -16,7 +18,7 @@ struct alignas(64) CondensedOrderBlock {
     };
     static_assert(sizeof(CondensedOrder) == 16);
 
-    CondensedOrder block;            // Fixed explicit array of 3 elements (48 bytes)
+    CondensedOrder block[3];         // Fixed explicit array of 3 elements (48 bytes)
     CondensedOrderBlock* next = nullptr;   // 8 bytes (64-bit system pointer)
     uint8_t padding = 0;             // 8 bytes padding -> 48 + 8 + 8 = 64 bytes total
 };
@@ -55,10 +57,9 @@ public:
         node->next = nullptr;
         CondensedOrderBlock* aligned_node = std::assume_aligned<64>(node);
 
-        // Zero first 32 bytes via 256-bit register blit
-        _mm256_store_si256(reinterpret_cast<__m256i*>(aligned_node->block), _mm256_setzero_si256());
-        // Zero remaining 16 bytes via 128-bit register blit
-        _mm_store_si128(reinterpret_cast<__m128i*>(&aligned_node->block), _mm_setzero_si128());
+        // Zero the 48-byte order array; fixed-size memset lowers to whatever vector
+        // width the build targets, with no AVX requirement on the binary
+        std::memset(aligned_node->block, 0, sizeof(aligned_node->block));
         return aligned_node;
     }
 
@@ -133,28 +134,10 @@ public:
         return &m_levels[index];
     }
 
+    // 8-wide compare scan, bound at startup to the widest ISA the CPU has (IsaDispatch.h)
     inline uint32_t find_insert_index(uint32_t price, bool& out_exists) const noexcept {
-        __m256i target = _mm256_set1_epi32(static_cast<int>(price));
-
-        for (uint32_t i = 0; i < m_count; i += 8) {
-            __m256i current_vec = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_prices + i));
-
-            int eq_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(target, current_vec));
-            if (eq_mask > 0) {
-                out_exists = true;
-                return i + (__builtin_ctz(eq_mask) >> 2);
-            }
-
-            __m256i gt_cmp = IsBid ? _mm256_cmpgt_epi32(target, current_vec)
-                                   : _mm256_cmpgt_epi32(current_vec, target);
-            int gt_mask = _mm256_movemask_epi8(gt_cmp);
-            if (gt_mask > 0) {
-                out_exists = false;
-                return i + (__builtin_ctz(gt_mask) >> 2);
-            }
-        }
-        out_exists = false;
-        return m_count;
+        return IsBid ? ISADISPATCH::k_price_insert_bid(m_prices, m_count, price, out_exists)
+                     : ISADISPATCH::k_price_insert_ask(m_prices, m_count, price, out_exists);
     }
 
     inline uint32_t find(uint32_t price) const noexcept {
@@ -177,6 +160,8 @@ public:
         m_levels[idx] = { price, sz, num_orders, feed_time, uuid, nullptr };
         m_count++;
 
+        TRACE_MARK(BookEmplace, price);
+
         return { idx, true };
     }
 
@@ -191,24 +176,15 @@ public:
         PriceLevel& level = m_levels[target_idx];
         if (new_sz == 0) return remove_from_level(level, oid);
 
-        __m256i target = _mm256_set1_epi64x(static_cast<int64_t>(oid));
         CondensedOrderBlock* current = level.pords;
         uint32_t depth = 0;
 
         while (current) {
-            __m256i oids = _mm256_set_epi64x(
-                                                0,                                // Lane 3: Zero Padding
-                                            current->block[2].oid,            // Lane 2: Order 2 ID
-                                            current->block[1].oid,            // Lane 1: Order 1 ID
-                                            current->block[0].oid             // Lane 0: Order 0 ID
-                                        );
-            if (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(target, oids))) > 0 || true) {
-                for (uint32_t i = 0; i < 3; ++i) {
-                    if (current->block[i].oid == oid && (depth * 3) + i < level.num_orders) {
-                        level.aggregate_sz = (level.aggregate_sz - current->block[i].sz) + new_sz;
-                        current->block[i].sz = new_sz;
-                        return true;
-                    }
+            for (uint32_t i = 0; i < 3; ++i) {
+                if (current->block[i].oid == oid && (depth * 3) + i < level.num_orders) {
+                    level.aggregate_sz = (level.aggregate_sz - current->block[i].sz) + new_sz;
+                    current->block[i].sz = new_sz;
+                    return true;
                 }
             }
             current = current->next; depth++;
@@ -218,6 +194,7 @@ public:
 
     bool erase(uint32_t index) noexcept {
         if (index >= m_count) [[unlikely]] return false;
+        TRACE_MARK(BookErase, m_prices[index]);
         CondensedOrderBlock* current = m_levels[index].pords;
         while (current) {
             CondensedOrderBlock* next_node = current->next;
@@ -245,7 +222,7 @@ public:
             PriceLevel& level = m_levels[0];
             if (level.aggregate_sz == 0) [[unlikely]] { erase(0); continue; }
 
-            auto& top_order = std::assume_aligned<64>(level.pords)->block;
+            auto& top_order = std::assume_aligned<64>(level.pords)->block[0];
             if (aggressive_sz >= top_order.sz) {
                 aggressive_sz -= top_order.sz;
                 level.aggregate_sz -= top_order.sz;
@@ -289,28 +266,18 @@ private:
     }
 
     bool remove_from_level(PriceLevel& level, uint64_t oid) noexcept {
-        __m256i target = _mm256_set1_epi64x(static_cast<int64_t>(oid));
         CondensedOrderBlock* current = level.pords;
         CondensedOrderBlock* target_block = nullptr;
         uint32_t depth = 0, inner_idx = 0;
         bool found = false;
 
         while (current) {
-            __m256i oids = _mm256_set_epi64x(
-                                                0,                                // Lane 3: Zero Padding
-                                            current->block[2].oid,            // Lane 2: Order 2 ID
-                                            current->block[1].oid,            // Lane 1: Order 1 ID
-                                            current->block[0].oid             // Lane 0: Order 0 ID
-                                        );
-            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(target, oids)));
-            if (mask > 0 || true) {
-                for (uint32_t i = 0; i < 3; ++i) {
-                    if (current->block[i].oid == oid && (depth * 3) + i < level.num_orders) {
-                        inner_idx = i; target_block = current; found = true; break;
-                    }
+            for (uint32_t i = 0; i < 3; ++i) {
+                if (current->block[i].oid == oid && (depth * 3) + i < level.num_orders) {
+                    inner_idx = i; target_block = current; found = true; break;
                 }
-                if (found) break;
             }
+            if (found) break;
             current = current->next; depth++;
         }
         if (!found) return false;
@@ -0,0 +1,381 @@
+#ifndef ISADISPATCH_H_INCLUDED
+#define ISADISPATCH_H_INCLUDED
+
+/**
+ * IsaDispatch.h
+ *
+ * Runtime ISA dispatch driven by InstructionSet (PerfAnalysis.h).
+ *
+ * The build no longer needs -march=native: every SIMD kernel is compiled for
+ * its own ISA with [[gnu::target(...)]] and the widest variant the host (and
+ * OS, via XCR0) supports is picked ONCE at static-init time.  The same binary
+ * runs on the whole fleet and uses AVX-512 where it is there.
+ *
+ * Levels (each implies the ones below it):
+ *   Scalar  - plain x86-64 (SSE2 baseline)
+ *   SSE42   - SSSE3/SSE4.1/SSE4.2 + POPCNT
+ *   AVX2    - AVX2 + BMI1/BMI2, OS saves ymm state
+ *   AVX512  - AVX-512 F/BW/VL/DQ, OS saves zmm/opmask state
+ *
+ * Setting ISA_FORCE=scalar|sse42|avx2|avx512 in the environment caps the level
+ * (it can never raise it above what the host supports) -- use it to run the
+ * fallback paths on a modern box or to A/B variants in production.
+ *
+ * Two dispatch granularities are used:
+ *   - small container kernels (below) are called through a const function
+ *     pointer resolved at startup; the call is direct-predicted and costs a
+ *     couple of cycles next to the cache misses these kernels sit behind.
+ *   - the ITCH decoders are dispatched once per datagram: the whole parse loop
+ *     is instantiated per ISA so the decoders still inline (itch5_avx.h).
+ *
+ * Function pointers declared here are inline variables, initialised in header
+ * order after g_isa.  Do not call them from another static initialiser.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+#include "PerfAnalysis.h"
+
+namespace ISADISPATCH
+{
+
+enum class Isa : uint8_t { Scalar, SSE42, AVX2, AVX512, NumIsa };
+
+inline constexpr const char* isa_names[]{"scalar", "sse4.2", "avx2", "avx512"};
+
+inline const char* isa_name(const Isa i) { return isa_names[static_cast<size_t>(i)]; }
+
+/// widest level this host and OS can run
+inline Isa isa_detect() noexcept
+{
+    const bool sse42{InstructionSet::SSSE3() && InstructionSet::SSE41() && InstructionSet::SSE42() && InstructionSet::POPCNT()};
+    const bool avx2{sse42 && InstructionSet::AVX() && InstructionSet::AVX2() && InstructionSet::BMI1()
+                    && InstructionSet::BMI2() && InstructionSet::OSAVX()};
+    const bool avx512{avx2 && InstructionSet::AVX512F() && InstructionSet::AVX512BW() && InstructionSet::AVX512VL()
+                      && InstructionSet::AVX512DQ() && InstructionSet::OSAVX512()};
+
+    if(avx512) return Isa::AVX512;
+    if(avx2)   return Isa::AVX2;
+    if(sse42)  return Isa::SSE42;
+    return Isa::Scalar;
+}
+
+/// detected level, optionally capped by ISA_FORCE
+inline Isa isa_select() noexcept
+{
+    const Isa det{isa_detect()};
+
+    const char* env{std::getenv("ISA_FORCE")};
+    if(env == nullptr)
+        return det;
+
+    for(size_t i = 0; i < static_cast<size_t>(Isa::NumIsa); ++i)
+    {
+        if(std::strcmp(env, isa_names[i]) == 0 || (i == 1 && std::strcmp(env, "sse42") == 0))
+            return static_cast<Isa>(i) < det ? static_cast<Isa>(i) : det;
+    }
+
+    return det;
+}
+
+/// the level the whole process runs at, fixed at startup
+inline const Isa g_isa{isa_select()};
+
+/// AVX-512 VBMI (VPERMB) on top of the AVX512 level; not part of the level
+/// itself, since Skylake-X and Cascade Lake run AVX-512 without it
+inline const bool g_vbmi{g_isa >= Isa::AVX512 && InstructionSet::AVX512VBMI()};
+
+/// one slot per level; a null slot falls back to the next level down
+template<typename Fn>
+struct IsaVariants
+{
+    Fn* v[static_cast<size_t>(Isa::NumIsa)];
+
+    constexpr Fn* pick(const Isa want) const noexcept
+    {
+        for(int i = static_cast<int>(want); i >= 0; --i)
+            if(v[i] != nullptr)
+                return v[i];
+        return nullptr;
+    }
+};
+
+template<typename Fn>
+inline Fn* isa_pick(const IsaVariants<Fn>& vs, const Isa want = g_isa) noexcept
+{
+    return vs.pick(want);
+}
+
+
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+/// ChunkyBucketMap: tag + key match inside one IndexChunk
+///   tags : 32-byte aligned control bytes (only [0-3] are slots)
+///   keys : 32-byte aligned uint64_t[4]
+/// returns the slot whose key matches, -1 if none (a tag hit is required first)
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+using ChunkMatchFn = int(const uint8_t* tags, const uint64_t* keys, uint8_t h2, uint64_t key) noexcept;
+using ChunkFreeMaskFn = uint32_t(const uint8_t* tags) noexcept;
+
+inline constexpr uint8_t chunk_tag_deleted{0xFE};/// TAG_EMPTY = 0xFF, so free <=> tag >= 0xFE
+
+inline int chunk_match_scalar(const uint8_t* tags, const uint64_t* keys, const uint8_t h2, const uint64_t key) noexcept
+{
+    if(tags[0] != h2 && tags[1] != h2 && tags[2] != h2 && tags[3] != h2)
+        return -1;
+
+    for(int i = 0; i < 4; ++i)
+        if(keys[i] == key)
+            return i;
+
+    return -1;
+}
+
+[[gnu::target("sse4.2")]]
+inline int chunk_match_sse42(const uint8_t* tags, const uint64_t* keys, const uint8_t h2, const uint64_t key) noexcept
+{
+    const __m128i tag_lane{_mm_load_si128(reinterpret_cast<const __m128i*>(tags))};
+    if((_mm_movemask_epi8(_mm_cmpeq_epi8(tag_lane, _mm_set1_epi8(static_cast<char>(h2)))) & 0xF) == 0)
+        return -1;
+
+    const __m128i k{_mm_set1_epi64x(static_cast<long long>(key))};
+    const int lo{_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_mm_load_si128(reinterpret_cast<const __m128i*>(keys)), k)))};
+    const int hi{_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_mm_load_si128(reinterpret_cast<const __m128i*>(keys+2)), k)))};
+    const int m{lo | (hi << 2)};
+
+    return m ? __builtin_ctz(m) : -1;
+}
+
+[[gnu::target("avx2")]]
+inline int chunk_match_avx2(const uint8_t* tags, const uint64_t* keys, const uint8_t h2, const uint64_t key) noexcept
+{
+    const __m256i tag_lane{_mm256_load_si256(reinterpret_cast<const __m256i*>(tags))};
+    const __m256i tag_match{_mm256_cmpeq_epi8(tag_lane, _mm256_set1_epi8(static_cast<char>(h2)))};
+    if((static_cast<uint32_t>(_mm256_movemask_epi8(tag_match)) & 0xF) == 0)
+        return -1;
+
+    const __m256i key_lane{_mm256_load_si256(reinterpret_cast<const __m256i*>(keys))};
+    const __m256i key_match{_mm256_cmpeq_epi64(key_lane, _mm256_set1_epi64x(static_cast<long long>(key)))};
+    const uint32_t key_mask{static_cast<uint32_t>(_mm256_movemask_epi8(key_match))};
+
+    return key_mask ? __builtin_ctz(key_mask) / 8 : -1;
+}
+
+/// AVX-512 VL/BW: compares straight into opmask registers, no movemask/ctz/8
+[[gnu::target("avx512f,avx512bw,avx512vl")]]
+inline int chunk_match_avx512(const uint8_t* tags, const uint64_t* keys, const uint8_t h2, const uint64_t key) noexcept
+{
+    const __mmask16 tag_mask{_mm_mask_cmpeq_epi8_mask(0xF, _mm_load_si128(reinterpret_cast<const __m128i*>(tags)),
+                                                      _mm_set1_epi8(static_cast<char>(h2)))};
+    if(tag_mask == 0)
+        return -1;
+
+    const __mmask8 key_mask{_mm256_cmpeq_epi64_mask(_mm256_load_si256(reinterpret_cast<const __m256i*>(keys)),
+                                                    _mm256_set1_epi64x(static_cast<long long>(key)))};
+
+    return key_mask ? __builtin_ctz(key_mask) : -1;
+}
+
+/// 4-bit mask of slots whose tag is EMPTY or DELETED
+inline uint32_t chunk_free_mask_scalar(const uint8_t* tags) noexcept
+{
+    return  static_cast<uint32_t>(tags[0] >= chunk_tag_deleted)
+         | (static_cast<uint32_t>(tags[1] >= chunk_tag_deleted) << 1)
+         | (static_cast<uint32_t>(tags[2] >= chunk_tag_deleted) << 2)
+         | (static_cast<uint32_t>(tags[3] >= chunk_tag_deleted) << 3);
+}
+
+[[gnu::target("sse4.2")]]
+inline uint32_t chunk_free_mask_sse42(const uint8_t* tags) noexcept
+{
+    /// unsigned t >= 0xFE  <=>  max(t, 0xFE) == t
+    const __m128i t{_mm_load_si128(reinterpret_cast<const __m128i*>(tags))};
+    const __m128i ge{_mm_cmpeq_epi8(_mm_max_epu8(t, _mm_set1_epi8(static_cast<char>(chunk_tag_deleted))), t)};
+    return static_cast<uint32_t>(_mm_movemask_epi8(ge)) & 0xF;
+}
+
+[[gnu::target("avx2")]]
+inline uint32_t chunk_free_mask_avx2(const uint8_t* tags) noexcept
+{
+    const __m256i tag_lane{_mm256_load_si256(reinterpret_cast<const __m256i*>(tags))};
+    const __m256i empty_v{_mm256_cmpeq_epi8(tag_lane, _mm256_set1_epi8(static_cast<char>(0xFF)))};
+    const __m256i tomb_v{_mm256_cmpeq_epi8(tag_lane, _mm256_set1_epi8(static_cast<char>(chunk_tag_deleted)))};
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(empty_v, tomb_v))) & 0xF;
+}
+
+[[gnu::target("avx512f,avx512bw,avx512vl")]]
+inline uint32_t chunk_free_mask_avx512(const uint8_t* tags) noexcept
+{
+    return _mm_mask_cmpge_epu8_mask(0xF, _mm_load_si128(reinterpret_cast<const __m128i*>(tags)),
+                                    _mm_set1_epi8(static_cast<char>(chunk_tag_deleted)));
+}
+
+inline ChunkMatchFn* const k_chunk_match{isa_pick<ChunkMatchFn>({{
+    &chunk_match_scalar, &chunk_match_sse42, &chunk_match_avx2, &chunk_match_avx512}})};
+
+inline ChunkFreeMaskFn* const k_chunk_free_mask{isa_pick<ChunkFreeMaskFn>({{
+    &chunk_free_mask_scalar, &chunk_free_mask_sse42, &chunk_free_mask_avx2, &chunk_free_mask_avx512}})};
+
+
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+/// ChunkedPriceBook: insert position in a sorted uint32_t price array
+///   bids are descending, asks ascending; compares are signed as in the original AVX2 code
+///   prices must be readable (zero padded) up to the next multiple of 8 past count; the
+///   AVX-512 variant masks its tail load and never reads past count
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+using PriceInsertFn = uint32_t(const uint32_t* prices, uint32_t count, uint32_t price, bool& exists) noexcept;
+
+template<bool IsBid>
+inline uint32_t price_insert_index_scalar(const uint32_t* prices, const uint32_t count, const uint32_t price, bool& exists) noexcept
+{
+    const int32_t p{static_cast<int32_t>(price)};
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const int32_t c{static_cast<int32_t>(prices[i])};
+        if(c == p)
+        {
+            exists = true;
+            return i;
+        }
+        if(IsBid ? p > c : c > p)
+        {
+            exists = false;
+            return i;
+        }
+    }
+
+    exists = false;
+    return count;
+}
+
+template<bool IsBid>
+[[gnu::target("sse4.2")]]
+inline uint32_t price_insert_index_sse42(const uint32_t* prices, const uint32_t count, const uint32_t price, bool& exists) noexcept
+{
+    const __m128i target{_mm_set1_epi32(static_cast<int>(price))};
+
+    for(uint32_t i = 0; i < count; i += 4)
+    {
+        const __m128i cur{_mm_load_si128(reinterpret_cast<const __m128i*>(prices + i))};
+
+        const int eq_mask{_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(target, cur)))};
+        if(eq_mask)
+        {
+            exists = true;
+            return i + __builtin_ctz(eq_mask);
+        }
+
+        const __m128i gt{IsBid ? _mm_cmpgt_epi32(target, cur) : _mm_cmpgt_epi32(cur, target)};
+        const int gt_mask{_mm_movemask_ps(_mm_castsi128_ps(gt))};
+        if(gt_mask)
+        {
+            exists = false;
+            return i + __builtin_ctz(gt_mask);
+        }
+    }
+
+    exists = false;
+    return count;
+}
+
+template<bool IsBid>
+[[gnu::target("avx2")]]
+inline uint32_t price_insert_index_avx2(const uint32_t* prices, const uint32_t count, const uint32_t price, bool& exists) noexcept
+{
+    const __m256i target{_mm256_set1_epi32(static_cast<int>(price))};
+
+    for(uint32_t i = 0; i < count; i += 8)
+    {
+        const __m256i cur{_mm256_load_si256(reinterpret_cast<const __m256i*>(prices + i))};
+
+        const int eq_mask{_mm256_movemask_epi8(_mm256_cmpeq_epi32(target, cur))};
+        if(eq_mask)
+        {
+            exists = true;
+            return i + (__builtin_ctz(eq_mask) >> 2);
+        }
+
+        const __m256i gt{IsBid ? _mm256_cmpgt_epi32(target, cur) : _mm256_cmpgt_epi32(cur, target)};
+        const int gt_mask{_mm256_movemask_epi8(gt)};
+        if(gt_mask)
+        {
+            exists = false;
+            return i + (__builtin_ctz(gt_mask) >> 2);
+        }
+    }
+
+    exists = false;
+    return count;
+}
+
+template<bool IsBid>
+[[gnu::target("avx512f,avx512bw,avx512vl")]]
+inline uint32_t price_insert_index_avx512(const uint32_t* prices, const uint32_t count, const uint32_t price, bool& exists) noexcept
+{
+    const __m512i target{_mm512_set1_epi32(static_cast<int>(price))};
+
+    for(uint32_t i = 0; i < count; i += 16)
+    {
+        const uint32_t left{count - i};
+        const __mmask16 valid{left >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << left) - 1)};
+        const __m512i cur{_mm512_maskz_loadu_epi32(valid, prices + i)};
+
+        const __mmask16 eq{_mm512_mask_cmpeq_epi32_mask(valid, target, cur)};
+        const __mmask16 gt{IsBid ? _mm512_mask_cmpgt_epi32_mask(valid, target, cur)
+                                 : _mm512_mask_cmpgt_epi32_mask(valid, cur, target)};
+
+        /// sorted input: the first eq or gt lane is the answer, whichever comes first
+        const __mmask16 any{static_cast<__mmask16>(eq | gt)};
+        if(any)
+        {
+            const uint32_t lane{static_cast<uint32_t>(__builtin_ctz(any))};
+            exists = (eq >> lane) & 1;
+            return i + lane;
+        }
+    }
+
+    exists = false;
+    return count;
+}
+
+inline PriceInsertFn* const k_price_insert_bid{isa_pick<PriceInsertFn>({{
+    &price_insert_index_scalar<true>, &price_insert_index_sse42<true>,
+    &price_insert_index_avx2<true>, &price_insert_index_avx512<true>}})};
+
+inline PriceInsertFn* const k_price_insert_ask{isa_pick<PriceInsertFn>({{
+    &price_insert_index_scalar<false>, &price_insert_index_sse42<false>,
+    &price_insert_index_avx2<false>, &price_insert_index_avx512<false>}})};
+
+
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Int64SparsePagedLadder: clear one 32-byte aligned PrcLevelGeneric
+/// AVX-512 has nothing to add for 32 bytes, so that level uses the AVX2 store
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+using Zero32Fn = void(void* p) noexcept;
+
+inline void zero32_scalar(void* p) noexcept
+{
+    std::memset(p, 0, 32);
+}
+
+[[gnu::target("sse4.2")]]
+inline void zero32_sse42(void* p) noexcept
+{
+    _mm_store_si128(static_cast<__m128i*>(p), _mm_setzero_si128());
+    _mm_store_si128(static_cast<__m128i*>(p) + 1, _mm_setzero_si128());
+}
+
+[[gnu::target("avx2")]]
+inline void zero32_avx2(void* p) noexcept
+{
+    _mm256_store_si256(static_cast<__m256i*>(p), _mm256_setzero_si256());
+}
+
+inline Zero32Fn* const k_zero32{isa_pick<Zero32Fn>({{&zero32_scalar, &zero32_sse42, &zero32_avx2, nullptr}})};
+
+}//ISADISPATCH
+
+#endif // ISADISPATCH_H_INCLUDED
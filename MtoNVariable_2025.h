@@ -3,15 +3,28 @@
 
 ///to do:
 // cached w and r idx
-// N readers
 //returns a pointer to the data rather than a copy
 
-#include "Definitions.h"
-
-
-/// KMW  ??? are the below still true (12/2/25)
-///   * incomplete, has problem with setting widx_ to new value before data written
-///   * either zero out data chunk after reads (Aeron does this) or serialize the setting of widx_ and use a reserve_widx_
+#include <immintrin.h>      // _mm_pause
+
+#include "Useful.h"
+#include "TraceProbe.h"
+
+
+/// record layout: [len : size_t][data : len bytes], rounded up to whole cachelines, so every record
+/// (and every len word) starts on a cacheline boundary.  data may wrap past the end of buf_, the len never does.
+///
+///   widx_  : claimed by producers (CAS), the claim fails if it would overrun rdone_
+///   ridx_  : claimed by consumers (read1 stores it, readN CASes it)
+///   rdone_ : released by consumers, strictly in order; producers may reuse everything below it
+///
+/// a producer publishes a record by storing its len last (release).  a consumer waits on the len word
+/// itself rather than on widx_, because widx_ moves when the space is claimed, before the data is written;
+/// readN also checks widx_ first, so it never reads a len word no producer has claimed yet.
+/// released records are zeroed at every cacheline start (Aeron does the same), so a len word is either 0
+/// (not yet published) or the len of the record that starts there -- never a stale len from an earlier lap.
+///
+/// read1 is for a single consumer; readN for any number of consumers.  do not mix them on one queue.
 namespace MKTDATASYSTEM::CONTAINERS
 {
 
@@ -20,9 +33,11 @@ struct MtoNVariable_2025 final
     MtoNVariable_2025(const size_t num_bytes);
     ~MtoNVariable_2025();
 
-    bool write(const char* d, const size_t len) noexcept;
-    void read1(char* d, size_t& len) noexcept;
-    void readN(char* d, size_t& len) noexcept;
+    bool write(const char* d, const size_t len) noexcept;/// false if len is 0, too large or the queue is full
+    void read1(char* d, size_t& len) noexcept;/// blocks until a record is available
+    void readN(char* d, size_t& len) noexcept;/// len == 0 means nothing read
+
+    size_t cap() const {return cap_;}
 
 private:
     const size_t cap_;
@@ -32,53 +47,52 @@ private:
 
     alignas(2*cacheline_size_bytes) atomic<size_t> widx_{};
     alignas(2*cacheline_size_bytes) atomic<size_t> ridx_{};
+    alignas(2*cacheline_size_bytes) atomic<size_t> rdone_{};
 
-    size_t get_widx(const size_t len) noexcept;
+    static size_t need_bytes(const size_t len) noexcept;
+    bool get_widx(const size_t len, size_t& widx) noexcept;
+    atomic_ref<size_t> len_at(const size_t relative_idx) noexcept;
+    void copy_out(const size_t relative_ridx, char* d, const size_t len) noexcept;
+    void release(const size_t ridx, const size_t need) noexcept;
 };
 
-size_t MtoNVariable_2025::get_widx(const size_t bytes) noexcept
+size_t MtoNVariable_2025::need_bytes(const size_t len) noexcept
 {
-    const size_t need{roundup_bytes.template operator()<cacheline_size_bytes>(sizeof_len + bytes)};
+    return roundupto.template operator()<cacheline_size_bytes>(sizeof_len + len);
+}
 
-    size_t expected_widx{}, new_widx{};
-    bool try_this{};
+atomic_ref<size_t> MtoNVariable_2025::len_at(const size_t relative_idx) noexcept
+{
+    return atomic_ref<size_t>(*reinterpret_cast<size_t*>(&buf_[relative_idx]));
+}
+
+bool MtoNVariable_2025::get_widx(const size_t bytes, size_t& widx) noexcept
+{
+    const size_t need{need_bytes(bytes)};
+
+    size_t expected_widx{widx_.load(memory_order_acquire)};
 
     /// false sharing
-    /// write at end or start at beginning
     /// slow reader
     do
     {
-        expected_widx = widx_.load(memory_order_acquire);
-        const size_t curr_ridx = ridx_.load(memory_order_acquire); /// use cached
-
-     //   const size_t relative_widx{expected_widx & mask_};
+        const size_t curr_rdone = rdone_.load(memory_order_acquire); /// use cached
 
-       /* size_t end_offset{};
+        ///slow read check: never claim space a consumer has not released yet
+        if(expected_widx + need - curr_rdone > cap_)
+            return false;
 
-        /// can it fit at end? if not, write at beginning
-        if(relative_widx + need > cap_)
-        {
-            end_offset = cap_ - relative_widx;
-        }
-        */
+        CONTENTION_COUNT(cas_attempts);
 
-        try_this = false;
+    }while(widx_.compare_exchange_weak(expected_widx, expected_widx + need, memory_order_acq_rel, memory_order_acquire) == false
+           && (CONTENTION_COUNT(cas_failures), true));
 
-        ///slow read check
-        if(expected_widx + need /*+ end_offset*/ - curr_ridx <= cap_ )
-        {
-            new_widx = expected_widx + need;
-          //  new_widx = roundup_bytes<cacheline_size>(new_widx);/// round up to next cacheline
-            try_this = true;
-        }
-
-    }while(try_this && widx_.compare_exchange_weak(expected_widx, new_widx) == false);
-
-    return expected_widx;
+    widx = expected_widx;
+    return true;
 }
 
 MtoNVariable_2025::MtoNVariable_2025(const size_t num_bytes) :
-    cap_(roundup_bytes_pow2.template operator()<cacheline_size_bytes>(num_bytes)), mask_(cap_-1)
+    cap_(powof2(num_bytes, cacheline_size_bytes)), mask_(cap_-1)
 {
     buf_ = new (std::align_val_t(page_size_bytes)) char[cap_]{};
 }
@@ -91,67 +105,121 @@ MtoNVariable_2025::~MtoNVariable_2025()
 
 bool MtoNVariable_2025::write(const char* d, const size_t len) noexcept
 {
-    if(len > cap_) return false;
+    if(len == 0 || len > cap_ - sizeof_len) return false;
+
+    size_t widx{};
+    if(get_widx(len, widx) == false)
+    {
+        CONTENTION_COUNT(prod_spins);
+        return false;
+    }
 
-    const size_t widx{get_widx(len)};
     const size_t relative_widx{widx & mask_};
+    const size_t frst{cap_ - (relative_widx + sizeof_len)};/// data bytes that fit before the end of buf_
 
-    if(relative_widx + len < cap_)[[likely]]///single write
+    if(len <= frst)[[likely]]///single write
     {
         memcpy(&buf_[relative_widx+sizeof_len], d, len);
     }
     else
     {
-        auto frst{cap_ - (relative_widx +sizeof_len)};
         memcpy(&buf_[relative_widx+sizeof_len], d, frst);
-        memcpy(&buf_[0], &d[frst+sizeof_len], len-frst);
+        memcpy(&buf_[0], &d[frst], len-frst);
     }
 
     /// the above must be completed before writing the len
-    atomic_thread_fence(memory_order_release);
-
-    memcpy(&buf_[relative_widx], static_cast<const void*>(&len), sizeof_len);/// always at least a cacheline available
+    len_at(relative_widx).store(len, memory_order_release);/// always at least a cacheline available
 
-#if 1
-    cout << "\n in Queue write: " << __FILE__ << ":" << __LINE__ << " : len, relative_widx, cap, buf_ = " << len << ", " << relative_widx << ", " << cap_ << endl;
-    for(int i = relative_widx; i < relative_widx+len; ++i)
-        cout << buf_[i];
+    TRACE_MARK(QueueProd, len);
 
-    cout << endl;
-#endif
     return true;
 }
 
-/// ??? zero out data on buf_ after read. it will prevent erroneous data being read in the future
-void MtoNVariable_2025::read1(char* d, size_t& len) noexcept
+void MtoNVariable_2025::copy_out(const size_t relative_ridx, char* d, const size_t len) noexcept
 {
-    auto curr_ridx{ridx_.load(memory_order_acquire)};
-    auto curr_widx{widx_.load(memory_order_acquire)};///use cached value
-
-    while(curr_ridx == curr_widx)
-    {
-        curr_widx = widx_.load(memory_order_acquire);
-    }
-//cout << "\n in Queue read1: " << __FILE__ << ":" << __LINE__ << " : curr_ridx, curr_widx = " << curr_ridx << ", " << curr_widx << endl;
-    const size_t relative_ridx{curr_ridx & mask_};
-
-    memcpy(static_cast<void*>(&len), &buf_[relative_ridx], sizeof_len);
-
-//cout << "\n in Queue read1: " << __FILE__ << ":" << __LINE__ << " : len, relative_ridx, cap_ = " << len << ", " << relative_ridx << ", " << cap_ << endl;
+    const size_t frst{cap_ - (relative_ridx + sizeof_len)};
 
     /// possible write that overlaps to beginning of buf_
-    if(len <= (cap_ - (relative_ridx+sizeof_len)))[[likely]]
+    if(len <= frst)[[likely]]
     {
         memcpy(d, &buf_[relative_ridx+sizeof_len], len);
     }
     else
     {
-        auto frst{cap_ - (relative_ridx +sizeof_len)};
         memcpy(d, &buf_[relative_ridx+sizeof_len], frst);
         memcpy(d+frst, &buf_[0], len - frst);
     }
+}
+
+/// zero the len word position of every cacheline in the record, then hand the space back to the producers
+/// in record order: a consumer that finished early waits for the ones claimed before it
+void MtoNVariable_2025::release(const size_t ridx, const size_t need) noexcept
+{
+    for(size_t off = 0; off < need; off += cacheline_size_bytes)
+        len_at((ridx + off) & mask_).store(0, memory_order_relaxed);
+
+    while(rdone_.load(memory_order_acquire) != ridx)
+    {
+        CONTENTION_COUNT(cons_spins);
+        _mm_pause();
+    }
+
+    rdone_.store(ridx + need, memory_order_release);
+}
+
+void MtoNVariable_2025::read1(char* d, size_t& len) noexcept
+{
+    const size_t curr_ridx{ridx_.load(memory_order_relaxed)};
+    const size_t relative_ridx{curr_ridx & mask_};
+
+    while((len = len_at(relative_ridx).load(memory_order_acquire)) == 0)
+    {
+        CONTENTION_COUNT(cons_spins);
+        _mm_pause();
+    }
+
+    copy_out(relative_ridx, d, len);
+
+    const size_t need{need_bytes(len)};
+    ridx_.store(curr_ridx + need, memory_order_relaxed);
+    release(curr_ridx, need);
+
+    TRACE_MARK(QueueCons, len);
+}
+
+/// the len is read before the claim, so it can be stale when another consumer gets there first;
+/// the CAS then fails because ridx_ has moved on, and a successful CAS means the record was not released
+/// (so not rewritten) in between.  stale reads can land inside a record being written -- harmless on x86,
+/// the value is discarded with the failed CAS.
+///
+/// the len word is only trusted once a producer has claimed curr_ridx (curr_ridx < widx_).  a claim
+/// needs rdone_ past the previous lap's record there, and release() zeroes before it moves rdone_, so
+/// the acquire on widx_ orders the read after that zeroing.  without it, a consumer at the wrapped
+/// head could read the len of a record another consumer is still copying out (not zeroed yet), win
+/// the CAS and return a record that was never written.
+void MtoNVariable_2025::readN(char* d, size_t& len) noexcept
+{
+    size_t curr_ridx{ridx_.load(memory_order_acquire)};
+
+    do
+    {
+        len = 0;
+        if(curr_ridx >= widx_.load(memory_order_acquire))
+            return;/// nothing claimed at the head
+
+        len = len_at(curr_ridx & mask_).load(memory_order_acquire);
+        if(len == 0)
+            return;/// nothing published at the head
+
+        CONTENTION_COUNT(cas_attempts);
+
+    }while(ridx_.compare_exchange_weak(curr_ridx, curr_ridx + need_bytes(len), memory_order_acq_rel, memory_order_acquire) == false
+           && (CONTENTION_COUNT(cas_failures), true));
+
+    copy_out(curr_ridx & mask_, d, len);
+    release(curr_ridx, need_bytes(len));
 
-    ridx_.store(roundup_bytes.template operator()<cacheline_size_bytes>(curr_ridx + sizeof_len + len), memory_order_release);
+    TRACE_MARK(QueueCons, len);
 }
 
 void test_m2nvariable_1()
@@ -1,6 +1,26 @@
 #ifndef PERFANALYSIS_H_INCLUDED
 #define PERFANALYSIS_H_INCLUDED
 
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>      // __rdtscp, __rdtsc
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 template<typename CLOCK = std::chrono::steady_clock>//std::chrono::high_resolution_clock
 class stopwatch
 {
@@ -54,7 +74,7 @@ class stopwatch_hr
         uint32_t ui;
         start_time = __rdtscp(&ui);
 
-        cout << "\n TSC_AUX was : " << ui << endl;
+        std::cout << "\n TSC_AUX was : " << ui << std::endl;
         calls++;
     };
 
@@ -77,10 +97,187 @@ class stopwatch_hr
     };
 };
 
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+/// perf_counters: hardware counter group via perf_event_open (Linux)
+///   cycles, instructions, L1D read misses, LLC read misses, dTLB read misses, branch misses
+///   used like stopwatch: start()/stop() around a region accumulate, per_op() normalises.
+///   all events are in one group (leader = cycles) so they are scheduled together; if the PMU
+///   has to multiplex, counts are scaled by time_enabled/time_running.
+///   user space only (exclude_kernel), so perf_event_paranoid <= 2 is enough.
+///   counters the kernel/PMU cannot open (VMs, older CPUs) read as 0 and are flagged, never fatal.
+/// //////////////////////////////////////////////////////////////////////////////////////////////////////
+class perf_counters
+{
+  public:
+    enum counter : int { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+    static constexpr const char* counter_names[NUM_COUNTERS]{"cycles", "instr", "L1D-miss", "LLC-miss", "dTLB-miss", "br-miss"};
+
+    uint64_t totals[NUM_COUNTERS]{};
+    uint64_t calls{0};
+
+#if defined(__linux__)
+    perf_counters()
+    {
+        auto cache_event = [](const uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        const std::pair<uint32_t, uint64_t> events[NUM_COUNTERS]{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL)},
+            {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+        {
+            perf_event_attr attr{};
+            attr.size           = sizeof(attr);
+            attr.type           = events[i].first;
+            attr.config         = events[i].second;
+            attr.disabled       = (leader_ < 0);///only the leader starts disabled, members follow it
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            fd_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+            if(fd_[i] < 0)
+            {
+                if(errno_ == 0) errno_ = errno;
+                continue;
+            }
+            ioctl(fd_[i], PERF_EVENT_IOC_ID, &id_[i]);
+            if(leader_ < 0)
+                leader_ = fd_[i];
+        }
+    }
+
+    ~perf_counters()
+    {
+        for(const int fd : fd_)
+            if(fd >= 0) close(fd);
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    inline bool available() const { return leader_ >= 0; }
+    inline bool available(const counter c) const { return fd_[c] >= 0; }
+    inline int open_error() const { return errno_; }
+
+    inline void start()
+    {
+        if(leader_ < 0) return;
+        read_group(start_);
+        ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        calls++;
+    };
+
+    inline void stop()
+    {
+        if(leader_ < 0) return;
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t end[NUM_COUNTERS];
+        read_group(end);
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+            totals[i] += end[i] - start_[i];
+    };
+#else
+    inline bool available() const { return false; }
+    inline bool available(const counter) const { return false; }
+    inline int open_error() const { return 0; }
+    inline void start() {}
+    inline void stop() {}
+#endif
+
+    inline void reset() {
+      for(auto& t : totals) t = 0;
+      calls = 0;
+    }
+
+    inline uint64_t count(const counter c) const {
+      return totals[c];
+    };
+
+    // return count per operation
+    inline double per_op(const counter c, const uint64_t ops) const {
+      return ops ? static_cast<double>(totals[c]) / ops : 0.0;
+    };
+
+    inline double ipc() const {
+      return totals[CYCLES] ? static_cast<double>(totals[INSTRUCTIONS]) / totals[CYCLES] : 0.0;
+    };
+
+    /// one line: "<label> cycles/op instr/op ... IPC"; counters that failed to open print "n/a"
+    void print(std::ostream& os, const char* label, const uint64_t ops) const
+    {
+        os << label;
+        if(!available())
+        {
+            os << " [perf counters unavailable, errno " << open_error() << "]\n";
+            return;
+        }
+        char buf[32];
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+        {
+            if(available(static_cast<counter>(i)))
+                snprintf(buf, sizeof(buf), " %9.3f %s/op", per_op(static_cast<counter>(i), ops), counter_names[i]);
+            else
+                snprintf(buf, sizeof(buf), " %9s %s/op", "n/a", counter_names[i]);
+            os << buf;
+        }
+        snprintf(buf, sizeof(buf), "  IPC %.2f\n", ipc());
+        os << buf;
+    }
+
+  private:
+#if defined(__linux__)
+    int      fd_[NUM_COUNTERS]{-1, -1, -1, -1, -1, -1};
+    uint64_t id_[NUM_COUNTERS]{};
+    uint64_t start_[NUM_COUNTERS]{};
+    int      leader_{-1};
+    int      errno_{0};
+
+    /// read the whole group in one syscall, map values back by id, scale for multiplexing
+    void read_group(uint64_t (&out)[NUM_COUNTERS]) const
+    {
+        struct { uint64_t nr, time_enabled, time_running; struct { uint64_t value, id; } v[NUM_COUNTERS]; } data{};
+        for(auto& o : out) o = 0;
+        if(::read(leader_, &data, sizeof(data)) <= 0)
+            return;
+
+        const double scale = (data.time_running && data.time_running < data.time_enabled)
+                             ? static_cast<double>(data.time_enabled) / data.time_running : 1.0;
+        for(uint64_t j = 0; j < data.nr && j < NUM_COUNTERS; ++j)
+            for(int i = 0; i < NUM_COUNTERS; ++i)
+                if(fd_[i] >= 0 && id_[i] == data.v[j].id)
+                    out[i] = static_cast<uint64_t>(data.v[j].value * scale);
+    }
+#endif
+};
+
+/// RAII region: counts from construction to destruction into an existing perf_counters
+///   { perf_scope ps(pc); hot_loop(); }   pc.print(std::cout, "hot_loop", n);
+class perf_scope
+{
+  public:
+    explicit perf_scope(perf_counters& pc) : pc_(pc) { pc_.start(); }
+    ~perf_scope() { pc_.stop(); }
+
+    perf_scope(const perf_scope&) = delete;
+    perf_scope& operator=(const perf_scope&) = delete;
+
+  private:
+    perf_counters& pc_;
+};
+
 // InstructionSet.cpp
 // Compile by using: cl /EHsc /W4 InstructionSet.cpp
+//               or: g++ -std=c++20 (no -march needed, cpuid.h is always available)
 // processor: x86, x64
-// Uses the __cpuid intrinsic to get information about
+// Uses the __cpuid intrinsic (MSVC) or GCC's <cpuid.h> to get information about
 // CPU extended instruction set support.
 
 #include <iostream>
@@ -88,8 +285,34 @@ class stopwatch_hr
 #include <bitset>
 #include <array>
 #include <string>
+#include <cstring>
+
+#if defined(_MSC_VER)
 #include <intrin.h>
 
+inline void cpuid_ex(int* info, const int leaf, const int subleaf) { __cpuidex(info, leaf, subleaf); }
+inline uint64_t xgetbv_0() { return _xgetbv(0); }
+#else
+#include <cpuid.h>
+
+/// GCC's __cpuid is a 5-arg macro, so wrap the leaf/subleaf form to keep the MSVC calling shape
+inline void cpuid_ex(int* info, const int leaf, const int subleaf)
+{
+    unsigned a{}, b{}, c{}, d{};
+    __cpuid_count(static_cast<unsigned>(leaf), static_cast<unsigned>(subleaf), a, b, c, d);
+    info[0] = static_cast<int>(a); info[1] = static_cast<int>(b);
+    info[2] = static_cast<int>(c); info[3] = static_cast<int>(d);
+}
+
+/// raw XGETBV, so no -mxsave is needed to read XCR0
+inline uint64_t xgetbv_0()
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+#endif
+
 class InstructionSet
 {
     // forward declarations
@@ -136,14 +359,24 @@ public:
     static bool INVPCID(void) { return CPU_Rep.f_7_EBX_[10]; }
     static bool RTM(void) { return CPU_Rep.isIntel_ && CPU_Rep.f_7_EBX_[11]; }
     static bool AVX512F(void) { return CPU_Rep.f_7_EBX_[16]; }
+    static bool AVX512DQ(void) { return CPU_Rep.f_7_EBX_[17]; }
     static bool RDSEED(void) { return CPU_Rep.f_7_EBX_[18]; }
     static bool ADX(void) { return CPU_Rep.f_7_EBX_[19]; }
     static bool AVX512PF(void) { return CPU_Rep.f_7_EBX_[26]; }
     static bool AVX512ER(void) { return CPU_Rep.f_7_EBX_[27]; }
     static bool AVX512CD(void) { return CPU_Rep.f_7_EBX_[28]; }
     static bool SHA(void) { return CPU_Rep.f_7_EBX_[29]; }
+    static bool AVX512BW(void) { return CPU_Rep.f_7_EBX_[30]; }
+    static bool AVX512VL(void) { return CPU_Rep.f_7_EBX_[31]; }
 
     static bool PREFETCHWT1(void) { return CPU_Rep.f_7_ECX_[0]; }
+    static bool AVX512VBMI(void) { return CPU_Rep.f_7_ECX_[1]; }
+    static bool AVX512VBMI2(void) { return CPU_Rep.f_7_ECX_[6]; }
+
+    /// the CPUID bits only say the core has the unit; the OS must also save the
+    /// ymm (XCR0 bits 1,2) and zmm/opmask (XCR0 bits 5,6,7) state on context switch
+    static bool OSAVX(void) { return OSXSAVE() && (CPU_Rep.xcr0_ & 0x6) == 0x6; }
+    static bool OSAVX512(void) { return OSXSAVE() && (CPU_Rep.xcr0_ & 0xE6) == 0xE6; }
 
     static bool LAHF(void) { return CPU_Rep.f_81_ECX_[0]; }
     static bool LZCNT(void) { return CPU_Rep.isIntel_ && CPU_Rep.f_81_ECX_[5]; }
@@ -175,6 +408,7 @@ private:
             f_7_ECX_{ 0 },
             f_81_ECX_{ 0 },
             f_81_EDX_{ 0 },
+            xcr0_{ 0 },
             data_{},
             extdata_{}
         {
@@ -183,12 +417,12 @@ private:
 
             // Calling __cpuid with 0x0 as the function_id argument
             // gets the number of the highest valid function ID.
-            __cpuid(cpui.data(), 0);
+            cpuid_ex(cpui.data(), 0, 0);
             nIds_ = cpui[0];
 
             for (int i = 0; i <= nIds_; ++i)
             {
-                __cpuidex(cpui.data(), i, 0);
+                cpuid_ex(cpui.data(), i, 0);
                 data_.push_back(cpui);
             }
 
@@ -222,17 +456,23 @@ private:
                 f_7_ECX_ = data_[7][2];
             }
 
+            // XCR0 says which register state the OS saves; only readable if OSXSAVE
+            if (f_1_ECX_[27])
+            {
+                xcr0_ = xgetbv_0();
+            }
+
             // Calling __cpuid with 0x80000000 as the function_id argument
             // gets the number of the highest valid extended ID.
-            __cpuid(cpui.data(), 0x80000000);
-            nExIds_ = cpui[0];
+            cpuid_ex(cpui.data(), 0x80000000, 0);
+            nExIds_ = static_cast<unsigned>(cpui[0]);
 
             char brand[0x40];
             memset(brand, 0, sizeof(brand));
 
-            for (int i = 0x80000000; i <= nExIds_; ++i)
+            for (unsigned i = 0x80000000; i <= nExIds_; ++i)
             {
-                __cpuidex(cpui.data(), i, 0);
+                cpuid_ex(cpui.data(), i, 0);
                 extdata_.push_back(cpui);
             }
 
@@ -254,7 +494,7 @@ private:
         };
 
         int nIds_;
-        int nExIds_;
+        unsigned nExIds_;
         std::string vendor_;
         std::string brand_;
         bool isIntel_;
@@ -265,18 +505,20 @@ private:
         std::bitset<32> f_7_ECX_;
         std::bitset<32> f_81_ECX_;
         std::bitset<32> f_81_EDX_;
+        uint64_t xcr0_;
         std::vector<std::array<int, 4>> data_;
         std::vector<std::array<int, 4>> extdata_;
     };
 };
 
 // Initialize static member data
-const InstructionSet::InstructionSet_Internal InstructionSet::CPU_Rep;
+// inline: the header is included by more than one TU (IsaDispatch.h reads it at static init)
+inline const InstructionSet::InstructionSet_Internal InstructionSet::CPU_Rep;
 
 // Print out supported instruction set extensions
-int run_instructionset()
+inline int run_instructionset()
 {
-    cout << "\n run_instructionset" << endl;
+    std::cout << "\n run_instructionset" << std::endl;
 
     auto& outstream = std::cout;
 
@@ -297,6 +539,11 @@ int run_instructionset()
     support_message("AVX512CD",    InstructionSet::AVX512CD());
     support_message("AVX512ER",    InstructionSet::AVX512ER());
     support_message("AVX512F",     InstructionSet::AVX512F());
+    support_message("AVX512DQ",    InstructionSet::AVX512DQ());
+    support_message("AVX512BW",    InstructionSet::AVX512BW());
+    support_message("AVX512VL",    InstructionSet::AVX512VL());
+    support_message("AVX512VBMI",  InstructionSet::AVX512VBMI());
+    support_message("AVX512VBMI2", InstructionSet::AVX512VBMI2());
     support_message("AVX512PF",    InstructionSet::AVX512PF());
     support_message("BMI1",        InstructionSet::BMI1());
     support_message("BMI2",        InstructionSet::BMI2());
@@ -318,6 +565,8 @@ int run_instructionset()
     support_message("MOVBE",       InstructionSet::MOVBE());
     support_message("MSR",         InstructionSet::MSR());
     support_message("OSXSAVE",     InstructionSet::OSXSAVE());
+    support_message("OS AVX",      InstructionSet::OSAVX());
+    support_message("OS AVX512",   InstructionSet::OSAVX512());
     support_message("PCLMULQDQ",   InstructionSet::PCLMULQDQ());
     support_message("POPCNT",      InstructionSet::POPCNT());
     support_message("PREFETCHWT1", InstructionSet::PREFETCHWT1());
@@ -339,7 +588,9 @@ int run_instructionset()
     support_message("XOP",         InstructionSet::XOP());
     support_message("XSAVE",       InstructionSet::XSAVE());
 
-    cout << "\n end run_instructionset" << endl;
+    std::cout << "\n end run_instructionset" << std::endl;
+
+    return 0;
 }
 
 #endif // PERFANALYSIS_H_INCLUDED
@@ -2,6 +2,7 @@
 #define PRODCONSGENERIC_H_INCLUDED
 
 #include "Useful.h"
+#include "TraceProbe.h"
 
 namespace PRODCONSGENERIC
 {
@@ -53,6 +53,7 @@ bool ProdConsMPMCSlot<T,N,TOEXIT>::emplace_impl(T* pt) noexcept
 
     while(2*(my_widx/sz_) != my_slot.wr_rd.load(memory_order_acquire))
     {
+        CONTENTION_COUNT(prod_spins);
         if(TOEXIT() == true)
             return false;
     }
@@ -61,6 +62,8 @@ bool ProdConsMPMCSlot<T,N,TOEXIT>::emplace_impl(T* pt) noexcept
 
     my_slot.wr_rd.store(2*(my_widx/sz_) + 1, memory_order_release);
 
+    TRACE_MARK(QueueProd, my_widx);
+
     return true;
 }
 
@@ -75,6 +78,7 @@ bool ProdConsMPMCSlot<T,N,TOEXIT>::cons(T& t) noexcept
 
     while(2*(my_ridx/sz_) + 1 != my_slot.wr_rd.load(memory_order_acquire))
     {
+        CONTENTION_COUNT(cons_spins);
         /// can get caught in this loop waiting indefinitely, so, allow for an exit request
         if(TOEXIT() == true)
             return false;
@@ -86,6 +90,8 @@ bool ProdConsMPMCSlot<T,N,TOEXIT>::cons(T& t) noexcept
 
     my_slot.wr_rd.store(2*(my_ridx/sz_) + 2, memory_order_release);
 
+    TRACE_MARK(QueueCons, my_ridx);
+
     return true;
 }
 
@@ -119,6 +119,8 @@ bool ProdConsSPSCVariable<T,N>::prod(const char* p, uint32_t len) noexcept
         widx_.store(curr_widx + to_wrt_len + bytes_consumed, memory_order_release);
     }
 
+    TRACE_MARK(QueueProd, len);
+
     return true;
 }
 
@@ -170,6 +172,8 @@ void ProdConsSPSCVariable<T,N>::cons(char* p, uint32_t& len) noexcept
 
         ridx_.store(curr_ridx + roundupto.template operator()<cacheline_size_bytes>(len), memory_order_release);
     }
+
+    TRACE_MARK(QueueCons, len);
 }
 
 void test_spscvariable_1()
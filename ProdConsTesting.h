@@ -41,7 +41,7 @@ struct ProdConsTester
 
     void producer(int core, int pidx, deque<D> ds)
     {
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         cout << "core, pidx = " << core << ", " << pidx << endl;
 
@@ -62,7 +62,7 @@ struct ProdConsTester
     void consumer(int core, const int cons)
     {
       //  int core = 5;
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         int i{};
         while(exit == false )
@@ -95,21 +95,21 @@ struct ProdConsTester
         cout << "ProdConsTester::operator()()" << endl;
 
         int core = 8;
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         deque<std::thread> joinable;
 
-        joinable.emplace_back(&producer, this, 2, 0, ds);
+        joinable.emplace_back(&ProdConsTester::producer, this, 2, 0, ds);
 
         std::this_thread::sleep_for(std::chrono::milliseconds(20));
 
-        joinable.emplace_back(&consumer, this, 11, 2);
+        joinable.emplace_back(&ProdConsTester::consumer, this, 11, 2);
 
         if constexpr (PRODS == 2)
-            joinable.emplace_back(&producer, this, 5, 1, ds);
+            joinable.emplace_back(&ProdConsTester::producer, this, 5, 1, ds);
 
         if constexpr (CONS == 2)
-            joinable.emplace_back(&consumer, this, 9, 3);
+            joinable.emplace_back(&ProdConsTester::consumer, this, 9, 3);
 
         int in;
         cin >> in;
@@ -125,9 +125,9 @@ struct ProdConsTester
     }
 
     inline static volatile bool exit{};
-    inline static auto toexit = [](){return exit;};
+    static bool toexit() noexcept {return exit;}
 
-    PRODCONS<D,N,toexit> pc;
+    PRODCONS<D,N,&ProdConsTester::toexit> pc;
 };
 
 /// variable sized data objects
@@ -156,7 +156,7 @@ struct ProdConsVariableTester
 {
     void producer(int core, int pidx, const int repeats)
     {
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         cout << "core, pidx = " << core << ", " << pidx << endl;
 
@@ -182,7 +182,7 @@ struct ProdConsVariableTester
 
     void consumer(int core, int cidx)
     {
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         char data[4*1024];
         int i{};
@@ -210,21 +210,21 @@ struct ProdConsVariableTester
         cout << "ProdConsTester::operator()()" << endl;
 
         int core = 8;
-        ::SetThreadAffinityMask(::GetCurrentThread(), 1 << core);
+        pin_this_thread(core);
 
         deque<std::thread> joinable;
 
-        joinable.emplace_back(&producer, this, 2, 0, repeats);
+        joinable.emplace_back(&ProdConsVariableTester::producer, this, 2, 0, repeats);
 
         std::this_thread::sleep_for(std::chrono::milliseconds(20));
 
-        joinable.emplace_back(&consumer, this, 11, 2);
+        joinable.emplace_back(&ProdConsVariableTester::consumer, this, 11, 2);
 
         if (num_prods == 2)
-            joinable.emplace_back(&producer, this, 5, 1, repeats);
+            joinable.emplace_back(&ProdConsVariableTester::producer, this, 5, 1, repeats);
 
         if (num_cons == 2)
-            joinable.emplace_back(&consumer, this, 9, 3);
+            joinable.emplace_back(&ProdConsVariableTester::consumer, this, 9, 3);
 
         int in;
         cin >> in;
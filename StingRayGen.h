@@ -0,0 +1,303 @@
+#ifndef STINGRAYGEN_H_INCLUDED
+#define STINGRAYGEN_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "StingRayExch.h"
+
+///
+/// synthetic StingRay traffic for load testing, rendered up front
+///
+/// SRGenerator draws messages by a configurable S/A/D/C/M/R mix across
+/// thousands of SRSymbolIdx values and packs them into SRPacketHeader + msgs
+/// packets, laid one after another in a single buffer, so serving a packet
+/// costs an index lookup and one copy.
+///
+/// the stream is self-consistent: D/C/M/R only refer to live orders, each
+/// symbol's mid walks a tick at a time and orders land a few ticks off it
+/// (mostly at the touch), and symbols are drawn with a Zipf skew so a few are
+/// busy and most are quiet.  it opens with a definition per symbol and a
+/// book of resting orders and closes by deleting every order left, so it can
+/// be replayed back to back.
+///
+
+namespace EXAMPLEINPUTS
+{
+using namespace STINGRAY;
+
+enum SRGenType : uint8_t { SRG_S, SRG_A, SRG_D, SRG_C, SRG_M, SRG_R, SRG_NUM_TYPES };
+constexpr char SRGenTypeChar[SRG_NUM_TYPES]{'S', 'A', 'D', 'C', 'M', 'R'};
+
+struct SRGenConfig
+{
+    uint64_t    msgs{10'000'000};   /// drawn by mix, after the opening and before the close
+    uint32_t    symbols{4000};      /// SRSymbolIdx 1..symbols
+    uint32_t    resting{100'000};   /// orders added in the opening
+    double      mix[SRG_NUM_TYPES]{0.2, 42, 36, 9, 7, 5.8};  /// relative weights, S A D C M R
+    double      zipf{1.0};          /// symbol skew, 0 is uniform
+    uint32_t    min_per_pkt{1};
+    uint32_t    max_per_pkt{12};
+    uint32_t    max_payload{1400};  /// msg bytes per packet
+    double      rate{0};            /// msgs/s the reader releases packets at, 0 for as fast as it is called
+    bool        loop{false};        /// the reader starts over at the end
+    uint32_t    first_seq_num{1};
+    uint8_t     ver{45};
+    uint64_t    seed{1968};
+};
+
+/// where a rendered packet is and when it is due
+struct SRGenPkt
+{
+    uint64_t off;       /// of its SRPacketHeader in SRGenerator::data()
+    uint64_t due_ns;    /// after the start of the feed
+};
+
+class SRGenerator
+{
+public:
+    /// renders the whole feed, false (and why) if cfg cannot make one
+    bool render(const SRGenConfig& cfg)
+    {
+        if(cfg.symbols == 0 || cfg.symbols > UINT16_MAX || cfg.min_per_pkt == 0 ||
+           cfg.max_per_pkt < cfg.min_per_pkt || cfg.max_per_pkt > UINT8_MAX ||
+           cfg.max_payload < sizeof(SRRep) || cfg.max_payload + sizeof(SRPacketHeader) > UINT16_MAX)
+        {
+            fprintf(stderr, "[srgen] bad config: %u symbols, %u..%u msgs and %u bytes per packet\n",
+                    cfg.symbols, cfg.min_per_pkt, cfg.max_per_pkt, cfg.max_payload);
+            return false;
+        }
+        cfg_ = cfg;
+        rng_.seed(cfg.seed);
+        type_ = std::discrete_distribution<int>(std::begin(cfg.mix), std::end(cfg.mix));
+        gap_ns_ = 1e9 / (cfg.rate > 0 ? cfg.rate : 1e6);
+        data_.clear();
+        pkts_.clear();
+        live_.clear();
+        std::fill(std::begin(type_count_), std::end(type_count_), 0);
+        msgs_ = 0;
+        seq_ = cfg.first_seq_num;
+        id_ = 0;
+        clock_ns_ = 0;
+        open_ = false;
+        pkt_msgs_ = 0;
+
+        /// a Zipf rank per symbol; prices log-uniform $0.50..$800, under $1 in 1/10000s, else in cents
+        std::vector<double> w(cfg.symbols + 1, 0.0);
+        mid_.assign(cfg.symbols + 1, 0);
+        scale_.assign(cfg.symbols + 1, 0);
+        std::uniform_real_distribution<double> logpx(std::log(0.5), std::log(800.0));
+        for(uint32_t s = 1; s <= cfg.symbols; ++s)
+        {
+            w[s] = 1.0 / std::pow(double(s), cfg.zipf);
+            const double px = std::exp(logpx(rng_));
+            scale_[s] = px < 1.0 ? 10000 : 100;
+            mid_[s] = std::max<SRPrice>(MIN_MID, SRPrice(px * scale_[s]));
+        }
+        sym_ = std::discrete_distribution<uint32_t>(w.begin(), w.end());
+
+        const uint64_t est = cfg.symbols + 2ull * cfg.resting + cfg.msgs;
+        data_.reserve(est * sizeof(SRAdd) + (est / cfg.min_per_pkt + 1) * sizeof(SRPacketHeader));
+        pkts_.reserve(est / ((cfg.min_per_pkt + cfg.max_per_pkt) / 2) + 1);
+        live_.reserve(2 * cfg.resting);
+
+        for(uint32_t s = 1; s <= cfg.symbols; ++s) definition(SRSymbolIdx(s));
+        for(uint32_t i = 0; i < cfg.resting; ++i) add();
+        for(uint64_t i = 0; i < cfg.msgs; ++i)
+        {
+            switch(draw())
+            {
+                case SRG_S: definition(draw_symbol()); break;
+                case SRG_A: add(); break;
+                case SRG_D: del(draw_live()); break;
+                case SRG_C: cancel(draw_live()); break;
+                case SRG_M: modify(draw_live()); break;
+                case SRG_R: replace(draw_live()); break;
+                default: break;
+            }
+        }
+        while(!live_.empty()) del(live_.size() - 1);
+        close_pkt();
+        span_ns_ = clock_ns_ + uint64_t(pkt_msgs_ * gap_ns_);
+        return true;
+    }
+
+    const char* data() const { return data_.data(); }
+    uint64_t bytes() const { return data_.size(); }
+    size_t packets() const { return pkts_.size(); }
+    const SRGenPkt& pkt(const size_t i) const { return pkts_[i]; }
+    uint64_t msgs() const { return msgs_; }
+    uint64_t type_count(const SRGenType t) const { return type_count_[t]; }
+    uint64_t span_ns() const { return span_ns_; }   /// the feed time a whole pass takes
+
+private:
+    static constexpr SRPrice MIN_MID{20};
+
+    struct LiveOrder
+    {
+        SROrderID   id;
+        SRPrice     prc;
+        SRSize      sz;
+        SRSymbolIdx sidx;
+        SRSide      sd;
+    };
+
+    SRGenType draw()
+    {
+        const SRGenType t = SRGenType(type_(rng_));
+        if(live_.empty() && t != SRG_S) return SRG_A;
+        return t;
+    }
+
+    SRSymbolIdx draw_symbol() { return SRSymbolIdx(sym_(rng_)); }           /// weight 0 at 0
+    size_t draw_live() { return rng_() % live_.size(); }
+    SRSize draw_size() { return SRSize(100 * (1 + rng_() % 10)); }
+
+    /// steps sidx's mid a tick either way now and then, then prices an order
+    /// 0.. ticks behind the touch on side sd
+    SRPrice draw_price(const SRSymbolIdx sidx, const SRSide sd)
+    {
+        SRPrice& mid = mid_[sidx];
+        const uint64_t r = rng_();
+        if((r & 3) == 0) mid = std::max(MIN_MID, mid + ((r & 4) ? 1 : -1));
+        SRPrice off = 1;
+        for(uint64_t b = r >> 8; (b & 3) != 0 && off < 24; b >>= 2) ++off;   /// P(k ticks back) ~ (3/4)^k
+        return sd == 'B' ? std::max<SRPrice>(1, mid - off) : mid + off;
+    }
+
+    void retire(const size_t i)
+    {
+        live_[i] = live_.back();
+        live_.pop_back();
+    }
+
+    void definition(const SRSymbolIdx sidx)
+    {
+        SRSecurityDefinition m{};
+        m.type = 'S';
+        snprintf(m.sym, sizeof(m.sym), "SR%05u", unsigned(sidx));
+        m.idx = sidx;
+        m.scale = scale_[sidx];
+        put(m, SRG_S);
+    }
+
+    void add()
+    {
+        const SRSymbolIdx sidx = draw_symbol();
+        const SRSide sd = (rng_() & 1) ? 'B' : 'S';
+        const LiveOrder o{++id_, draw_price(sidx, sd), draw_size(), sidx, sd};
+        put(SRAdd{0, 'A', o.id, o.prc, o.sz, o.sidx, o.sd}, SRG_A);
+        live_.push_back(o);
+    }
+
+    void del(const size_t i)
+    {
+        put(SRDel{0, 'D', live_[i].id}, SRG_D);
+        retire(i);
+    }
+
+    /// a partial cancel; an order with nothing to spare is deleted instead
+    void cancel(const size_t i)
+    {
+        LiveOrder& o = live_[i];
+        if(o.sz < 2) return del(i);
+        const SRSize qty = SRSize(1 + rng_() % (o.sz - 1));
+        put(SRCan{0, 'C', o.id, qty}, SRG_C);
+        o.sz -= qty;
+    }
+
+    /// new size and price in place; priority is lost on a price change or a size increase
+    void modify(const size_t i)
+    {
+        LiveOrder& o = live_[i];
+        const SRSize nsz = draw_size();
+        const SRPrice nprc = (rng_() & 1) ? draw_price(o.sidx, o.sd) : o.prc;
+        put(SRMod{0, 'M', o.id, nsz, nprc, nprc != o.prc || nsz > o.sz}, SRG_M);
+        o.sz = nsz;
+        o.prc = nprc;
+    }
+
+    void replace(const size_t i)
+    {
+        LiveOrder& o = live_[i];
+        const SROrderID nid = ++id_;
+        const SRSize nsz = draw_size();
+        const SRPrice nprc = draw_price(o.sidx, o.sd);
+        put(SRRep{0, 'R', o.id, nid, nsz, nprc}, SRG_R);
+        o.id = nid;
+        o.sz = nsz;
+        o.prc = nprc;
+    }
+
+    /// appends m to the open packet, first closing it if it is full and
+    /// opening the next; the msgs of a packet are 1 ns apart in feed time
+    template<typename Msg>
+    void put(Msg m, const SRGenType t)
+    {
+        if(open_ && (cnt_ == want_ || plen_ + sizeof(Msg) > cfg_.max_payload)) close_pkt();
+        if(!open_) open_pkt();
+        m.fd_tm = FEED_START_NS + clock_ns_ + cnt_;
+        const char* p = reinterpret_cast<const char*>(&m);
+        data_.insert(data_.end(), p, p + sizeof(Msg));
+        plen_ += sizeof(Msg);
+        ++cnt_;
+        ++type_count_[t];
+    }
+
+    /// the gap after a packet is exponential, its mean the time its msgs take at the rate
+    void open_pkt()
+    {
+        want_ = cfg_.min_per_pkt + uint32_t(rng_() % (cfg_.max_per_pkt - cfg_.min_per_pkt + 1));
+        if(!pkts_.empty()) clock_ns_ += uint64_t(gap_(rng_) * pkt_msgs_ * gap_ns_);
+        pkts_.push_back({data_.size(), clock_ns_});
+        data_.resize(data_.size() + sizeof(SRPacketHeader));
+        cnt_ = 0;
+        plen_ = 0;
+        open_ = true;
+    }
+
+    void close_pkt()
+    {
+        if(!open_) return;
+        const SRPacketHeader hdr{seq_, uint16_t(sizeof(SRPacketHeader) + plen_), cfg_.ver, uint8_t(cnt_)};
+        memcpy(data_.data() + pkts_.back().off, &hdr, sizeof(hdr));
+        seq_ += cnt_;
+        msgs_ += cnt_;
+        pkt_msgs_ = cnt_;
+        open_ = false;
+    }
+
+    static constexpr SRFeedTime FEED_START_NS{34'200'000'000'000ULL};   /// 09:30:00 past midnight
+
+    SRGenConfig                             cfg_;
+    std::mt19937_64                         rng_;
+    std::discrete_distribution<int>         type_;
+    std::discrete_distribution<uint32_t>    sym_;
+    std::exponential_distribution<double>   gap_{1.0};
+    double                                  gap_ns_{1000};
+    std::vector<SRPrice>                    mid_;       /// per SRSymbolIdx, in 1/scale
+    std::vector<SRPriceScale>               scale_;
+    std::vector<LiveOrder>                  live_;
+    std::vector<char>                       data_;
+    std::vector<SRGenPkt>                   pkts_;
+    uint64_t                                type_count_[SRG_NUM_TYPES]{};
+    uint64_t                                msgs_{0};
+    uint64_t                                clock_ns_{0};
+    uint64_t                                span_ns_{0};
+    SROrderID                               id_{0};
+    uint32_t                                seq_{1};
+    uint32_t                                want_{0};
+    uint32_t                                cnt_{0};
+    uint32_t                                plen_{0};
+    uint32_t                                pkt_msgs_{0};   /// in the last packet closed
+    bool                                    open_{false};
+};
+
+}
+
+#endif // STINGRAYGEN_H_INCLUDED
@@ -1,8 +1,11 @@
 #ifndef STINGRAYPUB_H_INCLUDED
 #define STINGRAYPUB_H_INCLUDED
 
+#include <chrono>
+
 #include "MktDataSystemInputs.h"
 #include "StingRayExch.h"
+#include "StingRayGen.h"
 
 namespace EXAMPLEINPUTS
 {
@@ -13,7 +16,7 @@ uint16_t buildPacket(char* buf, uint32_t& msg_seq_num, Msgs&&... msgs)
 {
     uint16_t len{sizeof(SRPacketHeader)};
 
-    static auto pack = [&buf, &len](auto&& msg)
+    auto pack = [&buf, &len](auto&& msg)
     {
         memcpy(buf+len, reinterpret_cast<void*>(&msg), sizeof(msg));
         len += sizeof(msg);
@@ -44,86 +47,21 @@ using namespace MKTDATASYSTEM::INPUTS;
 
 struct StingRayReadInterface : RecvInterface
 {
-    StingRayReadInterface(const deque<const Line*>& lines_dq, const size_t proc) : RecvInterface(lines_dq, proc) {}
+    StingRayReadInterface(const deque<const Line*>& lines_dq, const size_t proc, const SRGenConfig& cfg = {})
+        : RecvInterface(lines_dq, proc), cfg_(cfg) {}
 
+    /// renders the whole feed up front, so read() only has to hand packets out
     bool init()
     {
-         ///
-         uint32_t seqnum{17};
-         SRFeedTime fd_tm{171234};
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRSecurityDefinition{fd_tm-1,'S',"ken",1968,10},
-                         SRSecurityDefinition{fd_tm-2,'S',"wall",1969,100});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRAdd{fd_tm,'A',1717,68,100,1968,'B'},
-                         SRAdd{fd_tm+1,'A',1718,67,100,1968,'B'});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRAdd{fd_tm+2,'A',1719,70,100,1968,'S'},
-                         SRAdd{fd_tm+3,'A',1720,69,100,1968,'S'}, SRAdd{fd_tm+4,'A',1721,69,100,1968,'S'});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRAdd{fd_tm+4,'A',1722,56,100,1969,'S'},
-                         SRAdd{fd_tm+5,'A',1723,55,100,1969,'S'}, SRAdd{fd_tm+6,'A',1724,55,100,1969,'B'});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRCan{fd_tm+7,'C',1719,30},
-                         SRCan{fd_tm+8,'C',1724,33});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRDel{fd_tm+9,'D',1719},
-                         SRDel{fd_tm+10,'D',1724});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRMod{fd_tm+11,'M',1723,85,56,true},
-                         SRMod{fd_tm+12,'M',1723,76,57,true});
-
-            msgQ_.push_back(dt);
-         }
-
-         {
-            SRDataTransport dt;
-            dt.ph.len = buildPacket<45>(reinterpret_cast<char*>(&dt.ph), seqnum,
-                         SRRep{fd_tm+13,'R',1723,1725,75,56},
-                         SRDel{fd_tm+14,'D',1725});
-
-            msgQ_.push_back(dt);
-         }
-         return true;
+        cfg_.max_payload = std::min<uint32_t>(cfg_.max_payload, sizeof(SRDataTransport::dt));
+        if(!gen_.render(cfg_)) return false;
+
+        cout << "[srgen] " << gen_.msgs() << " msgs in " << gen_.packets() << " packets, "
+             << gen_.bytes() / 1e6 << " MB, " << cfg_.symbols << " symbols, mix";
+        for(int t = 0; t < SRG_NUM_TYPES; ++t) cout << ' ' << SRGenTypeChar[t] << '=' << gen_.type_count(SRGenType(t));
+        if(cfg_.rate > 0) cout << ", paced at " << cfg_.rate / 1e6 << " M msgs/s";
+        cout << endl;
+        return true;
     }
 
     bool join(const PhysLinePtr ppl)
@@ -132,43 +70,49 @@ struct StingRayReadInterface : RecvInterface
         return true;
     }
 
+    /// false when nothing is due yet, or at the end unless cfg.loop; each
+    /// pass over the feed carries on the seq nums of the one before
     bool read(const Line*& lp)
     {
-        static size_t ridx{};
-
-        if(ridx == msgQ_.size()) return false;
-//cout << __FILE__ << " : "<< __LINE__ <<endl;
-        auto& srdt = msgQ_[ridx++];
-
-        /// in a real recv interface, a logical line obj would be available
-       // static Line ln;
+        if(ridx_ == gen_.packets())
+        {
+            if(!cfg_.loop || ridx_ == 0) return false;
+            ridx_ = 0;
+            ++pass_;
+        }
+        const SRGenPkt& gp{gen_.pkt(ridx_)};
+
+        if(cfg_.rate > 0)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if(ridx_ == 0 && pass_ == 0) start_ = now;
+            if(now < start_ + std::chrono::nanoseconds(gp.due_ns + pass_ * gen_.span_ns())) return false;
+        }
+        ++ridx_;
+
+        const SRPacketHeader& ph{*reinterpret_cast<const SRPacketHeader*>(gen_.data() + gp.off)};
 
         /// the first Line has an arbitrated packet
         lp = lines_dq.front();
 
-        /// the first physical line packet arrived first
-      //  lp->pArb_line = lp->phys_lines_dq.front();
+        Packet& pkt{currPkt_};
 
-        Packet& pkt{currPkt_};//lp->pArb_line->ab_pkt};
-
-        memcpy(const_cast<char*>(pkt.data), reinterpret_cast<const char*>(&srdt.dt), srdt.ph.len);
-        pkt.len = srdt.ph.len;
-        pkt.first_seq_num = srdt.ph.msg_seq_num;
-        pkt.msg_cnt = srdt.ph.msg_cnt;
+        memcpy(const_cast<char*>(pkt.data), reinterpret_cast<const char*>(&ph + 1), ph.len - sizeof(SRPacketHeader));
+        pkt.len = ph.len;
+        pkt.first_seq_num = uint32_t(ph.msg_seq_num + pass_ * gen_.msgs());
+        pkt.msg_cnt = ph.msg_cnt;
 
         lp->set_arb_pkt(&pkt);
-        //lp->p_arb_pkt = &pkt;
-
-        /// for test, should be done via arbitration code
-       // lp->pArb_line->stats.incr(pkt.msg_cnt, pkt.len);
-
-cout << __FILE__ << " : "<< __LINE__ << " : " << pkt.first_seq_num<< " : " << int(pkt.msg_cnt) << " : " << pkt.len <<endl;
 
         return true;
     }
 
 private:
-    std::deque<SRDataTransport> msgQ_;
+    SRGenConfig cfg_;
+    SRGenerator gen_;
+    size_t ridx_{};
+    uint64_t pass_{};
+    std::chrono::steady_clock::time_point start_{};
     Packet currPkt_;
 };
 
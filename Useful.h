@@ -1,6 +1,10 @@
 #ifndef USEFUL_H_INCLUDED
 #define USEFUL_H_INCLUDED
 
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 inline constexpr uint64_t cacheline_size_bytes{64};
 inline constexpr uint64_t page_size_bytes{1024};//4096};
@@ -52,4 +56,38 @@ struct alignas(16) atomic_16b
 };
 
 
+/// pin the calling thread to one logical cpu
+inline bool pin_this_thread(const int core)
+{
+#ifdef _WIN32
+    return ::SetThreadAffinityMask(::GetCurrentThread(), DWORD_PTR{1} << core) != 0;
+#else
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    CPU_SET(core, &cs);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cs), &cs) == 0;
+#endif
+}
+
+
+/// per-thread contention counters for the lock-free queues (spins while waiting on a slot / space,
+/// CAS attempts and failures on the shared indices).  compiled in with -DCONTENTION_STATS, which the
+/// queue benchmarks use; otherwise CONTENTION_COUNT expands to nothing and the queues pay nothing.
+struct contention_stats
+{
+    uint64_t prod_spins{};
+    uint64_t cons_spins{};
+    uint64_t cas_attempts{};
+    uint64_t cas_failures{};
+};
+
+inline thread_local contention_stats tl_contention_stats{};
+
+#ifdef CONTENTION_STATS
+#define CONTENTION_COUNT(field) ((void)++::tl_contention_stats.field)
+#else
+#define CONTENTION_COUNT(field) ((void)0)
+#endif
+
+
 #endif // USEFUL_H_INCLUDED
@@ -0,0 +1,585 @@
+/**
+ * book_bench.cpp
+ *
+ * Common driver for the price-level book containers:
+ *   AVL FastNodeMap / PreallocatedNodePool   (BookBuilderSpec2_iter.h)
+ *   AVL FastNodeMap / DynamicNodePool        (dyn_mapnode_alloc.h)
+ *   AVL FastNodeMap / HybridNodePool         (chunksize_10)
+ *   Robin Hood FastNodeMap + sorted_indices_ (even_more_improved_chunksize_10)
+ *   Int64SparsePagedLadder                   (Pagedbook_1)
+ *   ChunkedPriceBook                         (Gemini_flatmap_1.h)
+ *
+ * A bid and an ask instance of each container replay the same precomputed
+ * add / cancel / execute / replace stream.  Prices are drawn from a
+ * distance-from-top distribution: geometric, power law, uniform, or an
+ * empirical histogram taken from an ITCH 5.0 BinaryFILE capture.  The stream
+ * is generated once per book depth, outside the timed region, so all
+ * containers see identical work.
+ *
+ * Depth is per side: each side's prices span `depth` ticks from the touch, so
+ * neither side ever holds more than `depth` live levels.
+ *
+ * Reported per container and depth: ns per message, the hardware counters per
+ * message (PerfAnalysis.h perf_counters), live levels per side (bid+ask) at
+ * the end of the run and heap bytes per live level over both sides (mallinfo2
+ * delta, so preallocated arenas count).
+ *
+ * The containers all define MapNode / FastNodeMap / PrcLevelGeneric at global
+ * scope, so each is included into its own namespace below.  The std headers
+ * they rely on are included first so their own #includes are no-ops there.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 book_bench.cpp -o book_bench
+ *
+ * Run:
+ *   ./book_bench [powerlaw|geometric|uniform|itch:<BinaryFILE>] [messages] [depth,...]
+ *   ./book_bench itch:01302019.NASDAQ_ITCH50 2000000 10,1000,100000
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <concepts>
+#include <type_traits>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <map>
+#include <cmath>
+
+#include <malloc.h>             // mallinfo2
+
+#include "PerfAnalysis.h"
+#include "TraceProbe.h"
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+
+// ─── Containers, one namespace each ──────────────────────────────────────────
+
+namespace avl_prealloc {
+// BookBuilderSpec2_iter.h stores the level as AggBookPrcLevel; same fields as its PrcLevelGeneric
+struct AggBookPrcLevel {
+    uint64_t prc{};
+    uint32_t agg_sz{};
+    uint16_t num_orders{};
+    uint64_t feed_time{};
+    uint64_t uuid{};
+    void*    plist{nullptr};
+};
+#include "BookBuilderSpec2_iter.h"
+}
+
+namespace avl_dynamic {
+using avl_prealloc::NIL;
+using avl_prealloc::PrcLevelGeneric;
+using GeminiPrcLevelGeneric = avl_prealloc::PrcLevelGeneric;
+#include "dyn_mapnode_alloc.h"
+}
+
+namespace avl_hybrid {
+using avl_prealloc::PrcLevelGeneric;
+#include "chunksize_10"
+}
+
+namespace robin_hood {
+using avl_prealloc::PrcLevelGeneric;
+#include "even_more_improved_chunksize_10"
+}
+
+namespace paged {
+#include "Pagedbook_1"
+}
+
+namespace chunked {
+#include "Gemini_flatmap_1.h"
+}
+
+// ─── Prices ──────────────────────────────────────────────────────────────────
+//
+// ITCH prices are u32 in 1/10000 $; one tick = $0.01.  Best bid sits one tick
+// under MID_TICK and best ask one over; distance d moves away from the touch.
+
+static constexpr uint32_t TICK     = 100;
+static constexpr uint32_t MID_TICK = 1'000'000;    // $10000.00, leaves room for 4×100k ticks
+
+static inline uint32_t bid_tick(const uint32_t d) noexcept { return MID_TICK - 1 - d; }
+static inline uint32_t ask_tick(const uint32_t d) noexcept { return MID_TICK + 1 + d; }
+
+// ─── Container adapters ──────────────────────────────────────────────────────
+//
+// Every side adapter offers the two level operations the stream needs:
+//   add(price, qty)             find-or-create the level, +qty, +1 order
+//   reduce(price, qty, remove)  -qty, -1 order if remove, erase at 0 orders
+// so the driver below is written once for all containers.
+
+template<bool IsBid>
+using KeyOrder = std::conditional_t<IsBid, std::greater<uint64_t>, std::less<uint64_t>>;
+
+// FastNodeMap variants share try_emplace(key) / find(key) / erase(MapNode*)
+// and a PrcLevelGeneric-like value with agg_sz / num_orders.
+template<class Map>
+struct NodeMapSide {
+    Map m;
+
+    [[gnu::always_inline]] inline void add(const uint32_t price, const uint32_t qty) noexcept {
+        auto [node, inserted] = m.try_emplace(price);
+        if (inserted) {
+            node->value.prc        = price;
+            node->value.agg_sz     = qty;
+            node->value.num_orders = 1;
+        } else {
+            node->value.agg_sz += qty;
+            ++node->value.num_orders;
+        }
+    }
+
+    [[gnu::always_inline]] inline void reduce(const uint32_t price, const uint32_t qty, const bool remove) noexcept {
+        auto* node = m.find(price);
+        if (!node) [[unlikely]] return;
+        node->value.agg_sz -= qty;
+        if (remove && --node->value.num_orders == 0)
+            m.erase(node);
+    }
+};
+
+static constexpr size_t PREALLOC_NODES = (1u << 19) - 1;   // > 4 × 100k levels per side
+static constexpr size_t HYBRID_NODES   = 4096;             // arena part; beyond it nodes come from aligned_alloc
+
+template<bool IsBid> using AvlPreallocSide = NodeMapSide<avl_prealloc::FastNodeMap<PREALLOC_NODES, KeyOrder<IsBid>>>;
+template<bool IsBid> using AvlDynamicSide  = NodeMapSide<avl_dynamic::FastNodeMap<KeyOrder<IsBid>>>;
+template<bool IsBid> using AvlHybridSide   = NodeMapSide<avl_hybrid::FastNodeMap<HYBRID_NODES, KeyOrder<IsBid>>>;
+template<bool IsBid> using RobinHoodSide   = NodeMapSide<robin_hood::FastNodeMap<KeyOrder<IsBid>>>;
+
+template<bool IsBid>
+struct PagedSide {
+    paged::Int64SparsePagedLadder m;
+
+    explicit PagedSide(const uint32_t max_dist)
+        : m(IsBid ? bid_tick(max_dist) : ask_tick(0), IsBid ? bid_tick(0) : ask_tick(max_dist)) {}
+
+    [[gnu::always_inline]] inline void add(const uint32_t price, const uint32_t qty) noexcept {
+        const int64_t tick = price / TICK;
+        auto [lvl, inserted] = m.try_emplace(tick, qty, 1, 0, 0, nullptr);
+        if (!lvl) [[unlikely]] return;
+        if (!inserted) {
+            lvl->agg_sz += qty;
+            lvl->set_metrics(static_cast<uint16_t>(lvl->get_num_orders() + 1), lvl->get_feed_time());
+        }
+    }
+
+    [[gnu::always_inline]] inline void reduce(const uint32_t price, const uint32_t qty, const bool remove) noexcept {
+        const int64_t tick = price / TICK;
+        auto* lvl = m.find(tick);
+        if (!lvl) [[unlikely]] return;
+        lvl->agg_sz -= qty;
+        if (remove) {
+            const uint16_t orders = static_cast<uint16_t>(lvl->get_num_orders() - 1);
+            if (orders == 0) m.erase(tick);
+            else lvl->set_metrics(orders, lvl->get_feed_time());
+        }
+    }
+};
+
+template<bool IsBid>
+struct ChunkedSide {
+    chunked::ChunkedPriceBook<IsBid> m;
+
+    [[gnu::always_inline]] inline void add(const uint32_t price, const uint32_t qty) noexcept {
+        auto [idx, inserted] = m.try_emplace(price, qty, 1, 0, 0);
+        if (!inserted) {
+            auto* lvl = m.at(idx);
+            lvl->aggregate_sz += qty;
+            ++lvl->num_orders;
+        }
+    }
+
+    [[gnu::always_inline]] inline void reduce(const uint32_t price, const uint32_t qty, const bool remove) noexcept {
+        const uint32_t idx = m.find(price);
+        if (idx == chunked::ChunkedPriceBook<IsBid>::INVALID_INDEX) [[unlikely]] return;
+        auto* lvl = m.at(idx);
+        lvl->aggregate_sz -= qty;
+        if (remove && --lvl->num_orders == 0)
+            m.erase(idx);
+    }
+};
+
+template<template<bool> class Side>
+struct Book {
+    Side<true>  bid;
+    Side<false> ask;
+
+    Book() = default;
+    template<class... A>
+    explicit Book(const A&... a) : bid(a...), ask(a...) {}
+};
+
+// ─── Distance-from-top distributions ─────────────────────────────────────────
+//
+// All are turned into a CDF over [0, max_dist) and sampled by binary search.
+
+struct DistanceDist {
+    std::string         name;
+    std::vector<double> weight;    // unnormalised, index = ticks from the touch
+
+    std::vector<double> cdf(const uint32_t max_dist) const {
+        std::vector<double> c(max_dist);
+        double acc = 0;
+        for (uint32_t d = 0; d < max_dist; ++d) {
+            acc += d < weight.size() ? weight[d] : 0.0;
+            c[d] = acc;
+        }
+        if (acc == 0) { c.assign(max_dist, 1.0); acc = 1.0; }
+        for (auto& v : c) v /= acc;
+        return c;
+    }
+};
+
+static constexpr uint32_t DIST_SUPPORT = 400'000;   // ≥ 4 × the largest depth
+
+static DistanceDist make_geometric(const double mean_ticks) {
+    DistanceDist d{"geometric", std::vector<double>(DIST_SUPPORT)};
+    const double q = mean_ticks / (1.0 + mean_ticks);
+    double w = 1.0;
+    for (auto& x : d.weight) { x = w; w *= q; }
+    return d;
+}
+
+// Empirical add-order placement follows roughly P(d) ∝ (1+d)^-alpha.
+static DistanceDist make_powerlaw(const double alpha) {
+    DistanceDist d{"powerlaw", std::vector<double>(DIST_SUPPORT)};
+    for (uint32_t i = 0; i < DIST_SUPPORT; ++i) d.weight[i] = std::pow(1.0 + i, -alpha);
+    return d;
+}
+
+static DistanceDist make_uniform() {
+    return {"uniform", std::vector<double>(DIST_SUPPORT, 1.0)};
+}
+
+// ITCH 5.0 BinaryFILE: back-to-back [BE u16 length][message].  Every stock's
+// book is rebuilt from A/F/E/C/X/D/U; each A/F/U records the new order's
+// distance in ticks from its side's best price at that moment (0 when it
+// joins or improves the touch).
+static bool make_itch(const char* path, DistanceDist& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+
+    struct Ord { uint16_t locate; uint8_t bid; uint32_t price; uint32_t shares; };
+    struct Levels { std::map<uint32_t, uint32_t> bid, ask; };   // price → live orders
+
+    std::unordered_map<uint64_t, Ord> orders;
+    std::unordered_map<uint16_t, Levels> books;
+    std::vector<double> hist(DIST_SUPPORT, 0.0);
+    uint64_t n_msgs = 0, n_samples = 0;
+
+    auto add = [&](const uint64_t ref, const Ord& o) {
+        Levels& b = books[o.locate];
+        auto& side = o.bid ? b.bid : b.ask;
+        uint32_t dist = 0;
+        if (!side.empty()) {
+            const uint32_t best = o.bid ? side.rbegin()->first : side.begin()->first;
+            const int64_t diff = o.bid ? int64_t{best} - o.price : int64_t{o.price} - best;
+            dist = diff > 0 ? static_cast<uint32_t>(diff / TICK) : 0;
+        }
+        if (dist < DIST_SUPPORT) { hist[dist] += 1.0; ++n_samples; }
+        ++side[o.price];
+        orders[ref] = o;
+    };
+    auto remove = [&](const uint64_t ref) {
+        auto it = orders.find(ref);
+        if (it == orders.end()) return;
+        const Ord& o = it->second;
+        Levels& b = books[o.locate];
+        auto& side = o.bid ? b.bid : b.ask;
+        auto lv = side.find(o.price);
+        if (lv != side.end() && --lv->second == 0) side.erase(lv);
+        orders.erase(it);
+    };
+    auto reduce = [&](const uint64_t ref, const uint32_t shares) {
+        auto it = orders.find(ref);
+        if (it == orders.end()) return;
+        if (it->second.shares <= shares) remove(ref);
+        else it->second.shares -= shares;
+    };
+
+    uint8_t msg[65536 + 32] = {};
+    uint8_t len_be[2];
+    while (fread(len_be, 1, 2, f) == 2) {
+        const uint16_t len = be16(len_be);
+        if (fread(msg, 1, len, f) != len) break;
+        ++n_msgs;
+        switch (msg[0]) {
+            case 'A': case 'F':
+                if (len >= 36) {
+                    const DecodedAddOrder a = scalar_decode_add_order(msg);
+                    add(a.order_ref, {a.stock_locate, static_cast<uint8_t>(a.side == 'B'), a.price, a.shares});
+                }
+                break;
+            case 'E': case 'C':
+                if (len >= 23) reduce(be64(msg + 11), be32(msg + 19));
+                break;
+            case 'X':
+                if (len >= 23) reduce(be64(msg + 11), be32(msg + 19));
+                break;
+            case 'D':
+                if (len >= 19) remove(be64(msg + 11));
+                break;
+            case 'U':
+                if (len >= 35) {
+                    auto it = orders.find(be64(msg + 11));
+                    if (it == orders.end()) break;
+                    const Ord o{it->second.locate, it->second.bid, be32(msg + 31), be32(msg + 27)};
+                    remove(be64(msg + 11));
+                    add(be64(msg + 19), o);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    fclose(f);
+
+    printf("itch: %s  %lu messages, %lu placement samples\n", path,
+           static_cast<unsigned long>(n_msgs), static_cast<unsigned long>(n_samples));
+    if (n_samples == 0) return false;
+    out = {std::string("itch:") + path, std::move(hist)};
+    return true;
+}
+
+// ─── Message stream ──────────────────────────────────────────────────────────
+
+enum class OpType : uint8_t { Add, Cancel, Execute, Replace };
+
+struct BookOp {
+    uint32_t price;
+    uint32_t qty;
+    uint32_t new_price;   // Replace only
+    uint32_t new_qty;     // Replace only
+    OpType   type;
+    uint8_t  side;        // 0 = bid, 1 = ask
+    uint8_t  remove;      // Cancel / Execute: the order leaves its level
+};
+
+struct Workload {
+    std::vector<BookOp> prefill;   // untimed: builds the initial book
+    std::vector<BookOp> stream;    // timed
+    uint64_t levels_end{0};        // live levels (both sides) after the stream
+    uint64_t side_levels_end[2]{}; // the same per side: bid, ask
+    uint64_t op_counts[4]{};
+};
+
+// Simulates the book at order granularity so every cancel / execute / replace
+// refers to a live order and the level count is known exactly.
+//
+// Every price is within `depth` ticks of the touch, so a side never holds
+// more than `depth` levels.  Resting liquidity on every one of the first
+// min(depth, 16) ticks and on about half of the rest, never touched by the
+// stream.  Active orders: ~max(1000, depth/4) per side drawn from the
+// distance distribution; they create and empty levels on the ticks between.
+// Message mix follows a typical ITCH day: 44% add, 40% cancel, 6% execute,
+// 10% replace.
+static uint32_t workload_max_dist(const uint32_t depth) noexcept {
+    return depth;
+}
+
+static Workload make_workload(const DistanceDist& dist, const uint32_t depth, const uint64_t n_msgs, const uint64_t seed) {
+    Workload w;
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+
+    const uint32_t max_dist = workload_max_dist(depth);
+    const std::vector<double> cdf = dist.cdf(max_dist);
+    auto sample_dist = [&]() {
+        return static_cast<uint32_t>(std::lower_bound(cdf.begin(), cdf.end(), uni(rng)) - cdf.begin());
+    };
+    auto sample_qty = [&]() { return static_cast<uint32_t>(100 * (1 + (rng() % 10))); };
+    auto price_of = [](const uint8_t side, const uint32_t d) { return (side ? ask_tick(d) : bid_tick(d)) * TICK; };
+
+    struct Live { uint32_t dist; uint32_t qty; uint8_t side; };
+    std::vector<Live> live;
+    std::vector<uint32_t> count[2] = { std::vector<uint32_t>(max_dist, 0), std::vector<uint32_t>(max_dist, 0) };
+    uint64_t levels = 0;
+
+    auto level_in  = [&](const uint8_t s, const uint32_t d) { if (count[s][d]++ == 0) ++levels; };
+    auto level_out = [&](const uint8_t s, const uint32_t d) { if (--count[s][d] == 0) --levels; };
+
+    for (uint8_t s = 0; s < 2; ++s)
+        for (uint32_t d = 0; d < max_dist; ++d)
+            if (d < std::min<uint32_t>(depth, 16) || (rng() & 1)) {
+                const uint32_t q = sample_qty();
+                w.prefill.push_back({price_of(s, d), q, 0, 0, OpType::Add, s, 0});
+                level_in(s, d);
+            }
+
+    const size_t target = std::max<size_t>(1000, depth / 4) * 2;
+    auto add_live = [&](std::vector<BookOp>& out) {
+        const uint8_t s = rng() & 1;
+        const uint32_t d = sample_dist();
+        const uint32_t q = sample_qty();
+        live.push_back({d, q, s});
+        level_in(s, d);
+        out.push_back({price_of(s, d), q, 0, 0, OpType::Add, s, 0});
+    };
+    auto take = [&](const size_t i) { Live o = live[i]; live[i] = live.back(); live.pop_back(); return o; };
+
+    while (live.size() < target) add_live(w.prefill);
+
+    w.stream.reserve(n_msgs);
+    for (uint64_t n = 0; n < n_msgs; ++n) {
+        const double r = uni(rng);
+        const bool force_add = live.size() < target / 2;
+        const bool no_add    = live.size() > target + target / 2;
+
+        if (force_add || (!no_add && r < 0.44)) {
+            add_live(w.stream);
+            ++w.op_counts[0];
+        } else if (r < 0.84 || live.size() < 8) {
+            const Live o = take(rng() % live.size());
+            level_out(o.side, o.dist);
+            w.stream.push_back({price_of(o.side, o.dist), o.qty, 0, 0, OpType::Cancel, o.side, 1});
+            ++w.op_counts[1];
+        } else if (r < 0.90) {
+            // aggressor hits the nearest of a few random orders: executions cluster at the touch
+            size_t best = rng() % live.size();
+            for (int k = 0; k < 7; ++k) {
+                const size_t c = rng() % live.size();
+                if (live[c].dist < live[best].dist) best = c;
+            }
+            if (rng() % 10 < 3 && live[best].qty > 100) {
+                const uint32_t q = live[best].qty / 2;
+                live[best].qty -= q;
+                w.stream.push_back({price_of(live[best].side, live[best].dist), q, 0, 0, OpType::Execute, live[best].side, 0});
+            } else {
+                const Live o = take(best);
+                level_out(o.side, o.dist);
+                w.stream.push_back({price_of(o.side, o.dist), o.qty, 0, 0, OpType::Execute, o.side, 1});
+            }
+            ++w.op_counts[2];
+        } else {
+            // replace: same side, price moved a couple of ticks, new size
+            Live& o = live[rng() % live.size()];
+            const int64_t nd = std::clamp<int64_t>(int64_t{o.dist} + static_cast<int64_t>(rng() % 5) - 2, 0, max_dist - 1);
+            const uint32_t nq = sample_qty();
+            const BookOp op{price_of(o.side, o.dist), o.qty, price_of(o.side, static_cast<uint32_t>(nd)), nq, OpType::Replace, o.side, 1};
+            level_out(o.side, o.dist);
+            o.dist = static_cast<uint32_t>(nd);
+            o.qty  = nq;
+            level_in(o.side, o.dist);
+            w.stream.push_back(op);
+            ++w.op_counts[3];
+        }
+    }
+    w.levels_end = levels;
+    for (uint8_t s = 0; s < 2; ++s)
+        w.side_levels_end[s] = static_cast<uint64_t>(max_dist - std::count(count[s].begin(), count[s].end(), 0u));
+    return w;
+}
+
+// ─── Driver ──────────────────────────────────────────────────────────────────
+
+template<class Side>
+[[gnu::always_inline]] static inline void apply_side(Side& s, const BookOp& op) noexcept {
+    switch (op.type) {
+        case OpType::Add:
+            s.add(op.price, op.qty);
+            break;
+        case OpType::Cancel:
+        case OpType::Execute:
+            s.reduce(op.price, op.qty, op.remove);
+            break;
+        case OpType::Replace:
+            s.reduce(op.price, op.qty, true);
+            s.add(op.new_price, op.new_qty);
+            break;
+    }
+}
+
+template<class B>
+[[gnu::noinline]] static void replay(B& book, const std::vector<BookOp>& ops) noexcept {
+    for (const BookOp& op : ops) {
+        if (op.side == 0) apply_side(book.bid, op);
+        else              apply_side(book.ask, op);
+    }
+}
+
+static size_t heap_in_use() {
+    const struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+template<class B, class... A>
+static void run_container(const char* name, const Workload& w, const A&... ctor_args) {
+    const size_t heap0 = heap_in_use();
+    auto book = std::make_unique<B>(ctor_args...);
+    replay(*book, w.prefill);
+
+    stopwatch<> sw;
+    perf_counters pc;
+    sw.start();
+    pc.start();
+    replay(*book, w.stream);
+    pc.stop();
+    sw.stop();
+
+    const size_t heap1 = heap_in_use();
+    const uint64_t ops = w.stream.size();
+    printf("  %-24s %9.2f ns/msg  %6lu+%-6lu levels  %9.1f B/level\n", name,
+           static_cast<double>(sw.total_time) / ops,
+           static_cast<unsigned long>(w.side_levels_end[0]), static_cast<unsigned long>(w.side_levels_end[1]),
+           w.levels_end ? static_cast<double>(heap1 - heap0) / w.levels_end : 0.0);
+    fflush(stdout);
+    pc.print(std::cout, "    ", ops);
+}
+
+int main(int argc, char** argv) {
+    const std::string_view spec = argc > 1 ? argv[1] : "powerlaw";
+    const uint64_t n_msgs = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1'000'000ULL;
+
+    std::vector<uint32_t> depths{10, 100, 1000, 10'000, 100'000};
+    if (argc > 3) {
+        depths.clear();
+        for (const char* p = argv[3]; *p; ) {
+            char* e;
+            depths.push_back(static_cast<uint32_t>(strtoul(p, &e, 10)));
+            p = *e ? e + 1 : e;
+        }
+    }
+
+    DistanceDist dist;
+    if (spec == "geometric")          dist = make_geometric(4.0);
+    else if (spec == "uniform")       dist = make_uniform();
+    else if (spec.starts_with("itch:")) {
+        if (!make_itch(argv[1] + 5, dist)) return 1;
+    }
+    else                              dist = make_powerlaw(1.5);
+
+    printf("distribution=%s  messages=%lu  isa=%s\n", dist.name.c_str(),
+           static_cast<unsigned long>(n_msgs), ISADISPATCH::isa_name(ISADISPATCH::g_isa));
+
+    for (const uint32_t depth : depths) {
+        if (depth == 0 || depth > DIST_SUPPORT) continue;
+        const Workload w = make_workload(dist, depth, n_msgs, 0x5eed + depth);
+        printf("\ndepth %u ticks/side  (add %lu / cancel %lu / execute %lu / replace %lu)\n", depth,
+               static_cast<unsigned long>(w.op_counts[0]), static_cast<unsigned long>(w.op_counts[1]),
+               static_cast<unsigned long>(w.op_counts[2]), static_cast<unsigned long>(w.op_counts[3]));
+
+        const uint32_t max_dist = workload_max_dist(depth);
+        run_container<Book<AvlPreallocSide>>("AVL/PreallocatedPool", w);
+        run_container<Book<AvlDynamicSide>>("AVL/DynamicPool", w);
+        run_container<Book<AvlHybridSide>>("AVL/HybridPool", w);
+        run_container<Book<RobinHoodSide>>("RobinHood+sorted", w);
+        run_container<Book<PagedSide>>("Int64SparsePagedLadder", w, max_dist);
+        run_container<Book<ChunkedSide>>("ChunkedPriceBook", w);
+    }
+    return 0;
+}
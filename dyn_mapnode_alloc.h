@@ -376,6 +376,7 @@ public:
 };
 
 
+#if 0 // migration notes (PreallocatedNodePool -> chunked pool), kept for reference, not compiled
 // --- OLD FIXED-SIZE VARIABLES ---
 // std::array<MapNode, MaxNodes + 1> storage_;
 // uint32_t free_head_{1};
@@ -548,5 +549,4 @@ void grow_pool() {
 
     total_capacity_ += CHUNK_SIZE;
 }
-
-
+#endif
@@ -0,0 +1,204 @@
+/**
+ * isa_bench.cpp
+ *
+ * Per-ISA microbenchmark for every kernel that IsaDispatch.h can bind:
+ *   - ITCH 5.0 decoders (itch5_avx.h): add / execute / delete / type scan
+ *   - ChunkyBucketMap chunk match + free mask
+ *   - ChunkedPriceBook sorted insert-position scan (bid side, several depths)
+ *   - Pagedbook 32-byte level clear
+ * Each variant the host can run is timed in the same binary, so the numbers
+ * are directly comparable and show what the runtime selection is worth.
+ * Every row is followed by its hardware counters per op (perf_counters in
+ * PerfAnalysis.h); needs perf_event_paranoid <= 2, otherwise reported n/a.
+ *
+ * Build (no -march: variants carry their own target attributes):
+ *   g++ -O3 -std=c++20 isa_bench.cpp -o isa_bench
+ *
+ * Run:
+ *   ./isa_bench [iterations]
+ *   ISA_FORCE=sse42 ./isa_bench     # also caps which variants are timed
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "PerfAnalysis.h"
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+
+using namespace ISADISPATCH;
+
+static constexpr size_t N_MSGS  = 4096;    // decoder working set: 4096 × 64 B = 256 KB
+static constexpr size_t MSG_STR = 64;      // one message per cache line
+
+// ─── Result reporting ────────────────────────────────────────────────────────
+
+static void report(const char* kernel, const Isa isa, const stopwatch<>& sw, const perf_counters& pc,
+                   const uint64_t cycles, const uint64_t ops, const uint64_t sink) {
+    printf("%-24s %-7s %8.2f ns/op %8.2f cyc/op   (sink %lx)\n",
+           kernel, isa_name(isa),
+           static_cast<double>(sw.total_time) / ops,
+           static_cast<double>(cycles) / ops,
+           static_cast<unsigned long>(sink));
+    fflush(stdout);
+    pc.print(std::cout, "    ", ops);
+}
+
+// Time fn(iters) once; fn returns a value folded into the sink so the
+// optimiser cannot drop the work.
+template<class F>
+static void run(const char* kernel, const Isa isa, const uint64_t ops, F&& fn) {
+    stopwatch<> sw;
+    perf_counters pc;
+    sw.start();
+    const uint64_t t0 = __rdtsc();
+    pc.start();
+    const uint64_t sink = fn();
+    pc.stop();
+    const uint64_t t1 = __rdtsc();
+    sw.stop();
+    report(kernel, isa, sw, pc, t1 - t0, ops, sink);
+}
+
+// ─── Decoder loops (one per policy, compiled for that policy's ISA) ──────────
+
+template<class Dec>
+[[gnu::always_inline]] static inline uint64_t decode_loop(const uint8_t* msgs, const int what, const uint64_t iters) noexcept {
+    uint64_t acc = 0;
+    for (uint64_t it = 0; it < iters; ++it) {
+        const uint8_t* m = msgs + (it & (N_MSGS - 1)) * MSG_STR;
+        switch (what) {
+            case 0: { auto d = Dec::add_order(m);     acc += d.order_ref ^ d.shares ^ d.price; break; }
+            case 1: { auto d = Dec::execute_order(m); acc += d.order_ref ^ d.match_num;        break; }
+            case 2: { auto d = Dec::delete_order(m);  acc += d.order_ref ^ d.timestamp_ns;     break; }
+            default: acc += Dec::scan_types(m);                                                 break;
+        }
+    }
+    return acc;
+}
+
+static uint64_t decode_scalar(const uint8_t* msgs, const int what, const uint64_t iters) noexcept {
+    return decode_loop<DecodeScalar>(msgs, what, iters);
+}
+
+[[gnu::target("sse4.2")]]
+static uint64_t decode_sse42(const uint8_t* msgs, const int what, const uint64_t iters) noexcept {
+    return decode_loop<DecodeSSE42>(msgs, what, iters);
+}
+
+[[gnu::target("avx2")]]
+static uint64_t decode_avx2(const uint8_t* msgs, const int what, const uint64_t iters) noexcept {
+    return decode_loop<DecodeAVX2>(msgs, what, iters);
+}
+
+using DecodeLoopFn = uint64_t(const uint8_t*, int, uint64_t) noexcept;
+
+// ─── Main ────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    const uint64_t iters = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20'000'000ULL;
+    const Isa top = g_isa;
+
+    printf("host isa=%s  iterations=%lu\n\n", isa_name(top), static_cast<unsigned long>(iters));
+
+    std::mt19937_64 rng(42);
+
+    // Random message bytes: decoder cost does not depend on field values.
+    std::vector<uint8_t> msgs(N_MSGS * MSG_STR);
+    for (auto& b : msgs) b = static_cast<uint8_t>(rng());
+    for (size_t i = 0; i < N_MSGS; ++i) msgs[i * MSG_STR] = static_cast<uint8_t>("AEDUF"[i % 5]);
+
+    static constexpr const char* decode_names[]{"itch add_order", "itch execute_order", "itch delete_order", "itch scan_types"};
+    const IsaVariants<DecodeLoopFn> decoders{{ decode_scalar, decode_sse42, decode_avx2, nullptr }};
+
+    for (int what = 0; what < 4; ++what) {
+        for (int l = 0; l <= static_cast<int>(top) && l < static_cast<int>(Isa::AVX512); ++l) {
+            DecodeLoopFn* fn = decoders.v[l];
+            run(decode_names[what], static_cast<Isa>(l), iters, [&] { return fn(msgs.data(), what, iters); });
+        }
+    }
+    printf("\n");
+
+    // ── ChunkyBucketMap chunk kernels ──────────────────────────────────────────
+    struct alignas(32) Chunk { uint8_t tags[32]; uint64_t keys[4]; };
+    std::vector<Chunk> chunks(4096);
+    for (auto& c : chunks) {
+        memset(c.tags, 0xFF, sizeof(c.tags));
+        for (int s = 0; s < 4; ++s) {
+            c.keys[s] = rng();
+            c.tags[s] = (rng() & 3) ? static_cast<uint8_t>(c.keys[s] & 0x7F) : 0xFE;
+        }
+    }
+
+    const IsaVariants<ChunkMatchFn> match{{ chunk_match_scalar, chunk_match_sse42, chunk_match_avx2, chunk_match_avx512 }};
+    const IsaVariants<ChunkFreeMaskFn> freem{{ chunk_free_mask_scalar, chunk_free_mask_sse42, chunk_free_mask_avx2, chunk_free_mask_avx512 }};
+
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        ChunkMatchFn* fn = match.v[l];
+        run("chunk_match", static_cast<Isa>(l), iters, [&] {
+            uint64_t acc = 0;
+            for (uint64_t it = 0; it < iters; ++it) {
+                const Chunk& c = chunks[it & 4095];
+                const uint64_t key = c.keys[it & 3] + ((it >> 2) & 1);   // half hits, half misses
+                acc += static_cast<uint64_t>(fn(c.tags, c.keys, static_cast<uint8_t>(key & 0x7F), key) + 1);
+            }
+            return acc;
+        });
+    }
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        ChunkFreeMaskFn* fn = freem.v[l];
+        run("chunk_free_mask", static_cast<Isa>(l), iters, [&] {
+            uint64_t acc = 0;
+            for (uint64_t it = 0; it < iters; ++it)
+                acc += fn(chunks[it & 4095].tags);
+            return acc;
+        });
+    }
+    printf("\n");
+
+    // ── ChunkedPriceBook insert-position scan ─────────────────────────────────
+    const IsaVariants<PriceInsertFn> insert{{ price_insert_index_scalar<true>, price_insert_index_sse42<true>,
+                                              price_insert_index_avx2<true>, price_insert_index_avx512<true> }};
+
+    for (const uint32_t depth : {8u, 32u, 128u}) {
+        // descending bid ladder, zero padded to a multiple of 8 as ChunkedPriceBook::grow does
+        std::vector<uint32_t> raw(depth + 16, 0);
+        uint32_t* prices = reinterpret_cast<uint32_t*>((reinterpret_cast<uintptr_t>(raw.data()) + 31) & ~uintptr_t{31});
+        for (uint32_t i = 0; i < depth; ++i) prices[i] = 1'000'000 - i * 10;
+
+        char label[32];
+        snprintf(label, sizeof(label), "price_insert bid d=%u", depth);
+        const uint64_t n = iters / (depth / 8);
+        for (int l = 0; l <= static_cast<int>(top); ++l) {
+            PriceInsertFn* fn = insert.v[l];
+            run(label, static_cast<Isa>(l), n, [&] {
+                uint64_t acc = 0;
+                bool exists = false;
+                for (uint64_t it = 0; it < n; ++it) {
+                    const uint32_t price = 1'000'000 - static_cast<uint32_t>(it % (depth * 10));
+                    acc += fn(prices, depth, price, exists) + exists;
+                }
+                return acc;
+            });
+        }
+    }
+    printf("\n");
+
+    // ── Pagedbook level clear ──────────────────────────────────────────────────
+    const IsaVariants<Zero32Fn> zero{{ zero32_scalar, zero32_sse42, zero32_avx2, nullptr }};
+    std::vector<Chunk> levels(4096);
+    for (int l = 0; l <= static_cast<int>(top) && l < static_cast<int>(Isa::AVX512); ++l) {
+        Zero32Fn* fn = zero.v[l];
+        run("zero32", static_cast<Isa>(l), iters, [&] {
+            for (uint64_t it = 0; it < iters; ++it)
+                fn(levels[it & 4095].tags);
+            return uint64_t{levels[iters & 4095].tags[0]};
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,1757 @@
+/**
+ * itch5_avx.h
+ *
+ * ITCH 5.0 wire formats and per-ISA message decoders, shared by the receiver
+ * (itch5_efvi.cpp) and the benchmarks.
+ *
+ * Every order-book and trade message (A F E C X D U P Q B) and the two
+ * session messages S / R have a decoder at each IsaDispatch.h level:
+ *   scalar_decode_*   memcpy + __builtin_bswap      (any x86-64)
+ *   sse_decode_*      two 16-byte VPSHUFB shuffles   (SSSE3/SSE4.2)
+ *   avx_decode_*      one 32-byte VPSHUFB shuffle    (AVX2)
+ *   vbmi_decode_*     one 64-byte VPERMB permute     (AVX-512 VBMI; A F E C X D U)
+ * The administrative and auction messages (H Y L V W K J h I N O) are well
+ * under 1% of a day's traffic and only have the scalar decoder, which every
+ * level uses.  The Decode* policy structs at the bottom bundle one level's set
+ * so that a parse loop templated on the policy can be instantiated once per
+ * ISA with all decoders inlined.  Nothing here needs -march / -mavx2: the SIMD
+ * variants carry their own [[gnu::target]] and are only called after g_isa
+ * says they are safe.
+ */
+
+#ifndef ITCH5_AVX_H_INCLUDED
+#define ITCH5_AVX_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>          // SSE4.2 / AVX2 / AVX-512, enabled per function
+
+#include "IsaDispatch.h"
+
+// ─── ITCH 5.0 message types ──────────────────────────────────────────────────
+
+enum class MsgType : uint8_t {
+    SystemEvent       = 'S',
+    StockDirectory    = 'R',
+    TradingAction     = 'H',
+    RegSHO            = 'Y',
+    MarketParticipant = 'L',
+    MwcbDecline       = 'V',
+    MwcbStatus        = 'W',
+    IpoQuoting        = 'K',
+    LuldCollar        = 'J',
+    OperationalHalt   = 'h',
+    AddOrder          = 'A',
+    AddOrderMPID      = 'F',
+    ExecuteOrder      = 'E',
+    ExecuteOrderPrice = 'C',
+    CancelOrder       = 'X',
+    DeleteOrder       = 'D',
+    ReplaceOrder      = 'U',
+    Trade             = 'P',
+    CrossTrade        = 'Q',
+    BrokenTrade       = 'B',
+    Noii              = 'I',
+    Rpii              = 'N',
+    Dlcr              = 'O',
+};
+
+// Body length (type byte included) of every type; 0 = not an ITCH 5.0 type.
+static constexpr uint16_t itch_msg_len(const uint8_t type) noexcept {
+    switch (static_cast<MsgType>(type)) {
+        case MsgType::SystemEvent:       return 12;
+        case MsgType::StockDirectory:    return 39;
+        case MsgType::TradingAction:     return 25;
+        case MsgType::RegSHO:            return 20;
+        case MsgType::MarketParticipant: return 26;
+        case MsgType::MwcbDecline:       return 35;
+        case MsgType::MwcbStatus:        return 12;
+        case MsgType::IpoQuoting:        return 28;
+        case MsgType::LuldCollar:        return 35;
+        case MsgType::OperationalHalt:   return 21;
+        case MsgType::AddOrder:          return 36;
+        case MsgType::AddOrderMPID:      return 40;
+        case MsgType::ExecuteOrder:      return 31;
+        case MsgType::ExecuteOrderPrice: return 36;
+        case MsgType::CancelOrder:       return 23;
+        case MsgType::DeleteOrder:       return 19;
+        case MsgType::ReplaceOrder:      return 35;
+        case MsgType::Trade:             return 44;
+        case MsgType::CrossTrade:        return 40;
+        case MsgType::BrokenTrade:       return 19;
+        case MsgType::Noii:              return 50;
+        case MsgType::Rpii:              return 20;
+        case MsgType::Dlcr:              return 48;
+    }
+    return 0;
+}
+
+#pragma pack(push, 1)
+
+struct MoldUDP64Header {
+    char     session[10];
+    uint64_t seqno;        // big-endian
+    uint16_t msg_count;    // big-endian
+};
+
+struct ITCHMsgHeader {
+    uint16_t length;       // big-endian, excludes this field
+    uint8_t  type;
+};
+
+struct AddOrderMsg {
+    uint8_t  type;         // 'A'
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint8_t  timestamp[6];
+    uint64_t order_ref;
+    char     side;         // 'B' or 'S'
+    uint32_t shares;
+    char     stock[8];
+    uint32_t price;        // fixed-point 4 decimals
+};
+
+struct ExecuteOrderMsg {
+    uint8_t  type;         // 'E'
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint8_t  timestamp[6];
+    uint64_t order_ref;
+    uint32_t executed_shares;
+    uint64_t match_num;
+};
+
+struct DeleteOrderMsg {
+    uint8_t  type;         // 'D'
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint8_t  timestamp[6];
+    uint64_t order_ref;
+};
+
+#pragma pack(pop)
+
+// The MoldUDP64 downstream header; the first message block follows it.
+static constexpr uint32_t MOLD_HDR_LEN = sizeof(MoldUDP64Header);
+static_assert(MOLD_HDR_LEN == 20, "MoldUDP64 header is session 10 + seqno 8 + count 2");
+
+// ─── AVX2 decoding ───────────────────────────────────────────────────────────
+//
+// Strategy: for each message type, issue a single VMOVDQU (32-byte load) then
+// use VPSHUFB (_mm256_shuffle_epi8) to simultaneously:
+//   (a) byte-swap every multi-byte BE field to host-endian LE, and
+//   (b) pack the extracted fields into predictable register lanes,
+// in one instruction.  Scalar _mm256_extract_epi{16,32,64} then pull clean
+// host-endian values with no branches and no loop overhead.
+//
+// Fields that cross the 16-byte lane boundary (VPSHUFB cannot cross lanes) or
+// fall outside the 32-byte window are handled by dedicated xmm primitives
+// (VMOVQ + VPSHUFB on xmm, 2-cycle latency, fully pipelined).
+//
+// _mm256_set_epi8(e31,e30,...,e1,e0) argument convention:
+//   arg at position P from the LEFT controls dst byte (31-P).
+//   Positions 0-15  → dst bytes 31-16 (lane 1, local indices 15-0)
+//   Positions 16-31 → dst bytes 15- 0 (lane 0, local indices 15-0)
+//   Each value is a LOCAL lane byte index (0-15); -1 zeros that dst byte.
+//
+// shuffle arg ordering for a bswap of a BE u16 at lane0 offsets [lo_idx, hi_idx]
+// into dst bytes [d_lo, d_lo+1]:
+//   dst[d_lo]   = lane0[hi_idx]   ← MSB of BE  → LSB of LE
+//   dst[d_lo+1] = lane0[lo_idx]   ← LSB of BE  → MSB of LE
+//   In set_epi8: pos (31 - d_lo)   = hi_idx
+//                pos (31 - d_lo-1) = lo_idx
+//
+// All shuffle maps below are derived analytically and checked against known
+// wire vectors at every ISA level: itch5_bench.cpp runs verify_wire_vectors()
+// before timing anything and asserts every decoded field of every type.
+
+// ── Unaligned load helpers ────────────────────────────────────────────────────
+//
+// ITCH messages are packed back-to-back inside MoldUDP64 datagrams.  After
+// the first message the cursor advances by (2 + mlen) bytes, so every
+// subsequent message body starts at an ARBITRARY byte offset — there is no
+// alignment guarantee at all.
+//
+// C++ aliasing rules: dereferencing a T* that is not suitably aligned for T
+// is undefined behaviour.  On x86 unaligned integer reads happen to work at
+// runtime, but the compiler is free to assume the pointer IS aligned and emit
+// instructions (e.g. MOVAPS) that fault on unaligned addresses, or reorder /
+// eliminate loads based on the false alignment assumption.
+//
+// Safe pattern: use memcpy (elided to a single MOV by every modern compiler)
+// or the Intel-blessed "loadu" intrinsics that carry the unaligned contract.
+//
+// Intrinsic alignment contracts (Intel Intrinsics Guide):
+//   _mm256_loadu_si256  — no alignment requirement  ✓
+//   _mm_loadu_si64      — no alignment requirement  ✓  (GCC/Clang: SSE2)
+//   _mm_loadu_si32      — no alignment requirement  ✓  (GCC 11+ / Clang 10+)
+//   _mm_loadl_epi64(p)  — p must be 8-byte aligned  ✗  (despite the name)
+//   _mm_cvtsi32_si128(*reinterpret_cast<uint32_t*>(p)) — UB if p unaligned  ✗
+//
+// We replace the two broken primitives with __builtin_memcpy-into-scalar,
+// which the compiler lowers to a single unaligned integer load (MOVQ / MOV r32).
+
+// bswap64_xmm: load 8 unaligned bytes → reverse byte order → host-endian u64.
+// Emits: MOVQ xmm + VPSHUFB xmm — 2-cycle latency, no alignment fault risk.
+[[gnu::target("sse4.2")]]
+static inline uint64_t bswap64_xmm(const uint8_t* __restrict__ p) noexcept {
+    // __builtin_memcpy → compiler emits MOVQ xmm (zero-extends), no UB.
+    uint64_t raw;
+    __builtin_memcpy(&raw, p, 8);
+    __m128i v = _mm_cvtsi64_si128(static_cast<long long>(raw));
+    // Shuffle: dst[i] = src[7-i]  — byte-reversal inside the low 8 bytes.
+    // _mm_set_epi8(e15..e0): e0=dst[0]=src[7], e1=dst[1]=src[6], ..., e7=dst[7]=src[0].
+    const __m128i sh = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1, 0,1,2,3,4,5,6,7);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_shuffle_epi8(v, sh)));
+}
+
+// bswap32_xmm: load 4 unaligned bytes → reverse → host-endian u32.
+// Emits: MOV r32 (unaligned scalar) + VMOVD xmm + VPSHUFB xmm.
+[[gnu::target("sse4.2")]]
+static inline uint32_t bswap32_xmm(const uint8_t* __restrict__ p) noexcept {
+    uint32_t raw;
+    __builtin_memcpy(&raw, p, 4);                 // single MOV r32, no UB
+    __m128i v = _mm_cvtsi32_si128(static_cast<int>(raw));
+    // Shuffle: dst[i] = src[3-i]  — byte-reversal inside the low 4 bytes.
+    // e3=dst[3]=src[0], e2=dst[2]=src[1], e1=dst[1]=src[2], e0=dst[0]=src[3].
+    const __m128i sh = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 0,1,2,3);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi8(v, sh)));
+}
+
+// ymm_loadu: unaligned 32-byte load with explicit aliasing safety.
+// The standard cast-to-__m256i* is technically UB for unaligned pointers under
+// strict-aliasing rules.  __m256i_u (GCC/Clang <immintrin.h>) carries
+// __attribute__((__may_alias__, __aligned__(1))), so the compiler knows the
+// load is intentionally unaligned and will not propagate alignment assumptions.
+[[gnu::target("avx2")]]
+static inline __m256i ymm_loadu(const uint8_t* __restrict__ p) noexcept {
+    return *reinterpret_cast<const __m256i_u*>(p);
+}
+
+// ── AddOrder ('A') / AddOrderMPID ('F') ─────────────────────────────────────
+//
+// Wire body layout (36 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48  (nanoseconds past midnight)
+//   [11-18] order_ref     BE u64
+//   [19]    side          'B' or 'S'
+//   [20-23] shares        BE u32
+//   [24-31] stock         ASCII, space-padded
+//   [32-35] price         BE u32  (fixed-point ×10000)
+//
+// One 32-byte VMOVDQU covers bytes [0-31] (both lanes).
+// Lane 0 = msg[0-15]:  extracts stock_locate, tracking_num
+// Lane 1 = msg[16-31]: extracts shares (bswap), stock (ASCII, no swap)
+// order_ref (msg[11-18]) straddles the lane boundary → bswap64_xmm.
+// timestamp (msg[5-10], 6 bytes) → bswap64_xmm(msg+5) >> 16 (drops 2 low bytes).
+// price (msg[32-35]) is outside the 32-byte window → bswap32_xmm.
+//
+// Shuffle map (verified):
+//   dst[ 0- 1] = bswap(lane0[1-2])  → stock_locate LE
+//   dst[ 2- 3] = bswap(lane0[3-4])  → tracking_num LE
+//   dst[16-19] = bswap(lane1[4-7])  → shares LE
+//   dst[24-31] = lane1[8-15]        → stock[0-7] (no swap, ASCII)
+//   all other dst bytes = 0
+
+struct DecodedAddOrder {
+    uint64_t order_ref;
+    uint32_t shares;
+    uint32_t price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];      // NUL-terminated
+    char     side;
+    uint64_t timestamp_ns;  // nanoseconds past midnight, u48 value in u64
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedAddOrder avx_decode_add_order(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    // Shuffle derivation (positions = arg index from LEFT in set_epi8 call):
+    //
+    // stock_locate: dst[0]=lane0[2], dst[1]=lane0[1]
+    //   pos31 (→ dst[0]) = 2,  pos30 (→ dst[1]) = 1
+    // tracking_num: dst[2]=lane0[4], dst[3]=lane0[3]
+    //   pos29 (→ dst[2]) = 4,  pos28 (→ dst[3]) = 3
+    // shares (bswap): dst[16]=lane1[7], dst[17]=lane1[6], dst[18]=lane1[5], dst[19]=lane1[4]
+    //   pos15 (→ dst[16]) = 7, pos14 (→ dst[17]) = 6,
+    //   pos13 (→ dst[18]) = 5, pos12 (→ dst[19]) = 4
+    //   → args at positions 12-15 in LEFT-to-RIGHT order = 4, 5, 6, 7
+    // stock (no swap): dst[24]=lane1[8], ..., dst[31]=lane1[15]
+    //   pos7 (→ dst[24]) = 8, pos6 (→ dst[25]) = 9, ..., pos0 (→ dst[31]) = 15
+    //   → args at positions 0-7 = 15,14,13,12,11,10,9,8
+    const __m256i shuf = _mm256_set_epi8(
+        // pos  0- 7 → dst[31-24] : stock[7..0] = lane1[15..8]
+        15,14,13,12,11,10, 9, 8,
+        // pos  8-11 → dst[23-20] : zeros
+        -1,-1,-1,-1,
+        // pos 12-15 → dst[19-16] : shares bswap = lane1[4..7] reversed
+         4, 5, 6, 7,
+        // pos 16-27 → dst[15- 4] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 28-31 → dst[ 3- 0] : tracking_num, stock_locate (both bswapped)
+         3, 4, 1, 2
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    // extract_epi16(n) → 16-bit word n (byte offset 2n in the register)
+    uint16_t stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    uint16_t tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    // extract_epi32(4) → 32-bit word 4 = bytes 16-19
+    uint32_t shares       = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    // extract_epi64(3) → 64-bit word 3 = bytes 24-31 (stock ASCII)
+    uint64_t stock_lo     = static_cast<uint64_t>(_mm256_extract_epi64(out, 3));
+
+    // Cross-lane and out-of-window fields via xmm primitives:
+    uint64_t ts_raw       = bswap64_xmm(msg + 5);
+    uint64_t timestamp_ns = ts_raw >> 16;   // u48 in top 6 bytes after bswap
+    uint64_t order_ref    = bswap64_xmm(msg + 11);
+    char     side         = static_cast<char>(msg[19]);
+    uint32_t price        = bswap32_xmm(msg + 32);
+
+    DecodedAddOrder r{};
+    r.stock_locate = stock_locate;
+    r.tracking_num = tracking_num;
+    r.order_ref    = order_ref;
+    r.side         = side;
+    r.shares       = shares;
+    r.price        = price;
+    r.timestamp_ns = timestamp_ns;
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+// ── ExecuteOrder ('E') ───────────────────────────────────────────────────────
+//
+// Wire body layout (31 bytes):
+//   [0]     type
+//   [1-2]   stock_locate    BE u16
+//   [3-4]   tracking_num    BE u16
+//   [5-10]  timestamp       BE u48
+//   [11-18] order_ref       BE u64
+//   [19-22] executed_shares BE u32  → lane1 local offsets [3-6]
+//   [23-30] match_num       BE u64
+//
+// 32-byte load covers all 31 bytes (1 byte pad, buffer always ≥ 2 KB).
+// Lane 1 = msg[16-31]: executed_shares at local offsets [3-6].
+// executed_shares bswap: dst[16]=lane1[6], dst[17]=lane1[5], dst[18]=lane1[4], dst[19]=lane1[3]
+//   → args at positions 12-15 = 3, 4, 5, 6
+
+struct DecodedExecuteOrder {
+    uint64_t order_ref;
+    uint64_t match_num;
+    uint32_t executed_shares;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedExecuteOrder avx_decode_execute_order(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        // pos  0-11 → dst[31-20] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 12-15 → dst[19-16] : executed_shares bswap (lane1[3-6] reversed)
+         3, 4, 5, 6,
+        // pos 16-27 → dst[15- 4] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 28-31 → dst[ 3- 0] : tracking_num, stock_locate (bswapped)
+         3, 4, 1, 2
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    uint16_t stock_locate    = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    uint16_t tracking_num    = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    uint32_t executed_shares = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+
+    uint64_t ts_raw       = bswap64_xmm(msg + 5);
+    uint64_t timestamp_ns = ts_raw >> 16;
+    uint64_t order_ref    = bswap64_xmm(msg + 11);
+    uint64_t match_num    = bswap64_xmm(msg + 23);
+
+    return { order_ref, match_num, executed_shares, stock_locate, tracking_num, timestamp_ns };
+}
+
+// ── DeleteOrder ('D') ────────────────────────────────────────────────────────
+//
+// Wire body layout (19 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11-18] order_ref     BE u64
+//
+// 19 bytes < 32; 32-byte load is safe (ef_vi buffers are PKT_BUF_SIZE = 2 KB).
+
+struct DecodedDeleteOrder {
+    uint64_t order_ref;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedDeleteOrder avx_decode_delete_order(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,   // lane1 unused
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[15-4] unused
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    uint16_t stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    uint16_t tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+
+    uint64_t ts_raw       = bswap64_xmm(msg + 5);
+    uint64_t timestamp_ns = ts_raw >> 16;
+    uint64_t order_ref    = bswap64_xmm(msg + 11);
+
+    return { order_ref, stock_locate, tracking_num, timestamp_ns };
+}
+
+// ── ExecuteOrderWithPrice ('C') ──────────────────────────────────────────────
+//
+// Wire body layout (36 bytes):
+//   [0]     type
+//   [1-2]   stock_locate    BE u16
+//   [3-4]   tracking_num    BE u16
+//   [5-10]  timestamp       BE u48
+//   [11-18] order_ref       BE u64
+//   [19-22] executed_shares BE u32  → lane1 local offsets [3-6]
+//   [23-30] match_num       BE u64  → lane1 local offsets [7-14]
+//   [31]    printable       'Y' or 'N'
+//   [32-35] price           BE u32  (execution price, ×10000)
+//
+// Unlike 'E', match_num sits entirely inside lane 1 here and is byte-swapped
+// by the shuffle; price is outside the window → bswap32_xmm.
+//   dst[16-19] = bswap(lane1[3-6])   → executed_shares
+//   dst[24-31] = bswap(lane1[7-14])  → match_num
+//     dst[24]=lane1[14] ... dst[31]=lane1[7] → args at positions 0-7 = 7..14
+
+struct DecodedExecuteOrderPrice {
+    uint64_t order_ref;
+    uint64_t match_num;
+    uint32_t executed_shares;
+    uint32_t price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     printable;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedExecuteOrderPrice avx_decode_execute_order_price(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        // pos  0- 7 → dst[31-24] : match_num bswap = lane1[7..14]
+         7, 8, 9,10,11,12,13,14,
+        // pos  8-11 → dst[23-20] : zeros
+        -1,-1,-1,-1,
+        // pos 12-15 → dst[19-16] : executed_shares bswap = lane1[3..6]
+         3, 4, 5, 6,
+        // pos 16-27 → dst[15- 4] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 28-31 → dst[ 3- 0] : tracking_num, stock_locate (bswapped)
+         3, 4, 1, 2
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedExecuteOrderPrice r{};
+    r.stock_locate    = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num    = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.executed_shares = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.match_num       = static_cast<uint64_t>(_mm256_extract_epi64(out, 3));
+    r.timestamp_ns    = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref       = bswap64_xmm(msg + 11);
+    r.printable       = static_cast<char>(msg[31]);
+    r.price           = bswap32_xmm(msg + 32);
+    return r;
+}
+
+// ── CancelOrder ('X') ────────────────────────────────────────────────────────
+//
+// Wire body layout (23 bytes):
+//   [0]     type
+//   [1-2]   stock_locate     BE u16
+//   [3-4]   tracking_num     BE u16
+//   [5-10]  timestamp        BE u48
+//   [11-18] order_ref        BE u64
+//   [19-22] cancelled_shares BE u32  → lane1 local offsets [3-6]
+//
+// Same field positions as 'E' up to byte 22, so the same shuffle map.
+
+struct DecodedCancelOrder {
+    uint64_t order_ref;
+    uint32_t cancelled_shares;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedCancelOrder avx_decode_cancel_order(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[31-20] unused
+         3, 4, 5, 6,                                         // cancelled_shares bswap
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[15-4] unused
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedCancelOrder r{};
+    r.stock_locate     = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num     = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.cancelled_shares = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.timestamp_ns     = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref        = bswap64_xmm(msg + 11);
+    return r;
+}
+
+// ── ReplaceOrder ('U') ───────────────────────────────────────────────────────
+//
+// Wire body layout (35 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11-18] orig_ref      BE u64
+//   [19-26] new_ref       BE u64  → lane1 local offsets [3-10]
+//   [27-30] shares        BE u32  → lane1 local offsets [11-14]
+//   [31-34] price         BE u32  (new price, ×10000)
+//
+//   dst[16-19] = bswap(lane1[11-14]) → shares
+//     dst[16]=lane1[14] ... dst[19]=lane1[11] → args at positions 12-15 = 11..14
+//   dst[24-31] = bswap(lane1[3-10])  → new_ref
+//     dst[24]=lane1[10] ... dst[31]=lane1[3]  → args at positions 0-7 = 3..10
+// price starts at byte 31 and runs past the window → bswap32_xmm.
+
+struct DecodedReplaceOrder {
+    uint64_t orig_ref;
+    uint64_t new_ref;
+    uint32_t shares;
+    uint32_t price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedReplaceOrder avx_decode_replace_order(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        // pos  0- 7 → dst[31-24] : new_ref bswap = lane1[3..10]
+         3, 4, 5, 6, 7, 8, 9,10,
+        // pos  8-11 → dst[23-20] : zeros
+        -1,-1,-1,-1,
+        // pos 12-15 → dst[19-16] : shares bswap = lane1[11..14]
+        11,12,13,14,
+        // pos 16-27 → dst[15- 4] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 28-31 → dst[ 3- 0] : tracking_num, stock_locate (bswapped)
+         3, 4, 1, 2
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedReplaceOrder r{};
+    r.stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.shares       = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.new_ref      = static_cast<uint64_t>(_mm256_extract_epi64(out, 3));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.orig_ref     = bswap64_xmm(msg + 11);
+    r.price        = bswap32_xmm(msg + 31);
+    return r;
+}
+
+// ── Trade ('P', non-cross) ───────────────────────────────────────────────────
+//
+// Wire body layout (44 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11-18] order_ref     BE u64  (0 for non-displayed orders since 2014)
+//   [19]    side          'B' or 'S'
+//   [20-23] shares        BE u32
+//   [24-31] stock         ASCII
+//   [32-35] price         BE u32
+//   [36-43] match_num     BE u64
+//
+// Bytes [0-35] are laid out exactly like 'A', so the 32-byte window uses the
+// add_order shuffle map; match_num is past the window → bswap64_xmm.
+
+struct DecodedTrade {
+    uint64_t order_ref;
+    uint64_t match_num;
+    uint32_t shares;
+    uint32_t price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];      // NUL-terminated
+    char     side;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedTrade avx_decode_trade(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        15,14,13,12,11,10, 9, 8,                             // stock[7..0] = lane1[15..8]
+        -1,-1,-1,-1,                                         // dst[23-20] unused
+         4, 5, 6, 7,                                         // shares bswap = lane1[4..7]
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[15-4] unused
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    uint64_t stock_lo = static_cast<uint64_t>(_mm256_extract_epi64(out, 3));
+
+    DecodedTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.shares       = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref    = bswap64_xmm(msg + 11);
+    r.side         = static_cast<char>(msg[19]);
+    r.price        = bswap32_xmm(msg + 32);
+    r.match_num    = bswap64_xmm(msg + 36);
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+// ── CrossTrade ('Q') ─────────────────────────────────────────────────────────
+//
+// Wire body layout (40 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11-18] shares        BE u64  (a cross can exceed 2^32 shares)
+//   [19-26] stock         ASCII   → lane1 local offsets [3-10]
+//   [27-30] cross_price   BE u32  → lane1 local offsets [11-14]
+//   [31-38] match_num     BE u64
+//   [39]    cross_type    'O' open, 'C' close, 'H' IPO / halt, 'I' intraday
+//
+//   dst[16-19] = bswap(lane1[11-14]) → cross_price  (args 12-15 = 11..14)
+//   dst[24-31] = lane1[3-10]         → stock, no swap (args 0-7 = 10..3)
+
+struct DecodedCrossTrade {
+    uint64_t shares;
+    uint64_t match_num;
+    uint32_t price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];      // NUL-terminated
+    char     cross_type;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedCrossTrade avx_decode_cross_trade(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        // pos  0- 7 → dst[31-24] : stock[7..0] = lane1[10..3]
+        10, 9, 8, 7, 6, 5, 4, 3,
+        // pos  8-11 → dst[23-20] : zeros
+        -1,-1,-1,-1,
+        // pos 12-15 → dst[19-16] : cross_price bswap = lane1[11..14]
+        11,12,13,14,
+        // pos 16-27 → dst[15- 4] : zeros
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        // pos 28-31 → dst[ 3- 0] : tracking_num, stock_locate (bswapped)
+         3, 4, 1, 2
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    uint64_t stock_lo = static_cast<uint64_t>(_mm256_extract_epi64(out, 3));
+
+    DecodedCrossTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.price        = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.shares       = bswap64_xmm(msg + 11);
+    r.match_num    = bswap64_xmm(msg + 31);
+    r.cross_type   = static_cast<char>(msg[39]);
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+// ── BrokenTrade ('B') ────────────────────────────────────────────────────────
+//
+// Wire body layout (19 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11-18] match_num     BE u64
+//
+// Same layout as 'D' with match_num in place of order_ref.
+
+struct DecodedBrokenTrade {
+    uint64_t match_num;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedBrokenTrade avx_decode_broken_trade(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,   // lane1 unused
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[15-4] unused
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedBrokenTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.match_num    = bswap64_xmm(msg + 11);
+    return r;
+}
+
+// ── SystemEvent ('S') ────────────────────────────────────────────────────────
+//
+// Wire body layout (12 bytes):
+//   [0]     type
+//   [1-2]   stock_locate  BE u16  (always 0)
+//   [3-4]   tracking_num  BE u16
+//   [5-10]  timestamp     BE u48
+//   [11]    event_code    'O' 'S' 'Q' 'M' 'E' 'C'
+//
+// Everything is in lane 0; the event code rides along in dst[4].
+
+struct DecodedSystemEvent {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     event_code;
+    uint64_t timestamp_ns;
+};
+
+[[gnu::target("avx2")]]
+static inline DecodedSystemEvent avx_decode_system_event(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,   // lane1 unused
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                   // dst[15-5] unused
+        11,                                                  // dst[4] = event_code
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedSystemEvent r{};
+    r.stock_locate = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.event_code   = static_cast<char>(_mm256_extract_epi8(out, 4));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    return r;
+}
+
+// ── StockDirectory ('R') ─────────────────────────────────────────────────────
+//
+// Wire body layout (39 bytes):
+//   [0]     type
+//   [1-2]   stock_locate          BE u16  (the locate this stock keeps all day)
+//   [3-4]   tracking_num          BE u16
+//   [5-10]  timestamp             BE u48
+//   [11-18] stock                 ASCII
+//   [19]    market_category
+//   [20]    financial_status
+//   [21-24] round_lot_size        BE u32  → lane1 local offsets [5-8]
+//   [25]    round_lots_only
+//   [26]    issue_classification
+//   [27-28] issue_subtype         ASCII
+//   [29]    authenticity
+//   [30]    short_sale_threshold
+//   [31]    ipo_flag
+//   [32]    luld_tier
+//   [33]    etp_flag
+//   [34-37] etp_leverage          BE u32
+//   [38]    inverse_indicator
+//
+// stock straddles the lane boundary and is copied with one 8-byte MOV; the
+// single-byte flags are plain loads.
+//   dst[16-19] = bswap(lane1[5-8]) → round_lot_size (args 12-15 = 5..8)
+
+struct DecodedStockDirectory {
+    uint32_t round_lot_size;
+    uint32_t etp_leverage;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];      // NUL-terminated
+    char     market_category;
+    char     financial_status;
+    char     round_lots_only;
+    char     issue_classification;
+    char     issue_subtype[3];  // NUL-terminated
+    char     authenticity;
+    char     short_sale_threshold;
+    char     ipo_flag;
+    char     luld_tier;
+    char     etp_flag;
+    char     inverse_indicator;
+    uint64_t timestamp_ns;
+};
+
+// the fields after the header are copied the same way by every level
+static inline void decode_stock_directory_tail(const uint8_t* msg, DecodedStockDirectory& r) noexcept {
+    memcpy(r.stock, msg + 11, 8);
+    r.stock[8]             = '\0';
+    r.market_category      = static_cast<char>(msg[19]);
+    r.financial_status     = static_cast<char>(msg[20]);
+    r.round_lots_only      = static_cast<char>(msg[25]);
+    r.issue_classification = static_cast<char>(msg[26]);
+    memcpy(r.issue_subtype, msg + 27, 2);
+    r.issue_subtype[2]     = '\0';
+    r.authenticity         = static_cast<char>(msg[29]);
+    r.short_sale_threshold = static_cast<char>(msg[30]);
+    r.ipo_flag             = static_cast<char>(msg[31]);
+    r.luld_tier            = static_cast<char>(msg[32]);
+    r.etp_flag             = static_cast<char>(msg[33]);
+    r.inverse_indicator    = static_cast<char>(msg[38]);
+}
+
+[[gnu::target("avx2")]]
+static inline DecodedStockDirectory avx_decode_stock_directory(const uint8_t* msg) noexcept {
+    __m256i raw = ymm_loadu(msg);
+
+    const __m256i shuf = _mm256_set_epi8(
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[31-20] unused
+         5, 6, 7, 8,                                         // round_lot_size bswap
+        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,                // dst[15-4] unused
+         3, 4, 1, 2                                          // tracking, stock_locate
+    );
+    __m256i out = _mm256_shuffle_epi8(raw, shuf);
+
+    DecodedStockDirectory r{};
+    r.stock_locate   = static_cast<uint16_t>(_mm256_extract_epi16(out, 0));
+    r.tracking_num   = static_cast<uint16_t>(_mm256_extract_epi16(out, 1));
+    r.round_lot_size = static_cast<uint32_t>(_mm256_extract_epi32(out, 4));
+    r.timestamp_ns   = bswap64_xmm(msg + 5) >> 16;
+    r.etp_leverage   = bswap32_xmm(msg + 34);
+    decode_stock_directory_tail(msg, r);
+    return r;
+}
+
+// ── Type scanner: find interesting message type bytes in a 32-byte window ────
+// Returns bitmask: bit i set ↔ byte i is one of A/F/E/D/U.
+[[gnu::target("avx2")]]
+static inline uint32_t avx_scan_types(const uint8_t* p) noexcept {
+    __m256i data = ymm_loadu(p);
+    __m256i any  = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('A')),
+                        _mm256_cmpeq_epi8(data, _mm256_set1_epi8('F'))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('E')),
+                            _mm256_cmpeq_epi8(data, _mm256_set1_epi8('D'))),
+            _mm256_cmpeq_epi8(data, _mm256_set1_epi8('U'))));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(any));
+}
+
+// ── SSE4.2 decoders ─────────────────────────────────────────────────────────
+//
+// Same shuffle maps as the AVX2 versions, split into their two 128-bit lanes:
+// one VPSHUFB on msg[0-15] (the lane-0 half) and one on msg[16-31] (lane 1).
+// _mm_set_epi8(e15..e0): the LAST argument controls dst byte 0.
+
+[[gnu::target("sse4.2")]]
+static inline DecodedAddOrder sse_decode_add_order(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    // dst[0-1] = stock_locate, dst[2-3] = tracking_num (both bswapped)
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = shares bswap (hi[4-7] reversed), dst[8-15] = stock (hi[8-15])
+    const __m128i shuf_hi = _mm_set_epi8(15,14,13,12,11,10, 9, 8,-1,-1,-1,-1, 4, 5, 6, 7);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    uint64_t stock_lo = static_cast<uint64_t>(_mm_extract_epi64(out_hi, 1));
+
+    DecodedAddOrder r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.shares       = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref    = bswap64_xmm(msg + 11);
+    r.side         = static_cast<char>(msg[19]);
+    r.price        = bswap32_xmm(msg + 32);
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedExecuteOrder sse_decode_execute_order(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = executed_shares bswap (hi[3-6] reversed)
+    const __m128i shuf_hi = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 5, 6);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    uint16_t stock_locate    = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    uint16_t tracking_num    = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    uint32_t executed_shares = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+
+    uint64_t timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    uint64_t order_ref    = bswap64_xmm(msg + 11);
+    uint64_t match_num    = bswap64_xmm(msg + 23);
+
+    return { order_ref, match_num, executed_shares, stock_locate, tracking_num, timestamp_ns };
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedDeleteOrder sse_decode_delete_order(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+
+    uint16_t stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    uint16_t tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+
+    uint64_t timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    uint64_t order_ref    = bswap64_xmm(msg + 11);
+
+    return { order_ref, stock_locate, tracking_num, timestamp_ns };
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedExecuteOrderPrice sse_decode_execute_order_price(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = executed_shares bswap (hi[3-6]), dst[8-15] = match_num bswap (hi[7-14])
+    const __m128i shuf_hi = _mm_set_epi8( 7, 8, 9,10,11,12,13,14,-1,-1,-1,-1, 3, 4, 5, 6);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    DecodedExecuteOrderPrice r{};
+    r.stock_locate    = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num    = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.executed_shares = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.match_num       = static_cast<uint64_t>(_mm_extract_epi64(out_hi, 1));
+    r.timestamp_ns    = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref       = bswap64_xmm(msg + 11);
+    r.printable       = static_cast<char>(msg[31]);
+    r.price           = bswap32_xmm(msg + 32);
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedCancelOrder sse_decode_cancel_order(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = cancelled_shares bswap (hi[3-6] reversed)
+    const __m128i shuf_hi = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 5, 6);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    DecodedCancelOrder r{};
+    r.stock_locate     = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num     = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.cancelled_shares = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.timestamp_ns     = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref        = bswap64_xmm(msg + 11);
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedReplaceOrder sse_decode_replace_order(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = shares bswap (hi[11-14]), dst[8-15] = new_ref bswap (hi[3-10])
+    const __m128i shuf_hi = _mm_set_epi8( 3, 4, 5, 6, 7, 8, 9,10,-1,-1,-1,-1,11,12,13,14);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    DecodedReplaceOrder r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.shares       = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.new_ref      = static_cast<uint64_t>(_mm_extract_epi64(out_hi, 1));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.orig_ref     = bswap64_xmm(msg + 11);
+    r.price        = bswap32_xmm(msg + 31);
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedTrade sse_decode_trade(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    // add_order's maps: [0-35] of 'P' match 'A'
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    const __m128i shuf_hi = _mm_set_epi8(15,14,13,12,11,10, 9, 8,-1,-1,-1,-1, 4, 5, 6, 7);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    uint64_t stock_lo = static_cast<uint64_t>(_mm_extract_epi64(out_hi, 1));
+
+    DecodedTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.shares       = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.order_ref    = bswap64_xmm(msg + 11);
+    r.side         = static_cast<char>(msg[19]);
+    r.price        = bswap32_xmm(msg + 32);
+    r.match_num    = bswap64_xmm(msg + 36);
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedCrossTrade sse_decode_cross_trade(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = cross_price bswap (hi[11-14]), dst[8-15] = stock (hi[3-10])
+    const __m128i shuf_hi = _mm_set_epi8(10, 9, 8, 7, 6, 5, 4, 3,-1,-1,-1,-1,11,12,13,14);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    uint64_t stock_lo = static_cast<uint64_t>(_mm_extract_epi64(out_hi, 1));
+
+    DecodedCrossTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.price        = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.shares       = bswap64_xmm(msg + 11);
+    r.match_num    = bswap64_xmm(msg + 31);
+    r.cross_type   = static_cast<char>(msg[39]);
+    memcpy(r.stock, &stock_lo, 8);
+    r.stock[8] = '\0';
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedBrokenTrade sse_decode_broken_trade(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+
+    DecodedBrokenTrade r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    r.match_num    = bswap64_xmm(msg + 11);
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedSystemEvent sse_decode_system_event(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+
+    // dst[4] = event_code (lo[11])
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,11, 3, 4, 1, 2);
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+
+    DecodedSystemEvent r{};
+    r.stock_locate = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.event_code   = static_cast<char>(_mm_extract_epi8(out_lo, 4));
+    r.timestamp_ns = bswap64_xmm(msg + 5) >> 16;
+    return r;
+}
+
+[[gnu::target("sse4.2")]]
+static inline DecodedStockDirectory sse_decode_stock_directory(const uint8_t* msg) noexcept {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i_u*>(msg + 16));
+
+    const __m128i shuf_lo = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 3, 4, 1, 2);
+    // dst[0-3] = round_lot_size bswap (hi[5-8] reversed)
+    const __m128i shuf_hi = _mm_set_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, 5, 6, 7, 8);
+
+    __m128i out_lo = _mm_shuffle_epi8(lo, shuf_lo);
+    __m128i out_hi = _mm_shuffle_epi8(hi, shuf_hi);
+
+    DecodedStockDirectory r{};
+    r.stock_locate   = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 0));
+    r.tracking_num   = static_cast<uint16_t>(_mm_extract_epi16(out_lo, 1));
+    r.round_lot_size = static_cast<uint32_t>(_mm_cvtsi128_si32(out_hi));
+    r.timestamp_ns   = bswap64_xmm(msg + 5) >> 16;
+    r.etp_leverage   = bswap32_xmm(msg + 34);
+    decode_stock_directory_tail(msg, r);
+    return r;
+}
+
+// Same contract as avx_scan_types: bit i ↔ byte i of the 32-byte window.
+[[gnu::target("sse4.2")]]
+static inline uint32_t sse_scan_types(const uint8_t* p) noexcept {
+    auto scan16 = [](__m128i data) {
+        __m128i any = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(data, _mm_set1_epi8('A')),
+                         _mm_cmpeq_epi8(data, _mm_set1_epi8('F'))),
+            _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(data, _mm_set1_epi8('E')),
+                             _mm_cmpeq_epi8(data, _mm_set1_epi8('D'))),
+                _mm_cmpeq_epi8(data, _mm_set1_epi8('U'))));
+        return static_cast<uint32_t>(_mm_movemask_epi8(any));
+    };
+    return scan16(_mm_loadu_si128(reinterpret_cast<const __m128i_u*>(p)))
+         | (scan16(_mm_loadu_si128(reinterpret_cast<const __m128i_u*>(p + 16))) << 16);
+}
+
+// ── Scalar decoders ─────────────────────────────────────────────────────────
+//
+// Reference implementation and the fallback for hosts without SSSE3.
+// memcpy + __builtin_bswapNN compiles to MOV + BSWAP (or a single MOVBE).
+
+static inline uint16_t be16(const uint8_t* p) noexcept {
+    uint16_t v; __builtin_memcpy(&v, p, 2); return __builtin_bswap16(v);
+}
+static inline uint32_t be32(const uint8_t* p) noexcept {
+    uint32_t v; __builtin_memcpy(&v, p, 4); return __builtin_bswap32(v);
+}
+static inline uint64_t be64(const uint8_t* p) noexcept {
+    uint64_t v; __builtin_memcpy(&v, p, 8); return __builtin_bswap64(v);
+}
+// u48 timestamp at p[0-5]: read 8 bytes and drop the 2 trailing ones
+static inline uint64_t be48(const uint8_t* p) noexcept {
+    return be64(p) >> 16;
+}
+
+static inline DecodedAddOrder scalar_decode_add_order(const uint8_t* msg) noexcept {
+    DecodedAddOrder r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    r.order_ref    = be64(msg + 11);
+    r.side         = static_cast<char>(msg[19]);
+    r.shares       = be32(msg + 20);
+    memcpy(r.stock, msg + 24, 8);
+    r.stock[8]     = '\0';
+    r.price        = be32(msg + 32);
+    return r;
+}
+
+static inline DecodedExecuteOrder scalar_decode_execute_order(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be64(msg + 23), be32(msg + 19),
+             be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+static inline DecodedDeleteOrder scalar_decode_delete_order(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+static inline DecodedExecuteOrderPrice scalar_decode_execute_order_price(const uint8_t* msg) noexcept {
+    DecodedExecuteOrderPrice r{};
+    r.stock_locate    = be16(msg + 1);
+    r.tracking_num    = be16(msg + 3);
+    r.timestamp_ns    = be48(msg + 5);
+    r.order_ref       = be64(msg + 11);
+    r.executed_shares = be32(msg + 19);
+    r.match_num       = be64(msg + 23);
+    r.printable       = static_cast<char>(msg[31]);
+    r.price           = be32(msg + 32);
+    return r;
+}
+
+static inline DecodedCancelOrder scalar_decode_cancel_order(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be32(msg + 19), be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+static inline DecodedReplaceOrder scalar_decode_replace_order(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be64(msg + 19), be32(msg + 27), be32(msg + 31),
+             be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+static inline DecodedTrade scalar_decode_trade(const uint8_t* msg) noexcept {
+    DecodedTrade r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    r.order_ref    = be64(msg + 11);
+    r.side         = static_cast<char>(msg[19]);
+    r.shares       = be32(msg + 20);
+    memcpy(r.stock, msg + 24, 8);
+    r.stock[8]     = '\0';
+    r.price        = be32(msg + 32);
+    r.match_num    = be64(msg + 36);
+    return r;
+}
+
+static inline DecodedCrossTrade scalar_decode_cross_trade(const uint8_t* msg) noexcept {
+    DecodedCrossTrade r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    r.shares       = be64(msg + 11);
+    memcpy(r.stock, msg + 19, 8);
+    r.stock[8]     = '\0';
+    r.price        = be32(msg + 27);
+    r.match_num    = be64(msg + 31);
+    r.cross_type   = static_cast<char>(msg[39]);
+    return r;
+}
+
+static inline DecodedBrokenTrade scalar_decode_broken_trade(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+static inline DecodedSystemEvent scalar_decode_system_event(const uint8_t* msg) noexcept {
+    return { be16(msg + 1), be16(msg + 3), static_cast<char>(msg[11]), be48(msg + 5) };
+}
+
+static inline DecodedStockDirectory scalar_decode_stock_directory(const uint8_t* msg) noexcept {
+    DecodedStockDirectory r{};
+    r.stock_locate   = be16(msg + 1);
+    r.tracking_num   = be16(msg + 3);
+    r.timestamp_ns   = be48(msg + 5);
+    r.round_lot_size = be32(msg + 21);
+    r.etp_leverage   = be32(msg + 34);
+    decode_stock_directory_tail(msg, r);
+    return r;
+}
+
+static inline uint32_t scalar_scan_types(const uint8_t* p) noexcept {
+    uint32_t mask = 0;
+    for (int i = 0; i < 32; ++i) {
+        const uint8_t c = p[i];
+        // non-short-circuit | keeps the per-byte test branch-free
+        mask |= static_cast<uint32_t>((c == 'A') | (c == 'F') | (c == 'E') | (c == 'D') | (c == 'U')) << i;
+    }
+    return mask;
+}
+
+// ── Administrative and auction messages (scalar at every level) ──────────────
+//
+// All share the [0-10] header of the order messages.  Field offsets are given
+// next to each decoder; stock fields are ASCII, space-padded, NUL-terminated
+// in the decoded struct.  Prices are ×10000 except the MWCB levels (×10^8).
+
+// 'H' (25): [11-18] stock [19] trading_state [20] reserved [21-24] reason
+struct DecodedTradingAction {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     trading_state;   // 'H' halted, 'P' paused, 'Q' quotation only, 'T' trading
+    char     reason[5];
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedTradingAction scalar_decode_trading_action(const uint8_t* msg) noexcept {
+    DecodedTradingAction r{};
+    r.stock_locate  = be16(msg + 1);
+    r.tracking_num  = be16(msg + 3);
+    r.timestamp_ns  = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.trading_state = static_cast<char>(msg[19]);
+    memcpy(r.reason, msg + 21, 4);
+    return r;
+}
+
+// 'Y' (20): [11-18] stock [19] reg_sho_action
+struct DecodedRegSHO {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     action;          // '0' no price test, '1' restriction in effect, '2' remains in effect
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedRegSHO scalar_decode_reg_sho(const uint8_t* msg) noexcept {
+    DecodedRegSHO r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.action       = static_cast<char>(msg[19]);
+    return r;
+}
+
+// 'L' (26): [11-14] mpid [15-22] stock [23] primary_mm [24] mode [25] state
+struct DecodedMarketParticipant {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     mpid[5];
+    char     stock[9];
+    char     primary_mm;
+    char     mode;
+    char     state;
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedMarketParticipant scalar_decode_market_participant(const uint8_t* msg) noexcept {
+    DecodedMarketParticipant r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    memcpy(r.mpid, msg + 11, 4);
+    memcpy(r.stock, msg + 15, 8);
+    r.primary_mm   = static_cast<char>(msg[23]);
+    r.mode         = static_cast<char>(msg[24]);
+    r.state        = static_cast<char>(msg[25]);
+    return r;
+}
+
+// 'V' (35): [11-18] level1 [19-26] level2 [27-34] level3   BE u64, ×10^8
+struct DecodedMwcbDecline {
+    uint64_t level1;
+    uint64_t level2;
+    uint64_t level3;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedMwcbDecline scalar_decode_mwcb_decline(const uint8_t* msg) noexcept {
+    return { be64(msg + 11), be64(msg + 19), be64(msg + 27), be16(msg + 1), be16(msg + 3), be48(msg + 5) };
+}
+
+// 'W' (12): [11] breached_level '1' '2' '3'
+struct DecodedMwcbStatus {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     breached_level;
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedMwcbStatus scalar_decode_mwcb_status(const uint8_t* msg) noexcept {
+    return { be16(msg + 1), be16(msg + 3), static_cast<char>(msg[11]), be48(msg + 5) };
+}
+
+// 'K' (28): [11-18] stock [19-22] release_time (s past midnight) [23] qualifier [24-27] ipo_price
+struct DecodedIpoQuoting {
+    uint32_t release_time;
+    uint32_t ipo_price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     qualifier;       // 'A' anticipated, 'C' cancelled / postponed
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedIpoQuoting scalar_decode_ipo_quoting(const uint8_t* msg) noexcept {
+    DecodedIpoQuoting r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.release_time = be32(msg + 19);
+    r.qualifier    = static_cast<char>(msg[23]);
+    r.ipo_price    = be32(msg + 24);
+    return r;
+}
+
+// 'J' (35): [11-18] stock [19-22] ref_price [23-26] upper [27-30] lower [31-34] extension
+struct DecodedLuldCollar {
+    uint32_t ref_price;
+    uint32_t upper_price;
+    uint32_t lower_price;
+    uint32_t extension;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedLuldCollar scalar_decode_luld_collar(const uint8_t* msg) noexcept {
+    DecodedLuldCollar r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.ref_price    = be32(msg + 19);
+    r.upper_price  = be32(msg + 23);
+    r.lower_price  = be32(msg + 27);
+    r.extension    = be32(msg + 31);
+    return r;
+}
+
+// 'h' (21): [11-18] stock [19] market_code [20] halt_action
+struct DecodedOperationalHalt {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     market_code;     // 'Q' Nasdaq, 'B' BX, 'X' PSX
+    char     action;          // 'H' halted, 'T' resumed
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedOperationalHalt scalar_decode_operational_halt(const uint8_t* msg) noexcept {
+    DecodedOperationalHalt r{};
+    r.stock_locate = be16(msg + 1);
+    r.tracking_num = be16(msg + 3);
+    r.timestamp_ns = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.market_code  = static_cast<char>(msg[19]);
+    r.action       = static_cast<char>(msg[20]);
+    return r;
+}
+
+// 'I' (50): [11-18] paired_shares [19-26] imbalance_shares  BE u64
+//           [27] direction [28-35] stock [36-39] far [40-43] near [44-47] current_ref
+//           [48] cross_type [49] price_variation
+struct DecodedNoii {
+    uint64_t paired_shares;
+    uint64_t imbalance_shares;
+    uint32_t far_price;
+    uint32_t near_price;
+    uint32_t ref_price;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     direction;       // 'B' buy, 'S' sell, 'N' none, 'O' insufficient orders, 'P' paused
+    char     cross_type;
+    char     price_variation;
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedNoii scalar_decode_noii(const uint8_t* msg) noexcept {
+    DecodedNoii r{};
+    r.stock_locate     = be16(msg + 1);
+    r.tracking_num     = be16(msg + 3);
+    r.timestamp_ns     = be48(msg + 5);
+    r.paired_shares    = be64(msg + 11);
+    r.imbalance_shares = be64(msg + 19);
+    r.direction        = static_cast<char>(msg[27]);
+    memcpy(r.stock, msg + 28, 8);
+    r.far_price        = be32(msg + 36);
+    r.near_price       = be32(msg + 40);
+    r.ref_price        = be32(msg + 44);
+    r.cross_type       = static_cast<char>(msg[48]);
+    r.price_variation  = static_cast<char>(msg[49]);
+    return r;
+}
+
+// 'N' (20): [11-18] stock [19] interest_flag
+struct DecodedRpii {
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     interest_flag;   // 'B' 'S' 'A' both sides, 'N' none
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedRpii scalar_decode_rpii(const uint8_t* msg) noexcept {
+    DecodedRpii r{};
+    r.stock_locate  = be16(msg + 1);
+    r.tracking_num  = be16(msg + 3);
+    r.timestamp_ns  = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.interest_flag = static_cast<char>(msg[19]);
+    return r;
+}
+
+// 'O' (48): [11-18] stock [19] open_eligibility [20-23] min_price [24-27] max_price
+//           [28-31] near_price [32-39] near_time (BE u64) [40-43] lower_collar [44-47] upper_collar
+struct DecodedDlcr {
+    uint64_t near_exec_time;
+    uint32_t min_price;
+    uint32_t max_price;
+    uint32_t near_price;
+    uint32_t lower_collar;
+    uint32_t upper_collar;
+    uint16_t stock_locate;
+    uint16_t tracking_num;
+    char     stock[9];
+    char     open_eligibility;
+    uint64_t timestamp_ns;
+};
+
+static inline DecodedDlcr scalar_decode_dlcr(const uint8_t* msg) noexcept {
+    DecodedDlcr r{};
+    r.stock_locate     = be16(msg + 1);
+    r.tracking_num     = be16(msg + 3);
+    r.timestamp_ns     = be48(msg + 5);
+    memcpy(r.stock, msg + 11, 8);
+    r.open_eligibility = static_cast<char>(msg[19]);
+    r.min_price        = be32(msg + 20);
+    r.max_price        = be32(msg + 24);
+    r.near_price       = be32(msg + 28);
+    r.near_exec_time   = be64(msg + 32);
+    r.lower_collar     = be32(msg + 40);
+    r.upper_collar     = be32(msg + 44);
+    return r;
+}
+
+// ─── AVX-512 VBMI decoding ───────────────────────────────────────────────────
+//
+// VPERMB (_mm512_permutexvar_epi8, AVX512_VBMI) picks any of the 64 source
+// bytes for each of the 64 destination bytes: no lanes, unlike VPSHUFB.  Every
+// one of A/F E C X D U fits in a 64-byte window, so a decode is
+//   one masked load      exactly the message's bytes, the rest zero; the mask
+//                        also means no read past the end of the message
+//   one VPERMB           every field byte-swapped straight to its offset in the
+//                        Decoded* struct: order_ref, the u48 timestamp, price
+//                        and all; stock[8], padding and the timestamp's top two
+//                        bytes zeroed by the permute's own zero mask
+//   one store            the register is the struct; its first sizeof bytes
+//                        are written out
+// and the xmm fix-ups the AVX2 decoders need for cross-lane and out-of-window
+// fields are gone.  The remaining types (P Q B S R) stay on the AVX2 decoders.
+//
+// The permute tables are not written by hand: vbmi_map() builds each one at
+// compile time from the type's field list (destination from offsetof, wire
+// offset, width, byte-swapped or not), so they follow the struct layouts above.
+// verify_wire_vectors() in itch5_bench.cpp checks them like every other level.
+//
+// VBMI is not implied by the AVX512 level (Skylake-X and Cascade Lake have
+// AVX-512 F/BW/VL/DQ without it); DecodeAVX512VBMI runs only where
+// ISADISPATCH::g_vbmi says so, and the AVX512 level stays on AVX2 elsewhere.
+
+#define ITCH5_VBMI_TARGET "avx512f,avx512bw,avx512vl,avx512dq,avx512vbmi"
+
+// One field: len bytes at wire offset src to struct offset dst; swap reverses
+// them (big-endian wire integer → host order).
+struct VbmiField {
+    uint8_t dst;
+    uint8_t src;
+    uint8_t len;
+    bool    swap;
+};
+
+// A VPERMB index vector: result byte i is message byte idx[i] where bit i of
+// keep is set, zero where it is not.
+struct alignas(64) VbmiMap {
+    uint8_t  idx[64];
+    uint64_t keep;
+};
+
+template<size_t N>
+static consteval VbmiMap vbmi_map(const VbmiField (&fields)[N]) {
+    VbmiMap m{};
+    for (const VbmiField& f : fields)
+        for (uint8_t i = 0; i < f.len; ++i) {
+            m.idx[f.dst + i] = static_cast<uint8_t>(f.swap ? f.src + f.len - 1 - i : f.src + i);
+            m.keep |= uint64_t{1} << (f.dst + i);
+        }
+    return m;
+}
+
+// Every type below shares the header: locate [1-2], tracking [3-4] and the
+// u48 timestamp [5-10] into the low six bytes of timestamp_ns.
+#define ITCH5_VBMI_HEADER(T)                                      \
+    VbmiField{offsetof(T, stock_locate), 1, 2, true},             \
+    VbmiField{offsetof(T, tracking_num), 3, 2, true},             \
+    VbmiField{offsetof(T, timestamp_ns), 5, 6, true}
+
+inline constexpr VbmiMap VBMI_ADD_ORDER = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedAddOrder),
+    VbmiField{offsetof(DecodedAddOrder, order_ref), 11, 8, true},
+    VbmiField{offsetof(DecodedAddOrder, side),      19, 1, false},
+    VbmiField{offsetof(DecodedAddOrder, shares),    20, 4, true},
+    VbmiField{offsetof(DecodedAddOrder, stock),     24, 8, false},
+    VbmiField{offsetof(DecodedAddOrder, price),     32, 4, true},
+});
+
+inline constexpr VbmiMap VBMI_EXECUTE_ORDER = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedExecuteOrder),
+    VbmiField{offsetof(DecodedExecuteOrder, order_ref),       11, 8, true},
+    VbmiField{offsetof(DecodedExecuteOrder, executed_shares), 19, 4, true},
+    VbmiField{offsetof(DecodedExecuteOrder, match_num),       23, 8, true},
+});
+
+inline constexpr VbmiMap VBMI_EXECUTE_ORDER_PRICE = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedExecuteOrderPrice),
+    VbmiField{offsetof(DecodedExecuteOrderPrice, order_ref),       11, 8, true},
+    VbmiField{offsetof(DecodedExecuteOrderPrice, executed_shares), 19, 4, true},
+    VbmiField{offsetof(DecodedExecuteOrderPrice, match_num),       23, 8, true},
+    VbmiField{offsetof(DecodedExecuteOrderPrice, printable),       31, 1, false},
+    VbmiField{offsetof(DecodedExecuteOrderPrice, price),           32, 4, true},
+});
+
+inline constexpr VbmiMap VBMI_CANCEL_ORDER = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedCancelOrder),
+    VbmiField{offsetof(DecodedCancelOrder, order_ref),        11, 8, true},
+    VbmiField{offsetof(DecodedCancelOrder, cancelled_shares), 19, 4, true},
+});
+
+inline constexpr VbmiMap VBMI_DELETE_ORDER = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedDeleteOrder),
+    VbmiField{offsetof(DecodedDeleteOrder, order_ref), 11, 8, true},
+});
+
+inline constexpr VbmiMap VBMI_REPLACE_ORDER = vbmi_map({
+    ITCH5_VBMI_HEADER(DecodedReplaceOrder),
+    VbmiField{offsetof(DecodedReplaceOrder, orig_ref),       11, 8, true},
+    VbmiField{offsetof(DecodedReplaceOrder, new_ref),        19, 8, true},
+    VbmiField{offsetof(DecodedReplaceOrder, shares),         27, 4, true},
+    VbmiField{offsetof(DecodedReplaceOrder, price),          31, 4, true},
+});
+
+#undef ITCH5_VBMI_HEADER
+
+// Masked load of the len message bytes, one VPERMB through map, and the
+// struct out of the low sizeof(R) bytes of the result: one xmm or ymm store,
+// plus eight bytes for the 24- and 40-byte structs.  Handlers take the struct by reference,
+// so it does get stored; a 64-byte store would split a cache line on most
+// stack slots, and a masked store blocks forwarding to the handler's loads.
+// The extracts are the all-ones maskz forms: GCC 12 builds the casts and the
+// unmasked extracts on _mm512_undefined_*(), which trips -Wmaybe-uninitialized.
+template<class R, const VbmiMap& Map>
+[[gnu::target(ITCH5_VBMI_TARGET), gnu::always_inline]]
+static inline R vbmi_decode(const uint8_t* msg, const unsigned len) noexcept {
+    const __m512i raw = _mm512_maskz_loadu_epi8(~0ULL >> (64 - len), msg);
+    const __m512i out = _mm512_maskz_permutexvar_epi8(Map.keep, _mm512_load_si512(Map.idx), raw);
+    constexpr size_t head = sizeof(R) >= 32 ? 32 : 16;
+    static_assert(sizeof(R) == head || sizeof(R) == head + 8);
+    R r;
+    uint8_t* const p = reinterpret_cast<uint8_t*>(&r);
+    if constexpr (head == 32) _mm256_storeu_si256(reinterpret_cast<__m256i_u*>(p), _mm512_maskz_extracti64x4_epi64(0xFF, out, 0));
+    else                      _mm_storeu_si128(reinterpret_cast<__m128i_u*>(p), _mm512_maskz_extracti32x4_epi32(0xF, out, 0));
+    if constexpr (sizeof(R) > head) {
+        const uint64_t tail = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm512_maskz_extracti64x2_epi64(0x3, out, head / 16)));
+        memcpy(p + head, &tail, 8);
+    }
+    return r;
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedAddOrder vbmi_decode_add_order(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedAddOrder, VBMI_ADD_ORDER>(msg, 36);                   // 'F' adds the MPID after these
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedExecuteOrder vbmi_decode_execute_order(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedExecuteOrder, VBMI_EXECUTE_ORDER>(msg, 31);
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedExecuteOrderPrice vbmi_decode_execute_order_price(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedExecuteOrderPrice, VBMI_EXECUTE_ORDER_PRICE>(msg, 36);
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedCancelOrder vbmi_decode_cancel_order(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedCancelOrder, VBMI_CANCEL_ORDER>(msg, 23);
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedDeleteOrder vbmi_decode_delete_order(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedDeleteOrder, VBMI_DELETE_ORDER>(msg, 19);
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static inline DecodedReplaceOrder vbmi_decode_replace_order(const uint8_t* msg) noexcept {
+    return vbmi_decode<DecodedReplaceOrder, VBMI_REPLACE_ORDER>(msg, 35);
+}
+
+// ── Decoder policies (one per ISA level) ────────────────────────────────────
+//
+// A parse loop written as template<class Dec> and force-inlined into an entry
+// point carrying the same [[gnu::target]] gets every decoder inlined; see
+// parse_datagram_impl in itch5_parse.h.  The AVX512 level runs DecodeAVX512VBMI
+// where the CPU has VBMI and the AVX2 policy where it does not.
+
+// The administrative and auction decoders, shared by every level.
+struct DecodeAdmin {
+    static DecodedTradingAction     trading_action(const uint8_t* m) noexcept     { return scalar_decode_trading_action(m); }
+    static DecodedRegSHO            reg_sho(const uint8_t* m) noexcept            { return scalar_decode_reg_sho(m); }
+    static DecodedMarketParticipant market_participant(const uint8_t* m) noexcept { return scalar_decode_market_participant(m); }
+    static DecodedMwcbDecline       mwcb_decline(const uint8_t* m) noexcept       { return scalar_decode_mwcb_decline(m); }
+    static DecodedMwcbStatus        mwcb_status(const uint8_t* m) noexcept        { return scalar_decode_mwcb_status(m); }
+    static DecodedIpoQuoting        ipo_quoting(const uint8_t* m) noexcept        { return scalar_decode_ipo_quoting(m); }
+    static DecodedLuldCollar        luld_collar(const uint8_t* m) noexcept        { return scalar_decode_luld_collar(m); }
+    static DecodedOperationalHalt   operational_halt(const uint8_t* m) noexcept   { return scalar_decode_operational_halt(m); }
+    static DecodedNoii              noii(const uint8_t* m) noexcept               { return scalar_decode_noii(m); }
+    static DecodedRpii              rpii(const uint8_t* m) noexcept               { return scalar_decode_rpii(m); }
+    static DecodedDlcr              dlcr(const uint8_t* m) noexcept               { return scalar_decode_dlcr(m); }
+};
+
+struct DecodeScalar : DecodeAdmin {
+    static constexpr ISADISPATCH::Isa isa = ISADISPATCH::Isa::Scalar;
+    static DecodedAddOrder          add_order(const uint8_t* m) noexcept           { return scalar_decode_add_order(m); }
+    static DecodedExecuteOrder      execute_order(const uint8_t* m) noexcept       { return scalar_decode_execute_order(m); }
+    static DecodedExecuteOrderPrice execute_order_price(const uint8_t* m) noexcept { return scalar_decode_execute_order_price(m); }
+    static DecodedCancelOrder       cancel_order(const uint8_t* m) noexcept        { return scalar_decode_cancel_order(m); }
+    static DecodedDeleteOrder       delete_order(const uint8_t* m) noexcept        { return scalar_decode_delete_order(m); }
+    static DecodedReplaceOrder      replace_order(const uint8_t* m) noexcept       { return scalar_decode_replace_order(m); }
+    static DecodedTrade             trade(const uint8_t* m) noexcept               { return scalar_decode_trade(m); }
+    static DecodedCrossTrade        cross_trade(const uint8_t* m) noexcept         { return scalar_decode_cross_trade(m); }
+    static DecodedBrokenTrade       broken_trade(const uint8_t* m) noexcept        { return scalar_decode_broken_trade(m); }
+    static DecodedSystemEvent       system_event(const uint8_t* m) noexcept        { return scalar_decode_system_event(m); }
+    static DecodedStockDirectory    stock_directory(const uint8_t* m) noexcept     { return scalar_decode_stock_directory(m); }
+    static uint32_t                 scan_types(const uint8_t* p) noexcept          { return scalar_scan_types(p); }
+};
+
+struct DecodeSSE42 : DecodeAdmin {
+    static constexpr ISADISPATCH::Isa isa = ISADISPATCH::Isa::SSE42;
+    [[gnu::target("sse4.2")]] static DecodedAddOrder          add_order(const uint8_t* m) noexcept           { return sse_decode_add_order(m); }
+    [[gnu::target("sse4.2")]] static DecodedExecuteOrder      execute_order(const uint8_t* m) noexcept       { return sse_decode_execute_order(m); }
+    [[gnu::target("sse4.2")]] static DecodedExecuteOrderPrice execute_order_price(const uint8_t* m) noexcept { return sse_decode_execute_order_price(m); }
+    [[gnu::target("sse4.2")]] static DecodedCancelOrder       cancel_order(const uint8_t* m) noexcept        { return sse_decode_cancel_order(m); }
+    [[gnu::target("sse4.2")]] static DecodedDeleteOrder       delete_order(const uint8_t* m) noexcept        { return sse_decode_delete_order(m); }
+    [[gnu::target("sse4.2")]] static DecodedReplaceOrder      replace_order(const uint8_t* m) noexcept       { return sse_decode_replace_order(m); }
+    [[gnu::target("sse4.2")]] static DecodedTrade             trade(const uint8_t* m) noexcept               { return sse_decode_trade(m); }
+    [[gnu::target("sse4.2")]] static DecodedCrossTrade        cross_trade(const uint8_t* m) noexcept         { return sse_decode_cross_trade(m); }
+    [[gnu::target("sse4.2")]] static DecodedBrokenTrade       broken_trade(const uint8_t* m) noexcept        { return sse_decode_broken_trade(m); }
+    [[gnu::target("sse4.2")]] static DecodedSystemEvent       system_event(const uint8_t* m) noexcept        { return sse_decode_system_event(m); }
+    [[gnu::target("sse4.2")]] static DecodedStockDirectory    stock_directory(const uint8_t* m) noexcept     { return sse_decode_stock_directory(m); }
+    [[gnu::target("sse4.2")]] static uint32_t                 scan_types(const uint8_t* p) noexcept          { return sse_scan_types(p); }
+};
+
+struct DecodeAVX2 : DecodeAdmin {
+    static constexpr ISADISPATCH::Isa isa = ISADISPATCH::Isa::AVX2;
+    [[gnu::target("avx2")]] static DecodedAddOrder          add_order(const uint8_t* m) noexcept           { return avx_decode_add_order(m); }
+    [[gnu::target("avx2")]] static DecodedExecuteOrder      execute_order(const uint8_t* m) noexcept       { return avx_decode_execute_order(m); }
+    [[gnu::target("avx2")]] static DecodedExecuteOrderPrice execute_order_price(const uint8_t* m) noexcept { return avx_decode_execute_order_price(m); }
+    [[gnu::target("avx2")]] static DecodedCancelOrder       cancel_order(const uint8_t* m) noexcept        { return avx_decode_cancel_order(m); }
+    [[gnu::target("avx2")]] static DecodedDeleteOrder       delete_order(const uint8_t* m) noexcept        { return avx_decode_delete_order(m); }
+    [[gnu::target("avx2")]] static DecodedReplaceOrder      replace_order(const uint8_t* m) noexcept       { return avx_decode_replace_order(m); }
+    [[gnu::target("avx2")]] static DecodedTrade             trade(const uint8_t* m) noexcept               { return avx_decode_trade(m); }
+    [[gnu::target("avx2")]] static DecodedCrossTrade        cross_trade(const uint8_t* m) noexcept         { return avx_decode_cross_trade(m); }
+    [[gnu::target("avx2")]] static DecodedBrokenTrade       broken_trade(const uint8_t* m) noexcept        { return avx_decode_broken_trade(m); }
+    [[gnu::target("avx2")]] static DecodedSystemEvent       system_event(const uint8_t* m) noexcept        { return avx_decode_system_event(m); }
+    [[gnu::target("avx2")]] static DecodedStockDirectory    stock_directory(const uint8_t* m) noexcept     { return avx_decode_stock_directory(m); }
+    [[gnu::target("avx2")]] static uint32_t                 scan_types(const uint8_t* p) noexcept          { return avx_scan_types(p); }
+};
+
+// The AVX2 policy with the VBMI permute decoders for the order messages.
+struct DecodeAVX512VBMI : DecodeAVX2 {
+    static constexpr ISADISPATCH::Isa isa = ISADISPATCH::Isa::AVX512;
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedAddOrder          add_order(const uint8_t* m) noexcept           { return vbmi_decode_add_order(m); }
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedExecuteOrder      execute_order(const uint8_t* m) noexcept       { return vbmi_decode_execute_order(m); }
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedExecuteOrderPrice execute_order_price(const uint8_t* m) noexcept { return vbmi_decode_execute_order_price(m); }
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedCancelOrder       cancel_order(const uint8_t* m) noexcept        { return vbmi_decode_cancel_order(m); }
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedDeleteOrder       delete_order(const uint8_t* m) noexcept        { return vbmi_decode_delete_order(m); }
+    [[gnu::target(ITCH5_VBMI_TARGET)]] static DecodedReplaceOrder      replace_order(const uint8_t* m) noexcept       { return vbmi_decode_replace_order(m); }
+};
+
+#endif // ITCH5_AVX_H_INCLUDED
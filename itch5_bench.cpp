@@ -0,0 +1,603 @@
+/**
+ * itch5_bench.cpp
+ *
+ * Decoder throughput on a synthetic ITCH 5.0 feed (itch5_gen.h), no NIC needed.
+ *
+ * For the configured message mix and then for each type on its own
+ * (A / F / E / X / D / U / P) the generator builds MoldUDP64 datagrams in
+ * ef_vi-sized slots, and the benchmark reports msgs/s, GB/s of UDP payload and
+ * cycles/msg for
+ *   parse_datagram   the receiver's datagram walker (itch5_parse.h), one row
+ *                    per ISA level the host can run
+ *   parse_null       the same walker with NullHandler: walk + decode only,
+ *                    the floor under any handler
+ *   decode           the bare per-message decoder (avx_decode_* and its
+ *                    sse / scalar siblings, and vbmi_decode_* in the avx512
+ *                    row where the CPU has VBMI) over the same message bodies
+ *   soa              decode_datagram_soa (itch5_soa.h): whole datagrams into
+ *                    structure-of-arrays, scalar / AVX2 / AVX-512 gathers
+ * each followed by its hardware counters per message (PerfAnalysis.h).  The
+ * run ends with the parse_null and decode cycles/msg of every feed side by
+ * side, one column per level.
+ *
+ * Before any timing, verify_wire_vectors() decodes one hand-assembled wire
+ * vector of every ITCH 5.0 type with each decoder policy the host can run and
+ * asserts every field; a wrong shuffle map fails the run with a WIRE VECTOR
+ * line and exit code 1.  verify_wire_datagram() does the same for a whole
+ * datagram behind a spec MoldUDP64 header, through every parse_datagram
+ * variant (WIRE DATAGRAM).
+ *
+ * The parse rows use a counting handler and cross-check its per-type counts
+ * against what the generator wrote, so a decoder or walker change that drops
+ * or misroutes messages shows up as a MISMATCH line.  This is the yardstick
+ * for every decoder optimisation.  The soa variants are checked field by field
+ * against the scalar per-message decoders on the mix feed before they are
+ * timed.
+ *
+ * Build (no -march: variants carry their own target attributes):
+ *   g++ -O3 -std=c++20 itch5_bench.cpp -o itch5_bench
+ *
+ * Run:
+ *   ./itch5_bench [messages] [symbols] [burst_max] [repetitions]
+ *   ISA_FORCE=sse42 ./itch5_bench     # caps which variants are timed
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <iterator>
+#include <iostream>
+
+#include "PerfAnalysis.h"
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+#include "itch5_parse.h"
+#include "itch5_gen.h"
+#include "itch5_soa.h"
+
+using namespace ISADISPATCH;
+
+// ─── Handler ─────────────────────────────────────────────────────────────────
+
+// Folds every decoded field into a checksum so no decode can be dropped.
+struct CountingHandler {
+    uint64_t adds{0}, executes{0}, deletes{0}, cancels{0}, replaces{0}, trades{0};
+    uint64_t sum{0};
+
+    void on_add_order(const DecodedAddOrder& m) noexcept {
+        ++adds;
+        sum += m.order_ref ^ m.shares ^ m.price ^ m.stock_locate ^ m.timestamp_ns ^ static_cast<uint8_t>(m.side);
+    }
+    void on_execute(const DecodedExecuteOrder& m) noexcept {
+        ++executes;
+        sum += m.order_ref ^ m.executed_shares ^ m.match_num ^ m.stock_locate ^ m.timestamp_ns;
+    }
+    void on_delete(const DecodedDeleteOrder& m) noexcept {
+        ++deletes;
+        sum += m.order_ref ^ m.stock_locate ^ m.timestamp_ns;
+    }
+    void on_cancel(const DecodedCancelOrder& m) noexcept {
+        ++cancels;
+        sum += m.order_ref ^ m.cancelled_shares ^ m.stock_locate ^ m.timestamp_ns;
+    }
+    void on_replace(const DecodedReplaceOrder& m) noexcept {
+        ++replaces;
+        sum += m.orig_ref ^ m.new_ref ^ m.shares ^ m.price ^ m.stock_locate ^ m.timestamp_ns;
+    }
+    void on_trade(const DecodedTrade& m) noexcept {
+        ++trades;
+        sum += m.match_num ^ m.shares ^ m.price ^ m.stock_locate ^ m.timestamp_ns ^ static_cast<uint8_t>(m.side);
+    }
+};
+
+// ─── Wire vectors ────────────────────────────────────────────────────────────
+//
+// One message of every type, assembled by hand from the ITCH 5.0 spec offsets
+// (not by itch5_gen.h, so an offset mistake cannot cancel out).  Every
+// multi-byte field uses distinct byte values, so a swapped or shifted byte in
+// a shuffle map changes the decoded value.  The static_asserts tie each
+// vector's size to itch_msg_len.
+
+#define WV_HDR(t) t, 0x01,0x02, 0x03,0x04, 0x12,0x34,0x56,0x78,0x9A,0xBC   // locate, tracking, timestamp
+#define WV_REF         0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88
+#define WV_MATCH       0xA1,0xA2,0xA3,0xA4,0xA5,0xA6,0xA7,0xA8
+
+static constexpr uint8_t wv_A[] = { WV_HDR('A'), WV_REF, 'B', 0x00,0x01,0x86,0xA0, 'A','A','P','L',' ',' ',' ',' ', 0x00,0x1C,0x9C,0x38 };
+static constexpr uint8_t wv_F[] = { WV_HDR('F'), WV_REF, 'S', 0x00,0x01,0x86,0xA0, 'A','A','P','L',' ',' ',' ',' ', 0x00,0x1C,0x9C,0x38, 'G','S','C','O' };
+static constexpr uint8_t wv_E[] = { WV_HDR('E'), WV_REF, 0x00,0x00,0x01,0x2C, WV_MATCH };
+static constexpr uint8_t wv_C[] = { WV_HDR('C'), WV_REF, 0x00,0x00,0x02,0x58, WV_MATCH, 'Y', 0x00,0x0F,0x42,0x40 };
+static constexpr uint8_t wv_X[] = { WV_HDR('X'), WV_REF, 0x00,0x00,0x00,0x64 };
+static constexpr uint8_t wv_D[] = { WV_HDR('D'), WV_REF };
+static constexpr uint8_t wv_U[] = { WV_HDR('U'), WV_REF, 0x99,0xAA,0xBB,0xCC,0xDD,0xEE,0xF0,0x01, 0x00,0x00,0x03,0xE8, 0x00,0x12,0xD6,0x87 };
+static constexpr uint8_t wv_P[] = { WV_HDR('P'), WV_REF, 'S', 0x00,0x00,0x00,0xC8, 'M','S','F','T',' ',' ',' ',' ', 0x00,0x3D,0x09,0x00, WV_MATCH };
+static constexpr uint8_t wv_Q[] = { WV_HDR('Q'), 0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x05, 'S','P','Y',' ',' ',' ',' ',' ',
+                                    0x00,0x45,0x67,0x89, WV_MATCH, 'C' };
+static constexpr uint8_t wv_B[] = { WV_HDR('B'), WV_MATCH };
+static constexpr uint8_t wv_S[] = { WV_HDR('S'), 'O' };
+static constexpr uint8_t wv_R[] = { WV_HDR('R'), 'Q','Q','Q',' ',' ',' ',' ',' ', 'Q', 'N', 0x00,0x00,0x00,0x64, 'N', 'E', 'E','T',
+                                    'P', 'N', ' ', '1', 'Y', 0x00,0x00,0x00,0x03, 'N' };
+static constexpr uint8_t wv_H[] = { WV_HDR('H'), 'A','M','C',' ',' ',' ',' ',' ', 'H', ' ', 'L','U','D','P' };
+static constexpr uint8_t wv_Y[] = { WV_HDR('Y'), 'G','M','E',' ',' ',' ',' ',' ', '1' };
+static constexpr uint8_t wv_L[] = { WV_HDR('L'), 'G','S','C','O', 'I','B','M',' ',' ',' ',' ',' ', 'Y', 'N', 'A' };
+static constexpr uint8_t wv_V[] = { WV_HDR('V'), 0x00,0x00,0x00,0x01,0x11,0x12,0x13,0x14, 0x00,0x00,0x00,0x02,0x21,0x22,0x23,0x24,
+                                    0x00,0x00,0x00,0x03,0x31,0x32,0x33,0x34 };
+static constexpr uint8_t wv_W[] = { WV_HDR('W'), '2' };
+static constexpr uint8_t wv_K[] = { WV_HDR('K'), 'R','D','D','T',' ',' ',' ',' ', 0x00,0x00,0x8C,0xA0, 'A', 0x00,0x03,0x3E,0x50 };
+static constexpr uint8_t wv_J[] = { WV_HDR('J'), 'N','V','D','A',' ',' ',' ',' ', 0x00,0x10,0x20,0x30, 0x00,0x11,0x21,0x31,
+                                    0x00,0x0F,0x1F,0x2F, 0x00,0x00,0x00,0x01 };
+static constexpr uint8_t wv_h[] = { WV_HDR('h'), 'T','S','L','A',' ',' ',' ',' ', 'Q', 'H' };
+static constexpr uint8_t wv_I[] = { WV_HDR('I'), 0x00,0x00,0x00,0x00,0x00,0x0F,0x42,0x40, 0x00,0x00,0x00,0x00,0x00,0x00,0x27,0x10, 'B',
+                                    'A','A','P','L',' ',' ',' ',' ', 0x00,0x1C,0x9C,0x38, 0x00,0x1C,0x9C,0x39, 0x00,0x1C,0x9C,0x3A, 'C', 'L' };
+static constexpr uint8_t wv_N[] = { WV_HDR('N'), 'A','R','M',' ',' ',' ',' ',' ', 'B' };
+static constexpr uint8_t wv_O[] = { WV_HDR('O'), 'S','P','O','T',' ',' ',' ',' ', 'Y', 0x00,0x0A,0x00,0x00, 0x00,0x0B,0x00,0x00,
+                                    0x00,0x0A,0x80,0x00, 0x00,0x00,0x1F,0x00,0x00,0x00,0x00,0x01, 0x00,0x09,0x00,0x00, 0x00,0x0C,0x00,0x00 };
+
+#define WV_LEN(t) static_assert(sizeof(wv_##t) == itch_msg_len(#t[0]), "wire vector " #t " has the wrong length")
+WV_LEN(A); WV_LEN(F); WV_LEN(E); WV_LEN(C); WV_LEN(X); WV_LEN(D); WV_LEN(U); WV_LEN(P); WV_LEN(Q); WV_LEN(B); WV_LEN(S);
+WV_LEN(R); WV_LEN(H); WV_LEN(Y); WV_LEN(L); WV_LEN(V); WV_LEN(W); WV_LEN(K); WV_LEN(J); WV_LEN(h); WV_LEN(I); WV_LEN(N);
+WV_LEN(O);
+#undef WV_LEN
+
+// copies the vector into a zeroed 64-byte buffer so the decoders' 32-byte overread stays in bounds
+template<size_t N>
+static const uint8_t* wire(const uint8_t (&v)[N]) {
+    static_assert(N <= 64);
+    alignas(64) static thread_local uint8_t buf[64 + 32];
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf + 1, v, N);                    // +1: never 16-byte aligned, like the wire
+    return buf + 1;
+}
+
+template<class Dec>
+static unsigned verify_wire_vectors(const char* isa) {
+    unsigned fails = 0;
+    const char* what = "";
+    auto expect = [&](const bool ok, const char* field) {
+        if (!ok) { printf("  WIRE VECTOR %s '%s' %s: wrong\n", isa, what, field); ++fails; }
+    };
+#define WV_CHECK(expr)   expect((expr), #expr)
+#define WV_HEADER_OK(d)  WV_CHECK(d.stock_locate == 0x0102); WV_CHECK(d.tracking_num == 0x0304); \
+                         WV_CHECK(d.timestamp_ns == 0x123456789ABCull)
+
+    { what = "A"; const auto d = Dec::add_order(wire(wv_A)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.side == 'B'); WV_CHECK(d.shares == 0x000186A0u);
+      WV_CHECK(strcmp(d.stock, "AAPL    ") == 0); WV_CHECK(d.price == 0x001C9C38u); }
+    { what = "F"; const auto d = Dec::add_order(wire(wv_F)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.side == 'S'); WV_CHECK(d.shares == 0x000186A0u);
+      WV_CHECK(strcmp(d.stock, "AAPL    ") == 0); WV_CHECK(d.price == 0x001C9C38u); }
+    { what = "E"; const auto d = Dec::execute_order(wire(wv_E)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.executed_shares == 0x12Cu);
+      WV_CHECK(d.match_num == 0xA1A2A3A4A5A6A7A8ull); }
+    { what = "C"; const auto d = Dec::execute_order_price(wire(wv_C)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.executed_shares == 0x258u);
+      WV_CHECK(d.match_num == 0xA1A2A3A4A5A6A7A8ull); WV_CHECK(d.printable == 'Y'); WV_CHECK(d.price == 0x000F4240u); }
+    { what = "X"; const auto d = Dec::cancel_order(wire(wv_X)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.cancelled_shares == 0x64u); }
+    { what = "D"; const auto d = Dec::delete_order(wire(wv_D)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); }
+    { what = "U"; const auto d = Dec::replace_order(wire(wv_U)); WV_HEADER_OK(d);
+      WV_CHECK(d.orig_ref == 0x1122334455667788ull); WV_CHECK(d.new_ref == 0x99AABBCCDDEEF001ull);
+      WV_CHECK(d.shares == 0x3E8u); WV_CHECK(d.price == 0x0012D687u); }
+    { what = "P"; const auto d = Dec::trade(wire(wv_P)); WV_HEADER_OK(d);
+      WV_CHECK(d.order_ref == 0x1122334455667788ull); WV_CHECK(d.side == 'S'); WV_CHECK(d.shares == 0xC8u);
+      WV_CHECK(strcmp(d.stock, "MSFT    ") == 0); WV_CHECK(d.price == 0x003D0900u); WV_CHECK(d.match_num == 0xA1A2A3A4A5A6A7A8ull); }
+    { what = "Q"; const auto d = Dec::cross_trade(wire(wv_Q)); WV_HEADER_OK(d);
+      WV_CHECK(d.shares == 0x0000000102030405ull); WV_CHECK(strcmp(d.stock, "SPY     ") == 0); WV_CHECK(d.price == 0x00456789u);
+      WV_CHECK(d.match_num == 0xA1A2A3A4A5A6A7A8ull); WV_CHECK(d.cross_type == 'C'); }
+    { what = "B"; const auto d = Dec::broken_trade(wire(wv_B)); WV_HEADER_OK(d);
+      WV_CHECK(d.match_num == 0xA1A2A3A4A5A6A7A8ull); }
+    { what = "S"; const auto d = Dec::system_event(wire(wv_S)); WV_HEADER_OK(d);
+      WV_CHECK(d.event_code == 'O'); }
+    { what = "R"; const auto d = Dec::stock_directory(wire(wv_R)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "QQQ     ") == 0); WV_CHECK(d.market_category == 'Q'); WV_CHECK(d.financial_status == 'N');
+      WV_CHECK(d.round_lot_size == 0x64u); WV_CHECK(d.round_lots_only == 'N'); WV_CHECK(d.issue_classification == 'E');
+      WV_CHECK(strcmp(d.issue_subtype, "ET") == 0); WV_CHECK(d.authenticity == 'P'); WV_CHECK(d.short_sale_threshold == 'N');
+      WV_CHECK(d.ipo_flag == ' '); WV_CHECK(d.luld_tier == '1'); WV_CHECK(d.etp_flag == 'Y'); WV_CHECK(d.etp_leverage == 3u);
+      WV_CHECK(d.inverse_indicator == 'N'); }
+    { what = "H"; const auto d = Dec::trading_action(wire(wv_H)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "AMC     ") == 0); WV_CHECK(d.trading_state == 'H'); WV_CHECK(strcmp(d.reason, "LUDP") == 0); }
+    { what = "Y"; const auto d = Dec::reg_sho(wire(wv_Y)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "GME     ") == 0); WV_CHECK(d.action == '1'); }
+    { what = "L"; const auto d = Dec::market_participant(wire(wv_L)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.mpid, "GSCO") == 0); WV_CHECK(strcmp(d.stock, "IBM     ") == 0);
+      WV_CHECK(d.primary_mm == 'Y'); WV_CHECK(d.mode == 'N'); WV_CHECK(d.state == 'A'); }
+    { what = "V"; const auto d = Dec::mwcb_decline(wire(wv_V)); WV_HEADER_OK(d);
+      WV_CHECK(d.level1 == 0x0000000111121314ull); WV_CHECK(d.level2 == 0x0000000221222324ull);
+      WV_CHECK(d.level3 == 0x0000000331323334ull); }
+    { what = "W"; const auto d = Dec::mwcb_status(wire(wv_W)); WV_HEADER_OK(d);
+      WV_CHECK(d.breached_level == '2'); }
+    { what = "K"; const auto d = Dec::ipo_quoting(wire(wv_K)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "RDDT    ") == 0); WV_CHECK(d.release_time == 0x8CA0u); WV_CHECK(d.qualifier == 'A');
+      WV_CHECK(d.ipo_price == 0x00033E50u); }
+    { what = "J"; const auto d = Dec::luld_collar(wire(wv_J)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "NVDA    ") == 0); WV_CHECK(d.ref_price == 0x00102030u); WV_CHECK(d.upper_price == 0x00112131u);
+      WV_CHECK(d.lower_price == 0x000F1F2Fu); WV_CHECK(d.extension == 1u); }
+    { what = "h"; const auto d = Dec::operational_halt(wire(wv_h)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "TSLA    ") == 0); WV_CHECK(d.market_code == 'Q'); WV_CHECK(d.action == 'H'); }
+    { what = "I"; const auto d = Dec::noii(wire(wv_I)); WV_HEADER_OK(d);
+      WV_CHECK(d.paired_shares == 0xF4240ull); WV_CHECK(d.imbalance_shares == 0x2710ull); WV_CHECK(d.direction == 'B');
+      WV_CHECK(strcmp(d.stock, "AAPL    ") == 0); WV_CHECK(d.far_price == 0x001C9C38u); WV_CHECK(d.near_price == 0x001C9C39u);
+      WV_CHECK(d.ref_price == 0x001C9C3Au); WV_CHECK(d.cross_type == 'C'); WV_CHECK(d.price_variation == 'L'); }
+    { what = "N"; const auto d = Dec::rpii(wire(wv_N)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "ARM     ") == 0); WV_CHECK(d.interest_flag == 'B'); }
+    { what = "O"; const auto d = Dec::dlcr(wire(wv_O)); WV_HEADER_OK(d);
+      WV_CHECK(strcmp(d.stock, "SPOT    ") == 0); WV_CHECK(d.open_eligibility == 'Y'); WV_CHECK(d.min_price == 0x000A0000u);
+      WV_CHECK(d.max_price == 0x000B0000u); WV_CHECK(d.near_price == 0x000A8000u); WV_CHECK(d.near_exec_time == 0x00001F0000000001ull);
+      WV_CHECK(d.lower_collar == 0x00090000u); WV_CHECK(d.upper_collar == 0x000C0000u); }
+
+#undef WV_HEADER_OK
+#undef WV_CHECK
+    return fails;
+}
+
+#undef WV_MATCH
+#undef WV_REF
+#undef WV_HDR
+
+// One MoldUDP64 datagram assembled by hand from the spec: the 20-byte
+// downstream header (session, seqno 12345, count 3), then A, X and D blocks.
+// Every parse_datagram variant must find all three right after the header,
+// with the fields of the per-message vectors above.
+static constexpr uint8_t wv_mold[] = { 'W','I','R','E','V','E','C','T','O','R',
+                                       0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x39, 0x00,0x03 };
+static_assert(sizeof(wv_mold) == MOLD_HDR_LEN, "wire vector MoldUDP64 header has the wrong length");
+
+static unsigned verify_wire_datagram(const Isa top) {
+    alignas(64) uint8_t buf[256]{};
+    uint8_t* const pkt = buf + 1;
+    uint32_t len = 0;
+    auto put = [&](const uint8_t* v, const size_t n) { memcpy(pkt + len, v, n); len += static_cast<uint32_t>(n); };
+    auto block = [&](const uint8_t* v, const size_t n) {
+        const uint8_t be[2] = { static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n) };
+        put(be, 2);
+        put(v, n);
+    };
+    put(wv_mold, sizeof(wv_mold));
+    block(wv_A, sizeof(wv_A));
+    block(wv_X, sizeof(wv_X));
+    block(wv_D, sizeof(wv_D));
+
+    CountingHandler want;
+    want.on_add_order(DecodeScalar::add_order(wire(wv_A)));
+    want.on_cancel(DecodeScalar::cancel_order(wire(wv_X)));
+    want.on_delete(DecodeScalar::delete_order(wire(wv_D)));
+
+    const IsaVariants<ParseDatagramFn<CountingHandler>> parse = parse_datagram_variants<CountingHandler>();
+    unsigned fails = 0;
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        if (!parse.v[l]) continue;
+        CountingHandler h;
+        parse.v[l](pkt, len, h);
+        if (h.adds != 1 || h.cancels != 1 || h.deletes != 1 || h.sum != want.sum) {
+            printf("  WIRE DATAGRAM %s: A %lu X %lu D %lu, sum %s\n", isa_name(static_cast<Isa>(l)),
+                   static_cast<unsigned long>(h.adds), static_cast<unsigned long>(h.cancels),
+                   static_cast<unsigned long>(h.deletes), h.sum == want.sum ? "ok" : "wrong");
+            ++fails;
+        }
+    }
+    return fails;
+}
+
+// ─── Result reporting ────────────────────────────────────────────────────────
+
+struct Span {
+    stopwatch<>   sw;
+    perf_counters pc;
+    uint64_t      cycles{0};
+
+    template<class F>
+    void time(F&& fn) {
+        sw.start();
+        const uint64_t t0 = __rdtsc();
+        pc.start();
+        fn();
+        pc.stop();
+        cycles += __rdtsc() - t0;
+        sw.stop();
+    }
+};
+
+// Prints one row; returns its cycles/msg.
+static double report(const char* what, const char* row, const Isa isa, const Span& s,
+                     const uint64_t msgs, const uint64_t bytes, const uint64_t sink) {
+    const double ns = static_cast<double>(s.sw.total_time);
+    printf("  %-4s %-15s %-7s %8.2f Mmsg/s %7.2f GB/s %8.2f cyc/msg %7.2f ns/msg   (sink %lx)\n",
+           what, row, isa_name(isa),
+           msgs * 1e3 / ns, bytes / ns, static_cast<double>(s.cycles) / msgs, ns / msgs,
+           static_cast<unsigned long>(sink));
+    fflush(stdout);
+    s.pc.print(std::cout, "       ", msgs);
+    return static_cast<double>(s.cycles) / msgs;
+}
+
+// cycles/msg of one feed's parse_null and decode rows per level, for the
+// side-by-side table at the end; 0 where the level did not run.
+struct CycRow {
+    char   what[4]{};
+    double parse_null[static_cast<size_t>(Isa::NumIsa)]{};
+    double decode[static_cast<size_t>(Isa::NumIsa)]{};
+};
+
+static void print_side_by_side(const std::vector<CycRow>& rows, const Isa top) {
+    printf("cycles/msg side by side (avx512 = the VBMI decoders)\n  %-4s %-10s", "", "");
+    for (int l = 0; l <= static_cast<int>(top); ++l) printf(" %8s", isa_name(static_cast<Isa>(l)));
+    printf("\n");
+    for (const CycRow& r : rows) {
+        for (int k = 0; k < 2; ++k) {
+            const double* c = k ? r.decode : r.parse_null;
+            bool any = false;
+            for (int l = 0; l <= static_cast<int>(top); ++l) any |= c[l] > 0;
+            if (!any) continue;
+            printf("  %-4s %-10s", r.what, k ? "decode" : "parse_null");
+            for (int l = 0; l <= static_cast<int>(top); ++l)
+                if (c[l] > 0) printf(" %8.2f", c[l]);
+                else          printf(" %8s", "-");
+            printf("\n");
+        }
+    }
+}
+
+// ─── parse_datagram over a whole feed ────────────────────────────────────────
+
+static void bench_parse(const char* what, const ItchFeed& feed, const unsigned reps, const Isa top) {
+    const IsaVariants<ParseDatagramFn<CountingHandler>> parse = parse_datagram_variants<CountingHandler>();
+
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        ParseDatagramFn<CountingHandler>* fn = parse.v[l];
+        if (!fn) continue;
+        CountingHandler h;
+        Span s;
+        s.time([&] {
+            for (unsigned r = 0; r < reps; ++r)
+                for (const ItchDatagram& d : feed.datagrams)
+                    fn(feed.payload(d), d.len, h);
+        });
+        report(what, "parse_datagram", static_cast<Isa>(l), s, feed.msgs * reps, feed.payload_bytes * reps, h.sum);
+
+        const uint64_t saw[] = { h.adds, h.executes, h.cancels, h.deletes, h.replaces, h.trades };
+        const uint64_t want[std::size(saw)] = { feed.type_count[GEN_A] + feed.type_count[GEN_F], feed.type_count[GEN_E],
+                                                   feed.type_count[GEN_X], feed.type_count[GEN_D], feed.type_count[GEN_U],
+                                                   feed.type_count[GEN_P] };
+        static constexpr const char* names[std::size(saw)] = { "A+F", "E", "X", "D", "U", "P" };
+        for (size_t t = 0; t < std::size(saw); ++t)
+            if (saw[t] != want[t] * reps)
+                printf("  MISMATCH %s: handler saw %lu %s, feed has %lu\n", isa_name(static_cast<Isa>(l)),
+                       static_cast<unsigned long>(saw[t]), names[t], static_cast<unsigned long>(want[t] * reps));
+    }
+}
+
+static void bench_parse_null(const char* what, const ItchFeed& feed, const unsigned reps, const Isa top, double* cyc) {
+    const IsaVariants<ParseDatagramFn<NullHandler>> parse = parse_datagram_variants<NullHandler>();
+
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        ParseDatagramFn<NullHandler>* fn = parse.v[l];
+        if (!fn) continue;
+        NullHandler h;
+        Span s;
+        s.time([&] {
+            for (unsigned r = 0; r < reps; ++r)
+                for (const ItchDatagram& d : feed.datagrams)
+                    fn(feed.payload(d), d.len, h);
+        });
+        cyc[l] = report(what, "parse_null", static_cast<Isa>(l), s, feed.msgs * reps, feed.payload_bytes * reps, 0);
+    }
+}
+
+// ─── Bare decoders over the message bodies of one type ───────────────────────
+
+template<class Dec>
+[[gnu::always_inline]] static inline uint64_t decode_loop(const uint8_t* const* bodies, const size_t n,
+                                                         const char type, const unsigned reps) noexcept {
+    uint64_t acc = 0;
+    for (unsigned r = 0; r < reps; ++r) {
+        for (size_t i = 0; i < n; ++i) {
+            const uint8_t* m = bodies[i];
+            switch (type) {
+                case 'A': case 'F': { auto d = Dec::add_order(m);     acc += d.order_ref ^ d.shares ^ d.price;  break; }
+                case 'E':           { auto d = Dec::execute_order(m); acc += d.order_ref ^ d.match_num;         break; }
+                case 'X':           { auto d = Dec::cancel_order(m);  acc += d.order_ref ^ d.cancelled_shares;  break; }
+                case 'U':           { auto d = Dec::replace_order(m); acc += d.new_ref ^ d.shares ^ d.price;    break; }
+                case 'P':           { auto d = Dec::trade(m);         acc += d.match_num ^ d.shares ^ d.price;  break; }
+                default:            { auto d = Dec::delete_order(m);  acc += d.order_ref ^ d.timestamp_ns;      break; }
+            }
+        }
+    }
+    return acc;
+}
+
+static uint64_t decode_scalar(const uint8_t* const* b, const size_t n, const char t, const unsigned reps) noexcept {
+    return decode_loop<DecodeScalar>(b, n, t, reps);
+}
+
+[[gnu::target("sse4.2")]]
+static uint64_t decode_sse42(const uint8_t* const* b, const size_t n, const char t, const unsigned reps) noexcept {
+    return decode_loop<DecodeSSE42>(b, n, t, reps);
+}
+
+[[gnu::target("avx2")]]
+static uint64_t decode_avx2(const uint8_t* const* b, const size_t n, const char t, const unsigned reps) noexcept {
+    return decode_loop<DecodeAVX2>(b, n, t, reps);
+}
+
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static uint64_t decode_avx512vbmi(const uint8_t* const* b, const size_t n, const char t, const unsigned reps) noexcept {
+    return decode_loop<DecodeAVX512VBMI>(b, n, t, reps);
+}
+
+using DecodeLoopFn = uint64_t(const uint8_t* const*, size_t, char, unsigned) noexcept;
+
+static void bench_decode(const char* what, const ItchFeed& feed, const char type, const unsigned reps, const Isa top,
+                         double* cyc) {
+    // pointers to every body of this type, in feed order
+    std::vector<const uint8_t*> bodies;
+    uint64_t bytes = 0;
+    for (const ItchDatagram& d : feed.datagrams) {
+        const uint8_t* cur = feed.payload(d) + MOLD_HDR_LEN;
+        for (uint16_t i = 0; i < d.msg_count; ++i) {
+            const uint16_t mlen = be16(cur);
+            if (cur[2] == static_cast<uint8_t>(type)) {
+                bodies.push_back(cur + 2);
+                bytes += 2u + mlen;
+            }
+            cur += 2 + mlen;
+        }
+    }
+    if (bodies.empty()) return;
+
+    const IsaVariants<DecodeLoopFn> decoders{{ decode_scalar, decode_sse42, decode_avx2,
+                                               g_vbmi ? decode_avx512vbmi : nullptr }};
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        DecodeLoopFn* fn = decoders.v[l];
+        if (!fn) continue;
+        uint64_t sink = 0;
+        Span s;
+        s.time([&] { sink = fn(bodies.data(), bodies.size(), type, reps); });
+        cyc[l] = report(what, "decode", static_cast<Isa>(l), s, bodies.size() * reps, bytes * reps, sink);
+    }
+}
+
+// ─── Whole datagrams into structure-of-arrays ────────────────────────────────
+
+// What a book stage would read: every array the soa decode fills.
+static uint64_t fold_soa(const ItchSoA& b) noexcept {
+    uint64_t acc = 0;
+    for (uint32_t i = 0; i < b.n; ++i)
+        acc += (b.order_ref[i] ^ b.new_ref[i] ^ b.ts[i]) + (b.shares[i] ^ b.price[i] ^ b.locate[i] ^ b.side[i] ^ b.type[i]);
+    return acc;
+}
+
+// Every soa variant against the scalar per-message decoders; returns the number of wrong messages.
+static uint64_t check_soa(const ItchFeed& feed, const Isa top) {
+    const IsaVariants<DecodeDatagramSoaFn> soa = decode_datagram_soa_variants();
+    static ItchSoA b;
+    uint64_t bad = 0;
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        if (!soa.v[l]) continue;
+        for (const ItchDatagram& d : feed.datagrams) {
+            const uint8_t* pkt = feed.payload(d);
+            if (soa.v[l](pkt, d.len, b) != d.msg_count || b.seqno != d.seqno) { ++bad; continue; }
+            for (uint32_t i = 0; i < b.n; ++i) {
+                const uint8_t* m = pkt + b.off[i];
+                uint64_t ref = 0, new_ref = 0;
+                uint32_t shares = 0, price = 0;
+                uint8_t  side = 0;
+                switch (m[0]) {
+                    case 'A': case 'F': { auto x = DecodeScalar::add_order(m);     ref = x.order_ref; shares = x.shares; price = x.price; side = x.side; break; }
+                    case 'E':           { auto x = DecodeScalar::execute_order(m); ref = x.order_ref; shares = x.executed_shares; break; }
+                    case 'X':           { auto x = DecodeScalar::cancel_order(m);  ref = x.order_ref; shares = x.cancelled_shares; break; }
+                    case 'D':           { auto x = DecodeScalar::delete_order(m);  ref = x.order_ref; break; }
+                    case 'U':           { auto x = DecodeScalar::replace_order(m); ref = x.orig_ref; new_ref = x.new_ref; shares = x.shares; price = x.price; break; }
+                    case 'P':           { auto x = DecodeScalar::trade(m);         ref = x.order_ref; shares = x.shares; price = x.price; side = x.side; break; }
+                    default: break;
+                }
+                if (b.type[i] != m[0] || b.locate[i] != be16(m + 1) || b.ts[i] != be48(m + 5) || b.order_ref[i] != ref ||
+                    b.new_ref[i] != new_ref || b.shares[i] != shares || b.price[i] != price || b.side[i] != side) {
+                    if (bad < 5)
+                        printf("  MISMATCH soa %s: datagram seqno %lu message %u ('%c')\n", isa_name(static_cast<Isa>(l)),
+                               static_cast<unsigned long>(d.seqno), i, m[0]);
+                    ++bad;
+                }
+            }
+        }
+    }
+    return bad;
+}
+
+static void bench_soa(const char* what, const ItchFeed& feed, const unsigned reps, const Isa top) {
+    const IsaVariants<DecodeDatagramSoaFn> soa = decode_datagram_soa_variants();
+    static ItchSoA b;
+    for (int l = 0; l <= static_cast<int>(top); ++l) {
+        DecodeDatagramSoaFn* fn = soa.v[l];
+        if (!fn) continue;
+        uint64_t sink = 0;
+        Span s;
+        s.time([&] {
+            for (unsigned r = 0; r < reps; ++r)
+                for (const ItchDatagram& d : feed.datagrams) {
+                    fn(feed.payload(d), d.len, b);
+                    sink += fold_soa(b);
+                }
+        });
+        report(what, "soa", static_cast<Isa>(l), s, feed.msgs * reps, feed.payload_bytes * reps, sink);
+    }
+}
+
+// ─── Main ────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    const uint64_t n_msgs  = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1'000'000ULL;
+    const uint32_t symbols = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 8000u;
+    const uint32_t burst   = argc > 3 ? static_cast<uint32_t>(strtoul(argv[3], nullptr, 10)) : 40u;
+    const unsigned reps    = argc > 4 ? static_cast<unsigned>(strtoul(argv[4], nullptr, 10)) : 10u;
+    const Isa top = g_isa;
+
+    printf("host isa=%s  messages=%lu  symbols=%u  burst<=%u  repetitions=%u\n\n", isa_name(top),
+           static_cast<unsigned long>(n_msgs), symbols, burst, reps);
+
+    // ── Wire vectors, every policy the host runs ──────────────────────────────
+    {
+        unsigned fails = verify_wire_vectors<DecodeScalar>("scalar");
+        if (top >= Isa::SSE42) fails += verify_wire_vectors<DecodeSSE42>("sse42");
+        if (top >= Isa::AVX2)  fails += verify_wire_vectors<DecodeAVX2>("avx2");
+        if (g_vbmi)            fails += verify_wire_vectors<DecodeAVX512VBMI>("avx512vbmi");
+        fails += verify_wire_datagram(top);
+        if (fails) {
+            printf("%u wire vector check(s) wrong\n", fails);
+            return 1;
+        }
+        printf("wire vectors: all 23 ITCH 5.0 types and a 20-byte-header datagram ok\n\n");
+    }
+
+    std::vector<CycRow> cyc;
+
+    // ── Configured mix ─────────────────────────────────────────────────────────
+    {
+        ItchGenConfig cfg;
+        cfg.symbols   = symbols;
+        cfg.burst_max = burst;
+        cfg.resting   = 100'000;
+        ItchFeed feed;
+        ItchGenerator(cfg).generate(feed, n_msgs);
+
+        printf("mix: %lu datagrams, %.1f msgs/datagram, %.1f B/msg  (",
+               static_cast<unsigned long>(feed.datagrams.size()),
+               static_cast<double>(feed.msgs) / feed.datagrams.size(),
+               static_cast<double>(feed.payload_bytes) / feed.msgs);
+        for (int t = 0; t < GEN_NUM_TYPES; ++t)
+            printf("%c %.1f%%%s", itch_gen_type_char[t], 100.0 * feed.type_count[t] / feed.msgs, t + 1 < GEN_NUM_TYPES ? ", " : ")\n");
+        bench_parse("mix", feed, reps, top);
+        CycRow& row = cyc.emplace_back();
+        memcpy(row.what, "mix", 4);
+        bench_parse_null("mix", feed, reps, top, row.parse_null);
+        if (const uint64_t bad = check_soa(feed, top)) {
+            printf("soa decode: %lu message(s) wrong\n", static_cast<unsigned long>(bad));
+            return 1;
+        }
+        bench_soa("mix", feed, reps, top);
+        printf("\n");
+    }
+
+    // ── One type at a time ────────────────────────────────────────────────────
+    for (int t = 0; t < GEN_NUM_TYPES; ++t) {
+        ItchGenConfig cfg = ItchGenConfig::only(static_cast<ItchGenType>(t));
+        cfg.symbols   = symbols;
+        cfg.burst_min = cfg.burst_max = burst;
+        cfg.resting   = static_cast<uint32_t>(n_msgs);     // E / X / D / U never run out of live orders
+        ItchFeed feed;
+        ItchGenerator(cfg).generate(feed, n_msgs);
+
+        const char type = itch_gen_type_char[t];
+        const char what[2] = { type, '\0' };
+        bench_parse(what, feed, reps, top);
+        CycRow& row = cyc.emplace_back();
+        row.what[0] = type;
+        bench_parse_null(what, feed, reps, top, row.parse_null);
+        bench_decode(what, feed, type, reps, top, row.decode);
+        bench_soa(what, feed, reps, top);
+        printf("\n");
+    }
+    print_side_by_side(cyc, top);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * itch5_binfile.h
+ *
+ * NASDAQ TotalView-ITCH 5.0 BinaryFILE (a day file as published: one
+ * [BE u16 length][message] block after another, nothing else) mapped for
+ * parallel decoding (itch5_ingest.cpp).
+ *
+ * A block's length is the only way to find the next one, so index() makes a
+ * single sequential pass over the mapping first, reading two length bytes
+ * and the type byte per message, and cuts the file into chunks of about
+ * chunk_bytes that each start on a message boundary.  Chunks can then be
+ * walked independently (parse_blocks_pick, itch5_parse.h), in any order and
+ * on any core.
+ *
+ * The same pass hands every Stock Directory message to a ShardTable
+ * (itch5_shard.h), so each locate's shard is settled before any decoder
+ * starts: every router then sends a symbol to the same shard whichever chunk
+ * it is in, including hot symbols given by name.
+ *
+ * The mapping is not faulted in up front (a day is 10 GB and more); the
+ * index pass reads it front to back under MADV_SEQUENTIAL, which is what
+ * brings it into the page cache.  One zero page is mapped behind the file,
+ * so the decoders' 32-byte overread past the last message never leaves the
+ * mapping.
+ */
+
+#ifndef ITCH5_BINFILE_H_INCLUDED
+#define ITCH5_BINFILE_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "itch5_avx.h"
+#include "itch5_shard.h"
+
+// A run of whole message blocks.
+struct BinChunk {
+    uint64_t offset;       // of its first block in the file
+    uint64_t bytes;
+    uint64_t first_msg;    // messages before it in the file
+    uint32_t msgs;
+};
+
+class BinFile {
+public:
+    BinFile() = default;
+    BinFile(const BinFile&) = delete;
+    BinFile& operator=(const BinFile&) = delete;
+
+    ~BinFile() {
+        if (m_map) munmap(m_map, m_map_len);
+    }
+
+    // Maps the whole file; prints the reason and returns false if it cannot.
+    bool open(const char* path) {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { perror(path); return false; }
+        struct stat st{};
+        if (fstat(fd, &st) < 0) { perror("fstat"); ::close(fd); return false; }
+        m_size = static_cast<size_t>(st.st_size);
+
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        m_map_len = (m_size + page - 1) / page * page + page;
+        void* base = mmap(nullptr, m_map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) { perror("mmap"); ::close(fd); return false; }
+        if (m_size && mmap(base, m_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            perror("mmap"); munmap(base, m_map_len); ::close(fd); return false;
+        }
+        ::close(fd);
+        m_map = static_cast<uint8_t*>(base);
+        if (m_size) madvise(m_map, m_size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    // The boundary pass: cuts the file into chunks of about chunk_bytes and
+    // feeds the directory to table (if any).  Stops at the first block that
+    // is empty or runs past the end of the file; tail() is what is left.
+    void index(const size_t chunk_bytes, ShardTable* table) {
+        m_chunks.clear();
+        m_msgs = 0;
+        const uint8_t* const base = m_map;
+        uint64_t pos = 0, start = 0;
+        uint64_t first = 0;
+
+        while (pos + 2 <= m_size) {
+            const uint32_t len = (uint32_t{base[pos]} << 8) | base[pos + 1];
+            if (len == 0 || pos + 2 + len > m_size) break;
+            const uint8_t* body = base + pos + 2;
+            if (table && body[0] == static_cast<uint8_t>(MsgType::StockDirectory) &&
+                len >= itch_msg_len(static_cast<uint8_t>(MsgType::StockDirectory)))
+                table->on_directory(DecodeScalar::stock_directory(body));
+            pos += 2 + len;
+            ++m_msgs;
+            if (pos - start >= chunk_bytes) {
+                m_chunks.push_back({start, pos - start, first, static_cast<uint32_t>(m_msgs - first)});
+                start = pos;
+                first = m_msgs;
+            }
+        }
+        if (pos > start) m_chunks.push_back({start, pos - start, first, static_cast<uint32_t>(m_msgs - first)});
+        m_indexed = pos;
+    }
+
+    const uint8_t* data() const noexcept { return m_map; }
+    size_t size() const noexcept { return m_size; }
+    const std::vector<BinChunk>& chunks() const noexcept { return m_chunks; }
+    uint64_t msgs() const noexcept { return m_msgs; }
+    uint64_t tail() const noexcept { return m_size - m_indexed; }       // bytes past the last whole block
+
+private:
+    uint8_t* m_map{nullptr};
+    size_t   m_map_len{0};
+    size_t   m_size{0};
+    uint64_t m_indexed{0};
+    uint64_t m_msgs{0};
+    std::vector<BinChunk> m_chunks;
+};
+
+#endif // ITCH5_BINFILE_H_INCLUDED
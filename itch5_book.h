@@ -0,0 +1,593 @@
+/**
+ * itch5_book.h
+ *
+ * ITCH 5.0 order book builder: an ItchHandler (itch5_parse.h) that applies
+ * A / F / E / C / X / D / U to a full-depth, order-by-order (L3) book per
+ * stock_locate and answers L2 (price level aggregates) and L3 (the orders
+ * queued at a level, in time priority) queries.
+ *
+ * Layout:
+ *   orders   BookOrder pool, indexed by uint32_t, recycled through a free
+ *            list.  Each order knows its level and its neighbours in that
+ *            level's FIFO, so execute / cancel / delete touch the order, its
+ *            two neighbours and the level: O(1), no search.
+ *   refs     order ref -> pool index, direct-indexed in 4K-ref pages (the
+ *            DirectOrderArray of orderid_bench.cpp, which beats
+ *            ChunkyBucketMap_1 there: refs are dense and only grow over the
+ *            day).  Once a page that is not the newest is down to
+ *            REF_SPILL live refs, those move to a hash and the page is
+ *            freed: an order resting all day costs a hash entry, not the
+ *            16 KB page around it, and a shard, which holds only its own
+ *            symbols' share of every page, does not keep the whole day's
+ *            pages alive.
+ *   levels   BookLevel pool, same scheme; a level keeps its aggregate shares,
+ *            order count and FIFO head / tail.
+ *   sides    per symbol and side, the live levels sorted by price key with
+ *            the best at the back (key = price for bids, ~price for asks, so
+ *            both ascend).  A price lookup scans back from the touch, where
+ *            nearly all adds land, before falling back to a binary search;
+ *            adding or emptying a level moves only the levels better than it.
+ *
+ * A level's address is stable for as long as it has orders; the pools are
+ * vectors and move as they grow, so queries return pointers that are good
+ * until the next message is applied.
+ *
+ * prefetch() is the first half of a two-phase apply: a consumer holding a run
+ * of messages fetches the ref slots, orders and levels they will touch for
+ * the whole run, then applies it (shard_apply_batch, itch5_shard.h).
+ *
+ * Messages naming a ref the book does not hold (a book joined mid-session, or
+ * a symbol the subscription filter dropped the add of) are counted in
+ * unknown() and otherwise ignored.  Replace keeps the side and symbol of the
+ * order it replaces and, as on the exchange, loses its time priority.
+ */
+
+#ifndef ITCH5_BOOK_H_INCLUDED
+#define ITCH5_BOOK_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
+#include <immintrin.h>          // _mm_prefetch
+
+#include "itch5_avx.h"
+
+// ─── Book elements ───────────────────────────────────────────────────────────
+
+enum class BookSide : uint8_t { Bid = 0, Ask = 1 };
+
+struct BookOrder {
+    uint64_t ref;
+    uint32_t shares;
+    uint32_t level;         // BookLevel index
+    uint32_t prev;          // older order at the level, or ItchBook::NIL
+    uint32_t next;          // newer order at the level, or ItchBook::NIL
+    uint16_t locate;
+    BookSide side;
+};
+
+struct BookLevel {
+    uint64_t shares;
+    uint32_t price;
+    uint32_t orders;
+    uint32_t head;          // oldest order: first in the queue
+    uint32_t tail;          // newest
+};
+
+// One row of an L2 snapshot.
+struct L2Level {
+    uint32_t price;
+    uint32_t orders;
+    uint64_t shares;
+};
+
+// ─── Book builder ────────────────────────────────────────────────────────────
+
+class ItchBook {
+public:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    ItchBook() : m_sym(65536) {}
+
+    // ── ItchHandler ──
+
+    void on_add_order(const DecodedAddOrder& m) noexcept {
+        add(m.order_ref, m.stock_locate, m.side == 'B' ? BookSide::Bid : BookSide::Ask, m.price, m.shares);
+    }
+    void on_execute(const DecodedExecuteOrder& m) noexcept            { reduce(m.order_ref, m.executed_shares); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept { reduce(m.order_ref, m.executed_shares); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept              { reduce(m.order_ref, m.cancelled_shares); }
+
+    void on_delete(const DecodedDeleteOrder& m) noexcept {
+        const uint32_t o = lookup(m.order_ref);
+        if (o == NIL) [[unlikely]] { ++m_unknown; return; }
+        remove(o);
+    }
+
+    void on_replace(const DecodedReplaceOrder& m) noexcept {
+        const uint32_t o = lookup(m.orig_ref);
+        if (o == NIL) [[unlikely]] { ++m_unknown; return; }
+        const uint16_t locate = m_orders[o].locate;
+        const BookSide side = m_orders[o].side;
+        remove(o);
+        add(m.new_ref, locate, side, m.price, m.shares);
+    }
+
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept {
+        memcpy(symbol_book(m.stock_locate).stock, m.stock, 8);
+    }
+
+    // ── Two-phase apply ──
+    //
+    // A message applied on its own misses up to three times in a row: its
+    // ref slot, the order the slot names, then that order's level and queue
+    // neighbours, each address known only once the line before it is in.
+    // A consumer holding a run of messages (shard_apply_batch, itch5_shard.h)
+    // calls prefetch(m, stage) on the whole run for each stage in
+    // [0, PREFETCH_STAGES) and only then applies it in order, so the run's
+    // misses for one hop are in flight together rather than back to back.
+    // A stage reads only what the stage before fetched.  An earlier message
+    // of the run may change what it read before this one is applied; that
+    // wastes a prefetch and never changes the book.  An add fetches the slot
+    // its ref goes in and the symbol's touch, where nearly all adds land.
+
+    static constexpr unsigned PREFETCH_STAGES = 3;
+
+    void prefetch(const DecodedAddOrder& m, const unsigned stage) const noexcept {
+        if (stage == 0) prefetch_slot(m.order_ref);
+        prefetch_touch(m.stock_locate, m.side == 'B' ? BookSide::Bid : BookSide::Ask, stage);
+    }
+    void prefetch(const DecodedExecuteOrder& m, const unsigned stage) const noexcept      { prefetch_order(m.order_ref, m.executed_shares, stage); }
+    void prefetch(const DecodedExecuteOrderPrice& m, const unsigned stage) const noexcept { prefetch_order(m.order_ref, m.executed_shares, stage); }
+    void prefetch(const DecodedCancelOrder& m, const unsigned stage) const noexcept       { prefetch_order(m.order_ref, m.cancelled_shares, stage); }
+    void prefetch(const DecodedDeleteOrder& m, const unsigned stage) const noexcept       { prefetch_order(m.order_ref, UINT32_MAX, stage); }
+
+    void prefetch(const DecodedReplaceOrder& m, const unsigned stage) const noexcept {
+        prefetch_order(m.orig_ref, UINT32_MAX, stage);
+        if (stage == 0) prefetch_slot(m.new_ref);
+    }
+
+    // ── Queries (pointers valid until the next message) ──
+
+    const BookOrder* order(const uint64_t ref) const noexcept {
+        const uint32_t o = lookup(ref);
+        return o == NIL ? nullptr : &m_orders[o];
+    }
+
+    // Best level of a side, or null if the side is empty.
+    const BookLevel* best(const uint16_t locate, const BookSide side) const noexcept {
+        const Side* s = side_of(locate, side);
+        return s && !s->rung.empty() ? &m_levels[s->rung.back().level] : nullptr;
+    }
+
+    const BookLevel* level(const uint16_t locate, const BookSide side, const uint32_t price) const noexcept {
+        const Side* s = side_of(locate, side);
+        if (!s) return nullptr;
+        bool found;
+        const size_t i = s->find(key(side, price), found);
+        return found ? &m_levels[s->rung[i].level] : nullptr;
+    }
+
+    unsigned level_count(const uint16_t locate, const BookSide side) const noexcept {
+        const Side* s = side_of(locate, side);
+        return s ? static_cast<unsigned>(s->rung.size()) : 0;
+    }
+
+    // L2: up to n levels from the touch outwards; returns how many.
+    unsigned depth(const uint16_t locate, const BookSide side, L2Level* out, const unsigned n) const noexcept {
+        const Side* s = side_of(locate, side);
+        if (!s) return 0;
+        unsigned k = 0;
+        for (size_t i = s->rung.size(); i-- > 0 && k < n; ++k) {
+            const BookLevel& l = m_levels[s->rung[i].level];
+            out[k] = {l.price, l.orders, l.shares};
+        }
+        return k;
+    }
+
+    // L3: fn(const BookOrder&) for each order at the level, oldest first.
+    template<class Fn>
+    void for_each_order(const BookLevel& l, Fn&& fn) const {
+        for (uint32_t o = l.head; o != NIL; o = m_orders[o].next) fn(m_orders[o]);
+    }
+
+    // Space-padded, from the Stock Directory; empty if none was seen.
+    const char* symbol(const uint16_t locate) const noexcept {
+        return m_sym[locate] ? m_sym[locate]->stock : "";
+    }
+
+    uint64_t orders_live() const noexcept { return m_orders_live; }
+    uint64_t levels_live() const noexcept { return m_levels_live; }
+    uint64_t unknown() const noexcept     { return m_unknown; }
+    uint64_t duplicate() const noexcept   { return m_duplicate; }     // adds of a ref already live
+
+    // ref index footprint: direct pages held, and refs moved to the hash
+    uint64_t ref_pages() const noexcept {
+        return static_cast<uint64_t>(std::count_if(m_refs.begin(), m_refs.end(), [](const auto& p) { return p != nullptr; }));
+    }
+    uint64_t ref_spilled() const noexcept { return m_ref_spill.size(); }
+
+    // fn(locate, stock) for every locate the book has seen, by a Stock
+    // Directory entry (stock is its symbol) or by an order (stock is empty).
+    template<class Fn>
+    void for_each_symbol(Fn&& fn) const {
+        for (uint32_t l = 0; l < 65536; ++l)
+            if (m_sym[l]) fn(static_cast<uint16_t>(l), m_sym[l]->stock);
+    }
+
+    // ── Checkpoint image (itch5_checkpoint.h) ──
+    //
+    //   BookImage, then BookOrder[orders], uint32_t[free_orders],
+    //   BookLevel[levels], uint32_t[free_levels], then per live ref page
+    //   RefImage + uint32_t[REF_PAGE], then RefSpillImage[ref_spilled], then
+    //   per symbol SymbolImage +
+    //   Rung[bids] + Rung[asks]; each piece starts 8-aligned.  The pools are
+    //   index-linked, so they go out and come back as flat copies.
+
+    // Writes the image through out(const void*, size_t).  Nothing here
+    // allocates, so it can run in a child forked off a threaded process.
+    template<class Out>
+    void save(Out&& out) const noexcept {
+        BookImage img{m_orders.size(), m_free_orders.size(), m_levels.size(), m_free_levels.size(), 0,
+                      m_ref_spill.size(), 0, m_orders_live, m_levels_live, m_unknown, m_duplicate};
+        for (const auto& p : m_refs) img.ref_pages += p != nullptr;
+        for (const auto& sb : m_sym) img.symbols += sb != nullptr;
+        out(&img, sizeof(img));
+        put(out, m_orders.data(), m_orders.size());
+        put(out, m_free_orders.data(), m_free_orders.size());
+        put(out, m_levels.data(), m_levels.size());
+        put(out, m_free_levels.data(), m_free_levels.size());
+        for (uint64_t p = 0; p < m_refs.size(); ++p)
+            if (m_refs[p]) {
+                const RefImage ri{p, m_refs[p]->live};
+                out(&ri, sizeof(ri));
+                out(m_refs[p]->slot, sizeof(m_refs[p]->slot));
+            }
+        for (const auto& [ref, o] : m_ref_spill) {
+            const RefSpillImage rs{ref, o};
+            out(&rs, sizeof(rs));
+        }
+        for (uint32_t l = 0; l < 65536; ++l)
+            if (const SymbolBook* sb = m_sym[l].get()) {
+                SymbolImage si{l, static_cast<uint32_t>(sb->side[0].rung.size()),
+                               static_cast<uint32_t>(sb->side[1].rung.size()), {}};
+                memcpy(si.stock, sb->stock, sizeof(sb->stock));
+                out(&si, sizeof(si));
+                put(out, sb->side[0].rung.data(), sb->side[0].rung.size());
+                put(out, sb->side[1].rung.data(), sb->side[1].rung.size());
+            }
+    }
+
+    // Replaces the book with the image save() wrote at [p, p + len); false
+    // (and the book left empty) if it does not add up.
+    bool load(const uint8_t* p, const size_t len) {
+        *this = ItchBook();
+        const uint8_t* const end = p + len;
+        BookImage img;
+        if (!take_bytes(p, end, &img, sizeof(img)) ||
+            !take(p, end, m_orders, img.orders) || !take(p, end, m_free_orders, img.free_orders) ||
+            !take(p, end, m_levels, img.levels) || !take(p, end, m_free_levels, img.free_levels)) {
+            *this = ItchBook();
+            return false;
+        }
+        for (uint64_t i = 0; i < img.ref_pages; ++i) {
+            RefImage ri;
+            if (!take_bytes(p, end, &ri, sizeof(ri)) || ri.page >> 32) { *this = ItchBook(); return false; }
+            if (ri.page >= m_refs.size()) grow_refs(ri.page);
+            m_refs[ri.page] = std::make_unique<RefPage>();
+            m_refs[ri.page]->live = ri.live;
+            if (!take_bytes(p, end, m_refs[ri.page]->slot, sizeof(RefPage::slot))) { *this = ItchBook(); return false; }
+        }
+        // a range is spilled as long as the hash holds refs from it
+        for (uint64_t i = 0; i < img.ref_spilled; ++i) {
+            RefSpillImage rs;
+            if (!take_bytes(p, end, &rs, sizeof(rs)) || rs.ref >> 44) { *this = ItchBook(); return false; }
+            const uint64_t pg = rs.ref >> REF_PAGE_SHIFT;
+            if (pg >= m_refs.size()) grow_refs(pg);
+            if (m_refs[pg] || !m_ref_spill.try_emplace(rs.ref, rs.order).second) { *this = ItchBook(); return false; }
+            m_spilled[pg] = 1;
+        }
+        for (uint64_t i = 0; i < img.symbols; ++i) {
+            SymbolImage si;
+            if (!take_bytes(p, end, &si, sizeof(si)) || si.locate > 65535) { *this = ItchBook(); return false; }
+            SymbolBook& sb = symbol_book(static_cast<uint16_t>(si.locate));
+            memcpy(sb.stock, si.stock, sizeof(sb.stock));
+            if (!take(p, end, sb.side[0].rung, si.bids) || !take(p, end, sb.side[1].rung, si.asks)) { *this = ItchBook(); return false; }
+        }
+        m_orders_live = img.orders_live;
+        m_levels_live = img.levels_live;
+        m_unknown     = img.unknown;
+        m_duplicate   = img.duplicate;
+        return true;
+    }
+
+private:
+    struct BookImage {
+        uint64_t orders, free_orders, levels, free_levels, ref_pages, ref_spilled, symbols;
+        uint64_t orders_live, levels_live, unknown, duplicate;
+    };
+    struct RefImage {
+        uint64_t page;
+        uint32_t live;
+        uint32_t pad{0};
+    };
+    struct RefSpillImage {
+        uint64_t ref;
+        uint32_t order;
+        uint32_t pad{0};
+    };
+    struct SymbolImage {
+        uint32_t locate;
+        uint32_t bids;
+        uint32_t asks;
+        char     stock[12];
+    };
+
+    // n elements, then zeros up to the next 8 bytes
+    template<class Out, class T>
+    static void put(Out& out, const T* v, const size_t n) noexcept {
+        static constexpr uint8_t zeros[8]{};
+        out(v, n * sizeof(T));
+        if (const size_t tail = (n * sizeof(T)) & 7) out(zeros, 8 - tail);
+    }
+
+    static bool take_bytes(const uint8_t*& p, const uint8_t* end, void* dst, const size_t n) noexcept {
+        if (static_cast<size_t>(end - p) < n) return false;
+        memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+
+    template<class T>
+    static bool take(const uint8_t*& p, const uint8_t* end, std::vector<T>& v, const uint64_t n) {
+        const uint64_t bytes = (n * sizeof(T) + 7) & ~uint64_t{7};
+        if (n > static_cast<uint64_t>(end - p) / sizeof(T) || bytes > static_cast<uint64_t>(end - p)) return false;
+        v.resize(n);
+        memcpy(v.data(), p, n * sizeof(T));
+        p += bytes;
+        return true;
+    }
+
+    static constexpr unsigned REF_PAGE_SHIFT = 12;
+    static constexpr size_t   REF_PAGE       = size_t{1} << REF_PAGE_SHIFT;
+    static constexpr uint32_t REF_SPILL      = REF_PAGE / 64;   // live refs at which an old page moves to the hash
+    static constexpr size_t   TOUCH_SCAN     = 8;       // levels scanned from the touch before bisecting
+
+    struct RefPage {
+        uint32_t slot[REF_PAGE];
+        uint32_t live{0};
+        RefPage() { memset(slot, 0xFF, sizeof(slot)); }
+    };
+
+    struct Rung {
+        uint32_t key;
+        uint32_t level;
+    };
+
+    // Live levels of one side, ascending by key: best at the back.
+    struct Side {
+        std::vector<Rung> rung;
+
+        // Index of k, or of where it would go (found = false).
+        size_t find(const uint32_t k, bool& found) const noexcept {
+            size_t i = rung.size();
+            for (size_t scanned = 0; i > 0 && scanned < TOUCH_SCAN; --i, ++scanned) {
+                if (rung[i - 1].key == k) { found = true; return i - 1; }
+                if (rung[i - 1].key < k) { found = false; return i; }
+            }
+            const auto it = std::lower_bound(rung.begin(), rung.begin() + static_cast<ptrdiff_t>(i), k,
+                                             [](const Rung& r, const uint32_t v) { return r.key < v; });
+            const size_t j = static_cast<size_t>(it - rung.begin());
+            found = j < i && rung[j].key == k;
+            return j;
+        }
+    };
+
+    struct SymbolBook {
+        Side side[2];
+        char stock[9]{};
+    };
+
+    static uint32_t key(const BookSide side, const uint32_t price) noexcept {
+        return side == BookSide::Bid ? price : ~price;
+    }
+
+    SymbolBook& symbol_book(const uint16_t locate) {
+        if (!m_sym[locate]) [[unlikely]] m_sym[locate] = std::make_unique<SymbolBook>();
+        return *m_sym[locate];
+    }
+
+    const Side* side_of(const uint16_t locate, const BookSide side) const noexcept {
+        return m_sym[locate] ? &m_sym[locate]->side[static_cast<int>(side)] : nullptr;
+    }
+
+    // ── ref index ──
+
+    // A page index has either a page or (m_spilled) its live refs in
+    // m_ref_spill, never both.
+    uint32_t lookup(const uint64_t ref) const noexcept {
+        const uint64_t p = ref >> REF_PAGE_SHIFT;
+        if (p >= m_refs.size() || !m_refs[p]) [[unlikely]] return lookup_spilled(ref, p);
+        return m_refs[p]->slot[ref & (REF_PAGE - 1)];
+    }
+
+    uint32_t lookup_spilled(const uint64_t ref, const uint64_t p) const noexcept {
+        if (p >= m_refs.size() || !m_spilled[p]) return NIL;
+        const auto it = m_ref_spill.find(ref);
+        return it == m_ref_spill.end() ? NIL : it->second;
+    }
+
+    void grow_refs(const uint64_t p) {
+        m_refs.resize(p + 1);
+        m_spilled.resize(p + 1, 0);
+    }
+
+    const uint32_t* slot_of(const uint64_t ref) const noexcept {
+        const uint64_t p = ref >> REF_PAGE_SHIFT;
+        return p < m_refs.size() && m_refs[p] ? &m_refs[p]->slot[ref & (REF_PAGE - 1)] : nullptr;
+    }
+
+    // false if ref is live already
+    bool index(const uint64_t ref, const uint32_t o) {
+        const uint64_t p = ref >> REF_PAGE_SHIFT;
+        if (p >= m_refs.size()) [[unlikely]] grow_refs(p);
+        if (!m_refs[p]) [[unlikely]] {
+            if (m_spilled[p]) return m_ref_spill.try_emplace(ref, o).second;
+            m_refs[p] = std::make_unique<RefPage>();
+        }
+        uint32_t& slot = m_refs[p]->slot[ref & (REF_PAGE - 1)];
+        if (slot != NIL) return false;
+        slot = o;
+        ++m_refs[p]->live;
+        return true;
+    }
+
+    void unindex(const uint64_t ref) noexcept {
+        const uint64_t p = ref >> REF_PAGE_SHIFT;
+        if (!m_refs[p]) [[unlikely]] { m_ref_spill.erase(ref); return; }
+        RefPage& page = *m_refs[p];
+        page.slot[ref & (REF_PAGE - 1)] = NIL;
+        // refs only grow: a page that is not the newest sees few adds again,
+        // so once it is nearly empty its stragglers move to the hash
+        if (--page.live <= REF_SPILL && p + 1 < m_refs.size()) [[unlikely]] spill(p);
+    }
+
+    void spill(const uint64_t p) noexcept {
+        const RefPage& page = *m_refs[p];
+        const uint64_t base = p << REF_PAGE_SHIFT;
+        for (uint32_t i = 0, left = page.live; left > 0; ++i)
+            if (page.slot[i] != NIL) { m_ref_spill.emplace(base + i, page.slot[i]); --left; }
+        m_refs[p].reset();
+        m_spilled[p] = 1;
+    }
+
+    // ── prefetch stages ──
+
+    static void fetch(const void* p) noexcept { _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0); }
+
+    void prefetch_slot(const uint64_t ref) const noexcept {
+        if (const uint32_t* s = slot_of(ref)) fetch(s);
+    }
+
+    // 0: the slot; 1: the order; 2: its level, and its neighbours if taking
+    // shares off it leaves none
+    void prefetch_order(const uint64_t ref, const uint32_t shares, const unsigned stage) const noexcept {
+        const uint32_t* s = slot_of(ref);
+        if (!s) return;
+        if (stage == 0) { fetch(s); return; }
+        const uint32_t o = *s;
+        if (o == NIL) return;
+        if (stage == 1) { fetch(&m_orders[o]); return; }
+        const BookOrder& ord = m_orders[o];
+        fetch(&m_levels[ord.level]);
+        if (shares >= ord.shares) {
+            if (ord.prev != NIL) fetch(&m_orders[ord.prev]);
+            if (ord.next != NIL) fetch(&m_orders[ord.next]);
+        }
+    }
+
+    // 0: the symbol's book; 1: the side's best rung; 2: its level
+    void prefetch_touch(const uint16_t locate, const BookSide side, const unsigned stage) const noexcept {
+        const SymbolBook* sb = m_sym[locate].get();
+        if (!sb) return;
+        if (stage == 0) { fetch(sb); return; }
+        const Side& s = sb->side[static_cast<int>(side)];
+        if (s.rung.empty()) return;
+        if (stage == 1) fetch(&s.rung.back());
+        else            fetch(&m_levels[s.rung.back().level]);
+    }
+
+    // ── pools ──
+
+    template<class T>
+    static uint32_t take(std::vector<T>& pool, std::vector<uint32_t>& free) {
+        if (!free.empty()) {
+            const uint32_t i = free.back();
+            free.pop_back();
+            return i;
+        }
+        pool.emplace_back();
+        return static_cast<uint32_t>(pool.size() - 1);
+    }
+
+    // ── book operations ──
+
+    void add(const uint64_t ref, const uint16_t locate, const BookSide side, const uint32_t price, const uint32_t shares) {
+        const uint32_t o = take(m_orders, m_free_orders);
+        if (!index(ref, o)) [[unlikely]] { m_free_orders.push_back(o); ++m_duplicate; return; }
+
+        Side& s = symbol_book(locate).side[static_cast<int>(side)];
+        const uint32_t k = key(side, price);
+        bool found;
+        const size_t i = s.find(k, found);
+        uint32_t l;
+        if (found) {
+            l = s.rung[i].level;
+        } else {
+            l = take(m_levels, m_free_levels);
+            m_levels[l] = {0, price, 0, NIL, NIL};
+            s.rung.insert(s.rung.begin() + static_cast<ptrdiff_t>(i), Rung{k, l});
+            ++m_levels_live;
+        }
+
+        BookLevel& lv = m_levels[l];
+        m_orders[o] = {ref, shares, l, lv.tail, NIL, locate, side};
+        if (lv.tail != NIL) m_orders[lv.tail].next = o;
+        else                lv.head = o;
+        lv.tail = o;
+        lv.shares += shares;
+        ++lv.orders;
+        ++m_orders_live;
+    }
+
+    void reduce(const uint64_t ref, const uint32_t shares) noexcept {
+        const uint32_t o = lookup(ref);
+        if (o == NIL) [[unlikely]] { ++m_unknown; return; }
+        BookOrder& ord = m_orders[o];
+        if (shares >= ord.shares) { remove(o); return; }
+        ord.shares -= shares;
+        m_levels[ord.level].shares -= shares;
+    }
+
+    void remove(const uint32_t o) noexcept {
+        const BookOrder ord = m_orders[o];
+        BookLevel& lv = m_levels[ord.level];
+        if (ord.prev != NIL) m_orders[ord.prev].next = ord.next;
+        else                 lv.head = ord.next;
+        if (ord.next != NIL) m_orders[ord.next].prev = ord.prev;
+        else                 lv.tail = ord.prev;
+        lv.shares -= ord.shares;
+        unindex(ord.ref);
+        m_free_orders.push_back(o);
+        --m_orders_live;
+
+        if (--lv.orders == 0) {
+            Side& s = m_sym[ord.locate]->side[static_cast<int>(ord.side)];
+            bool found;
+            const size_t i = s.find(key(ord.side, lv.price), found);
+            s.rung.erase(s.rung.begin() + static_cast<ptrdiff_t>(i));
+            m_free_levels.push_back(ord.level);
+            --m_levels_live;
+        }
+    }
+
+    std::vector<BookOrder>                   m_orders;
+    std::vector<uint32_t>                    m_free_orders;
+    std::vector<BookLevel>                   m_levels;
+    std::vector<uint32_t>                    m_free_levels;
+    std::vector<std::unique_ptr<RefPage>>    m_refs;
+    std::vector<uint8_t>                     m_spilled;     // per page index: its refs are in m_ref_spill
+    std::unordered_map<uint64_t, uint32_t>   m_ref_spill;   // ref -> order, for refs of spilled pages
+    std::vector<std::unique_ptr<SymbolBook>> m_sym;         // by stock_locate
+
+    uint64_t m_orders_live{0};
+    uint64_t m_levels_live{0};
+    uint64_t m_unknown{0};
+    uint64_t m_duplicate{0};
+};
+
+#endif // ITCH5_BOOK_H_INCLUDED
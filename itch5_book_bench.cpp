@@ -0,0 +1,318 @@
+/**
+ * itch5_book_bench.cpp
+ *
+ * Book-building throughput: ItchBook (itch5_book.h) behind the receiver's
+ * datagram walker (itch5_parse.h), over either a NASDAQ TotalView-ITCH 5.0
+ * BinaryFILE (a full day is the yardstick) or a synthetic feed
+ * (itch5_gen.h) when no capture is at hand.
+ *
+ * A BinaryFILE is a run of [BE u16 length][message] blocks, the MoldUDP64
+ * message-block layout without the datagram header, so it is read in 4 MB
+ * chunks and each chunk's whole messages go through the walker's bare-block
+ * entry point (parse_blocks_pick).  Only the walk is timed, not the reads.
+ * The same input goes through NullHandler first, so the report separates the
+ * decode from the book:
+ *
+ *   decode   walk + decode, NullHandler
+ *   book     walk + decode + ItchBook, each message applied as decoded
+ *   2phase   the same through ShardBatch (itch5_shard.h): a datagram (up to
+ *            SHARD_BATCH messages) decoded, its book state prefetched, then
+ *            applied; the A/B for building the receiver and the ingest
+ *            with -DSHARD_PREFETCH
+ *   apply    book - decode and 2phase - decode: what the book costs per
+ *            message either way
+ *
+ * Each timed row is followed by its hardware counters per message over the
+ * same walk (PerfAnalysis.h perf_counters), or a note when the host does not
+ * expose them.
+ *
+ * followed by the book at the end (live orders, levels, refs it never saw
+ * added) and, for the symbol busiest near the touch, an L2 snapshot of
+ * both sides and the L3 queue at the best bid.
+ *
+ * Afterwards every level of every symbol is walked and checked against its
+ * orders (count, shares, price order, ref lookup); on a synthetic feed the
+ * live order count must also match what the generator holds.  Any
+ * inconsistency is a BOOK line and exit code 1.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 itch5_book_bench.cpp -o itch5_book_bench
+ *
+ * Run:
+ *   ./itch5_book_bench itch:<BinaryFILE>
+ *   ./itch5_book_bench [messages] [symbols] [repetitions]
+ *   ./itch5_book_bench itch:01302019.NASDAQ_ITCH50
+ *   ISA_FORCE=sse42 ./itch5_book_bench 10000000
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+#include "itch5_parse.h"
+#include "itch5_gen.h"
+#include "itch5_book.h"
+#include "itch5_shard.h"
+#include "PerfAnalysis.h"
+
+using namespace ISADISPATCH;
+using bench_clock = std::chrono::steady_clock;
+
+// ─── Inputs ──────────────────────────────────────────────────────────────────
+
+static constexpr size_t CHUNK = size_t{4} << 20;
+static constexpr size_t SLACK = 64;         // the decoders load 32 bytes at a time
+
+struct Timing {
+    uint64_t msgs{0};
+    uint64_t ns{0};
+    perf_counters pc;
+};
+
+// Walks a BinaryFILE through parse with handler h; false if it cannot be read.
+template<class Handler>
+static bool run_file(const char* path, Handler& h, Timing& t) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+
+    ParseBlocksFn<Handler>* const parse = parse_blocks_pick<Handler>();
+    std::vector<uint8_t> buf(CHUNK + SLACK, 0);
+    uint8_t* const blocks = buf.data();
+    size_t have = 0;
+
+    while (true) {
+        const size_t got = fread(blocks + have, 1, CHUNK - have, f);
+        have += got;
+        if (have == 0) break;
+
+        // whole messages only; the tail waits for the next read
+        size_t end = 0;
+        uint32_t count = 0;
+        while (end + 2 <= have) {
+            const size_t mlen = (size_t{blocks[end]} << 8) | blocks[end + 1];
+            if (end + 2 + mlen > have) break;
+            end += 2 + mlen;
+            ++count;
+        }
+        if (count == 0) {
+            if (got == 0) break;                  // a torn last message
+            continue;
+        }
+        t.pc.start();
+        const auto t0 = bench_clock::now();
+        parse(blocks, blocks + end, count, h);
+        if constexpr (requires { h.flush(); }) h.flush();
+        t.pc.stop();
+        t.ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count());
+        t.msgs += count;
+
+        memmove(blocks, blocks + end, have - end);
+        have -= end;
+    }
+    fclose(f);
+    return true;
+}
+
+template<class Handler>
+static void run_feed(const ItchFeed& feed, Handler& h, Timing& t) {
+    ParseDatagramFn<Handler>* const parse = parse_datagram_pick<Handler>();
+    t.pc.start();
+    const auto t0 = bench_clock::now();
+    for (const ItchDatagram& d : feed.datagrams) {
+        parse(feed.payload(d), d.len, h);
+        if constexpr (requires { h.flush(); }) h.flush();
+    }
+    t.pc.stop();
+    t.ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count());
+    t.msgs += feed.msgs;
+}
+
+// ─── Book checks and report ──────────────────────────────────────────────────
+
+// Every level against the orders queued at it; returns the problems found.
+static uint64_t check_book(const ItchBook& book) {
+    uint64_t bad = 0, orders = 0, levels = 0;
+    std::vector<L2Level> l2;
+    for (uint32_t locate = 0; locate < 65536; ++locate)
+        for (const BookSide side : {BookSide::Bid, BookSide::Ask}) {
+            const uint16_t loc = static_cast<uint16_t>(locate);
+            l2.resize(book.level_count(loc, side));
+            const unsigned n = book.depth(loc, side, l2.data(), static_cast<unsigned>(l2.size()));
+            for (unsigned i = 0; i < n; ++i) {
+                const BookLevel* lv = book.level(loc, side, l2[i].price);
+                uint64_t shares = 0, queued = 0;
+                if (lv)
+                    book.for_each_order(*lv, [&](const BookOrder& o) {
+                        shares += o.shares;
+                        ++queued;
+                        if (o.locate != loc || o.side != side || book.order(o.ref) != &o || o.shares == 0) ++bad;
+                    });
+                const bool worse = i > 0 && (side == BookSide::Bid ? l2[i].price >= l2[i - 1].price
+                                                                   : l2[i].price <= l2[i - 1].price);
+                if (!lv || queued == 0 || queued != l2[i].orders || shares != l2[i].shares || worse) {
+                    if (bad < 5)
+                        printf("BOOK locate %u %s level %u: %lu orders / %lu shares queued, level says %u / %lu\n",
+                               locate, side == BookSide::Bid ? "bid" : "ask", l2[i].price,
+                               static_cast<unsigned long>(queued), static_cast<unsigned long>(shares),
+                               l2[i].orders, static_cast<unsigned long>(l2[i].shares));
+                    ++bad;
+                }
+                orders += queued;
+            }
+            levels += n;
+        }
+    if (orders != book.orders_live() || levels != book.levels_live()) {
+        printf("BOOK %lu orders / %lu levels reachable, book counts %lu / %lu\n",
+               static_cast<unsigned long>(orders), static_cast<unsigned long>(levels),
+               static_cast<unsigned long>(book.orders_live()), static_cast<unsigned long>(book.levels_live()));
+        ++bad;
+    }
+    return bad;
+}
+
+static void print_timing(const char* row, const Timing& t) {
+    printf("  %-7s %12lu msgs %9.3f s %8.2f Mmsg/s %7.2f ns/msg\n", row, static_cast<unsigned long>(t.msgs),
+           t.ns / 1e9, t.ns ? t.msgs * 1e3 / t.ns : 0.0, t.msgs ? static_cast<double>(t.ns) / t.msgs : 0.0);
+    fflush(stdout);
+    t.pc.print(std::cout, "         ", t.msgs);
+}
+
+static void print_apply(const Timing& decode, const Timing& book, const Timing& two) {
+    const auto per_msg = [&](const Timing& t) {
+        return t.msgs ? static_cast<double>(t.ns - std::min(t.ns, decode.ns)) / t.msgs : 0.0;
+    };
+    printf("  apply   %7.2f ns/msg one by one, %.2f ns/msg two-phase\n", per_msg(book), per_msg(two));
+}
+
+// The two-phase book against the one built message by message.
+static uint64_t check_same(const ItchBook& a, const ItchBook& b) {
+    if (a.orders_live() == b.orders_live() && a.levels_live() == b.levels_live() && a.unknown() == b.unknown() &&
+        a.duplicate() == b.duplicate())
+        return 0;
+    printf("BOOK two-phase: %lu orders / %lu levels / %lu unknown, one by one: %lu / %lu / %lu\n",
+           static_cast<unsigned long>(b.orders_live()), static_cast<unsigned long>(b.levels_live()),
+           static_cast<unsigned long>(b.unknown()), static_cast<unsigned long>(a.orders_live()),
+           static_cast<unsigned long>(a.levels_live()), static_cast<unsigned long>(a.unknown()));
+    return 1;
+}
+
+static void print_book(const ItchBook& book) {
+    printf("  book: %lu live orders, %lu levels, %lu msgs for unknown refs, %lu duplicate adds\n",
+           static_cast<unsigned long>(book.orders_live()), static_cast<unsigned long>(book.levels_live()),
+           static_cast<unsigned long>(book.unknown()), static_cast<unsigned long>(book.duplicate()));
+    printf("  refs: %lu pages of 4K, %lu spilled to the hash\n",
+           static_cast<unsigned long>(book.ref_pages()), static_cast<unsigned long>(book.ref_spilled()));
+
+    uint16_t top = 0;
+    uint64_t most = 0;
+    L2Level l2[5];
+    for (uint32_t locate = 1; locate < 65536; ++locate) {
+        uint64_t n = 0;     // ranked by the orders in the top five levels
+        for (const BookSide side : {BookSide::Bid, BookSide::Ask}) {
+            const unsigned got = book.depth(static_cast<uint16_t>(locate), side, l2, 5);
+            for (unsigned k = 0; k < got; ++k) n += l2[k].orders;
+        }
+        if (n > most) { most = n; top = static_cast<uint16_t>(locate); }
+    }
+    if (most == 0) return;
+
+    printf("  locate %u '%.8s'\n", top, book.symbol(top));
+    for (const BookSide side : {BookSide::Bid, BookSide::Ask}) {
+        const unsigned n = book.depth(top, side, l2, 5);
+        printf("    %s", side == BookSide::Bid ? "bid" : "ask");
+        for (unsigned i = 0; i < n; ++i)
+            printf("  %u.%04u x %lu (%u)", l2[i].price / 10000, l2[i].price % 10000,
+                   static_cast<unsigned long>(l2[i].shares), l2[i].orders);
+        printf("\n");
+    }
+    if (const BookLevel* best = book.best(top, BookSide::Bid)) {
+        printf("    best bid queue:");
+        unsigned shown = 0;
+        book.for_each_order(*best, [&](const BookOrder& o) {
+            if (shown++ < 8) printf(" %lu:%u", static_cast<unsigned long>(o.ref), o.shares);
+        });
+        printf("%s\n", shown > 8 ? " ..." : "");
+    }
+}
+
+// ─── Entry point ─────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    printf("isa=%s\n", isa_name(g_isa));
+
+    if (argc > 1 && strncmp(argv[1], "itch:", 5) == 0) {
+        const char* path = argv[1] + 5;
+        Timing decode, apply;
+        NullHandler null;
+        if (!run_file(path, null, decode)) return 1;
+        ItchBook book;
+        if (!run_file(path, book, apply)) return 1;
+        Timing two;
+        ItchBook book2;
+        ShardBatch<ItchBook> batch(book2);
+        if (!run_file(path, batch, two)) return 1;
+
+        printf("%s\n", path);
+        print_timing("decode", decode);
+        print_timing("book", apply);
+        print_timing("2phase", two);
+        print_apply(decode, apply, two);
+        print_book(book);
+        if (const uint64_t bad = check_book(book) + check_book(book2) + check_same(book, book2)) {
+            printf("%lu book inconsistencies\n", static_cast<unsigned long>(bad));
+            return 1;
+        }
+        return 0;
+    }
+
+    const uint64_t n_msgs  = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10'000'000ULL;
+    const uint32_t symbols = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 8000u;
+    const unsigned reps    = argc > 3 ? static_cast<unsigned>(strtoul(argv[3], nullptr, 10)) : 3u;
+
+    ItchGenConfig cfg;
+    cfg.symbols = symbols;
+    ItchFeed feed;
+    ItchGenerator gen(cfg);
+    gen.generate(feed, n_msgs);
+    printf("synthetic: %lu msgs, %u symbols, %lu datagrams, %u repetitions\n", static_cast<unsigned long>(feed.msgs),
+           symbols, static_cast<unsigned long>(feed.datagrams.size()), reps);
+
+    // a fresh book per repetition: the feed's adds are only new once
+    Timing decode, apply, two;
+    for (unsigned r = 0; r < reps; ++r) {
+        NullHandler null;
+        run_feed(feed, null, decode);
+    }
+    uint64_t bad = 0;
+    for (unsigned r = 0; r < reps; ++r) {
+        ItchBook book, book2;
+        ShardBatch<ItchBook> batch(book2);
+        run_feed(feed, book, apply);
+        run_feed(feed, batch, two);
+        if (r + 1 < reps) continue;
+
+        print_timing("decode", decode);
+        print_timing("book", apply);
+        print_timing("2phase", two);
+        print_apply(decode, apply, two);
+        print_book(book);
+        bad = check_book(book) + check_book(book2) + check_same(book, book2);
+        if (book.orders_live() != gen.live_orders() || book.unknown() != 0) {
+            printf("BOOK %lu live orders, generator holds %lu; %lu unknown refs\n",
+                   static_cast<unsigned long>(book.orders_live()), static_cast<unsigned long>(gen.live_orders()),
+                   static_cast<unsigned long>(book.unknown()));
+            ++bad;
+        }
+    }
+    if (bad) {
+        printf("%lu book inconsistencies\n", static_cast<unsigned long>(bad));
+        return 1;
+    }
+    return 0;
+}
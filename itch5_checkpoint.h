@@ -0,0 +1,246 @@
+/**
+ * itch5_checkpoint.h
+ *
+ * Book checkpoint file for a fast intraday restart: every shard's ItchBook
+ * (itch5_book.h) and where each receive queue's MoldUDP64 sessions stood
+ * (itch5_mold.h) at one consistent cut, so a restarted receiver maps the
+ * file, copies the books back and picks the feed up at the next seqno
+ * instead of replaying the day.  itch5_rx.h takes the cut and restores.
+ *
+ * Layout, every piece 8-aligned:
+ *   CkptHeader    magic, sizes, the sessions per queue, where each shard's
+ *                 image starts
+ *   shard images  ItchBook::save(), one after another
+ * The book pools are index-linked (no pointers), so an image is a run of
+ * flat arrays: a restore is a handful of memcpy's out of the mapping.  Those
+ * links cannot be checked one by one, so the header carries a sum over the
+ * images and itself, and a file that does not match is not restored.
+ *
+ * CkptWriter runs in a child forked off the receiver at the cut, against
+ * the child's copy-on-write view of the books, while the parent's shards
+ * carry on.  It therefore only makes system calls (open, pwrite,
+ * fdatasync, close, rename; no malloc, no stdio), from buffers set up in
+ * the parent.  The file is written under path.tmp and renamed over path once
+ * complete and synced, so path is always the last whole checkpoint.
+ */
+
+#ifndef ITCH5_CHECKPOINT_H_INCLUDED
+#define ITCH5_CHECKPOINT_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "itch5_mold.h"
+#include "itch5_shard.h"
+#include "itch5_book.h"
+
+static constexpr unsigned CKPT_MAX_QUEUES = 8;
+static constexpr char     CKPT_MAGIC[8]   = { 'I', 'T', 'C', 'H', 'C', 'K', 'P', '2' };
+
+// ─── File header ─────────────────────────────────────────────────────────────
+
+struct CkptHeader {
+    char             magic[8];
+    uint64_t         bytes;             // the whole file
+    uint64_t         sum;               // ckpt_sum of the images, then of this header with sum = 0
+    int64_t          taken_ns;          // CLOCK_REALTIME at the cut
+    uint32_t         queues;
+    uint32_t         shards;
+    uint32_t         sessions[CKPT_MAX_QUEUES];
+    MoldSessionState session[CKPT_MAX_QUEUES][MoldSequencer::MAX_SESSIONS];
+    uint64_t         shard_offset[SHARD_MAX];
+    uint64_t         shard_bytes[SHARD_MAX];
+};
+
+// FNV-1a over the 8-byte words of [p, p + len), on from h; len is a
+// multiple of 8 (the header and every image are).
+static inline uint64_t ckpt_sum(uint64_t h, const void* p, const size_t len) noexcept {
+    const uint8_t* b = static_cast<const uint8_t*>(p);
+    for (size_t i = 0; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, b + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static constexpr uint64_t CKPT_SUM_SEED = 0xcbf29ce484222325ULL;
+
+// ─── Writer (forked child) ───────────────────────────────────────────────────
+
+class CkptWriter {
+public:
+    static constexpr size_t BUF = size_t{1} << 20;
+
+    // In the parent: names and the write buffer.
+    explicit CkptWriter(const char* path) : m_buf(new uint8_t[BUF]) {
+        snprintf(m_path, sizeof(m_path), "%s", path);
+        snprintf(m_tmp, sizeof(m_tmp), "%s.tmp", path);
+    }
+
+    const char* path() const noexcept { return m_path; }
+
+    // In the child: h (sizes and offsets filled in here) and books[0..n)
+    // to path.  False on any failed call, with path untouched.
+    bool write(CkptHeader& h, const ItchBook* const* books, const unsigned n) noexcept {
+        m_fd = ::open(m_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) return false;
+        m_ok = true;
+        m_pos = sizeof(CkptHeader);
+        m_used = 0;
+        m_sum = CKPT_SUM_SEED;
+        m_word = 0;
+        m_word_bytes = 0;
+        if (pwrite_all(&h, sizeof(h), 0)) {       // placeholder, so the images land after it
+            for (unsigned k = 0; k < n; ++k) {
+                h.shard_offset[k] = m_pos;
+                books[k]->save([this](const void* p, const size_t len) noexcept { put(p, len); });
+                h.shard_bytes[k] = m_pos - h.shard_offset[k];
+            }
+            flush();
+            h.bytes = m_pos;
+            memcpy(h.magic, CKPT_MAGIC, sizeof(h.magic));
+            h.sum = 0;
+            h.sum = ckpt_sum(m_sum, &h, sizeof(h));
+            m_ok = m_ok && pwrite_all(&h, sizeof(h), 0) && fdatasync(m_fd) == 0;
+        } else {
+            m_ok = false;
+        }
+        m_ok = ::close(m_fd) == 0 && m_ok;
+        if (m_ok) m_ok = rename(m_tmp, m_path) == 0;
+        else      unlink(m_tmp);
+        return m_ok;
+    }
+
+private:
+    void put(const void* p, const size_t len) noexcept {
+        sum(static_cast<const uint8_t*>(p), len);
+        if (m_used + len > BUF) flush();
+        if (len >= BUF) {
+            m_ok = m_ok && pwrite_all(p, len, m_pos);
+            m_pos += len;
+            return;
+        }
+        memcpy(m_buf.get() + m_used, p, len);
+        m_used += len;
+        m_pos += len;
+    }
+
+    // ckpt_sum across pieces of any length (the book pads with 4-byte
+    // pieces): the bytes of an unfinished word wait in m_word.
+    void sum(const uint8_t* b, size_t len) noexcept {
+        for (; len && m_word_bytes; --len) {
+            m_word |= uint64_t{*b++} << (8 * m_word_bytes);
+            if (++m_word_bytes == 8) {
+                m_sum = ckpt_sum(m_sum, &m_word, 8);
+                m_word = 0;
+                m_word_bytes = 0;
+            }
+        }
+        const size_t whole = len & ~size_t{7};
+        m_sum = ckpt_sum(m_sum, b, whole);
+        for (size_t i = whole; i < len; ++i) m_word |= uint64_t{b[i]} << (8 * m_word_bytes++);
+    }
+
+    void flush() noexcept {
+        if (m_used) m_ok = m_ok && pwrite_all(m_buf.get(), m_used, m_pos - m_used);
+        m_used = 0;
+    }
+
+    bool pwrite_all(const void* p, size_t len, uint64_t off) noexcept {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        while (len) {
+            const ssize_t w = pwrite(m_fd, b, len, static_cast<off_t>(off));
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            b += w;
+            len -= static_cast<size_t>(w);
+            off += static_cast<uint64_t>(w);
+        }
+        return true;
+    }
+
+    std::unique_ptr<uint8_t[]> m_buf;
+    char     m_path[256];
+    char     m_tmp[260];
+    int      m_fd{-1};
+    bool     m_ok{false};
+    uint64_t m_pos{0};      // file offset the next byte lands at
+    uint64_t m_sum{0};
+    uint64_t m_word{0};     // bytes summed but not yet a whole word
+    unsigned m_word_bytes{0};
+    size_t   m_used{0};     // buffered, ending at m_pos
+};
+
+// ─── Reader ──────────────────────────────────────────────────────────────────
+
+class CkptFile {
+public:
+    CkptFile() = default;
+    CkptFile(const CkptFile&) = delete;
+    CkptFile& operator=(const CkptFile&) = delete;
+
+    ~CkptFile() {
+        if (m_map) munmap(m_map, m_size);
+    }
+
+    // Maps path and checks its header; false if there is none (quietly) or
+    // it is not a whole checkpoint (saying why).
+    bool open(const char* path) {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            if (errno != ENOENT) perror(path);
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) < 0) { perror("fstat"); ::close(fd); return false; }
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size < sizeof(CkptHeader)) {
+            fprintf(stderr, "[ckpt] %s: too short for a checkpoint\n", path);
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) { perror("mmap"); return false; }
+        m_map = static_cast<uint8_t*>(base);
+
+        const CkptHeader& h = header();
+        bool ok = memcmp(h.magic, CKPT_MAGIC, sizeof(h.magic)) == 0 && h.bytes == m_size &&
+                  h.queues <= CKPT_MAX_QUEUES && h.shards >= 1 && h.shards <= SHARD_MAX;
+        for (unsigned q = 0; ok && q < h.queues; ++q) ok = h.sessions[q] <= MoldSequencer::MAX_SESSIONS;
+        for (unsigned k = 0; ok && k < h.shards; ++k)
+            ok = h.shard_offset[k] >= sizeof(CkptHeader) && h.shard_offset[k] <= m_size &&
+                 h.shard_bytes[k] <= m_size - h.shard_offset[k];
+        if (ok) {
+            CkptHeader copy;
+            memcpy(&copy, &h, sizeof(copy));        // padding and all, as summed
+            copy.sum = 0;
+            const uint64_t sum = ckpt_sum(ckpt_sum(CKPT_SUM_SEED, m_map + sizeof(CkptHeader), m_size - sizeof(CkptHeader)),
+                                          &copy, sizeof(copy));
+            ok = sum == h.sum;
+        }
+        if (!ok) fprintf(stderr, "[ckpt] %s: not a whole checkpoint\n", path);
+        return ok;
+    }
+
+    const CkptHeader& header() const noexcept { return *reinterpret_cast<const CkptHeader*>(m_map); }
+
+    const uint8_t* shard(const unsigned k, size_t& len) const noexcept {
+        len = header().shard_bytes[k];
+        return m_map + header().shard_offset[k];
+    }
+
+private:
+    uint8_t* m_map{nullptr};
+    size_t   m_size{0};
+};
+
+#endif // ITCH5_CHECKPOINT_H_INCLUDED
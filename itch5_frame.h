@@ -0,0 +1,112 @@
+/**
+ * itch5_frame.h
+ *
+ * Link header -> IPv4 -> UDP walk shared by the receive paths that see whole
+ * frames rather than socket payloads: the capture reader (itch5_pcap.h) and
+ * the AF_PACKET backend (itch5_sock.cpp).
+ *
+ * Link types are the pcap LINKTYPE_ numbers: Ethernet (with up to two 802.1Q
+ * / 802.1ad tags), raw IPv4 and Linux cooked capture v1 / v2.  Only
+ * unfragmented IPv4 / UDP is accepted, optionally only to a few destination
+ * groups and / or one port.
+ */
+
+#ifndef ITCH5_FRAME_H_INCLUDED
+#define ITCH5_FRAME_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+
+enum : uint16_t {
+    LINK_ETHERNET = 1,
+    LINK_RAW      = 101,
+    LINK_SLL      = 113,
+    LINK_IPV4     = 228,
+    LINK_SLL2     = 276,
+};
+
+enum class FrameUdp : uint8_t {
+    Ok,
+    Skip,           // not IPv4 / UDP, a fragment, or filtered out
+    Truncated,      // the capture length cuts the datagram short
+};
+
+// No groups / port 0 = any.  Groups in network byte order (inet_pton), port
+// in host order.
+struct UdpFilter {
+    static constexpr unsigned MAX_GROUPS = 8;
+
+    uint32_t group[MAX_GROUPS]{};
+    unsigned n_groups{0};
+    uint16_t port{0};
+
+    bool add_group(const uint32_t g) noexcept {
+        if (n_groups == MAX_GROUPS) return false;
+        group[n_groups++] = g;
+        return true;
+    }
+    bool match_group(const uint32_t dst) const noexcept {
+        if (n_groups == 0) return true;
+        for (unsigned i = 0; i < n_groups; ++i)
+            if (group[i] == dst) return true;
+        return false;
+    }
+};
+
+static inline uint16_t frame_be16(const uint8_t* p) noexcept { uint16_t v; memcpy(&v, p, 2); return __builtin_bswap16(v); }
+
+// On Ok, payload / len are the UDP payload inside f.
+static inline FrameUdp frame_udp(const uint16_t link, const uint8_t* f, const uint32_t caplen, const UdpFilter& flt,
+                                 const uint8_t*& payload, uint32_t& len) noexcept {
+    uint32_t off;
+    uint16_t proto;
+    switch (link) {
+        case LINK_ETHERNET:
+            if (caplen < 14) return FrameUdp::Skip;
+            proto = frame_be16(f + 12);
+            off = 14;
+            for (int tags = 0; tags < 2 && (proto == 0x8100 || proto == 0x88a8) && off + 4 <= caplen; ++tags) {
+                proto = frame_be16(f + off + 2);
+                off += 4;
+            }
+            break;
+        case LINK_RAW:
+        case LINK_IPV4:
+            proto = 0x0800;
+            off = 0;
+            break;
+        case LINK_SLL:                                  // protocol at 14
+            if (caplen < 16) return FrameUdp::Skip;
+            proto = frame_be16(f + 14);
+            off = 16;
+            break;
+        case LINK_SLL2:                                 // protocol at 0
+            if (caplen < 20) return FrameUdp::Skip;
+            proto = frame_be16(f);
+            off = 20;
+            break;
+        default:
+            return FrameUdp::Skip;
+    }
+
+    const uint8_t* ip = f + off;
+    if (proto != 0x0800 || caplen < off + 20 || (ip[0] >> 4) != 4 || ip[9] != 17) return FrameUdp::Skip;
+    const uint32_t ihl = (ip[0] & 15u) * 4;
+    if (ihl < 20 || (frame_be16(ip + 6) & 0x3fff)) return FrameUdp::Skip;     // bad header length, or a fragment
+
+    uint32_t dst;
+    memcpy(&dst, ip + 16, 4);
+    const uint8_t* udp = ip + ihl;
+    if (caplen < off + ihl + 8) return FrameUdp::Truncated;
+    if (!flt.match_group(dst) || (flt.port && frame_be16(udp + 2) != flt.port)) return FrameUdp::Skip;
+
+    const uint32_t ulen = frame_be16(udp + 4);
+    if (ulen < 8) return FrameUdp::Skip;
+    if (caplen < off + ihl + ulen) return FrameUdp::Truncated;
+
+    payload = udp + 8;
+    len = ulen - 8;
+    return FrameUdp::Ok;
+}
+
+#endif // ITCH5_FRAME_H_INCLUDED
@@ -0,0 +1,272 @@
+/**
+ * itch5_gen.h
+ *
+ * Synthetic ITCH 5.0 feed: builds valid MoldUDP64 datagrams in memory so the
+ * parse path can be driven without a Solarflare NIC.
+ *
+ * Configurable:
+ *   mix        relative weights of A / F / E / X / D / U / P
+ *   symbols    stock_locate 1..symbols, names "SYM00001"..
+ *   burst      messages per datagram, uniform in [burst_min, burst_max] and
+ *              capped so the UDP payload stays within max_payload bytes
+ *
+ * The generator tracks its live orders, so E / X / D / U always name an order
+ * that an earlier A / F added (and still has the shares), U retires the old
+ * ref and adds the new one, and E / X that take the last shares remove the
+ * order.  `resting` seeds orders that were added before the capture starts,
+ * so a stream of only E / X / D / U is possible; when a type that needs a
+ * live order is drawn and none is live, an A is emitted instead.  Order refs and match numbers increase
+ * monotonically, timestamps advance a few hundred ns per message.
+ *
+ * Output layout mirrors the receiver: each datagram sits in its own
+ * ITCH_GEN_SLOT (2 KB, like an ef_vi RX buffer) at ITCH_GEN_HDR = 42 bytes,
+ * where the UDP payload starts after Ethernet + IPv4 + UDP.  The payload is
+ * therefore unaligned exactly as on the wire, and the decoders' 32-byte
+ * overread always stays inside the slot.  The 42 header bytes are zero.
+ */
+
+#ifndef ITCH5_GEN_H_INCLUDED
+#define ITCH5_GEN_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "itch5_avx.h"
+
+static constexpr size_t ITCH_GEN_SLOT = 2048;
+static constexpr size_t ITCH_GEN_HDR  = 42;
+
+// ─── Configuration ───────────────────────────────────────────────────────────
+
+enum ItchGenType : uint8_t { GEN_A, GEN_F, GEN_E, GEN_X, GEN_D, GEN_U, GEN_P, GEN_NUM_TYPES };
+
+static constexpr char     itch_gen_type_char[GEN_NUM_TYPES] = { 'A', 'F', 'E', 'X', 'D', 'U', 'P' };
+static constexpr uint16_t itch_gen_type_len[GEN_NUM_TYPES]  = { 36, 40, 31, 23, 19, 35, 44 };
+
+struct ItchGenConfig {
+    // roughly the share of each type in a NASDAQ TotalView day
+    double   mix[GEN_NUM_TYPES]{ 40.0, 1.0, 4.0, 3.0, 38.0, 12.0, 2.0 };
+    uint32_t symbols{8000};
+    uint32_t burst_min{1};
+    uint32_t burst_max{40};
+    uint32_t max_payload{1400};        // MoldUDP64 header + message blocks
+    uint32_t resting{0};               // orders live before the first datagram (joined mid-session)
+    uint64_t first_seqno{1};
+    uint64_t seed{42};
+    char     session[10]{'0', '0', '0', '0', '0', '0', '0', '0', '0', '1'};
+
+    // only type t, every datagram full up to burst_max
+    static ItchGenConfig only(const ItchGenType t) {
+        ItchGenConfig c;
+        for (double& w : c.mix) w = 0.0;
+        c.mix[t] = 1.0;
+        c.burst_min = c.burst_max;
+        return c;
+    }
+};
+
+// ─── Generated feed ──────────────────────────────────────────────────────────
+
+struct ItchDatagram {
+    uint32_t offset;       // of the UDP payload in ItchFeed::mem
+    uint32_t len;          // UDP payload bytes
+    uint64_t seqno;        // of its first message
+    uint16_t msg_count;
+};
+
+struct ItchFeed {
+    std::vector<uint8_t>      mem;           // datagrams.size() × ITCH_GEN_SLOT
+    std::vector<ItchDatagram> datagrams;
+    uint64_t                  msgs{0};
+    uint64_t                  payload_bytes{0};
+    uint64_t                  type_count[GEN_NUM_TYPES]{};
+
+    const uint8_t* payload(const ItchDatagram& d) const noexcept { return mem.data() + d.offset; }
+};
+
+// ─── Generator ───────────────────────────────────────────────────────────────
+
+class ItchGenerator {
+public:
+    explicit ItchGenerator(const ItchGenConfig& cfg)
+        : m_cfg(cfg), m_rng(cfg.seed), m_seqno(cfg.first_seqno),
+          m_type(std::begin(cfg.mix), std::end(cfg.mix)) {
+        m_mid.resize(cfg.symbols);
+        for (auto& p : m_mid) p = 100'000 + static_cast<uint32_t>(m_rng() % 5'000'000);   // $10 .. $510
+        m_live.reserve(cfg.resting);
+        for (uint32_t i = 0; i < cfg.resting; ++i)
+            m_live.push_back(new_order(draw_locate(), (m_rng() & 1) ? 'B' : 'S'));
+    }
+
+    // Appends datagrams until at least n_msgs messages have been produced.
+    void generate(ItchFeed& out, const uint64_t n_msgs) {
+        std::uniform_int_distribution<uint32_t> burst(m_cfg.burst_min, std::max(m_cfg.burst_min, m_cfg.burst_max));
+        const uint64_t target = out.msgs + n_msgs;
+        while (out.msgs < target) {
+            const size_t slot = out.mem.size();
+            out.mem.resize(slot + ITCH_GEN_SLOT, 0);
+            uint8_t* const pkt = out.mem.data() + slot + ITCH_GEN_HDR;
+            const uint32_t room = static_cast<uint32_t>(std::min<size_t>(m_cfg.max_payload, ITCH_GEN_SLOT - ITCH_GEN_HDR - 32));
+
+            const uint32_t want = static_cast<uint32_t>(std::min<uint64_t>(burst(m_rng), target - out.msgs));
+            uint32_t len = MOLD_HDR_LEN;
+            uint16_t count = 0;
+            while (count < want) {
+                const ItchGenType t = draw();
+                if (len + 2 + itch_gen_type_len[t] > room) break;
+                len += encode(t, pkt + len);
+                ++out.type_count[t];
+                ++count;
+            }
+
+            memcpy(pkt, m_cfg.session, 10);
+            put_be64(pkt + 10, m_seqno);
+            put_be16(pkt + 18, count);
+            out.datagrams.push_back({static_cast<uint32_t>(slot + ITCH_GEN_HDR), len, m_seqno, count});
+            out.msgs += count;
+            out.payload_bytes += len;
+            m_seqno += count;
+        }
+    }
+
+    uint64_t next_seqno() const noexcept { return m_seqno; }
+    size_t live_orders() const noexcept { return m_live.size(); }
+
+private:
+    struct LiveOrder {
+        uint64_t ref;
+        uint32_t price;
+        uint32_t shares;
+        uint16_t locate;
+        char     side;
+    };
+
+    static void put_be16(uint8_t* p, const uint16_t v) noexcept { const uint16_t b = __builtin_bswap16(v); memcpy(p, &b, 2); }
+    static void put_be32(uint8_t* p, const uint32_t v) noexcept { const uint32_t b = __builtin_bswap32(v); memcpy(p, &b, 4); }
+    static void put_be64(uint8_t* p, const uint64_t v) noexcept { const uint64_t b = __builtin_bswap64(v); memcpy(p, &b, 8); }
+    static void put_be48(uint8_t* p, const uint64_t v) noexcept { const uint64_t b = __builtin_bswap64(v << 16); memcpy(p, &b, 6); }
+
+    ItchGenType draw() {
+        const ItchGenType t = static_cast<ItchGenType>(m_type(m_rng));
+        if (m_live.empty() && (t == GEN_E || t == GEN_X || t == GEN_D || t == GEN_U)) return GEN_A;
+        return t;
+    }
+
+    void stock_name(char* dst, const uint16_t locate) const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "SYM%05u", static_cast<unsigned>(locate % 100000));
+        memcpy(dst, buf, 8);
+    }
+
+    // [0] type  [1-2] locate  [3-4] tracking  [5-10] timestamp
+    void header(uint8_t* b, const ItchGenType t, const uint16_t locate) {
+        m_ts += 50 + (m_rng() & 511);
+        b[0] = static_cast<uint8_t>(itch_gen_type_char[t]);
+        put_be16(b + 1, locate);
+        put_be16(b + 3, static_cast<uint16_t>(m_tracking++));
+        put_be48(b + 5, m_ts);
+    }
+
+    LiveOrder new_order(const uint16_t locate, const char side) {
+        const uint32_t mid = m_mid[locate - 1];
+        const uint32_t off = 100 * static_cast<uint32_t>(m_rng() % 20);   // 0..19 ticks from the touch
+        return {++m_ref, side == 'B' ? mid - 100 - off : mid + 100 + off,
+                100 * static_cast<uint32_t>(1 + m_rng() % 10), locate, side};
+    }
+
+    uint16_t draw_locate() { return static_cast<uint16_t>(1 + m_rng() % m_cfg.symbols); }
+
+    size_t draw_live() { return m_rng() % m_live.size(); }
+
+    void retire(const size_t i) {
+        m_live[i] = m_live.back();
+        m_live.pop_back();
+    }
+
+    // writes the length prefix and body of one message at p, returns bytes written
+    uint32_t encode(const ItchGenType t, uint8_t* p) {
+        const uint16_t mlen = itch_gen_type_len[t];
+        put_be16(p, mlen);
+        uint8_t* b = p + 2;
+
+        switch (t) {
+            case GEN_A:
+            case GEN_F: {
+                const LiveOrder o = new_order(draw_locate(), (m_rng() & 1) ? 'B' : 'S');
+                header(b, t, o.locate);
+                put_be64(b + 11, o.ref);
+                b[19] = static_cast<uint8_t>(o.side);
+                put_be32(b + 20, o.shares);
+                stock_name(reinterpret_cast<char*>(b + 24), o.locate);
+                put_be32(b + 32, o.price);
+                if (t == GEN_F) memcpy(b + 36, "GSCO", 4);
+                m_live.push_back(o);
+                break;
+            }
+            case GEN_E:
+            case GEN_X: {
+                const size_t i = draw_live();
+                LiveOrder& o = m_live[i];
+                const uint32_t qty = std::min(o.shares, 100 * static_cast<uint32_t>(1 + m_rng() % 5));
+                header(b, t, o.locate);
+                put_be64(b + 11, o.ref);
+                put_be32(b + 19, qty);
+                if (t == GEN_E) put_be64(b + 23, ++m_match);
+                o.shares -= qty;
+                if (o.shares == 0) retire(i);
+                break;
+            }
+            case GEN_D: {
+                const size_t i = draw_live();
+                header(b, t, m_live[i].locate);
+                put_be64(b + 11, m_live[i].ref);
+                retire(i);
+                break;
+            }
+            case GEN_U: {
+                const size_t i = draw_live();
+                LiveOrder& o = m_live[i];
+                const LiveOrder n = new_order(o.locate, o.side);   // a replace keeps the side
+                header(b, t, o.locate);
+                put_be64(b + 11, o.ref);
+                put_be64(b + 19, n.ref);
+                put_be32(b + 27, n.shares);
+                put_be32(b + 31, n.price);
+                o = n;
+                break;
+            }
+            case GEN_P: {
+                const uint16_t locate = draw_locate();
+                const uint32_t mid = m_mid[locate - 1];
+                header(b, t, locate);
+                put_be64(b + 11, 0);                            // non-displayed orders carry ref 0
+                b[19] = static_cast<uint8_t>((m_rng() & 1) ? 'B' : 'S');
+                put_be32(b + 20, 100 * static_cast<uint32_t>(1 + m_rng() % 10));
+                stock_name(reinterpret_cast<char*>(b + 24), locate);
+                put_be32(b + 32, mid);
+                put_be64(b + 36, ++m_match);
+                break;
+            }
+            default:
+                break;
+        }
+        return 2u + mlen;
+    }
+
+    ItchGenConfig                       m_cfg;
+    std::mt19937_64                     m_rng;
+    uint64_t                            m_seqno;
+    std::discrete_distribution<int>     m_type;
+    std::vector<uint32_t>               m_mid;     // per locate, price in 1/10000 $
+    std::vector<LiveOrder>              m_live;
+    uint64_t                            m_ref{0};
+    uint64_t                            m_match{0};
+    uint64_t                            m_ts{34'200'000'000'000ULL};   // 09:30:00 in ns past midnight
+    uint32_t                            m_tracking{0};
+};
+
+#endif // ITCH5_GEN_H_INCLUDED
@@ -0,0 +1,243 @@
+/**
+ * itch5_ingest.cpp
+ *
+ * Parallel ingest of a NASDAQ TotalView-ITCH 5.0 BinaryFILE: the day file is
+ * mapped and indexed into chunks (itch5_binfile.h), decoder threads walk the
+ * chunks in parallel with the best decoders the CPU has (AVX2 where there is
+ * AVX2), and shard threads build the L3 books (itch5_book.h), each for the
+ * symbols it owns.
+ *
+ *   index     one sequential pass over the file: chunk boundaries, and the
+ *             Stock Directory into the shard table
+ *   decode    the decoder threads take chunks in file order off a shared
+ *             counter; each routes its chunk's decoded messages into one
+ *             bucket per shard (ShardRouter, itch5_shard.h) in a slot of its
+ *             own
+ *   apply     the shard threads go through the chunks in file order, each
+ *             applying its bucket of every chunk to its books, message by
+ *             message, or with -DSHARD_PREFETCH in two phases
+ *             (shard_apply_batch: prefetch, then apply)
+ *
+ * Per-symbol order is preserved: a symbol's messages are in one shard's
+ * buckets, in file order within a chunk, and every shard applies the chunks
+ * in file order.  Symbols on different shards are not ordered against each
+ * other, as in the receiver.  At most `slots` chunks (twice the decoders, plus
+ * two) are decoded ahead of the slowest shard; a decoder waits for its slot
+ * to be released, so memory stays bounded whatever the file size.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 itch5_ingest.cpp -o itch5_ingest -lpthread
+ *
+ * Run:
+ *   ./itch5_ingest <BinaryFILE> [decoders] [shards] [chunk-MB]
+ *   ./itch5_ingest 01302019.NASDAQ_ITCH50 8 8
+ *   SHARD_HOT=AAPL,NVDA ./itch5_ingest 01302019.NASDAQ_ITCH50 8 10
+ *
+ *   decoders, shards   default: half the cores each, at least one
+ *   chunk-MB           default 4
+ *
+ * SHARD_HOT works as for the receiver (itch5_rx.h).  Reported: the index
+ * pass, the decode-and-apply phase and the whole run in msgs/s, then each
+ * shard's book.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>             // sysconf
+
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+#include "itch5_parse.h"
+#include "itch5_shard.h"
+#include "itch5_book.h"
+#include "itch5_binfile.h"
+
+using ingest_clock = std::chrono::steady_clock;
+
+// ─── Chunk slots ─────────────────────────────────────────────────────────────
+
+// One chunk's decoded messages, a bucket per shard.  turn is the chunk a
+// decoder may fill the slot with next; filled is that chunk + 1 once its
+// buckets are complete; done counts the shards through with it, the last of
+// which hands the slot on to chunk + slots.
+struct alignas(64) IngestSlot {
+    std::atomic<uint64_t> turn{0};
+    std::atomic<uint64_t> filled{0};
+    std::atomic<unsigned> done{0};
+    std::vector<ShardMsg> bucket[SHARD_MAX];
+};
+
+// ShardRouter's lane: appends to the bucket of the slot being filled.
+struct BucketLane {
+    std::vector<ShardMsg>* out{nullptr};
+
+    bool push(const ShardMsg& m) noexcept {
+        out->push_back(m);
+        return true;
+    }
+};
+
+// Blocks until a reaches want.
+template<class T>
+static void wait_for(const std::atomic<T>& a, const T want) noexcept {
+    for (T v; (v = a.load(std::memory_order_acquire)) != want;) a.wait(v, std::memory_order_acquire);
+}
+
+static const BinFile*  g_file = nullptr;
+static ShardTable      g_table;
+static IngestSlot*     g_slots = nullptr;
+static unsigned        g_n_slots = 0;
+static unsigned        g_n_shards = 1;
+static std::atomic<uint64_t> g_next_chunk{0};
+
+// ─── Decoders ────────────────────────────────────────────────────────────────
+
+static void* decoder_thread(void*) {
+    using Router = ShardRouter<BucketLane>;
+    BucketLane lanes[SHARD_MAX];
+    Router router;
+    router.bind(lanes, g_table);
+    ParseBlocksFn<Router>* const parse = parse_blocks_pick<Router>();
+
+    const std::vector<BinChunk>& chunks = g_file->chunks();
+    for (uint64_t c; (c = g_next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks.size();) {
+        IngestSlot& s = g_slots[c % g_n_slots];
+        wait_for(s.turn, c);
+        for (unsigned k = 0; k < g_n_shards; ++k) {
+            s.bucket[k].clear();
+            lanes[k].out = &s.bucket[k];
+        }
+        const uint8_t* p = g_file->data() + chunks[c].offset;
+        parse(p, p + chunks[c].bytes, chunks[c].msgs, router);
+        s.filled.store(c + 1, std::memory_order_release);
+        s.filled.notify_all();
+    }
+    return nullptr;
+}
+
+// ─── Shards ──────────────────────────────────────────────────────────────────
+
+// A shard's handler: the book of the symbols it owns, and what it was handed.
+struct IngestShard {
+    ItchBook book;
+    uint64_t msgs{0};
+
+    void on_add_order(const DecodedAddOrder& m) noexcept                { ++msgs; book.on_add_order(m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept              { ++msgs; book.on_execute(m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                { ++msgs; book.on_delete(m); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept   { ++msgs; book.on_execute_price(m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept                { ++msgs; book.on_cancel(m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept              { ++msgs; book.on_replace(m); }
+    void on_trade(const DecodedTrade&) noexcept                         { ++msgs; }
+    void on_cross_trade(const DecodedCrossTrade&) noexcept              { ++msgs; }
+    void on_broken_trade(const DecodedBrokenTrade&) noexcept            { ++msgs; }
+    void on_system_event(const DecodedSystemEvent&) noexcept            { ++msgs; }
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept    { ++msgs; book.on_stock_directory(m); }
+
+    static constexpr unsigned PREFETCH_STAGES = ItchBook::PREFETCH_STAGES;
+    template<class M>
+    void prefetch(const M& m, const unsigned stage) const noexcept { book.prefetch(m, stage); }
+};
+
+struct ShardCtx {
+    IngestShard handler;
+    unsigned    id{0};
+    pthread_t   tid{};
+};
+
+static void* shard_thread(void* arg) {
+    ShardCtx& sh = *static_cast<ShardCtx*>(arg);
+    const uint64_t n_chunks = g_file->chunks().size();
+    for (uint64_t c = 0; c < n_chunks; ++c) {
+        IngestSlot& s = g_slots[c % g_n_slots];
+        wait_for(s.filled, c + 1);
+#ifdef SHARD_PREFETCH
+        shard_apply_batch(s.bucket[sh.id].data(), s.bucket[sh.id].size(), sh.handler);
+#else
+        for (const ShardMsg& m : s.bucket[sh.id]) shard_apply(m, sh.handler);
+#endif
+        if (s.done.fetch_add(1, std::memory_order_acq_rel) + 1 == g_n_shards) {
+            s.done.store(0, std::memory_order_relaxed);
+            s.turn.store(c + g_n_slots, std::memory_order_release);
+            s.turn.notify_all();
+        }
+    }
+    return nullptr;
+}
+
+// ─── Entry point ─────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <BinaryFILE> [decoders] [shards] [chunk-MB]\n", argv[0]);
+        return 1;
+    }
+    const unsigned cores    = std::max(1u, static_cast<unsigned>(sysconf(_SC_NPROCESSORS_ONLN)));
+    const unsigned decoders = argc > 2 ? std::max(1, atoi(argv[2])) : std::max(1u, cores / 2);
+    const unsigned shards   = argc > 3 ? std::max(1, atoi(argv[3])) : std::max(1u, cores / 2);
+    const size_t   chunk_mb = argc > 4 ? std::max(1, atoi(argv[4])) : 4;
+
+    g_table.configure(shards, getenv("SHARD_HOT"));
+    g_n_shards = g_table.shards();
+    printf("[ingest] decoder isa=%s, %u decoders, %u shards (%u hot), %zu MB chunks\n",
+           ISADISPATCH::isa_name(ISADISPATCH::g_isa), decoders, g_n_shards, g_table.hot(), chunk_mb);
+
+    BinFile file;
+    if (!file.open(argv[1])) return 1;
+    g_file = &file;
+
+    const auto t0 = ingest_clock::now();
+    file.index(chunk_mb << 20, &g_table);
+    const auto t1 = ingest_clock::now();
+    const double index_s = std::chrono::duration<double>(t1 - t0).count();
+    printf("[ingest] %s: %.1f MB, %lu msgs in %zu chunks, indexed in %.3f s (%.2f GB/s)\n", argv[1], file.size() / 1e6,
+           static_cast<unsigned long>(file.msgs()), file.chunks().size(), index_s, file.size() / index_s / 1e9);
+    if (file.tail())
+        printf("[ingest] %lu bytes after the last whole message ignored\n", static_cast<unsigned long>(file.tail()));
+
+    g_n_slots = 2 * decoders + 2;
+    std::unique_ptr<IngestSlot[]> slots(new IngestSlot[g_n_slots]);
+    for (unsigned i = 0; i < g_n_slots; ++i) slots[i].turn.store(i, std::memory_order_relaxed);
+    g_slots = slots.get();
+
+    std::unique_ptr<ShardCtx[]> shard(new ShardCtx[g_n_shards]);
+    for (unsigned k = 0; k < g_n_shards; ++k) {
+        shard[k].id = k;
+        if (pthread_create(&shard[k].tid, nullptr, shard_thread, &shard[k]) != 0) { perror("pthread_create"); return 1; }
+    }
+    std::vector<pthread_t> dec(decoders);
+    for (pthread_t& t : dec)
+        if (pthread_create(&t, nullptr, decoder_thread, nullptr) != 0) { perror("pthread_create"); return 1; }
+    for (pthread_t& t : dec) pthread_join(t, nullptr);
+    for (unsigned k = 0; k < g_n_shards; ++k) pthread_join(shard[k].tid, nullptr);
+    const auto t2 = ingest_clock::now();
+
+    const double apply_s = std::chrono::duration<double>(t2 - t1).count();
+    const double total_s = std::chrono::duration<double>(t2 - t0).count();
+    const double msgs = static_cast<double>(file.msgs());
+    printf("[ingest] decode + apply %.3f s: %.2f Mmsg/s\n", apply_s, msgs / apply_s / 1e6);
+    printf("[ingest] total          %.3f s: %.2f Mmsg/s  %.1f ns/msg\n", total_s, msgs / total_s / 1e6,
+           msgs ? total_s * 1e9 / msgs : 0.0);
+
+    uint64_t orders = 0, levels = 0, unknown = 0;
+    for (unsigned k = 0; k < g_n_shards; ++k) {
+        const ItchBook& book = shard[k].handler.book;
+        printf("[shard] %u: %lu msgs, book %lu live orders, %lu levels, %lu msgs for unknown refs\n", k,
+               static_cast<unsigned long>(shard[k].handler.msgs), static_cast<unsigned long>(book.orders_live()),
+               static_cast<unsigned long>(book.levels_live()), static_cast<unsigned long>(book.unknown()));
+        orders += book.orders_live();
+        levels += book.levels_live();
+        unknown += book.unknown();
+    }
+    printf("[ingest] books: %lu live orders, %lu levels, %lu msgs for unknown refs\n",
+           static_cast<unsigned long>(orders), static_cast<unsigned long>(levels), static_cast<unsigned long>(unknown));
+    return 0;
+}
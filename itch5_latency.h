@@ -0,0 +1,160 @@
+/**
+ * itch5_latency.h
+ *
+ * Per-stage latency accounting for the receiver, compiled in with
+ * -DRX_LATENCY (itch5_rx.h); without it the stamps cost nothing:
+ *
+ *   wire    receive timestamp -> pushed onto the queue's ring
+ *           (NIC hardware timestamp where the backend gets one, else the
+ *           kernel's software one; a replay has none and skips the stage)
+ *   queue   ring push -> consumer pop
+ *   decode  consumer pop -> datagram parsed and handed on
+ *   book    shard lane push -> applied by the shard's handler (-DITCH_SHARDS)
+ *
+ * PktDesc carries the receive timestamp (ns, CLOCK_REALTIME domain) and the
+ * TSC at enqueue; the backend records the wire stage as it pushes, and each
+ * later stage takes the TSC once as it finishes.  A stage is recorded once
+ * per datagram weighted by its message count, so the histograms are per
+ * message; the book stage is per message outright.
+ *
+ * LatencyHistogram is log-linear, 16 sub-buckets per power of two (within
+ * 6.25%), single writer, read by the stats thread with relaxed loads; the
+ * stats line shows each stage's percentiles over the last second.
+ */
+
+#ifndef ITCH5_LATENCY_H_INCLUDED
+#define ITCH5_LATENCY_H_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <time.h>
+#include <x86intrin.h>          // __rdtsc
+
+#include "TraceProbe.h"         // calibrate_tsc_hz
+
+// ─── Histogram ───────────────────────────────────────────────────────────────
+
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned BUCKETS  = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    void record(const uint64_t v, const uint64_t n = 1) noexcept {
+        std::atomic<uint64_t>& c = m_count[bucket(v)];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Adds the counts so far into sum (BUCKETS long).
+    void add_to(uint64_t* sum) const noexcept {
+        for (unsigned b = 0; b < BUCKETS; ++b) sum[b] += m_count[b].load(std::memory_order_relaxed);
+    }
+
+    static unsigned bucket(const uint64_t v) noexcept {
+        if (v < (1u << SUB_BITS)) return static_cast<unsigned>(v);
+        const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(v));
+        const unsigned shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) | static_cast<unsigned>((v >> shift) & ((1u << SUB_BITS) - 1));
+    }
+
+    // Largest value that lands in bucket b.
+    static uint64_t upper(const unsigned b) noexcept {
+        if (b < (1u << SUB_BITS)) return b;
+        const unsigned shift = (b >> SUB_BITS) - 1;
+        const uint64_t base = (uint64_t{1} << SUB_BITS) | (b & ((1u << SUB_BITS) - 1));
+        return ((base + 1) << shift) - 1;
+    }
+
+    // Value at quantile q of counts (BUCKETS long, total n); 0 if empty.
+    static uint64_t quantile(const uint64_t* counts, const uint64_t n, const double q) noexcept {
+        if (n == 0) return 0;
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(n - 1)) + 1;
+        uint64_t seen = 0;
+        for (unsigned b = 0; b < BUCKETS; ++b)
+            if ((seen += counts[b]) >= rank) return upper(b);
+        return upper(BUCKETS - 1);
+    }
+
+private:
+    std::atomic<uint64_t> m_count[BUCKETS]{};
+};
+
+// ─── Stages and clocks ───────────────────────────────────────────────────────
+
+enum class LatStage : uint8_t { Wire, Queue, Decode, Book, Count };
+
+static constexpr const char* lat_stage_name[static_cast<int>(LatStage::Count)] = { "wire", "queue", "decode", "book" };
+
+struct LatencySet {
+    LatencyHistogram stage[static_cast<int>(LatStage::Count)];
+
+    void record(const LatStage s, const uint64_t ns, const uint64_t n = 1) noexcept {
+        stage[static_cast<int>(s)].record(ns, n);
+    }
+};
+
+#ifdef RX_LATENCY
+
+// TSC rate, measured once at startup (lat_clock_init).  Only differences of
+// a few microseconds go through it, so its error stays in the noise; the wire
+// stage, the one that compares against the NIC's or kernel's clock, is taken
+// with clock_gettime instead.
+inline double g_lat_ns_per_tick = 0.0;
+
+inline int64_t lat_realtime_ns() noexcept {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+inline void lat_clock_init() {
+    g_lat_ns_per_tick = 1e9 / static_cast<double>(TRACEPROBE::calibrate_tsc_hz());
+}
+
+[[gnu::always_inline]] inline uint64_t lat_tsc() noexcept { return __rdtsc(); }
+
+// Ticks from a to b as ns; 0 if the clocks disagree on the order.
+inline uint64_t lat_ticks_ns(const uint64_t a, const uint64_t b) noexcept {
+    return b > a ? static_cast<uint64_t>(static_cast<double>(b - a) * g_lat_ns_per_tick) : 0;
+}
+
+#else
+
+inline void lat_clock_init() {}
+[[gnu::always_inline]] inline uint64_t lat_tsc() noexcept { return 0; }
+
+#endif // RX_LATENCY
+
+// Prints one line for a group of sets: per stage, p50 / p99 / p99.9 / max of
+// what they recorded since the previous print (each an upper bucket bound).
+struct LatencyReport {
+    uint64_t last[static_cast<int>(LatStage::Count)][LatencyHistogram::BUCKETS]{};
+
+    void print(const LatencySet* const* sets, const unsigned n_sets) {
+        uint64_t now[LatencyHistogram::BUCKETS];
+        uint64_t delta[LatencyHistogram::BUCKETS];
+        char line[512];
+        const int start = snprintf(line, sizeof(line), "[lat] ns");
+        int pos = start;
+        for (int s = 0; s < static_cast<int>(LatStage::Count); ++s) {
+            for (uint64_t& c : now) c = 0;
+            for (unsigned i = 0; i < n_sets; ++i) sets[i]->stage[s].add_to(now);
+            uint64_t n = 0;
+            unsigned top = 0;
+            for (unsigned b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                delta[b] = now[b] - last[s][b];
+                last[s][b] = now[b];
+                if (delta[b]) { n += delta[b]; top = b; }
+            }
+            if (n == 0 || pos >= static_cast<int>(sizeof(line))) continue;
+            pos += snprintf(line + pos, sizeof(line) - pos, "  %s p50=%lu p99=%lu p99.9=%lu max=%lu", lat_stage_name[s],
+                            static_cast<unsigned long>(LatencyHistogram::quantile(delta, n, 0.50)),
+                            static_cast<unsigned long>(LatencyHistogram::quantile(delta, n, 0.99)),
+                            static_cast<unsigned long>(LatencyHistogram::quantile(delta, n, 0.999)),
+                            static_cast<unsigned long>(LatencyHistogram::upper(top)));
+        }
+        if (pos > start) printf("%s\n", line);     // quiet second: nothing to say
+    }
+};
+
+#endif // ITCH5_LATENCY_H_INCLUDED
@@ -0,0 +1,590 @@
+/**
+ * itch5_mold.h
+ *
+ * MoldUDP64 sequencing for the receiver: which datagrams carry messages not
+ * yet delivered, and which line (A or B) delivered them first.
+ *
+ * MoldSequencer keeps the next expected sequence number per session (the
+ * 10-byte session field; a handful live at once, the last one hit is checked
+ * first) and classifies every datagram in O(1):
+ *   New        starts exactly at the expected seqno
+ *   Dup        every message already delivered (the other line won, or a
+ *              retransmit)
+ *   Partial    overlaps the expected seqno: the leading messages already
+ *              delivered are cut off, into a trimmed copy of the datagram
+ *   Gap        starts past the expected seqno; messages [gap_from,
+ *              gap_from + gap_count) are missing
+ *   Heartbeat  msg_count 0 at the expected seqno (0 past it is a Gap)
+ * The first datagram of a session the sequencer has not seen sets its
+ * expected seqno, so joining mid-session is not a gap.
+ *
+ * MoldArbiter<Desc> drains two receive rings, one per line, through one
+ * sequencer: whichever line delivers a seqno first wins, the other line's
+ * copy is a Dup.  A Gap on one line is held for up to the arbitration window
+ * while the other line keeps draining, since usually it has the missing
+ * datagrams in flight; only if the window passes without them is the gap
+ * declared and the held datagram delivered.  With one line there is nothing
+ * to wait for and gaps are declared at once.  Single consumer, no locks: the
+ * rings are the only shared state.
+ *
+ * With a MoldRecovery attached, a gap is not declared but recovered: the
+ * arbiter sends a MoldUDP64 re-request for the missing range to the
+ * retransmission server and parks every later live datagram, from either
+ * line, in a bounded reorder window (copied, so the receive buffers go
+ * straight back).  The rings keep draining the whole time; retransmits are
+ * picked up as they arrive and the window is spliced back in behind them in
+ * sequence order.  A range that stays unanswered through the retries, or a
+ * window that fills up, is declared a gap after all and delivery moves on.
+ */
+
+#ifndef ITCH5_MOLD_H_INCLUDED
+#define ITCH5_MOLD_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "itch5_avx.h"          // MOLD_HDR_LEN
+
+static constexpr uint16_t MOLD_END_OF_SESSION = 0xffff;
+static constexpr uint32_t MOLD_MAX_DATAGRAM   = 65536;
+
+// ─── Header ──────────────────────────────────────────────────────────────────
+
+// [0-9] session  [10-17] seqno BE  [18-19] msg_count BE
+struct MoldHeader {
+    uint64_t session_lo;    // session bytes 0-7, as loaded
+    uint16_t session_hi;    // session bytes 8-9
+    uint64_t seqno;
+    uint16_t count;
+};
+
+static inline bool mold_header(const uint8_t* pkt, const uint32_t len, MoldHeader& h) noexcept {
+    if (len < MOLD_HDR_LEN) return false;
+    uint64_t seq_be;
+    uint16_t count_be;
+    memcpy(&h.session_lo, pkt, 8);
+    memcpy(&h.session_hi, pkt + 8, 2);
+    memcpy(&seq_be, pkt + 10, 8);
+    memcpy(&count_be, pkt + 18, 2);
+    h.seqno = __builtin_bswap64(seq_be);
+    h.count = __builtin_bswap16(count_be);
+    return true;
+}
+
+// ─── Sequencer ───────────────────────────────────────────────────────────────
+
+enum class MoldVerdict : uint8_t { New, Partial, Dup, Gap, Heartbeat, EndOfSession, Bad };
+
+// Where a session stands: its next expected seqno (for a checkpoint).
+struct MoldSessionState {
+    uint64_t lo;            // session bytes 0-7, as loaded
+    uint16_t hi;            // session bytes 8-9
+    uint64_t next;
+};
+
+struct MoldAdmit {
+    MoldVerdict    verdict;
+    const uint8_t* data{nullptr};       // what to parse; null if nothing new
+    uint32_t       len{0};
+    uint64_t       gap_from{0};         // Gap only
+    uint64_t       gap_count{0};
+};
+
+class MoldSequencer {
+public:
+    static constexpr int MAX_SESSIONS = 4;
+
+    // Classifies pkt and advances the session past it.  A Gap is only taken
+    // (expected seqno moved past the hole) if accept_gap; otherwise it is
+    // reported and nothing changes, so the datagram can be offered again.
+    MoldAdmit admit(const uint8_t* pkt, const uint32_t len, const bool accept_gap) noexcept {
+        MoldHeader h;
+        if (!mold_header(pkt, len, h)) return {MoldVerdict::Bad};
+        Session& s = session(h);
+        if (h.count == MOLD_END_OF_SESSION) return {MoldVerdict::EndOfSession};
+
+        const uint64_t first = h.seqno;
+        const uint64_t last  = h.seqno + h.count;
+        if (first > s.next) {
+            MoldAdmit a{MoldVerdict::Gap, nullptr, 0, s.next, first - s.next};
+            if (accept_gap) {
+                if (h.count) { a.data = pkt; a.len = len; }
+                s.next = last;
+            }
+            return a;
+        }
+        if (last <= s.next)
+            return {h.count ? MoldVerdict::Dup : MoldVerdict::Heartbeat};
+        if (first == s.next) {
+            s.next = last;
+            return {MoldVerdict::New, pkt, len};
+        }
+        const uint32_t n = trim(pkt, len, static_cast<uint32_t>(s.next - first), h.count, s.next);
+        if (n == 0) return {MoldVerdict::Bad};
+        s.next = last;
+        return {MoldVerdict::Partial, m_scratch, n};
+    }
+
+    uint64_t sessions() const noexcept { return m_sessions_seen; }
+
+    // The sessions in play (at most MAX_SESSIONS) into out; returns how many.
+    unsigned save(MoldSessionState* out) const noexcept {
+        unsigned n = 0;
+        for (const Session& s : m_sessions)
+            if (s.used) out[n++] = {s.lo, s.hi, s.next};
+        return n;
+    }
+
+    // Picks a session up at st.next, as if everything before it had been
+    // delivered: a restart from a checkpoint.  Earlier datagrams are Dup, a
+    // later first datagram is a Gap, not a mid-session join.
+    void resume(const MoldSessionState& st) noexcept {
+        MoldHeader h{st.lo, st.hi, st.next, 0};
+        session(h).next = st.next;
+    }
+
+private:
+    struct Session {
+        uint64_t lo{0};
+        uint16_t hi{0};
+        bool     used{false};
+        uint64_t next{0};       // expected seqno
+    };
+
+    Session& session(const MoldHeader& h) noexcept {
+        if (m_last->used && m_last->lo == h.session_lo && m_last->hi == h.session_hi) [[likely]]
+            return *m_last;
+        for (Session& s : m_sessions)
+            if (s.used && s.lo == h.session_lo && s.hi == h.session_hi) return *(m_last = &s);
+        // a new session replaces the oldest one
+        Session& s = m_sessions[m_sessions_seen++ % MAX_SESSIONS];
+        s = {h.session_lo, h.session_hi, true, h.seqno};
+        return *(m_last = &s);
+    }
+
+    // Copies pkt into m_scratch without its first `skip` messages, header
+    // rewritten to start at seqno.  Returns the new length, 0 if the message
+    // blocks do not add up.
+    uint32_t trim(const uint8_t* pkt, const uint32_t len, const uint32_t skip, const uint16_t count, const uint64_t seqno) noexcept {
+        const uint8_t* cur = pkt + MOLD_HDR_LEN;
+        const uint8_t* end = pkt + len;
+        for (uint32_t i = 0; i < skip; ++i) {
+            if (cur + 2 > end) return 0;
+            uint16_t mlen_be;
+            memcpy(&mlen_be, cur, 2);
+            cur += 2 + __builtin_bswap16(mlen_be);
+            if (cur > end) return 0;
+        }
+        if (len > MOLD_MAX_DATAGRAM) return 0;
+        const uint64_t seq_be = __builtin_bswap64(seqno);
+        const uint16_t count_be = __builtin_bswap16(static_cast<uint16_t>(count - skip));
+        memcpy(m_scratch, pkt, 10);
+        memcpy(m_scratch + 10, &seq_be, 8);
+        memcpy(m_scratch + 18, &count_be, 2);
+        const uint32_t body = static_cast<uint32_t>(end - cur);
+        memcpy(m_scratch + MOLD_HDR_LEN, cur, body);
+        return MOLD_HDR_LEN + body;
+    }
+
+    Session  m_sessions[MAX_SESSIONS];
+    Session* m_last{&m_sessions[0]};
+    uint64_t m_sessions_seen{0};
+    alignas(64) uint8_t m_scratch[MOLD_MAX_DATAGRAM + 32]{};   // + the decoders' overread
+};
+
+// ─── Gap recovery ────────────────────────────────────────────────────────────
+
+// Re-request socket plus the reorder window; driven by MoldArbiter.
+class MoldRecovery {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t SLOT_SIZE = 2048;        // per parked datagram, overread included
+
+    enum class Put : uint8_t { Parked, Dup, Full, TooBig };
+    enum class Ask : uint8_t { Sent, Waiting, GiveUp };
+
+    explicit MoldRecovery(const uint32_t slots = 4096,
+                          const std::chrono::microseconds timeout = std::chrono::milliseconds(2),
+                          const int max_retries = 5)
+        : m_capacity(slots), m_timeout(timeout), m_max_retries(max_retries) {}
+
+    ~MoldRecovery() { if (m_fd >= 0) close(m_fd); }
+
+    MoldRecovery(const MoldRecovery&) = delete;
+    MoldRecovery& operator=(const MoldRecovery&) = delete;
+
+    // endpoint is "ip:port" of the re-request server.  Prints the reason and
+    // returns false if it cannot be used.
+    bool open(const char* endpoint) {
+        char ip[64];
+        const char* colon = strrchr(endpoint, ':');
+        if (!colon || colon - endpoint >= static_cast<long>(sizeof(ip))) {
+            fprintf(stderr, "re-request endpoint '%s' is not ip:port\n", endpoint);
+            return false;
+        }
+        memcpy(ip, endpoint, colon - endpoint);
+        ip[colon - endpoint] = '\0';
+
+        struct sockaddr_in sin{};
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(static_cast<uint16_t>(atoi(colon + 1)));
+        if (inet_pton(AF_INET, ip, &sin.sin_addr) != 1) {
+            fprintf(stderr, "re-request endpoint '%s' is not ip:port\n", endpoint);
+            return false;
+        }
+        m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_fd < 0) { perror("socket"); return false; }
+        // connected: only the server's answers come back on it
+        if (connect(m_fd, reinterpret_cast<sockaddr*>(&sin), sizeof(sin)) < 0) { perror("connect"); return false; }
+        m_slots.resize(static_cast<size_t>(m_capacity) * SLOT_SIZE);
+        m_len.resize(m_capacity);
+        m_first.resize(m_capacity);
+        m_last.resize(m_capacity);
+        m_order.resize(m_capacity);
+        m_free.resize(m_capacity);
+        for (uint32_t i = 0; i < m_capacity; ++i) m_free[i] = m_capacity - 1 - i;
+        return true;
+    }
+
+    // ── reorder window ──
+
+    // Parks a copy of pkt, in seqno order, unless every message in it is
+    // parked already.  The arbiter only parks datagrams past the delivered
+    // seqno, so "parked" is the whole test.  Datagrams nearly always arrive
+    // in order and go on the back; one from inside the hole, or late on one
+    // line, is slotted in ahead of the later ones.
+    Put park(const uint8_t* pkt, const uint32_t len) noexcept {
+        MoldHeader h;
+        if (!mold_header(pkt, len, h)) return Put::Dup;
+        const uint64_t first = h.seqno;
+        const uint64_t last  = h.seqno + h.count;
+        if (covered(first, last)) return Put::Dup;
+        if (len > SLOT_SIZE - 32) return Put::TooBig;
+        if (m_count == m_capacity) return Put::Full;
+
+        const uint32_t slot = m_free[m_capacity - 1 - m_count];
+        memcpy(&m_slots[static_cast<size_t>(slot) * SLOT_SIZE], pkt, len);
+        m_len[slot] = len;
+        m_first[slot] = first;
+        m_last[slot] = last;
+
+        uint32_t i = m_count;               // position in the window: after every earlier first seqno
+        for (; i > 0 && m_first[at(i - 1)] > first; --i)
+            m_order[(m_head + i) % m_capacity] = at(i - 1);
+        m_order[(m_head + i) % m_capacity] = slot;
+        ++m_count;
+        if (last > m_parked_end) m_parked_end = last;
+        return Put::Parked;
+    }
+
+    bool     empty() const noexcept { return m_count == 0; }
+    uint32_t parked() const noexcept { return m_count; }
+
+    const uint8_t* front(uint32_t& len) const noexcept {
+        const uint32_t slot = at(0);
+        len = m_len[slot];
+        return &m_slots[static_cast<size_t>(slot) * SLOT_SIZE];
+    }
+
+    void pop_front() noexcept {
+        m_free[m_capacity - m_count] = at(0);
+        m_head = (m_head + 1) % m_capacity;
+        if (--m_count == 0) m_parked_end = 0;
+    }
+
+    // ── re-requests ──
+
+    // Asks for [from, from + count) of the session in pkt's header.  A new
+    // range goes out at once; the same range again only after the timeout,
+    // and after max_retries unanswered resends the answer is GiveUp.
+    Ask ask(const uint8_t* pkt, const uint64_t from, const uint64_t count) noexcept {
+        const clock::time_point now = clock::now();
+        if (from == m_req_from && count == m_req_count) {
+            if (now - m_sent < m_timeout) return Ask::Waiting;
+            if (++m_retries > m_max_retries) return Ask::GiveUp;
+        } else {
+            m_req_from = from;
+            m_req_count = count;
+            m_retries = 0;
+        }
+        // [0-9] session  [10-17] seqno BE  [18-19] count BE, as the downstream header
+        uint8_t req[20];
+        const uint64_t seq_be = __builtin_bswap64(from);
+        const uint16_t count_be = __builtin_bswap16(static_cast<uint16_t>(count < 0xfffe ? count : 0xfffe));
+        memcpy(req, pkt, 10);
+        memcpy(req + 10, &seq_be, 8);
+        memcpy(req + 18, &count_be, 2);
+        send(m_fd, req, sizeof(req), MSG_DONTWAIT);
+        m_sent = now;
+        return Ask::Sent;
+    }
+
+    // One retransmitted datagram, if one has arrived; valid until the next call.
+    bool receive(const uint8_t*& pkt, uint32_t& len) noexcept {
+        const ssize_t n = recv(m_fd, m_rx, MOLD_MAX_DATAGRAM, MSG_DONTWAIT);
+        if (n <= 0) return false;
+        pkt = m_rx;
+        len = static_cast<uint32_t>(n);
+        return true;
+    }
+
+private:
+    // slot of the i-th parked datagram, in seqno order
+    uint32_t at(const uint32_t i) const noexcept { return m_order[(m_head + i) % m_capacity]; }
+
+    // Whether the parked datagrams hold every seqno in [first, last).  From
+    // the back: each one that reaches the uncovered end pulls it down to its
+    // first seqno; one that falls short of it cannot help once the end has
+    // moved below its start, so a single pass does.
+    bool covered(const uint64_t first, uint64_t last) const noexcept {
+        if (last > m_parked_end) return false;
+        for (uint32_t i = m_count; i > 0 && last > first; --i) {
+            const uint32_t slot = at(i - 1);
+            if (m_first[slot] < last && m_last[slot] >= last) last = m_first[slot];
+        }
+        return last <= first;
+    }
+
+    int                       m_fd{-1};
+    uint32_t                  m_capacity;
+    std::vector<uint8_t>      m_slots;
+    std::vector<uint32_t>     m_len;
+    std::vector<uint64_t>     m_first;             // per slot: seqno range of the datagram in it
+    std::vector<uint64_t>     m_last;
+    std::vector<uint32_t>     m_order;             // ring of slots from m_head, ascending first seqno
+    std::vector<uint32_t>     m_free;              // slots not in the window: [0, capacity - count)
+    size_t                    m_head{0};
+    uint32_t                  m_count{0};
+    uint64_t                  m_parked_end{0};     // past the highest parked seqno
+    std::chrono::microseconds m_timeout;
+    int                       m_max_retries;
+    uint64_t                  m_req_from{0};
+    uint64_t                  m_req_count{0};
+    int                       m_retries{0};
+    clock::time_point         m_sent{};
+    alignas(64) uint8_t       m_rx[MOLD_MAX_DATAGRAM + 32]{};
+};
+
+// ─── A/B arbiter ─────────────────────────────────────────────────────────────
+
+// The arbiter's thread is the only writer; a stats thread may read with
+// relaxed loads, so a plain load + store (no lock prefix) suffices.
+struct MoldLineStats {
+    std::atomic<uint64_t> datagrams{0};
+    std::atomic<uint64_t> wins{0};          // delivered (or parked) at least one new message
+    std::atomic<uint64_t> dupes{0};         // nothing new: the other line (or an earlier copy) won
+};
+
+struct MoldArbStats {
+    MoldLineStats         line[2];
+    std::atomic<uint64_t> gaps{0};          // declared: the messages never arrived in time
+    std::atomic<uint64_t> gap_msgs{0};
+    std::atomic<uint64_t> filled{0};        // held gaps the other line filled inside the window
+    std::atomic<uint64_t> partials{0};
+    std::atomic<uint64_t> heartbeats{0};
+    std::atomic<uint64_t> recoveries{0};    // holes handed to recovery
+    std::atomic<uint64_t> requests{0};      // re-requests sent, resends included
+    std::atomic<uint64_t> recovered_msgs{0};
+    std::atomic<uint64_t> parked_max{0};    // reorder window high-water mark, datagrams
+
+    static void bump(std::atomic<uint64_t>& c, const uint64_t n = 1) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+template<class Desc>
+class MoldArbiter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit MoldArbiter(const std::chrono::nanoseconds window = std::chrono::microseconds(100)) noexcept
+        : m_window(window) {}
+
+    // Gaps are recovered through r from here on instead of declared.
+    void set_recovery(MoldRecovery* r) noexcept { m_rec = r; }
+
+    // Takes at most one datagram off each line (b is null for a single line).
+    // parse(data, len) gets every datagram's worth of new messages, in
+    // sequence order; release(desc) every descriptor the arbiter is done
+    // with.  While a recovery is in flight it also collects retransmits and
+    // splices the reorder window back in.  Returns how many datagrams it
+    // finished; a held one does not count.
+    template<class Ring, class P, class R>
+    unsigned poll(Ring& a, Ring* b, P&& parse, R&& release) noexcept {
+        unsigned n = poll_line(0, a, b != nullptr, parse, release);
+        if (b) n += poll_line(1, *b, true, parse, release);
+        if (recovering()) [[unlikely]] n += recover(parse);
+        return n;
+    }
+
+    // Anything held or parked that a drain at the end of input must wait for.
+    bool holding() const noexcept { return m_held[0].active || m_held[1].active || recovering(); }
+
+    const MoldArbStats& stats() const noexcept { return m_stats; }
+    const MoldSequencer& sequencer() const noexcept { return m_seq; }
+
+    // Before the first poll: see MoldSequencer::resume.
+    void resume(const MoldSessionState& st) noexcept { m_seq.resume(st); }
+
+private:
+    struct Held {
+        Desc              desc;
+        clock::time_point deadline;
+        bool              active{false};
+    };
+
+    bool recovering() const noexcept { return m_rec && !m_rec->empty(); }
+
+    template<class Ring, class P, class R>
+    unsigned poll_line(const int line, Ring& r, const bool other_live, P& parse, R& release) noexcept {
+        Held& h = m_held[line];
+        Desc d;
+        bool final_gap;                     // no point waiting for the other line any more
+        if (h.active) [[unlikely]] {
+            d = h.desc;
+            final_gap = clock::now() >= h.deadline;
+        } else {
+            if (!r.pop(d)) return 0;
+            MoldArbStats::bump(m_stats.line[line].datagrams);
+            final_gap = !other_live;
+        }
+
+        const bool was_recovering = recovering();
+        const MoldAdmit a = m_seq.admit(d.data, d.len, final_gap && !m_rec);
+        if (a.verdict == MoldVerdict::Gap) [[unlikely]] {
+            if (!final_gap && !was_recovering) {
+                if (!h.active) h = {d, clock::now() + m_window, true};
+                return 0;
+            }
+            h.active = false;
+            if (m_rec) {
+                park(line, d, parse);
+                if (!was_recovering) MoldArbStats::bump(m_stats.recoveries);
+                release(d);
+                return 1;
+            }
+        } else if (h.active) {
+            h.active = false;
+            MoldArbStats::bump(m_stats.filled);
+        }
+
+        deliver(line, a, parse);
+        release(d);
+        // the other line may just have filled the hole in front of the window
+        if (was_recovering && a.data) drain(parse);
+        return 1;
+    }
+
+    template<class P>
+    void park(const int line, const Desc& d, P& parse) noexcept {
+        MoldRecovery::Put put;
+        while ((put = m_rec->park(d.data, d.len)) == MoldRecovery::Put::Full)
+            give_up(parse);                 // window full: the hole in front is lost
+        if (put == MoldRecovery::Put::TooBig) {
+            // cannot be parked: everything in front of it is lost, then it goes out as is
+            while (!m_rec->empty()) give_up(parse);
+            deliver(line, m_seq.admit(d.data, d.len, true), parse);
+            return;
+        }
+        MoldArbStats::bump(put == MoldRecovery::Put::Parked ? m_stats.line[line].wins : m_stats.line[line].dupes);
+        if (m_rec->parked() > m_stats.parked_max.load(std::memory_order_relaxed))
+            m_stats.parked_max.store(m_rec->parked(), std::memory_order_relaxed);
+        drain(parse);
+    }
+
+    template<class P>
+    unsigned recover(P& parse) noexcept {
+        unsigned n = 0;
+        const uint8_t* pkt;
+        uint32_t len;
+        while (m_rec->receive(pkt, len)) {
+            const MoldAdmit a = m_seq.admit(pkt, len, false);
+            if (a.data) {
+                uint16_t count_be;
+                memcpy(&count_be, a.data + 18, 2);
+                MoldArbStats::bump(m_stats.recovered_msgs, __builtin_bswap16(count_be));
+                parse(a.data, a.len);
+                ++n;
+            }
+        }
+        drain(parse);
+        return n;
+    }
+
+    // Delivers parked datagrams from the front for as long as they follow on
+    // from what has been delivered; at the first one that does not, asks for
+    // the messages in between.
+    template<class P>
+    void drain(P& parse) noexcept {
+        while (!m_rec->empty()) {
+            uint32_t len;
+            const uint8_t* pkt = m_rec->front(len);
+            const MoldAdmit a = m_seq.admit(pkt, len, false);
+            if (a.verdict == MoldVerdict::Gap) {
+                const MoldRecovery::Ask ask = m_rec->ask(pkt, a.gap_from, a.gap_count);
+                if (ask == MoldRecovery::Ask::Sent) MoldArbStats::bump(m_stats.requests);
+                if (ask != MoldRecovery::Ask::GiveUp) return;
+                give_up(parse);
+                continue;
+            }
+            deliver(-1, a, parse);
+            m_rec->pop_front();
+        }
+    }
+
+    // Declares the hole in front of the window a gap and delivers the first
+    // parked datagram past it.
+    template<class P>
+    void give_up(P& parse) noexcept {
+        uint32_t len;
+        const uint8_t* pkt = m_rec->front(len);
+        deliver(-1, m_seq.admit(pkt, len, true), parse);
+        m_rec->pop_front();
+    }
+
+    // Counts a's verdict (against line, if it came straight off one) and
+    // parses whatever it has that is new.
+    template<class P>
+    void deliver(const int line, const MoldAdmit& a, P& parse) noexcept {
+        switch (a.verdict) {
+            case MoldVerdict::Gap:
+                MoldArbStats::bump(m_stats.gaps);
+                MoldArbStats::bump(m_stats.gap_msgs, a.gap_count);
+                if (a.data && line >= 0) MoldArbStats::bump(m_stats.line[line].wins);
+                break;
+            case MoldVerdict::Partial:
+                MoldArbStats::bump(m_stats.partials);
+                [[fallthrough]];
+            case MoldVerdict::New:
+                if (line >= 0) MoldArbStats::bump(m_stats.line[line].wins);
+                break;
+            case MoldVerdict::Dup:
+                if (line >= 0) MoldArbStats::bump(m_stats.line[line].dupes);
+                break;
+            case MoldVerdict::Heartbeat:
+                MoldArbStats::bump(m_stats.heartbeats);
+                break;
+            default:
+                break;
+        }
+        if (a.data) parse(a.data, a.len);
+    }
+
+    MoldSequencer            m_seq;
+    Held                     m_held[2];
+    std::chrono::nanoseconds m_window;
+    MoldRecovery*            m_rec{nullptr};
+    MoldArbStats             m_stats;
+};
+
+#endif // ITCH5_MOLD_H_INCLUDED
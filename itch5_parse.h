@@ -0,0 +1,311 @@
+/**
+ * itch5_parse.h
+ *
+ * MoldUDP64 datagram walker over the itch5_avx.h decoders, shared by the
+ * receiver (itch5_efvi.cpp) and the benchmarks.
+ *
+ * parse_datagram_impl<Dec, Handler> is written once against a decoder policy
+ * and a handler; one entry point per ISA level force-inlines it under that
+ * level's [[gnu::target]], and parse_datagram_pick<Handler>() binds the best
+ * one for this CPU (IsaDispatch.h); the AVX512 slot is the VBMI policy, and
+ * is filled only where the CPU has VBMI.  The handler receives each decoded
+ * message through
+ *   h.on_add_order(const DecodedAddOrder&)            'A' and 'F'
+ *   h.on_execute(const DecodedExecuteOrder&)          'E'
+ *   h.on_delete(const DecodedDeleteOrder&)            'D'
+ * which every handler must have, and any of
+ *   on_execute_price 'C'     on_stock_directory    'R'     on_luld_collar      'J'
+ *   on_cancel        'X'     on_system_event       'S'     on_operational_halt 'h'
+ *   on_replace       'U'     on_trading_action     'H'     on_noii             'I'
+ *   on_trade         'P'     on_reg_sho            'Y'     on_rpii             'N'
+ *   on_cross_trade   'Q'     on_market_participant 'L'     on_dlcr             'O'
+ *   on_broken_trade  'B'     on_mwcb_decline       'V'
+ *                            on_mwcb_status        'W'
+ *                            on_ipo_quoting        'K'
+ * each taking the matching Decoded* struct from itch5_avx.h; types without a
+ * callback are skipped undecoded.  The handler is inlined into the loop, so
+ * the indirect call happens once per datagram.  parse_blocks_pick<Handler>()
+ * is the same walk over bare message blocks with no datagram header in front,
+ * as a BinaryFILE stores them.
+ *
+ * A handler may also have
+ *   bool subscribed(uint16_t raw_locate) noexcept
+ * which the loop asks for every message but the Stock Directory, with the
+ * stock_locate bytes as loaded (big-endian, unswapped), before any decode:
+ * false skips the message (itch5_subscribe.h).
+ *
+ * The ItchHandler concept checks the three mandatory callbacks (noexcept, as
+ * the loop is) where the handler type is plugged in, so a misspelt callback
+ * is a one-line concept error rather than a page of template backtrace.
+ * NullHandler takes every type and throws it away, for timing the walk and
+ * the decodes on their own.
+ */
+
+#ifndef ITCH5_PARSE_H_INCLUDED
+#define ITCH5_PARSE_H_INCLUDED
+
+#include <cstdint>
+#include <concepts>
+
+#include <immintrin.h>          // _mm_prefetch (SSE2 baseline)
+
+#include "TraceProbe.h"
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+
+// ─── Handler contract ────────────────────────────────────────────────────────
+
+template<class H>
+concept ItchHandler = requires(H& h, const DecodedAddOrder& a, const DecodedExecuteOrder& e, const DecodedDeleteOrder& d) {
+    { h.on_add_order(a) } noexcept;
+    { h.on_execute(e) } noexcept;
+    { h.on_delete(d) } noexcept;
+};
+
+// Every callback, none of them doing anything.  Each decoded struct is handed
+// to an empty asm statement so the compiler still has to build it: a parse
+// with this handler costs the walk plus the decodes and nothing else.
+struct NullHandler {
+    template<class M>
+    [[gnu::always_inline]] static void keep(const M& m) noexcept { asm volatile("" : : "r"(&m) : "memory"); }
+
+    void on_add_order(const DecodedAddOrder& m) noexcept                  { keep(m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept                { keep(m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                  { keep(m); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept     { keep(m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept                  { keep(m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept                { keep(m); }
+    void on_trade(const DecodedTrade& m) noexcept                         { keep(m); }
+    void on_cross_trade(const DecodedCrossTrade& m) noexcept              { keep(m); }
+    void on_broken_trade(const DecodedBrokenTrade& m) noexcept            { keep(m); }
+    void on_system_event(const DecodedSystemEvent& m) noexcept            { keep(m); }
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept      { keep(m); }
+    void on_trading_action(const DecodedTradingAction& m) noexcept        { keep(m); }
+    void on_reg_sho(const DecodedRegSHO& m) noexcept                      { keep(m); }
+    void on_market_participant(const DecodedMarketParticipant& m) noexcept { keep(m); }
+    void on_mwcb_decline(const DecodedMwcbDecline& m) noexcept            { keep(m); }
+    void on_mwcb_status(const DecodedMwcbStatus& m) noexcept              { keep(m); }
+    void on_ipo_quoting(const DecodedIpoQuoting& m) noexcept              { keep(m); }
+    void on_luld_collar(const DecodedLuldCollar& m) noexcept              { keep(m); }
+    void on_operational_halt(const DecodedOperationalHalt& m) noexcept    { keep(m); }
+    void on_noii(const DecodedNoii& m) noexcept                           { keep(m); }
+    void on_rpii(const DecodedRpii& m) noexcept                           { keep(m); }
+    void on_dlcr(const DecodedDlcr& m) noexcept                           { keep(m); }
+};
+static_assert(ItchHandler<NullHandler>);
+
+// ─── Parse a single MoldUDP64 datagram ───────────────────────────────────────
+
+// One optional message type: decoded and delivered only if the handler has the
+// callback, otherwise the case is an empty `break` and not even the decode is
+// compiled in.  The length check uses the spec length of the type.
+#define ITCH_PARSE_CASE(TYPE, DECODE, CALLBACK)                                        \
+    case MsgType::TYPE:                                                                \
+        if constexpr (requires { h.CALLBACK(Dec::DECODE(body)); })                     \
+            if (mlen >= itch_msg_len(static_cast<uint8_t>(MsgType::TYPE)))             \
+                h.CALLBACK(Dec::DECODE(body));                                         \
+        break;
+
+// Walks up to msg_count message blocks ([BE u16 length][message]) from cur,
+// stopping at end or at a block that does not fit.  The datagram walker below
+// and the BinaryFILE ingest (itch5_binfile.h) both come through here.  The
+// decoders load 32 bytes at a time, so at least that much must be readable
+// past end.
+template<class Dec, ItchHandler Handler>
+[[gnu::always_inline]] static inline void parse_blocks_impl(const uint8_t* cur, const uint8_t* const end, uint32_t msg_count,
+                                                            Handler& h) noexcept {
+    while (msg_count-- && cur + 3 <= end) {
+        // Per-message block:
+        //   [0-1]  length  BE u16  (body length, not including these 2 bytes)
+        //   [2]    type    uint8
+        //   [3..]  fields
+        uint16_t mlen_be;
+        __builtin_memcpy(&mlen_be, cur, 2);
+        uint16_t mlen = __builtin_bswap16(mlen_be);
+
+        if (mlen < 1 || cur + 2 + mlen > end) break;
+
+        const uint8_t  type = cur[2];   // single byte: no alignment issue
+        const uint8_t* body = cur + 2;  // body[0] = type
+
+        // ── Prefetch next message into L1 while decoding this one ─────────────
+        // The decode path has several dependent loads (ymm + xmm).  Issuing a
+        // T0 prefetch for the next message's first cache line now hides DRAM
+        // latency behind the current message's AVX shuffle work.
+        const uint8_t* next = cur + 2 + mlen;
+        if (next + 3 <= end)
+            _mm_prefetch(reinterpret_cast<const char*>(next + 2), _MM_HINT_T0);
+
+        if constexpr (requires { { h.subscribed(uint16_t{}) } noexcept -> std::same_as<bool>; }) {
+            uint16_t locate_raw;
+            __builtin_memcpy(&locate_raw, body + 1, 2);
+            if (type != static_cast<uint8_t>(MsgType::StockDirectory) && !h.subscribed(locate_raw)) {
+                cur = next;
+                continue;
+            }
+        }
+
+        // The switch is the type filter: it compiles to one jump table on the
+        // type byte, and every type the handler does not take lands on a bare
+        // `break`.  (This used to be a Dec::scan_types pre-check, which only
+        // paid off while most types fell through; now all of them decode.)
+        switch (static_cast<MsgType>(type)) {
+            case MsgType::AddOrder:
+            case MsgType::AddOrderMPID:
+                if (mlen >= 36) {
+                    TRACE_BEGIN(DecodeAdd, type);
+                    DecodedAddOrder m = Dec::add_order(body);
+                    TRACE_END(DecodeAdd, m.stock_locate);
+                    h.on_add_order(m);
+                }
+                break;
+            case MsgType::ExecuteOrder:
+                if (mlen >= 31) {
+                    TRACE_BEGIN(DecodeExecute, type);
+                    DecodedExecuteOrder m = Dec::execute_order(body);
+                    TRACE_END(DecodeExecute, m.stock_locate);
+                    h.on_execute(m);
+                }
+                break;
+            case MsgType::DeleteOrder:
+                if (mlen >= 19) {
+                    TRACE_BEGIN(DecodeDelete, type);
+                    DecodedDeleteOrder m = Dec::delete_order(body);
+                    TRACE_END(DecodeDelete, m.stock_locate);
+                    h.on_delete(m);
+                }
+                break;
+
+            ITCH_PARSE_CASE(ExecuteOrderPrice, execute_order_price, on_execute_price)
+            ITCH_PARSE_CASE(CancelOrder,       cancel_order,        on_cancel)
+            ITCH_PARSE_CASE(ReplaceOrder,      replace_order,       on_replace)
+            ITCH_PARSE_CASE(Trade,             trade,               on_trade)
+            ITCH_PARSE_CASE(CrossTrade,        cross_trade,         on_cross_trade)
+            ITCH_PARSE_CASE(BrokenTrade,       broken_trade,        on_broken_trade)
+            ITCH_PARSE_CASE(SystemEvent,       system_event,        on_system_event)
+            ITCH_PARSE_CASE(StockDirectory,    stock_directory,     on_stock_directory)
+            ITCH_PARSE_CASE(TradingAction,     trading_action,      on_trading_action)
+            ITCH_PARSE_CASE(RegSHO,            reg_sho,             on_reg_sho)
+            ITCH_PARSE_CASE(MarketParticipant, market_participant,  on_market_participant)
+            ITCH_PARSE_CASE(MwcbDecline,       mwcb_decline,        on_mwcb_decline)
+            ITCH_PARSE_CASE(MwcbStatus,        mwcb_status,         on_mwcb_status)
+            ITCH_PARSE_CASE(IpoQuoting,        ipo_quoting,         on_ipo_quoting)
+            ITCH_PARSE_CASE(LuldCollar,        luld_collar,         on_luld_collar)
+            ITCH_PARSE_CASE(OperationalHalt,   operational_halt,    on_operational_halt)
+            ITCH_PARSE_CASE(Noii,              noii,                on_noii)
+            ITCH_PARSE_CASE(Rpii,              rpii,                on_rpii)
+            ITCH_PARSE_CASE(Dlcr,              dlcr,                on_dlcr)
+
+            default:
+                break;
+        }
+        cur = next;
+    }
+}
+
+template<class Dec, ItchHandler Handler>
+[[gnu::always_inline]] static inline void parse_datagram_impl(const uint8_t* pkt, uint32_t len, Handler& h) noexcept {
+    // pkt points to the MoldUDP64 UDP payload at an arbitrary byte offset
+    // inside a 2 KB ef_vi DMA buffer — no alignment guarantee.
+    //
+    // MoldUDP64 header layout (MOLD_HDR_LEN = 20 bytes):
+    //   [0-9]   session   char[10]
+    //   [10-17] seqno     BE u64
+    //   [18-19] msg_count BE u16
+    //
+    // Do NOT cast pkt to MoldUDP64Header* and dereference multi-byte fields.
+    // Even with __attribute__((packed)) the base pointer may be unaligned, and
+    // dereferencing a packed struct member via an unaligned pointer is still UB
+    // once the compiler can prove alignment.  Use __builtin_memcpy instead.
+
+    if (len < MOLD_HDR_LEN) return;
+
+    uint16_t msg_count_be;
+    __builtin_memcpy(&msg_count_be, pkt + 18, 2);
+    const uint16_t msg_count = __builtin_bswap16(msg_count_be);
+
+    if (msg_count == 0) return;
+
+    TRACE_BEGIN(ParseDatagram, msg_count);
+    parse_blocks_impl<Dec>(pkt + MOLD_HDR_LEN, pkt + len, msg_count, h);   // first message block right after the header
+    TRACE_END(ParseDatagram, msg_count);
+}
+
+#undef ITCH_PARSE_CASE
+
+// ─── Per-ISA entry points ────────────────────────────────────────────────────
+
+template<ItchHandler Handler>
+static void parse_datagram_scalar(const uint8_t* pkt, uint32_t len, Handler& h) noexcept {
+    parse_datagram_impl<DecodeScalar>(pkt, len, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target("sse4.2")]]
+static void parse_datagram_sse42(const uint8_t* pkt, uint32_t len, Handler& h) noexcept {
+    parse_datagram_impl<DecodeSSE42>(pkt, len, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target("avx2")]]
+static void parse_datagram_avx2(const uint8_t* pkt, uint32_t len, Handler& h) noexcept {
+    parse_datagram_impl<DecodeAVX2>(pkt, len, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static void parse_datagram_avx512vbmi(const uint8_t* pkt, uint32_t len, Handler& h) noexcept {
+    parse_datagram_impl<DecodeAVX512VBMI>(pkt, len, h);
+}
+
+template<ItchHandler Handler>
+using ParseDatagramFn = void(const uint8_t*, uint32_t, Handler&) noexcept;
+
+template<ItchHandler Handler>
+static ISADISPATCH::IsaVariants<ParseDatagramFn<Handler>> parse_datagram_variants() noexcept {
+    return {{ parse_datagram_scalar<Handler>, parse_datagram_sse42<Handler>, parse_datagram_avx2<Handler>,
+             ISADISPATCH::g_vbmi ? parse_datagram_avx512vbmi<Handler> : nullptr }};
+}
+
+// AVX512 slot empty without VBMI → falls back to the AVX2 entry point.
+template<ItchHandler Handler>
+static ParseDatagramFn<Handler>* parse_datagram_pick() noexcept {
+    return ISADISPATCH::isa_pick(parse_datagram_variants<Handler>());
+}
+
+// Bare message blocks, no datagram header: [cur, end), at most n messages.
+
+template<ItchHandler Handler>
+static void parse_blocks_scalar(const uint8_t* cur, const uint8_t* end, uint32_t n, Handler& h) noexcept {
+    parse_blocks_impl<DecodeScalar>(cur, end, n, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target("sse4.2")]]
+static void parse_blocks_sse42(const uint8_t* cur, const uint8_t* end, uint32_t n, Handler& h) noexcept {
+    parse_blocks_impl<DecodeSSE42>(cur, end, n, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target("avx2")]]
+static void parse_blocks_avx2(const uint8_t* cur, const uint8_t* end, uint32_t n, Handler& h) noexcept {
+    parse_blocks_impl<DecodeAVX2>(cur, end, n, h);
+}
+
+template<ItchHandler Handler>
+[[gnu::target(ITCH5_VBMI_TARGET)]]
+static void parse_blocks_avx512vbmi(const uint8_t* cur, const uint8_t* end, uint32_t n, Handler& h) noexcept {
+    parse_blocks_impl<DecodeAVX512VBMI>(cur, end, n, h);
+}
+
+template<ItchHandler Handler>
+using ParseBlocksFn = void(const uint8_t*, const uint8_t*, uint32_t, Handler&) noexcept;
+
+template<ItchHandler Handler>
+static ParseBlocksFn<Handler>* parse_blocks_pick() noexcept {
+    return ISADISPATCH::isa_pick(ISADISPATCH::IsaVariants<ParseBlocksFn<Handler>>{
+        { parse_blocks_scalar<Handler>, parse_blocks_sse42<Handler>, parse_blocks_avx2<Handler>,
+          ISADISPATCH::g_vbmi ? parse_blocks_avx512vbmi<Handler> : nullptr }});
+}
+
+#endif // ITCH5_PARSE_H_INCLUDED
@@ -0,0 +1,238 @@
+/**
+ * itch5_pcap.h
+ *
+ * Offline packet source: mmaps a pcap or pcapng capture and walks it frame by
+ * frame down to the UDP payload, so a recorded feed can be pushed through the
+ * receiver's ring and consumer (itch5_replay.cpp) without a NIC.
+ *
+ * Formats:
+ *   pcap       µs or ns timestamps, either byte order
+ *   pcapng     SHB / IDB / EPB / SPB, byte order per section, if_tsresol per
+ *              interface; every other block type is skipped
+ * Link types:  those itch5_frame.h walks (Ethernet, raw IPv4, Linux SLL)
+ *
+ * next() returns the UDP datagrams frame_udp() accepts; everything else in the
+ * capture (other feeds, ARP, IGMP, TCP) is counted and skipped, as are
+ * datagrams the snaplen cut short.
+ *
+ * The payload pointers point into the mapping, which stays valid until the
+ * reader is destroyed.  One zero page is mapped behind the file, so the
+ * decoders' 32-byte overread past the last datagram never leaves the mapping.
+ */
+
+#ifndef ITCH5_PCAP_H_INCLUDED
+#define ITCH5_PCAP_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "itch5_frame.h"
+
+// One UDP datagram out of the capture.
+struct PcapUdp {
+    const uint8_t* payload;
+    uint32_t       len;       // UDP payload bytes
+    uint64_t       ts_ns;     // capture timestamp, ns since the epoch
+};
+
+class PcapReader {
+public:
+    PcapReader() = default;
+    PcapReader(const PcapReader&) = delete;
+    PcapReader& operator=(const PcapReader&) = delete;
+
+    ~PcapReader() {
+        if (m_map) munmap(m_map, m_map_len);
+    }
+
+    // Maps the whole capture (faulted in up front, so a replay times the
+    // pipeline rather than the page cache) and reads the file header.
+    // Prints the reason and returns false if the file is not a capture.
+    bool open(const char* path) {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) { perror(path); return false; }
+        struct stat st{};
+        if (fstat(fd, &st) < 0) { perror("fstat"); ::close(fd); return false; }
+        m_size = static_cast<size_t>(st.st_size);
+
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        m_map_len = (m_size + page - 1) / page * page + page;
+        void* base = mmap(nullptr, m_map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) { perror("mmap"); ::close(fd); return false; }
+        if (m_size && mmap(base, m_size, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED) {
+            perror("mmap"); munmap(base, m_map_len); ::close(fd); return false;
+        }
+        ::close(fd);
+        m_map = static_cast<uint8_t*>(base);
+
+        if (m_size < 24) { fprintf(stderr, "%s: too short for a capture\n", path); return false; }
+        uint32_t magic;
+        memcpy(&magic, m_map, 4);
+        switch (magic) {
+            case 0xa1b2c3d4: m_ng = false; m_swap = false; m_ts_mul = 1000; break;
+            case 0xd4c3b2a1: m_ng = false; m_swap = true;  m_ts_mul = 1000; break;
+            case 0xa1b23c4d: m_ng = false; m_swap = false; m_ts_mul = 1;    break;
+            case 0x4d3cb2a1: m_ng = false; m_swap = true;  m_ts_mul = 1;    break;
+            case 0x0a0d0d0a: m_ng = true;  break;
+            default:
+                fprintf(stderr, "%s: not a pcap / pcapng file (magic %08x)\n", path, magic);
+                return false;
+        }
+        if (!m_ng) m_link = static_cast<uint16_t>(rd32(m_map + 20));
+        rewind();
+        return true;
+    }
+
+    // 0 = any.  group is in network byte order (inet_pton), port in host order.
+    void set_filter(const uint32_t group, const uint16_t port) noexcept {
+        m_filter = {};
+        if (group) m_filter.add_group(group);
+        m_filter.port = port;
+    }
+
+    void rewind() noexcept {
+        m_pos = m_ng ? 0 : 24;
+        if (m_ng) m_ifaces.clear();
+    }
+
+    // Next matching datagram; false at the end of the capture (or where it
+    // stops making sense, if the tail is corrupt).
+    bool next(PcapUdp& out) noexcept {
+        return m_ng ? next_pcapng(out) : next_pcap(out);
+    }
+
+    bool     is_pcapng() const noexcept { return m_ng; }
+    size_t   size() const noexcept      { return m_size; }
+    uint64_t frames() const noexcept    { return m_frames; }
+    uint64_t skipped() const noexcept   { return m_skipped; }
+    uint64_t truncated() const noexcept { return m_truncated; }
+
+private:
+    struct Iface {
+        uint16_t link;
+        uint8_t  tsresol;     // pcapng if_tsresol: bit 7 clear = 10^-n s, set = 2^-n s
+    };
+
+    uint16_t rd16(const uint8_t* p) const noexcept { uint16_t v; memcpy(&v, p, 2); return m_swap ? __builtin_bswap16(v) : v; }
+    uint32_t rd32(const uint8_t* p) const noexcept { uint32_t v; memcpy(&v, p, 4); return m_swap ? __builtin_bswap32(v) : v; }
+
+    static uint64_t ts_to_ns(const uint64_t ts, const uint8_t tsresol) noexcept {
+        const uint8_t n = tsresol & 0x7f;
+        if (tsresol & 0x80) {
+            if (n >= 64) return 0;
+            // ts * 10^9 >> n in two 32-bit halves of ts, each product < 2^62
+            const uint64_t hi = (ts >> 32) * 1'000'000'000u;
+            const uint64_t lo = (ts & 0xffffffffu) * 1'000'000'000u;
+            return n >= 32 ? (hi + (lo >> 32)) >> (n - 32) : (hi << (32 - n)) + (lo >> n);
+        }
+        uint64_t v = ts;
+        for (uint8_t i = n; i < 9; ++i) v *= 10;
+        for (uint8_t i = 9; i < n; ++i) v /= 10;
+        return v;
+    }
+
+    // [0] ts_sec  [4] ts_usec / ts_nsec  [8] incl_len  [12] orig_len  [16] frame
+    bool next_pcap(PcapUdp& out) noexcept {
+        while (m_pos + 16 <= m_size) {
+            const uint8_t* rec = m_map + m_pos;
+            const uint32_t caplen = rd32(rec + 8);
+            if (m_pos + 16 + caplen > m_size) break;
+            m_pos += 16 + caplen;
+            ++m_frames;
+            const uint64_t ts = static_cast<uint64_t>(rd32(rec)) * 1'000'000'000u + static_cast<uint64_t>(rd32(rec + 4)) * m_ts_mul;
+            if (frame_udp(m_link, rec + 16, caplen, ts, out)) return true;
+        }
+        m_pos = m_size;
+        return false;
+    }
+
+    // block: [0] type  [4] total length  [8] body  [total-4] total length again
+    bool next_pcapng(PcapUdp& out) noexcept {
+        while (m_pos + 12 <= m_size) {
+            const uint8_t* blk = m_map + m_pos;
+            uint32_t type;
+            memcpy(&type, blk, 4);
+            if (type == 0x0a0d0d0a) {                       // section header: fixes the byte order
+                uint32_t bom;
+                memcpy(&bom, blk + 8, 4);
+                if (bom != 0x1a2b3c4d && bom != 0x4d3c2b1a) break;
+                m_swap = bom == 0x4d3c2b1a;
+                m_ifaces.clear();
+            }
+            type = rd32(blk);
+            const uint32_t total = rd32(blk + 4);
+            if (total < 12 || (total & 3) || m_pos + total > m_size) break;
+            m_pos += total;
+
+            switch (type) {
+                case 1: {                                   // interface description
+                    if (total < 20) break;
+                    Iface ifc{rd16(blk + 8), 6};
+                    for (uint32_t o = 16; o + 4 <= total - 4;) {
+                        const uint16_t code = rd16(blk + o);
+                        const uint16_t olen = rd16(blk + o + 2);
+                        if (code == 0) break;
+                        if (code == 9 && olen >= 1) ifc.tsresol = blk[o + 4];
+                        o += 4 + ((olen + 3u) & ~3u);
+                    }
+                    m_ifaces.push_back(ifc);
+                    break;
+                }
+                case 6: {                                   // enhanced packet
+                    if (total < 32) break;
+                    const uint32_t id = rd32(blk + 8);
+                    const uint32_t caplen = rd32(blk + 20);
+                    if (id >= m_ifaces.size() || 28 + caplen > total - 4) break;
+                    ++m_frames;
+                    const uint64_t ts = ts_to_ns(static_cast<uint64_t>(rd32(blk + 12)) << 32 | rd32(blk + 16), m_ifaces[id].tsresol);
+                    if (frame_udp(m_ifaces[id].link, blk + 28, caplen, ts, out)) { m_last_ts = ts; return true; }
+                    break;
+                }
+                case 3: {                                   // simple packet: interface 0, no timestamp
+                    if (total < 16 || m_ifaces.empty()) break;
+                    const uint32_t caplen = std::min(rd32(blk + 8), total - 16);
+                    ++m_frames;
+                    if (frame_udp(m_ifaces[0].link, blk + 12, caplen, m_last_ts, out)) return true;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        m_pos = m_size;
+        return false;
+    }
+
+    bool frame_udp(const uint16_t link, const uint8_t* f, const uint32_t caplen, const uint64_t ts, PcapUdp& out) noexcept {
+        switch (::frame_udp(link, f, caplen, m_filter, out.payload, out.len)) {
+            case FrameUdp::Ok:        out.ts_ns = ts; return true;
+            case FrameUdp::Skip:      ++m_skipped;    return false;
+            case FrameUdp::Truncated: ++m_truncated;  return false;
+        }
+        return false;
+    }
+
+    uint8_t*           m_map{nullptr};
+    size_t             m_map_len{0};
+    size_t             m_size{0};
+    size_t             m_pos{0};
+    bool               m_ng{false};
+    bool               m_swap{false};
+    uint16_t           m_link{0};            // pcap: one link type for the file
+    uint32_t           m_ts_mul{1000};       // pcap: µs or ns fraction -> ns
+    std::vector<Iface> m_ifaces;             // pcapng: per section
+    uint64_t           m_last_ts{0};
+    UdpFilter          m_filter;
+    uint64_t           m_frames{0};
+    uint64_t           m_skipped{0};
+    uint64_t           m_truncated{0};
+};
+
+#endif // ITCH5_PCAP_H_INCLUDED
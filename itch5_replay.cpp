@@ -0,0 +1,173 @@
+/**
+ * itch5_replay.cpp
+ *
+ * ITCH 5.0 receiver fed from a pcap / pcapng capture instead of a NIC: the
+ * same ring, consumer thread and handlers as itch5_efvi.cpp (itch5_rx.h), so
+ * the parse pipeline can be measured end to end offline.  A capture is one
+ * source, replayed into one receive queue.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 itch5_replay.cpp -o itch5_replay -lpthread
+ *
+ * Run:
+ *   ./itch5_replay capture.pcap [speed] [mcast-group] [port] [trace-file]
+ *
+ *   speed        0 (default): as fast as the consumer keeps up; otherwise
+ *                datagrams are released on the capture's own clock, speed
+ *                times faster (1 = real time, 10 = ten times as fast)
+ *   mcast-group  only datagrams sent to this group (0.0.0.0 or omitted: any)
+ *   port         only datagrams sent to this port (0 or omitted: any)
+ *
+ * The capture is mapped and faulted in before the clock starts; the ring
+ * carries pointers straight into the mapping (itch5_pcap.h), so nothing is
+ * copied on the way to the consumer.  At the end of the capture the replay
+ * waits for the consumer to drain the ring and prints packets, messages and
+ * throughput; with speed > 0 it also reports how far behind the capture's
+ * schedule the sends fell at worst.
+ *
+ * -DTRACE_PROBES, -DITCH_PRINT, -DITCH_SHARDS, -DRX_LATENCY and ISA_FORCE
+ * work as for itch5_efvi; a capture has no receive stamps, so -DRX_LATENCY
+ * reports every stage but the wire.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <immintrin.h>          // _mm_pause
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#include "TraceProbe.h"
+#include "IsaDispatch.h"
+#include "itch5_rx.h"
+#include "itch5_pcap.h"
+
+using replay_clock = std::chrono::steady_clock;
+
+// Nothing to hand back: the descriptors point into the read-only mapping.
+static void rx_release(unsigned, int) noexcept {}
+
+// ─── Replay loop ─────────────────────────────────────────────────────────────
+
+struct ReplayStats {
+    uint64_t pkts{0};
+    uint64_t payload_bytes{0};
+    int64_t  max_late_ns{0};     // paced only: worst send behind schedule
+};
+
+// Spins for the last stretch, sleeps for anything longer, so a paced replay of
+// a quiet period does not burn the core the consumer may share.
+static void wait_until(const replay_clock::time_point due) {
+    using namespace std::chrono;
+    while (true) {
+        const auto now = replay_clock::now();
+        if (now >= due) return;
+        if (due - now > milliseconds(2))
+            std::this_thread::sleep_for(due - now - milliseconds(1));
+        else
+            _mm_pause();
+    }
+}
+
+// The replay counterpart of itch5_efvi's poll_loop, except that it returns
+// once the capture is exhausted.
+static ReplayStats replay_loop(PcapReader& cap, const double speed, const replay_clock::time_point t0) {
+#ifdef TRACE_PROBES
+    TRACEPROBE::trace_thread_init("replay");
+#endif
+    ReplayStats st;
+    PcapUdp pkt;
+    uint64_t cap0 = 0;
+
+    while (cap.next(pkt)) {
+        if (speed > 0.0) {
+            if (st.pkts == 0) cap0 = pkt.ts_ns;
+            // capture clocks can step backwards (several interfaces): send those at once
+            const int64_t offset = static_cast<int64_t>(pkt.ts_ns - cap0);
+            const auto due = t0 + std::chrono::nanoseconds(static_cast<int64_t>(std::max<int64_t>(offset, 0) / speed));
+            wait_until(due);
+            const int64_t late = std::chrono::duration_cast<std::chrono::nanoseconds>(replay_clock::now() - due).count();
+            if (late > st.max_late_ns) st.max_late_ns = late;
+        }
+
+        TRACE_MARK(RxPacket, pkt.len);
+
+        PktDesc desc{ pkt.payload, pkt.len, -1 };
+        rx_stamp_enqueue(0, &desc, 1);     // no receive stamp: the wire stage stays empty
+        while (!g_rxq[0].ring.push(desc)) _mm_pause();  // back-pressure spin
+        TRACE_MARK(RingPush, 0);
+
+        ++st.pkts;
+        st.payload_bytes += pkt.len;
+    }
+    g_rx_done.store(true, std::memory_order_release);
+    return st;
+}
+
+// ─── Entry point ─────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <capture.pcap|.pcapng> [speed] [mcast-group] [port] [trace-file]\n", argv[0]);
+        return 1;
+    }
+
+    const char*  path  = argv[1];
+    const double speed = argc > 2 ? atof(argv[2]) : 0.0;
+    uint32_t     group = 0;
+    if (argc > 3 && inet_pton(AF_INET, argv[3], &group) != 1) {
+        fprintf(stderr, "bad mcast-group '%s'\n", argv[3]);
+        return 1;
+    }
+    const uint16_t port = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : 0;
+
+#ifdef TRACE_PROBES
+    static TRACEPROBE::TraceDumper dumper;
+    dumper.start(argc > 5 ? argv[5] : "itch5_replay.trace");
+#endif
+
+    printf("[main] decoder isa=%s\n", ISADISPATCH::isa_name(ISADISPATCH::g_isa));
+
+    PcapReader cap;
+    if (!cap.open(path)) return 1;
+    cap.set_filter(group, port);
+    printf("[replay] %s: %s, %.1f MB, speed=%s\n", path, cap.is_pcapng() ? "pcapng" : "pcap",
+           cap.size() / 1e6, speed > 0.0 ? argv[2] : "max");
+
+    pthread_t consumer;
+    rx_start_consumers(&consumer);
+#ifndef ITCH_PRINT
+    pthread_t tid;
+    pthread_create(&tid, nullptr, stats_thread, nullptr);
+    pthread_detach(tid);
+#endif
+
+    const auto t0 = replay_clock::now();
+    const ReplayStats st = replay_loop(cap, speed, t0);
+    pthread_join(consumer, nullptr);
+    rx_join_shards();
+    const double secs = std::chrono::duration<double>(replay_clock::now() - t0).count();
+
+    printf("[replay] frames=%lu udp=%lu skipped=%lu truncated=%lu\n",
+           static_cast<unsigned long>(cap.frames()), static_cast<unsigned long>(st.pkts),
+           static_cast<unsigned long>(cap.skipped()), static_cast<unsigned long>(cap.truncated()));
+#ifndef ITCH_PRINT
+    const uint64_t msgs = rx_total();
+    printf("[replay] %lu msgs in %.3f s: %.2f Mmsg/s  %.1f ns/msg  %.1f MB/s payload\n",
+           static_cast<unsigned long>(msgs), secs, msgs / secs / 1e6,
+           msgs ? secs * 1e9 / msgs : 0.0, st.payload_bytes / secs / 1e6);
+#else
+    printf("[replay] %lu pkts in %.3f s\n", static_cast<unsigned long>(st.pkts), secs);
+#endif
+    const MoldArbStats& mold = g_rxq[0].arb.stats();
+    printf("[replay] mold dupes=%lu gaps=%lu (%lu msgs)\n",
+           static_cast<unsigned long>(mold.line[0].dupes.load()), static_cast<unsigned long>(mold.gaps.load()),
+           static_cast<unsigned long>(mold.gap_msgs.load()));
+    if (speed > 0.0)
+        printf("[replay] paced: worst send %.1f us behind the capture clock\n", st.max_late_ns / 1e3);
+    return 0;
+}
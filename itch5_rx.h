@@ -0,0 +1,1117 @@
+/**
+ * itch5_rx.h
+ *
+ * Backend-independent half of the ITCH receiver: the receive queues (SPSC
+ * rings of packet descriptors), the message handlers, the consumer threads
+ * that parse what the rings deliver, and the once-a-second stats thread.
+ *
+ * The feed is split across g_n_queues receive queues (RxQueue, g_rxq), each
+ * with its own set of multicast groups, ring(s), handler and consumer thread,
+ * optionally pinned to a core, so the groups of a partitioned feed are parsed
+ * in parallel.  rx_parse_queues() reads the group -> queue -> core map the
+ * receivers take on the command line:
+ *   239.1.1.1                          one queue, one group
+ *   239.1.1.1,239.2.1.1                one queue, the A and B lines of a feed
+ *   239.1.1.1+239.1.1.2@2/239.1.1.3@3  two queues of two and one groups, their
+ *                                      consumers pinned to cores 2 and 3
+ *
+ * A backend (itch5_efvi.cpp: Solarflare ef_vi; itch5_sock.cpp: kernel
+ * sockets; itch5_replay.cpp: pcap / pcapng capture) owns the packet buffers
+ * and one receive context per queue.  It pushes one PktDesc per UDP datagram
+ * into its queue's ring (line A) or, for the line B groups of an A/B queue,
+ * into ring_b.  It defines rx_release() to take a buffer back once the
+ * consumer is done with it, and sets g_rx_done if its source can end.  Each
+ * receiver program includes this header from exactly one translation unit.
+ *
+ * A consumer drains its queue's ring(s) through a MoldArbiter (itch5_mold.h):
+ * only datagrams with messages not yet delivered reach the parser, whichever
+ * line carried them first, and duplicates, gaps and line wins are counted.
+ * With MOLD_REREQUEST=ip:port[/ip:port...] in the environment, gaps are
+ * re-requested from that MoldUDP64 retransmission server (the n-th for queue
+ * n, the last for any queues past it) and spliced back in rather than skipped.
+ *
+ * The consumer hands decoded messages to RxHandler, bound at compile time
+ * (itch5_parse.h, ItchHandler): by default StatsHandler, which counts
+ * messages per type for a once-a-second summary line.  -DITCH_PRINT swaps in
+ * PrintHandler, one printf line per message, for eyeballing a feed; it costs
+ * microseconds per message and is not for production.  A book builder or a
+ * queue to one plugs in the same way.
+ *
+ * -DITCH_SHARDS plugs in the queue to book builders (itch5_shard.h): every
+ * consumer routes its decoded messages by stock_locate over SPSC lanes to
+ * SHARDS shard threads (default 2), each with its own ShardHandler building
+ * the L3 book (itch5_book.h) of the symbols it owns, so a symbol's book lives
+ * on one core.  A shard applies each message as it pops it; with
+ * -DSHARD_PREFETCH it pops its lanes in runs instead and applies each run in
+ * two phases, the run's book state prefetched first (shard_apply_batch; off
+ * by default, as it has measured slower where the book fits in cache: see
+ * the 2phase row of itch5_book_bench).  SHARD_HOT=AAPL,NVDA,17 gives each of
+ * those symbols (or stock_locates) a shard of its own, and
+ * SHARD_CORES=4,5,6 pins shard k to the k-th core listed.
+ *
+ * CHECKPOINT=path (with -DITCH_SHARDS) writes every shard's book and where
+ * each queue's MoldUDP64 sessions stand to path every CHECKPOINT_SECS
+ * (default 60), and a receiver started with the same CHECKPOINT maps it,
+ * restores the books and picks the sessions up at the seqnos saved, so an
+ * intraday restart does not replay the day (itch5_checkpoint.h).  The cut is
+ * a marker each consumer sends down its lanes between two datagrams; the
+ * shards stop at it and stay parked only while the process forks, and a
+ * child writes the file from its copy-on-write view of the books while the
+ * shards carry on.  A restart needs the same queues, SHARDS and SHARD_HOT;
+ * otherwise it starts cold.
+ *
+ * SUBSCRIBE=AAPL,NVDA,17 keeps only those symbols (or stock_locates): every
+ * other symbol's messages are dropped by the parse loop before decoding
+ * (itch5_subscribe.h).  SUBSCRIBE_FILE=path takes the list from a file
+ * instead, one or more per line, and applies it again whenever the file
+ * changes; the consumers pick up a new list between datagrams, without a
+ * lock.  Either way the default is every symbol.
+ *
+ * -DRX_LATENCY adds per-stage latency histograms (itch5_latency.h): each
+ * PktDesc carries its receive timestamp and the TSC at enqueue, the backend
+ * records the wire stage as it pushes, the consumer the queue and decode
+ * stages, a shard the book, and the stats thread prints each stage's
+ * percentiles over the last second as a [lat] line.
+ */
+
+#ifndef ITCH5_RX_H_INCLUDED
+#define ITCH5_RX_H_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>             // sleep, fork
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "TraceProbe.h"
+#include "itch5_avx.h"
+#include "itch5_parse.h"
+#include "itch5_mold.h"
+#include "itch5_frame.h"
+#include "itch5_shard.h"
+#include "itch5_book.h"
+#include "itch5_latency.h"
+#include "itch5_subscribe.h"
+#include "itch5_checkpoint.h"
+
+// ─── Constants ───────────────────────────────────────────────────────────────
+
+static constexpr size_t   RING_CAPACITY  = 1u << 14; // 16384 slots
+static constexpr unsigned RX_MAX_QUEUES  = 8;
+static constexpr unsigned RX_MAX_GROUPS  = UdpFilter::MAX_GROUPS;  // per line of a queue
+static constexpr size_t   SHARD_LANE_CAPACITY = 1u << 12;          // messages per lane
+
+// ─── Lock-free SPSC ring (single producer, single consumer) ──────────────────
+
+template<typename T, size_t N>
+struct alignas(64) SPSCRing {
+    static_assert((N & (N-1)) == 0, "N must be power of two");
+
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::array<T, N> buf_;
+
+    bool push(const T& v) noexcept {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t next = (t + 1) & (N - 1);
+        if (next == head_.load(std::memory_order_acquire))
+            return false;   // full
+        buf_[t] = v;
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Pushes as many of v[0..n) as fit, publishing them with one tail store;
+    // returns how many went in.
+    size_t push_n(const T* v, const size_t n) noexcept {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        const size_t room = (head_.load(std::memory_order_acquire) - t - 1) & (N - 1);
+        const size_t k = n < room ? n : room;
+        for (size_t i = 0; i < k; ++i)
+            buf_[(t + i) & (N - 1)] = v[i];
+        tail_.store((t + k) & (N - 1), std::memory_order_release);
+        return k;
+    }
+
+    bool pop(T& out) noexcept {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire))
+            return false;   // empty
+        out = buf_[h];
+        head_.store((h + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to n into out, releasing the slots with one head store;
+    // returns how many came out.
+    size_t pop_n(T* out, const size_t n) noexcept {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        const size_t avail = (tail_.load(std::memory_order_acquire) - h) & (N - 1);
+        const size_t k = n < avail ? n : avail;
+        for (size_t i = 0; i < k; ++i)
+            out[i] = buf_[(h + i) & (N - 1)];
+        head_.store((h + k) & (N - 1), std::memory_order_release);
+        return k;
+    }
+};
+
+using ShardLane = SPSCRing<ShardMsg, SHARD_LANE_CAPACITY>;
+
+// ─── Packet descriptor (what we put in the ring) ─────────────────────────────
+
+// data / len are the UDP payload: the backend strips the link, IP and UDP
+// headers, so the consumer sees the same thing whatever the frames carried.
+struct PktDesc {
+    const uint8_t* data;
+    uint32_t       len;
+    int            buf_id;    // backend refill handle, handed back to rx_release
+#ifdef RX_LATENCY
+    int64_t        rx_ns{0};      // receive timestamp, CLOCK_REALTIME ns; 0: none
+    uint64_t       enq_tsc{0};    // TSC as it went into the ring
+#endif
+};
+
+// Messages in a MoldUDP64 datagram; 0 for a heartbeat, an end of session or
+// anything too short to be one.
+static inline uint32_t rx_mold_count(const uint8_t* data, const uint32_t len) noexcept {
+    if (len < MOLD_HDR_LEN) return 0;
+    uint16_t count_be;
+    memcpy(&count_be, data + 18, 2);
+    const uint16_t n = __builtin_bswap16(count_be);
+    return n == 0xFFFF ? 0 : n;
+}
+
+// Set by a backend whose source ends (a replay); the consumers drain their
+// rings and return.  A live backend never sets it.
+static std::atomic<bool> g_rx_done{false};
+
+// Provided by the backend: gives a parsed packet's buffer back to queue's
+// receive context.
+static void rx_release(unsigned queue, int buf_id) noexcept;
+
+// ─── ITCH message handlers ───────────────────────────────────────────────────
+
+// Per-type message counts.  The consumer is the only writer; the stats thread
+// reads with relaxed loads, so a plain load + store (no lock prefix) suffices.
+struct StatsHandler {
+    std::array<std::atomic<uint64_t>, 128> by_type{};
+
+    void count(const uint8_t type) noexcept {
+        std::atomic<uint64_t>& c = by_type[type & 127];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    void on_add_order(const DecodedAddOrder&) noexcept                 { count('A'); }
+    void on_execute(const DecodedExecuteOrder&) noexcept               { count('E'); }
+    void on_delete(const DecodedDeleteOrder&) noexcept                 { count('D'); }
+    void on_execute_price(const DecodedExecuteOrderPrice&) noexcept    { count('C'); }
+    void on_cancel(const DecodedCancelOrder&) noexcept                 { count('X'); }
+    void on_replace(const DecodedReplaceOrder&) noexcept               { count('U'); }
+    void on_trade(const DecodedTrade&) noexcept                        { count('P'); }
+    void on_cross_trade(const DecodedCrossTrade&) noexcept             { count('Q'); }
+    void on_broken_trade(const DecodedBrokenTrade&) noexcept           { count('B'); }
+    void on_system_event(const DecodedSystemEvent&) noexcept           { count('S'); }
+    void on_stock_directory(const DecodedStockDirectory&) noexcept     { count('R'); }
+
+    uint64_t total() const noexcept {
+        uint64_t n = 0;
+        for (const auto& c : by_type) n += c.load(std::memory_order_relaxed);
+        return n;
+    }
+};
+
+#ifdef ITCH_PRINT
+
+static void on_add_order(const DecodedAddOrder& m) {
+    double price = m.price / 10000.0;
+    printf("[ADD] %-8s %c %6u @ %9.4f  ref=%-20lu  ts=%lu ns\n",
+           m.stock, m.side, m.shares, price,
+           (unsigned long)m.order_ref, (unsigned long)m.timestamp_ns);
+}
+
+static void on_execute(const DecodedExecuteOrder& m) {
+    printf("[EXE] ref=%-20lu  qty=%6u  match=%-20lu  ts=%lu ns\n",
+           (unsigned long)m.order_ref, m.executed_shares,
+           (unsigned long)m.match_num, (unsigned long)m.timestamp_ns);
+}
+
+static void on_delete(const DecodedDeleteOrder& m) {
+    printf("[DEL] ref=%-20lu  ts=%lu ns\n",
+           (unsigned long)m.order_ref, (unsigned long)m.timestamp_ns);
+}
+
+static void on_execute_price(const DecodedExecuteOrderPrice& m) {
+    printf("[EXP] ref=%-20lu  qty=%6u @ %9.4f  match=%-20lu  %c  ts=%lu ns\n",
+           (unsigned long)m.order_ref, m.executed_shares, m.price / 10000.0,
+           (unsigned long)m.match_num, m.printable, (unsigned long)m.timestamp_ns);
+}
+
+static void on_cancel(const DecodedCancelOrder& m) {
+    printf("[CXL] ref=%-20lu  qty=%6u  ts=%lu ns\n",
+           (unsigned long)m.order_ref, m.cancelled_shares, (unsigned long)m.timestamp_ns);
+}
+
+static void on_replace(const DecodedReplaceOrder& m) {
+    printf("[RPL] ref=%-20lu -> %-20lu  %6u @ %9.4f  ts=%lu ns\n",
+           (unsigned long)m.orig_ref, (unsigned long)m.new_ref, m.shares, m.price / 10000.0,
+           (unsigned long)m.timestamp_ns);
+}
+
+static void on_trade(const DecodedTrade& m) {
+    printf("[TRD] %-8s %c %6u @ %9.4f  match=%-20lu  ts=%lu ns\n",
+           m.stock, m.side, m.shares, m.price / 10000.0,
+           (unsigned long)m.match_num, (unsigned long)m.timestamp_ns);
+}
+
+static void on_cross_trade(const DecodedCrossTrade& m) {
+    printf("[CRS] %-8s %c %10lu @ %9.4f  match=%-20lu  ts=%lu ns\n",
+           m.stock, m.cross_type, (unsigned long)m.shares, m.price / 10000.0,
+           (unsigned long)m.match_num, (unsigned long)m.timestamp_ns);
+}
+
+static void on_broken_trade(const DecodedBrokenTrade& m) {
+    printf("[BRK] match=%-20lu  ts=%lu ns\n",
+           (unsigned long)m.match_num, (unsigned long)m.timestamp_ns);
+}
+
+static void on_system_event(const DecodedSystemEvent& m) {
+    printf("[SYS] event=%c  ts=%lu ns\n", m.event_code, (unsigned long)m.timestamp_ns);
+}
+
+static void on_stock_directory(const DecodedStockDirectory& m) {
+    printf("[DIR] locate=%-5u %-8s  mkt=%c  lot=%u\n",
+           m.stock_locate, m.stock, m.market_category, m.round_lot_size);
+}
+
+// Forwards the parse loop's decoded messages to the printf callbacks above.
+struct PrintHandler {
+    void on_add_order(const DecodedAddOrder& m) noexcept                { ::on_add_order(m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept              { ::on_execute(m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                { ::on_delete(m); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept   { ::on_execute_price(m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept                { ::on_cancel(m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept              { ::on_replace(m); }
+    void on_trade(const DecodedTrade& m) noexcept                       { ::on_trade(m); }
+    void on_cross_trade(const DecodedCrossTrade& m) noexcept            { ::on_cross_trade(m); }
+    void on_broken_trade(const DecodedBrokenTrade& m) noexcept          { ::on_broken_trade(m); }
+    void on_system_event(const DecodedSystemEvent& m) noexcept          { ::on_system_event(m); }
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept    { ::on_stock_directory(m); }
+};
+
+using RxHandler = PrintHandler;
+
+#elif defined(ITCH_SHARDS)
+
+// A shard's handler: counts like StatsHandler and builds the L3 book of the
+// symbols routed to it (itch5_book.h).
+struct ShardBookHandler : StatsHandler {
+    ItchBook book;
+
+    void on_add_order(const DecodedAddOrder& m) noexcept                { count('A'); book.on_add_order(m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept              { count('E'); book.on_execute(m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                { count('D'); book.on_delete(m); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept   { count('C'); book.on_execute_price(m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept                { count('X'); book.on_cancel(m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept              { count('U'); book.on_replace(m); }
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept    { count('R'); book.on_stock_directory(m); }
+
+    static constexpr unsigned PREFETCH_STAGES = ItchBook::PREFETCH_STAGES;
+    template<class M>
+    void prefetch(const M& m, const unsigned stage) const noexcept { book.prefetch(m, stage); }
+};
+
+using RxHandler    = ShardRouter<ShardLane>;
+using ShardHandler = ShardBookHandler;
+
+#else
+
+using RxHandler = StatsHandler;
+
+#endif // ITCH_PRINT
+
+#if defined(ITCH_PRINT) && defined(ITCH_SHARDS)
+#error "ITCH_PRINT and ITCH_SHARDS do not combine: the shards would print from K threads at once"
+#endif
+
+// ─── Subscription filter ─────────────────────────────────────────────────────
+
+static_assert(RX_MAX_QUEUES <= SUB_MAX_READERS, "one subscription reader per queue");
+
+// Readers: the consumers, by queue.  Writer: rx_start_consumers, then the
+// SUBSCRIBE_FILE watcher.
+static SubscriptionFilter g_subs;
+
+// The consumer's handler: RxHandler behind the subscription filter.  set is
+// the consumer's current bitmap, refreshed between datagrams; skipped counts
+// the messages it kept from the decoders (single writer).
+struct RxSubscribedHandler : RxHandler {
+    SubscriptionSet*      set{nullptr};
+    std::atomic<uint64_t> skipped{0};
+
+    bool subscribed(const uint16_t raw_locate) noexcept {
+        if (set->test(raw_locate)) return true;
+        skipped.store(skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept {
+        g_subs.learn(set, m);
+        RxHandler::on_stock_directory(m);
+    }
+};
+
+// Bound once at startup to the best parse_datagram entry point (itch5_parse.h).
+static ParseDatagramFn<RxSubscribedHandler>* const parse_datagram = parse_datagram_pick<RxSubscribedHandler>();
+
+// ─── Receive queues ──────────────────────────────────────────────────────────
+
+// One receive context's worth of consumer state.  The backend is the only
+// producer into the rings and the consumer thread the only one touching the
+// rest, so queues share nothing but g_rx_done.
+struct RxQueue {
+    SPSCRing<PktDesc, RING_CAPACITY> ring;      // line A, or the only line
+    SPSCRing<PktDesc, RING_CAPACITY> ring_b;    // line B, if ab
+    RxSubscribedHandler  handler;
+    MoldArbiter<PktDesc> arb;
+    MoldRecovery         recovery;
+
+    unsigned    id{0};
+    bool        ab{false};
+    int         core{-1};                       // the consumer's core; -1 = not pinned
+    const char* groups[2][RX_MAX_GROUPS]{};     // per line, as given
+    unsigned    n_groups[2]{};
+
+    // Receive ring gauge, for a backend that keeps its NIC ring topped up
+    // (ef_vi): buffers posted out of fill_capacity, the low-water mark since
+    // the stats thread last looked, refill doorbells / buffers posted, and
+    // frames the NIC discarded.  The backend's poll thread writes, the stats
+    // thread reads.
+    uint32_t              fill_capacity{0};     // 0: no gauge
+    std::atomic<uint32_t> fill{0};
+    std::atomic<uint32_t> fill_min{UINT32_MAX};
+    std::atomic<uint64_t> refills{0};
+    std::atomic<uint64_t> refilled{0};
+    std::atomic<uint64_t> discards{0};
+
+#ifdef RX_LATENCY
+    LatencySet lat;     // wire: the backend writes;  queue / decode: the consumer
+#endif
+};
+
+static RxQueue  g_rxq[RX_MAX_QUEUES];
+static unsigned g_n_queues = 1;
+
+// Backend: stamps n descriptors about to go into queue's ring with one TSC
+// read, and records their wire stage against one clock_gettime.
+static inline void rx_stamp_enqueue([[maybe_unused]] const unsigned queue, [[maybe_unused]] PktDesc* d,
+                                    [[maybe_unused]] const unsigned n) noexcept {
+#ifdef RX_LATENCY
+    const uint64_t tsc = lat_tsc();
+    int64_t now = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        d[i].enq_tsc = tsc;
+        if (!d[i].rx_ns) continue;
+        if (!now) now = lat_realtime_ns();
+        if (const uint32_t msgs = rx_mold_count(d[i].data, d[i].len))
+            g_rxq[queue].lat.record(LatStage::Wire, now > d[i].rx_ns ? static_cast<uint64_t>(now - d[i].rx_ns) : 0, msgs);
+    }
+#endif
+}
+
+// Consumers that have returned (g_rx_done); the shard threads follow them.
+static std::atomic<unsigned> g_rx_consumers_done{0};
+
+static inline bool rx_any_ab() noexcept {
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        if (g_rxq[q].ab) return true;
+    return false;
+}
+
+// Fills g_rxq / g_n_queues from a queue map (splitting spec in place):
+//   queues := queue ['/' queue ...]
+//   queue  := line [',' line] ['@' core]       two lines: A and B of one feed
+//   line   := group ['+' group ...]
+// Prints the reason and returns false if it does not parse.
+static inline bool rx_parse_queues(char* spec) {
+    g_n_queues = 0;
+    for (char* next = spec; next;) {
+        char* q = next;
+        next = strchr(q, '/');
+        if (next) *next++ = '\0';
+        if (g_n_queues == RX_MAX_QUEUES) { fprintf(stderr, "more than %u queues\n", RX_MAX_QUEUES); return false; }
+        RxQueue& rq = g_rxq[g_n_queues];
+        rq.id = g_n_queues++;
+
+        if (char* at = strchr(q, '@')) {
+            *at++ = '\0';
+            char* end;
+            rq.core = static_cast<int>(strtol(at, &end, 10));
+            if (end == at || *end || rq.core < 0 || rq.core >= CPU_SETSIZE) { fprintf(stderr, "bad core '%s'\n", at); return false; }
+        }
+        char* line_b = strchr(q, ',');
+        if (line_b) *line_b++ = '\0';
+        rq.ab = line_b != nullptr;
+
+        char* lines[2] = {q, line_b};
+        for (int l = 0; l < (rq.ab ? 2 : 1); ++l) {
+            for (char* g = lines[l]; g;) {
+                char* plus = strchr(g, '+');
+                if (plus) *plus++ = '\0';
+                in_addr addr;
+                if (inet_pton(AF_INET, g, &addr) != 1) { fprintf(stderr, "bad mcast-group '%s'\n", g); return false; }
+                if (rq.n_groups[l] == RX_MAX_GROUPS) { fprintf(stderr, "more than %u groups on a line\n", RX_MAX_GROUPS); return false; }
+                rq.groups[l][rq.n_groups[l]++] = g;
+                g = plus;
+            }
+        }
+    }
+    return true;
+}
+
+// One line per queue: its groups and core.
+static inline void rx_print_queues(const char* tag) {
+    for (unsigned q = 0; q < g_n_queues; ++q) {
+        const RxQueue& rq = g_rxq[q];
+        printf("[%s] queue %u:", tag, q);
+        for (int l = 0; l < (rq.ab ? 2 : 1); ++l) {
+            printf(rq.ab ? " %c" : "", 'A' + l);
+            for (unsigned i = 0; i < rq.n_groups[l]; ++i) printf(" %s", rq.groups[l][i]);
+        }
+        if (rq.core >= 0) printf(" -> core %d\n", rq.core);
+        else              printf(" -> any core\n");
+    }
+}
+
+// ─── Checkpoint cut ──────────────────────────────────────────────────────────
+
+#ifdef ITCH_SHARDS
+
+static_assert(RX_MAX_QUEUES <= CKPT_MAX_QUEUES, "a checkpoint holds every queue's sessions");
+
+// A checkpoint is taken at a cut through the message stream: gen moves on,
+// each consumer saves where its sessions stand between two datagrams and
+// sends SHARD_CHECKPOINT down every lane behind what it has routed so far,
+// and a shard takes nothing more from a lane once that lane's marker is
+// through.  A shard with every queue's marker parks; once all have, the
+// books hold exactly what the saved seqnos say was delivered.  released
+// (= gen) lets them go.
+struct RxCheckpoint {
+    std::atomic<uint64_t> gen{0};
+    std::atomic<uint64_t> released{0};
+    std::atomic<unsigned> parked{0};
+    MoldSessionState      session[RX_MAX_QUEUES][MoldSequencer::MAX_SESSIONS]{};    // per queue, its consumer writes
+    unsigned              sessions[RX_MAX_QUEUES]{};
+    unsigned              every_s{60};
+};
+
+static RxCheckpoint g_ckpt;
+
+// Consumer, between datagrams: its part of the cut, once per gen.
+static inline void rx_checkpoint_mark(RxQueue& rq, uint64_t& seen) noexcept {
+    const uint64_t gen = g_ckpt.gen.load(std::memory_order_acquire);
+    if (gen == seen) [[likely]] return;
+    seen = gen;
+    g_ckpt.sessions[rq.id] = rq.arb.sequencer().save(g_ckpt.session[rq.id]);
+    rq.handler.broadcast(SHARD_CHECKPOINT);
+}
+
+#else
+
+static inline void rx_checkpoint_mark(RxQueue&, uint64_t&) noexcept {}
+
+#endif // ITCH_SHARDS
+
+// ─── Consumer thread ─────────────────────────────────────────────────────────
+
+#ifdef RX_LATENCY
+
+// What the arbiter pops through under RX_LATENCY: records a datagram's queue
+// stage as it comes off the ring, and leaves the TSC in `mark` for the
+// decode stage to start from.
+struct RxLatRing {
+    SPSCRing<PktDesc, RING_CAPACITY>& ring;
+    LatencySet&                       lat;
+    uint64_t&                         mark;
+
+    bool pop(PktDesc& d) noexcept {
+        if (!ring.pop(d)) return false;
+        mark = lat_tsc();
+        if (const uint32_t msgs = rx_mold_count(d.data, d.len))
+            lat.record(LatStage::Queue, lat_ticks_ns(d.enq_tsc, mark), msgs);
+        return true;
+    }
+};
+
+#endif // RX_LATENCY
+
+// arg is the RxQueue to drain.
+static void* consumer_thread(void* arg) {
+    RxQueue& rq = *static_cast<RxQueue*>(arg);
+    const unsigned queue = rq.id;
+#ifdef TRACE_PROBES
+    char name[16];
+    snprintf(name, sizeof(name), "consumer%u", queue);
+    TRACEPROBE::trace_thread_init(name);
+#endif
+    if (rq.core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(rq.core, &set);
+        if (const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            fprintf(stderr, "[rx] queue %u: cannot pin to core %d (%s), left unpinned\n", queue, rq.core, strerror(rc));
+    }
+
+    RxSubscribedHandler& handler = rq.handler;
+    MoldArbiter<PktDesc>& arb = rq.arb;
+#ifndef RX_LATENCY
+    SPSCRing<PktDesc, RING_CAPACITY>& ring = rq.ring;
+    SPSCRing<PktDesc, RING_CAPACITY>* const ring_b = rq.ab ? &rq.ring_b : nullptr;
+#endif
+#ifdef RX_LATENCY
+    // decode runs from the pop (or the previous parse, for datagrams out of
+    // the reorder window) to the end of the parse
+    uint64_t mark = 0;
+    RxLatRing lat_a{rq.ring, rq.lat, mark}, lat_b{rq.ring_b, rq.lat, mark};
+    const auto parse = [&handler, &rq, &mark](const uint8_t* data, const uint32_t len) noexcept {
+        parse_datagram(data, len, handler);
+        const uint64_t now = lat_tsc();
+        if (const uint32_t msgs = rx_mold_count(data, len))
+            rq.lat.record(LatStage::Decode, lat_ticks_ns(mark, now), msgs);
+        mark = now;
+    };
+    RxLatRing& ring = lat_a;
+    RxLatRing* const ring_b = rq.ab ? &lat_b : nullptr;
+#else
+    const auto parse = [&handler](const uint8_t* data, const uint32_t len) noexcept {
+        parse_datagram(data, len, handler);
+    };
+#endif
+    const auto release = [queue](const PktDesc& desc) noexcept {
+        TRACE_MARK(RingPop, desc.buf_id);
+        rx_release(queue, desc.buf_id);
+    };
+
+    if (const char* env = getenv("MOLD_REREQUEST")) {
+        // the queue-th endpoint, or the last one
+        char rr[64];
+        for (unsigned i = 0;; ++i) {
+            const char* slash = strchr(env, '/');
+            if (i == queue || !slash) {
+                const size_t n = slash ? static_cast<size_t>(slash - env) : strlen(env);
+                snprintf(rr, sizeof(rr), "%.*s", static_cast<int>(n), env);
+                break;
+            }
+            env = slash + 1;
+        }
+        if (rq.recovery.open(rr)) {
+            arb.set_recovery(&rq.recovery);
+            printf("[mold] queue %u: gap recovery via re-request server %s\n", queue, rr);
+        }
+    }
+
+    uint64_t ckpt_seen = 0;
+    while (true) {
+        handler.set = g_subs.quiescent(queue);
+        rx_checkpoint_mark(rq, ckpt_seen);
+        if (arb.poll(ring, ring_b, parse, release) == 0 && g_rx_done.load(std::memory_order_acquire)) {
+            // the done flag is stored after the last push: drain what landed
+            // between the failed pops and here, and any gap still held
+            while (arb.poll(ring, ring_b, parse, release) || arb.holding()) handler.set = g_subs.quiescent(queue);
+            break;
+        }
+    }
+    rx_checkpoint_mark(rq, ckpt_seen);      // a cut under way must not wait for this queue
+    g_subs.offline(queue);
+    g_rx_consumers_done.fetch_add(1, std::memory_order_release);
+    return nullptr;
+}
+
+// ─── Shard threads ───────────────────────────────────────────────────────────
+
+#ifdef ITCH_SHARDS
+
+struct RxShard {
+    ShardHandler handler;
+    unsigned     id{0};
+    int          core{-1};
+    pthread_t    tid{};
+#ifdef RX_LATENCY
+    LatencySet   lat;           // book; the shard thread writes
+#endif
+};
+
+static RxShard    g_shards[SHARD_MAX];
+static unsigned   g_n_shards = 1;
+static ShardLane* g_lanes = nullptr;        // [queue * g_n_shards + shard]
+
+// Shard, with every queue's marker through: holds still until the
+// checkpoint thread has forked.
+static inline void rx_checkpoint_park() noexcept {
+    const uint64_t gen = g_ckpt.gen.load(std::memory_order_acquire);
+    g_ckpt.parked.fetch_add(1, std::memory_order_acq_rel);
+    while (g_ckpt.released.load(std::memory_order_acquire) < gen) _mm_pause();
+}
+
+// Drains shard arg's lane from every queue until the consumers are done.
+static void* shard_thread(void* arg) {
+    RxShard& sh = *static_cast<RxShard*>(arg);
+#ifdef TRACE_PROBES
+    char name[16];
+    snprintf(name, sizeof(name), "shard%u", sh.id);
+    TRACEPROBE::trace_thread_init(name);
+#endif
+    if (sh.core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(sh.core, &set);
+        if (const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            fprintf(stderr, "[rx] shard %u: cannot pin to core %d (%s), left unpinned\n", sh.id, sh.core, strerror(rc));
+    }
+
+    ShardHandler& handler = sh.handler;
+    const uint32_t every = (1u << g_n_queues) - 1;
+    uint32_t cut = 0;                           // queues whose checkpoint marker is through
+#ifdef SHARD_PREFETCH
+    // Pops runs of up to SHARD_BATCH and applies each in two phases
+    // (shard_apply_batch, itch5_shard.h); a checkpoint marker ends a run.
+    ShardMsg run[SHARD_BATCH];
+    const auto drain = [&](const bool last) noexcept {
+        unsigned n = 0;
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            ShardLane& lane = g_lanes[q * g_n_shards + sh.id];
+            while (n < 256 && (!(cut >> q & 1) || last)) {
+                size_t k = 0;
+                for (; k < SHARD_BATCH && lane.pop(run[k]); ++k)
+                    if (run[k].type == SHARD_CHECKPOINT && !last) [[unlikely]] {
+                        cut |= 1u << q;
+                        break;
+                    }
+                shard_apply_batch(run, k, handler);
+#ifdef RX_LATENCY
+                const uint64_t now = lat_tsc();
+                for (size_t i = 0; i < k; ++i) sh.lat.record(LatStage::Book, lat_ticks_ns(run[i].stamp_tsc, now));
+#endif
+                n += static_cast<unsigned>(k);
+                if (k < SHARD_BATCH) break;         // lane empty, or the marker
+            }
+        }
+        return n;
+    };
+#else
+    const auto drain = [&](const bool last) noexcept {
+        unsigned n = 0;
+        ShardMsg m;
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            if (cut >> q & 1 && !last) continue;
+            for (ShardLane& lane = g_lanes[q * g_n_shards + sh.id]; n < 256 && lane.pop(m); ++n) {
+                if (m.type == SHARD_CHECKPOINT && !last) [[unlikely]] {
+                    cut |= 1u << q;
+                    break;
+                }
+                shard_apply(m, handler);
+#ifdef RX_LATENCY
+                sh.lat.record(LatStage::Book, lat_ticks_ns(m.stamp_tsc, lat_tsc()));
+#endif
+            }
+        }
+        return n;
+    };
+#endif
+
+    while (true) {
+        if (cut == every) [[unlikely]] {
+            rx_checkpoint_park();
+            cut = 0;
+        }
+        if (drain(false) == 0) {
+            if (g_rx_consumers_done.load(std::memory_order_acquire) == g_n_queues) {
+                // every consumer has pushed its last message before counting itself out
+                while (drain(true)) {}
+                break;
+            }
+            _mm_pause();
+        }
+    }
+    return nullptr;
+}
+
+// ─── Checkpoints ─────────────────────────────────────────────────────────────
+
+// The newest session's next seqno of queue q in h.
+static inline uint64_t rx_checkpoint_seqno(const CkptHeader& h, const unsigned q) noexcept {
+    uint64_t next = 0;
+    for (unsigned i = 0; i < h.sessions[q]; ++i) next = std::max(next, h.session[q][i].next);
+    return next;
+}
+
+// Every every_s seconds: takes a cut, forks a child to write it out and lets
+// the shards go as soon as the fork is done.  arg is the CkptWriter.
+static void* checkpoint_thread(void* arg) {
+    CkptWriter& w = *static_cast<CkptWriter*>(arg);
+    using ckpt_clock = std::chrono::steady_clock;
+    const auto consumers_done = []() noexcept {
+        return g_rx_consumers_done.load(std::memory_order_acquire) == g_n_queues;
+    };
+
+    while (true) {
+        for (unsigned s = 0; s < g_ckpt.every_s; ++s) {
+            sleep(1);
+            if (consumers_done()) return nullptr;
+        }
+        const auto t0 = ckpt_clock::now();
+        const uint64_t gen = g_ckpt.gen.fetch_add(1, std::memory_order_acq_rel) + 1;
+        while (g_ckpt.parked.load(std::memory_order_acquire) < g_n_shards) {
+            if (consumers_done()) {                         // the feed ended under the cut
+                g_ckpt.released.store(gen, std::memory_order_release);
+                return nullptr;
+            }
+            _mm_pause();
+        }
+
+        CkptHeader h{};
+        h.queues = g_n_queues;
+        h.shards = g_n_shards;
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            h.sessions[q] = g_ckpt.sessions[q];
+            memcpy(h.session[q], g_ckpt.session[q], sizeof(h.session[q]));
+        }
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        h.taken_ns = ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+        const ItchBook* books[SHARD_MAX];
+        uint64_t orders = 0;
+        for (unsigned k = 0; k < g_n_shards; ++k) {
+            books[k] = &g_shards[k].handler.book;
+            orders += books[k]->orders_live();
+        }
+
+        const pid_t pid = fork();
+        if (pid == 0) _exit(w.write(h, books, g_n_shards) ? 0 : 1);
+        g_ckpt.parked.store(0, std::memory_order_relaxed);
+        g_ckpt.released.store(gen, std::memory_order_release);
+        const auto t1 = ckpt_clock::now();
+        if (pid < 0) { perror("fork"); continue; }
+
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        const auto t2 = ckpt_clock::now();
+        struct stat st{};
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || stat(w.path(), &st) != 0) {
+            fprintf(stderr, "[ckpt] %s: write failed, the last checkpoint stands\n", w.path());
+            continue;
+        }
+        printf("[ckpt] %s: %lu orders, %.1f MB, queue 0 at seqno %lu; shards parked %ld us, written in %ld ms\n",
+               w.path(), static_cast<unsigned long>(orders), st.st_size / 1e6,
+               static_cast<unsigned long>(rx_checkpoint_seqno(h, 0)),
+               static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()),
+               static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count()));
+    }
+}
+
+// Before the consumers start: the books, directory and sessions of the
+// checkpoint at path into the shards, table, subscription filter and
+// queues.  A checkpoint taken with other queues or shards, one whose
+// symbols the table would now put on other shards, or a damaged one leaves
+// everything as it was: a cold start.
+static inline void rx_checkpoint_restore(const char* path, ShardTable& table) {
+    const auto t0 = std::chrono::steady_clock::now();
+    CkptFile file;
+    if (!file.open(path)) {
+        printf("[ckpt] %s: nothing to restore, cold start\n", path);
+        return;
+    }
+    const CkptHeader& h = file.header();
+    if (h.queues != g_n_queues || h.shards != g_n_shards) {
+        fprintf(stderr, "[ckpt] %s: taken with %u queues and %u shards, not %u and %u; cold start\n",
+                path, h.queues, h.shards, g_n_queues, g_n_shards);
+        return;
+    }
+
+    ShardTable restored = table;
+    bool ok = true;
+    for (unsigned k = 0; ok && k < g_n_shards; ++k) {
+        size_t len;
+        const uint8_t* image = file.shard(k, len);
+        ok = g_shards[k].handler.book.load(image, len);
+        if (ok)
+            g_shards[k].handler.book.for_each_symbol([&](const uint16_t locate, const char* stock) {
+                if (stock[0]) {
+                    DecodedStockDirectory d{};
+                    d.stock_locate = locate;
+                    memcpy(d.stock, stock, sizeof(d.stock));
+                    restored.on_directory(d);
+                }
+                ok = ok && restored.shard(locate) == k;
+            });
+    }
+    if (!ok) {
+        for (unsigned k = 0; k < g_n_shards; ++k) g_shards[k].handler.book = ItchBook();
+        fprintf(stderr, "[ckpt] %s: damaged, or its symbols sit on other shards now; cold start\n", path);
+        return;
+    }
+    table = restored;
+
+    uint64_t orders = 0, levels = 0;
+    for (unsigned k = 0; k < g_n_shards; ++k) {
+        const ItchBook& book = g_shards[k].handler.book;
+        orders += book.orders_live();
+        levels += book.levels_live();
+        book.for_each_symbol([](const uint16_t locate, const char* stock) {
+            if (!stock[0]) return;
+            DecodedStockDirectory d{};
+            d.stock_locate = locate;
+            memcpy(d.stock, stock, sizeof(d.stock));
+            g_subs.know(d);
+        });
+    }
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        for (unsigned i = 0; i < h.sessions[q]; ++i) g_rxq[q].arb.resume(h.session[q][i]);
+
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const int64_t age_ns = ts.tv_sec * 1'000'000'000LL + ts.tv_nsec - h.taken_ns;
+    printf("[ckpt] %s: restored %lu orders, %lu levels taken %.1f s ago, in %.1f ms\n", path,
+           static_cast<unsigned long>(orders), static_cast<unsigned long>(levels), age_ns / 1e9,
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        printf("[ckpt] queue %u resumes at seqno %lu\n", q, static_cast<unsigned long>(rx_checkpoint_seqno(h, q)));
+}
+
+// Reads CHECKPOINT_SECS and starts the checkpoint thread writing to path.
+static inline void rx_start_checkpoints(const char* path) {
+    if (const char* secs = getenv("CHECKPOINT_SECS")) g_ckpt.every_s = std::max(1, atoi(secs));
+    static CkptWriter writer(path);
+    pthread_t tid;
+    pthread_create(&tid, nullptr, checkpoint_thread, &writer);
+    pthread_detach(tid);
+    printf("[ckpt] every %u s to %s\n", g_ckpt.every_s, path);
+}
+
+// ─── Shard start ─────────────────────────────────────────────────────────────
+
+// Reads SHARDS / SHARD_HOT / SHARD_CORES, restores the CHECKPOINT if there
+// is one, gives every queue's router its lanes and starts the shard threads.
+static inline void rx_start_shards() {
+    ShardTable table;
+    table.configure(getenv("SHARDS") ? static_cast<unsigned>(atoi(getenv("SHARDS"))) : 2, getenv("SHARD_HOT"));
+    g_n_shards = table.shards();
+    if (const char* path = getenv("CHECKPOINT")) rx_checkpoint_restore(path, table);
+
+    g_lanes = new ShardLane[g_n_queues * g_n_shards];
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        g_rxq[q].handler.bind(&g_lanes[q * g_n_shards], table);
+
+    const char* cores = getenv("SHARD_CORES");
+    for (unsigned k = 0; k < g_n_shards; ++k) {
+        RxShard& sh = g_shards[k];
+        sh.id = k;
+        if (cores && *cores) {
+            sh.core = atoi(cores);
+            cores = strchr(cores, ',');
+            cores = cores ? cores + 1 : nullptr;
+        }
+        char where[16] = "any core";
+        if (sh.core >= 0) snprintf(where, sizeof(where), "core %d", sh.core);
+        if (k < table.hot()) printf("[shard] %u: hot %s -> %s\n", k, table.hot_name(k), where);
+        else                 printf("[shard] %u: cold -> %s\n", k, where);
+        pthread_create(&sh.tid, nullptr, shard_thread, &sh);
+    }
+}
+
+#endif // ITCH_SHARDS
+
+// Applies list as the subscription and says so; false if it does not parse.
+static inline bool rx_subscribe(const char* list) {
+    if (!g_subs.subscribe(list)) {
+        fprintf(stderr, "[sub] bad subscription '%s'\n", list);
+        return false;
+    }
+    const SubscriptionSet* s = g_subs.live();
+    if (s->all) printf("[sub] every symbol\n");
+    else        printf("[sub] %u symbols, %u stock_locates\n", s->n_symbols, s->n_locates);
+    return true;
+}
+
+// Reads arg's file into a comma list and applies it whenever its mtime moves.
+static void* subscribe_thread(void* arg) {
+    const char* path = static_cast<const char*>(arg);
+    timespec last{};
+    static char list[SUB_MAX_SYMBOLS * 9 + 1];
+    while (true) {
+        struct stat st;
+        if (stat(path, &st) == 0 && (st.st_mtim.tv_sec != last.tv_sec || st.st_mtim.tv_nsec != last.tv_nsec)) {
+            last = st.st_mtim;
+            if (FILE* f = fopen(path, "r")) {
+                size_t n = 0;
+                for (int c; (c = fgetc(f)) != EOF && n + 1 < sizeof(list);) {
+                    if (c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                        if (n && list[n - 1] != ',') list[n++] = ',';
+                    } else {
+                        list[n++] = static_cast<char>(c);
+                    }
+                }
+                fclose(f);
+                if (n && list[n - 1] == ',') --n;
+                list[n] = '\0';
+                rx_subscribe(n ? list : "*");
+            }
+        }
+        sleep(1);
+    }
+    return nullptr;
+}
+
+// Starts one consumer per queue (and with ITCH_SHARDS the shard threads
+// first, and the checkpoint thread after); joinable, for a backend whose
+// source ends.  Applies SUBSCRIBE or starts the SUBSCRIBE_FILE watcher
+// first, after a restored checkpoint's directory is known.
+static inline void rx_start_consumers(pthread_t* tids) {
+    lat_clock_init();
+#ifdef ITCH_SHARDS
+    rx_start_shards();
+#endif
+    if (const char* path = getenv("SUBSCRIBE_FILE")) {
+        pthread_t tid;
+        pthread_create(&tid, nullptr, subscribe_thread, const_cast<char*>(path));
+        pthread_detach(tid);
+    } else if (const char* list = getenv("SUBSCRIBE")) {
+        if (!rx_subscribe(list)) exit(1);
+    }
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        pthread_create(&tids[q], nullptr, consumer_thread, &g_rxq[q]);
+#ifdef ITCH_SHARDS
+    if (const char* path = getenv("CHECKPOINT")) rx_start_checkpoints(path);
+#else
+    if (getenv("CHECKPOINT")) fprintf(stderr, "[ckpt] CHECKPOINT needs the books (-DITCH_SHARDS); ignored\n");
+#endif
+}
+
+// After the consumers have been joined: waits for the shard threads to drain.
+static inline void rx_join_shards() {
+#ifdef ITCH_SHARDS
+    for (unsigned k = 0; k < g_n_shards; ++k) {
+        pthread_join(g_shards[k].tid, nullptr);
+        const ItchBook& book = g_shards[k].handler.book;
+        printf("[shard] %u: book %lu live orders, %lu levels, %lu msgs for unknown refs\n", k,
+               static_cast<unsigned long>(book.orders_live()), static_cast<unsigned long>(book.levels_live()),
+               static_cast<unsigned long>(book.unknown()));
+    }
+#endif
+}
+
+// ─── Stats thread ────────────────────────────────────────────────────────────
+
+#ifndef ITCH_PRINT
+
+// Messages of type t handled so far: by the shards or, unsharded, by the
+// consumers.
+static inline uint64_t rx_count(const int t) noexcept {
+    uint64_t n = 0;
+#ifdef ITCH_SHARDS
+    for (unsigned k = 0; k < g_n_shards; ++k) n += g_shards[k].handler.by_type[t].load(std::memory_order_relaxed);
+#else
+    for (unsigned q = 0; q < g_n_queues; ++q) n += g_rxq[q].handler.by_type[t].load(std::memory_order_relaxed);
+#endif
+    return n;
+}
+
+static inline uint64_t rx_total() noexcept {
+    uint64_t n = 0;
+    for (int t = 0; t < 128; ++t) n += rx_count(t);
+    return n;
+}
+
+// Once a second: messages per second, in total and per type seen, across all
+// queues; then each queue's arbitration counters, each shard's rate, the
+// messages the subscription filter skipped, and under RX_LATENCY the stage
+// latencies.
+static void* stats_thread(void*) {
+    std::array<uint64_t, 128> last{};
+    uint64_t last_skipped = 0;
+#ifdef ITCH_SHARDS
+    std::array<uint64_t, SHARD_MAX> last_shard{};
+#endif
+    while (true) {
+        sleep(1);
+        uint64_t total = 0;
+        char line[256];
+        int pos = 0;
+        for (int t = 0; t < 128; ++t) {
+            const uint64_t now = rx_count(t);
+            const uint64_t d = now - last[t];
+            last[t] = now;
+            total += d;
+            if (d && pos < static_cast<int>(sizeof(line)) - 32)
+                pos += snprintf(line + pos, sizeof(line) - pos, " %c=%lu", t, static_cast<unsigned long>(d));
+        }
+        line[pos] = '\0';
+        printf("[stats] %lu msg/s%s\n", static_cast<unsigned long>(total), line);
+
+        const auto ld = [](const std::atomic<uint64_t>& c) { return static_cast<unsigned long>(c.load(std::memory_order_relaxed)); };
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            const MoldArbStats& a = g_rxq[q].arb.stats();
+            char tag[16] = "[mold]";
+            if (g_n_queues > 1) snprintf(tag, sizeof(tag), "[mold q%u]", q);
+            if (g_rxq[q].ab)
+                printf("%s A wins=%lu dupes=%lu  B wins=%lu dupes=%lu  gaps=%lu (%lu msgs) filled=%lu", tag,
+                       ld(a.line[0].wins), ld(a.line[0].dupes), ld(a.line[1].wins), ld(a.line[1].dupes),
+                       ld(a.gaps), ld(a.gap_msgs), ld(a.filled));
+            else
+                printf("%s dupes=%lu gaps=%lu (%lu msgs)", tag, ld(a.line[0].dupes), ld(a.gaps), ld(a.gap_msgs));
+            printf("  recoveries=%lu requests=%lu recovered=%lu msgs window-max=%lu\n",
+                   ld(a.recoveries), ld(a.requests), ld(a.recovered_msgs), ld(a.parked_max));
+        }
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            RxQueue& rq = g_rxq[q];
+            if (!rq.fill_capacity) continue;
+            const uint64_t refills = rq.refills.load(std::memory_order_relaxed);
+            const uint64_t refilled = rq.refilled.load(std::memory_order_relaxed);
+            const uint32_t low = rq.fill_min.exchange(UINT32_MAX, std::memory_order_relaxed);
+            printf("[rx] queue %u: ring fill=%u/%u min=%u  refills=%lu (%.1f buffers each)  discards=%lu\n", q,
+                   rq.fill.load(std::memory_order_relaxed), rq.fill_capacity,
+                   low == UINT32_MAX ? rq.fill.load(std::memory_order_relaxed) : low,
+                   static_cast<unsigned long>(refills), refills ? static_cast<double>(refilled) / refills : 0.0,
+                   static_cast<unsigned long>(rq.discards.load(std::memory_order_relaxed)));
+        }
+#ifdef ITCH_SHARDS
+        printf("[shard] msg/s");
+        for (unsigned k = 0; k < g_n_shards; ++k) {
+            const uint64_t now = g_shards[k].handler.total();
+            printf(" %u=%lu", k, static_cast<unsigned long>(now - last_shard[k]));
+            last_shard[k] = now;
+        }
+        printf("\n");
+#endif
+        if (!g_subs.all()) {
+            uint64_t skipped = 0;
+            for (unsigned q = 0; q < g_n_queues; ++q) skipped += g_rxq[q].handler.skipped.load(std::memory_order_relaxed);
+            printf("[sub] skipped %lu msg/s\n", static_cast<unsigned long>(skipped - last_skipped));
+            last_skipped = skipped;
+        }
+#ifdef RX_LATENCY
+        static LatencyReport lat_report;
+        const LatencySet* sets[RX_MAX_QUEUES + SHARD_MAX];
+        unsigned n_sets = 0;
+        for (unsigned q = 0; q < g_n_queues; ++q) sets[n_sets++] = &g_rxq[q].lat;
+#ifdef ITCH_SHARDS
+        for (unsigned k = 0; k < g_n_shards; ++k) sets[n_sets++] = &g_shards[k].lat;
+#endif
+        lat_report.print(sets, n_sets);
+#endif
+        fflush(stdout);
+    }
+    return nullptr;
+}
+
+#endif // ITCH_PRINT
+
+#endif // ITCH5_RX_H_INCLUDED
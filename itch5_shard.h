@@ -0,0 +1,317 @@
+/**
+ * itch5_shard.h
+ *
+ * Symbol-sharded fan-out from the decoder to K book-builder threads: every
+ * message that names a stock goes to the one shard that owns its
+ * stock_locate, so each symbol's book is built on one core and stays in that
+ * core's caches.
+ *
+ * ShardTable maps stock_locate -> shard.  Shards [0, hot) are reserved for
+ * hot symbols, one each; every other locate lands on the cold shards
+ * [hot, K) by locate modulo their count, which balances well since NASDAQ
+ * hands out locates densely from 1.  The table starts out with that modulo
+ * mapping and is rebuilt entry by entry from the Stock Directory messages
+ * at the start of the day, which is where a hot symbol's locate is learnt.
+ * A hot symbol is given by name, matched on its directory message, or as a
+ * bare stock_locate, isolated from the start.
+ *
+ * ShardRouter<Lane> is an ItchHandler (itch5_parse.h) that copies each
+ * decoded message into a ShardMsg and pushes it onto the lane of its shard;
+ * a market-wide System Event goes to every shard.  A lane is any SPSC ring
+ * with push(const ShardMsg&); one per (producer, shard) pair, so a lane
+ * never has more than one writer.  shard_apply() hands a popped ShardMsg to
+ * a shard-side handler's callback.
+ *
+ * shard_apply_batch() applies a run of them in two phases when the handler
+ * can prefetch (ItchBook::prefetch, itch5_book.h): SHARD_BATCH messages are
+ * prefetched stage by stage, then applied in order, so their cache misses
+ * overlap.  ShardBatch<H> puts the same in front of a handler on the
+ * decoder's side of things: it collects what the walker decodes and applies
+ * it on flush(), after each datagram.  The receiver's and the ingest's
+ * shards only apply in two phases when built with -DSHARD_PREFETCH; where
+ * the books fit in cache it is slower than applying message by message
+ * (itch5_book_bench, book against 2phase).
+ *
+ * Ordering: a symbol's messages travel one lane, in the order the decoder
+ * saw them.  Messages for different shards are not ordered with respect to
+ * each other, which a book per symbol does not need.
+ */
+
+#ifndef ITCH5_SHARD_H_INCLUDED
+#define ITCH5_SHARD_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <concepts>
+#include <immintrin.h>          // _mm_pause
+
+#include "itch5_avx.h"
+#include "itch5_latency.h"
+
+static constexpr unsigned SHARD_MAX = 16;
+static constexpr uint8_t  SHARD_CHECKPOINT = 0x01;    // control: a checkpoint cut (itch5_rx.h)
+
+// ─── Lane element ────────────────────────────────────────────────────────────
+
+// One decoded message; type is the ITCH message type character.  Under
+// RX_LATENCY it also carries the TSC it was pushed at, for the book stage.
+struct ShardMsg {
+    union {
+        DecodedAddOrder          add;
+        DecodedExecuteOrder      execute;
+        DecodedDeleteOrder       del;
+        DecodedExecuteOrderPrice execute_price;
+        DecodedCancelOrder       cancel;
+        DecodedReplaceOrder      replace;
+        DecodedTrade             trade;
+        DecodedCrossTrade        cross_trade;
+        DecodedBrokenTrade       broken_trade;
+        DecodedSystemEvent       system_event;
+        DecodedStockDirectory    directory;
+    };
+    uint8_t type;
+#ifdef RX_LATENCY
+    uint64_t stamp_tsc;
+#endif
+};
+
+// Delivers m to whichever of h's callbacks takes its type; as with the
+// walker (itch5_parse.h), only the A / E / D ones are required.
+#define SHARD_APPLY_CASE(TYPE, CALLBACK, FIELD)                                 \
+    case TYPE:                                                                  \
+        if constexpr (requires { h.CALLBACK(m.FIELD); }) h.CALLBACK(m.FIELD);   \
+        break;
+
+template<class H>
+static inline void shard_apply(const ShardMsg& m, H& h) noexcept {
+    switch (m.type) {
+        case 'A': h.on_add_order(m.add);                  break;
+        case 'E': h.on_execute(m.execute);                break;
+        case 'D': h.on_delete(m.del);                     break;
+        SHARD_APPLY_CASE('C', on_execute_price,   execute_price)
+        SHARD_APPLY_CASE('X', on_cancel,          cancel)
+        SHARD_APPLY_CASE('U', on_replace,         replace)
+        SHARD_APPLY_CASE('P', on_trade,           trade)
+        SHARD_APPLY_CASE('Q', on_cross_trade,     cross_trade)
+        SHARD_APPLY_CASE('B', on_broken_trade,    broken_trade)
+        SHARD_APPLY_CASE('S', on_system_event,    system_event)
+        SHARD_APPLY_CASE('R', on_stock_directory, directory)
+        default:                                          break;
+    }
+}
+
+#undef SHARD_APPLY_CASE
+
+// ─── Two-phase apply ─────────────────────────────────────────────────────────
+
+static constexpr size_t SHARD_BATCH = 32;     // messages prefetched ahead of applying them
+
+// A handler that can fetch a message's book state ahead of applying it.
+template<class H>
+concept ShardPrefetcher = requires(const H& h, const DecodedAddOrder& a) {
+    { H::PREFETCH_STAGES } -> std::convertible_to<unsigned>;
+    { h.prefetch(a, 0u) } noexcept;
+};
+
+template<ShardPrefetcher H>
+static inline void shard_prefetch(const ShardMsg& m, const unsigned stage, const H& h) noexcept {
+    switch (m.type) {
+        case 'A': h.prefetch(m.add, stage);               break;
+        case 'E': h.prefetch(m.execute, stage);           break;
+        case 'D': h.prefetch(m.del, stage);               break;
+        case 'C': h.prefetch(m.execute_price, stage);     break;
+        case 'X': h.prefetch(m.cancel, stage);            break;
+        case 'U': h.prefetch(m.replace, stage);           break;
+        default:                                          break;
+    }
+}
+
+// Applies m[0..n) in order.  For a ShardPrefetcher, each SHARD_BATCH of them
+// gets every prefetch stage first, a pass over the batch per stage.
+template<class H>
+static inline void shard_apply_batch(const ShardMsg* m, const size_t n, H& h) noexcept {
+    for (size_t base = 0; base < n; base += SHARD_BATCH) {
+        const size_t end = n - base < SHARD_BATCH ? n : base + SHARD_BATCH;
+        if constexpr (ShardPrefetcher<H>)
+            for (unsigned stage = 0; stage < H::PREFETCH_STAGES; ++stage)
+                for (size_t i = base; i < end; ++i) shard_prefetch(m[i], stage, h);
+        for (size_t i = base; i < end; ++i) shard_apply(m[i], h);
+    }
+}
+
+// An ItchHandler in front of h: keeps what the walker decodes and applies
+// it through shard_apply_batch on flush(), which the caller makes after
+// every datagram, and whenever SHARD_BATCH are waiting.  It takes the types
+// h takes, so the walker skips the rest undecoded as it would for h.
+template<class H>
+class ShardBatch {
+public:
+    explicit ShardBatch(H& h) noexcept : m_h(h) {}
+
+    void on_add_order(const DecodedAddOrder& m) noexcept                { keep('A', &ShardMsg::add, m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept              { keep('E', &ShardMsg::execute, m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                { keep('D', &ShardMsg::del, m); }
+
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept requires requires(H& h) { h.on_execute_price(m); }
+    { keep('C', &ShardMsg::execute_price, m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept requires requires(H& h) { h.on_cancel(m); }
+    { keep('X', &ShardMsg::cancel, m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept requires requires(H& h) { h.on_replace(m); }
+    { keep('U', &ShardMsg::replace, m); }
+    void on_trade(const DecodedTrade& m) noexcept requires requires(H& h) { h.on_trade(m); }
+    { keep('P', &ShardMsg::trade, m); }
+    void on_cross_trade(const DecodedCrossTrade& m) noexcept requires requires(H& h) { h.on_cross_trade(m); }
+    { keep('Q', &ShardMsg::cross_trade, m); }
+    void on_broken_trade(const DecodedBrokenTrade& m) noexcept requires requires(H& h) { h.on_broken_trade(m); }
+    { keep('B', &ShardMsg::broken_trade, m); }
+    void on_system_event(const DecodedSystemEvent& m) noexcept requires requires(H& h) { h.on_system_event(m); }
+    { keep('S', &ShardMsg::system_event, m); }
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept requires requires(H& h) { h.on_stock_directory(m); }
+    { keep('R', &ShardMsg::directory, m); }
+
+    void flush() noexcept {
+        shard_apply_batch(m_run, m_n, m_h);
+        m_n = 0;
+    }
+
+private:
+    template<class M>
+    [[gnu::always_inline]] void keep(const uint8_t type, M ShardMsg::* field, const M& m) noexcept {
+        m_run[m_n].*field = m;
+        m_run[m_n].type = type;
+        if (++m_n == SHARD_BATCH) flush();
+    }
+
+    H&       m_h;
+    size_t   m_n{0};
+    ShardMsg m_run[SHARD_BATCH];
+};
+
+// ─── Routing table ───────────────────────────────────────────────────────────
+
+class ShardTable {
+public:
+    ShardTable() { configure(1, nullptr); }
+
+    // shards total, of which one per hot symbol in hot_list ("AAPL,NVDA,17":
+    // symbols, or stock_locates if all digits).  The hot symbols beyond
+    // shards - 1 stay cold; there must be a cold shard for everything else.
+    void configure(const unsigned shards, const char* hot_list) {
+        m_shards = shards < 1 ? 1 : shards > SHARD_MAX ? SHARD_MAX : shards;
+        m_hot = 0;
+        for (const char* p = hot_list; p && *p && m_hot + 1 < m_shards;) {
+            const char* comma = strchr(p, ',');
+            const size_t n = comma ? static_cast<size_t>(comma - p) : strlen(p);
+            if (n > 0 && n < sizeof(m_hot_name[0])) {
+                memcpy(m_hot_name[m_hot], p, n);
+                m_hot_name[m_hot][n] = '\0';
+                m_hot_locate[m_hot] = n == strspn(p, "0123456789") ? static_cast<uint16_t>(atoi(p)) : 0;
+                ++m_hot;
+            }
+            p = comma ? comma + 1 : p + n;
+        }
+        for (uint32_t l = 0; l < 65536; ++l) m_shard[l] = cold(static_cast<uint16_t>(l));
+        for (unsigned h = 0; h < m_hot; ++h)
+            if (m_hot_locate[h]) m_shard[m_hot_locate[h]] = static_cast<uint8_t>(h);
+    }
+
+    unsigned shards() const noexcept { return m_shards; }
+    unsigned hot() const noexcept    { return m_hot; }
+    const char* hot_name(const unsigned h) const noexcept { return m_hot_name[h]; }
+
+    unsigned shard(const uint16_t locate) const noexcept { return m_shard[locate]; }
+
+    // A directory entry (re)declares locate: hot if its name is on the list,
+    // else back to its cold shard.
+    void on_directory(const DecodedStockDirectory& m) noexcept {
+        char name[9];
+        size_t n = strnlen(m.stock, 8);
+        while (n && m.stock[n - 1] == ' ') --n;
+        memcpy(name, m.stock, n);
+        name[n] = '\0';
+        uint8_t s = cold(m.stock_locate);
+        for (unsigned h = 0; h < m_hot; ++h)
+            if (m_hot_locate[h] ? m_hot_locate[h] == m.stock_locate : strcmp(m_hot_name[h], name) == 0)
+                s = static_cast<uint8_t>(h);
+        m_shard[m.stock_locate] = s;
+    }
+
+private:
+    uint8_t cold(const uint16_t locate) const noexcept {
+        return static_cast<uint8_t>(m_hot + locate % (m_shards - m_hot));
+    }
+
+    uint8_t  m_shard[65536];
+    unsigned m_shards{1};
+    unsigned m_hot{0};
+    char     m_hot_name[SHARD_MAX][9]{};
+    uint16_t m_hot_locate[SHARD_MAX]{};     // 0: matched by name
+};
+
+// ─── Router ──────────────────────────────────────────────────────────────────
+
+template<class Lane>
+class ShardRouter {
+public:
+    // lanes[k] carries shard k's messages from this router; the table is
+    // configured already.
+    void bind(Lane* lanes, const ShardTable& table) noexcept {
+        m_lanes = lanes;
+        m_table = table;
+    }
+
+    const ShardTable& table() const noexcept { return m_table; }
+
+    void on_add_order(const DecodedAddOrder& m) noexcept                { route(m.stock_locate, 'A', &ShardMsg::add, m); }
+    void on_execute(const DecodedExecuteOrder& m) noexcept              { route(m.stock_locate, 'E', &ShardMsg::execute, m); }
+    void on_delete(const DecodedDeleteOrder& m) noexcept                { route(m.stock_locate, 'D', &ShardMsg::del, m); }
+    void on_execute_price(const DecodedExecuteOrderPrice& m) noexcept   { route(m.stock_locate, 'C', &ShardMsg::execute_price, m); }
+    void on_cancel(const DecodedCancelOrder& m) noexcept                { route(m.stock_locate, 'X', &ShardMsg::cancel, m); }
+    void on_replace(const DecodedReplaceOrder& m) noexcept              { route(m.stock_locate, 'U', &ShardMsg::replace, m); }
+    void on_trade(const DecodedTrade& m) noexcept                       { route(m.stock_locate, 'P', &ShardMsg::trade, m); }
+    void on_cross_trade(const DecodedCrossTrade& m) noexcept            { route(m.stock_locate, 'Q', &ShardMsg::cross_trade, m); }
+    void on_broken_trade(const DecodedBrokenTrade& m) noexcept          { route(m.stock_locate, 'B', &ShardMsg::broken_trade, m); }
+
+    void on_stock_directory(const DecodedStockDirectory& m) noexcept {
+        m_table.on_directory(m);
+        route(m.stock_locate, 'R', &ShardMsg::directory, m);
+    }
+
+    void on_system_event(const DecodedSystemEvent& m) noexcept {
+        ShardMsg msg;
+        msg.system_event = m;
+        msg.type = 'S';
+        for (unsigned k = 0; k < m_table.shards(); ++k) push(k, msg);
+    }
+
+    // A control message to every shard, type outside the ITCH types (such
+    // as SHARD_CHECKPOINT), in line with the messages routed so far.
+    void broadcast(const uint8_t type) noexcept {
+        ShardMsg msg;
+        msg.type = type;
+        for (unsigned k = 0; k < m_table.shards(); ++k) push(k, msg);
+    }
+
+private:
+    template<class M>
+    [[gnu::always_inline]] void route(const uint16_t locate, const uint8_t type, M ShardMsg::* field, const M& m) noexcept {
+        ShardMsg msg;
+        msg.*field = m;
+        msg.type = type;
+        push(m_table.shard(locate), msg);
+    }
+
+    void push(const unsigned k, ShardMsg& msg) noexcept {
+#ifdef RX_LATENCY
+        msg.stamp_tsc = lat_tsc();
+#endif
+        while (!m_lanes[k].push(msg)) _mm_pause();      // back-pressure spin
+    }
+
+    Lane*      m_lanes{nullptr};
+    ShardTable m_table;
+};
+
+#endif // ITCH5_SHARD_H_INCLUDED
@@ -0,0 +1,331 @@
+/**
+ * itch5_soa.h
+ *
+ * Batched decode of a whole MoldUDP64 datagram into structure-of-arrays form,
+ * for book stages that want a packet's worth of updates at once instead of
+ * one handler call per message (itch5_parse.h).
+ *
+ * decode_datagram_soa(pkt, len, ItchSoA&) runs in two phases:
+ *   walk     scalar: follows the length prefixes (a serial dependency chain
+ *            no SIMD can break), recording each message's body offset, its
+ *            type and a per-type field layout word from soa_layout[]
+ *   fields   per ISA level: for 8 (AVX2) or 16 (AVX-512) messages at a time,
+ *            every field is fetched with one masked VPGATHERDD / VPGATHERDQ
+ *            at body offset + field offset and byte-swapped with one VPSHUFB,
+ *            whatever mix of types the block holds.  Lanes whose type has no
+ *            such field are masked off and read as 0.
+ *
+ * The arrays cover what a book needs:
+ *   type[]       raw type byte (0 if the message is shorter than its type's spec length)
+ *   locate[]     stock_locate            every ITCH 5.0 type
+ *   ts[]         timestamp, ns           every ITCH 5.0 type
+ *   order_ref[]  order_ref               A F E C X D U(original) P
+ *   new_ref[]    new order_ref           U
+ *   shares[]     shares / executed / cancelled   A F P E C X U
+ *   price[]      price ×10000            A F P C U
+ *   side[]       'B' / 'S'               A F P
+ *   off[]        body offset in pkt, so the other types (and the other
+ *                fields) can still be decoded with the itch5_avx.h decoders
+ *
+ * A 1500-byte MTU datagram holds at most (1500 - 42 - 20) / 14 = 102 messages,
+ * well inside ITCH_SOA_CAP; messages past the cap are counted in `dropped`.
+ * Gathers read 4 / 8 bytes at fixed offsets of each message, so like the
+ * shuffle decoders they may read up to 8 bytes past the last message; the RX
+ * buffers (2 KB ef_vi / ITCH_GEN_SLOT) always have that slack.
+ */
+
+#ifndef ITCH5_SOA_H_INCLUDED
+#define ITCH5_SOA_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "IsaDispatch.h"
+#include "itch5_avx.h"
+
+static constexpr uint32_t ITCH_SOA_CAP = 256;      // multiple of 16: the AVX-512 loop runs whole blocks
+
+struct ItchSoA {
+    uint32_t n{0};                  // messages decoded
+    uint32_t dropped{0};            // messages past ITCH_SOA_CAP
+    uint64_t seqno{0};              // of message 0
+
+    alignas(64) uint64_t order_ref[ITCH_SOA_CAP];
+    alignas(64) uint64_t new_ref[ITCH_SOA_CAP];
+    alignas(64) uint64_t ts[ITCH_SOA_CAP];
+    alignas(64) uint32_t shares[ITCH_SOA_CAP];
+    alignas(64) uint32_t price[ITCH_SOA_CAP];
+    alignas(64) uint32_t off[ITCH_SOA_CAP];
+    alignas(64) uint32_t layout[ITCH_SOA_CAP];   // soa_layout[type], filled by the walk
+    alignas(64) uint16_t locate[ITCH_SOA_CAP];
+    alignas(64) uint8_t  type[ITCH_SOA_CAP];
+    alignas(64) uint8_t  side[ITCH_SOA_CAP];
+};
+
+// ─── Per-type field layout ───────────────────────────────────────────────────
+//
+// One 32-bit word per type byte:
+//   bits  0- 7  body offset of shares (0 = none; offset 0 is the type byte)
+//   bits  8-15  body offset of price  (0 = none)
+//   bit  16     header: locate @1, timestamp @5   (every ITCH 5.0 type)
+//   bit  17     order_ref @11
+//   bit  18     new_ref @19
+//   bit  19     side @19
+// A block of messages turns these into gather masks and offsets with a few
+// shifts and compares, without a table gather per field.
+
+static constexpr uint32_t SOA_HDR     = 1u << 16;
+static constexpr uint32_t SOA_REF     = 1u << 17;
+static constexpr uint32_t SOA_NEW_REF = 1u << 18;
+static constexpr uint32_t SOA_SIDE    = 1u << 19;
+
+static constexpr uint32_t soa_layout_of(const uint8_t type) noexcept {
+    if (itch_msg_len(type) == 0) return 0;
+    const auto layout = [](const uint32_t shares, const uint32_t price, const uint32_t flags) {
+        return shares | price << 8 | SOA_HDR | flags;
+    };
+    switch (static_cast<MsgType>(type)) {
+        case MsgType::AddOrder:
+        case MsgType::AddOrderMPID:      return layout(20, 32, SOA_REF | SOA_SIDE);
+        case MsgType::Trade:             return layout(20, 32, SOA_REF | SOA_SIDE);
+        case MsgType::ExecuteOrder:      return layout(19,  0, SOA_REF);
+        case MsgType::ExecuteOrderPrice: return layout(19, 32, SOA_REF);
+        case MsgType::CancelOrder:       return layout(19,  0, SOA_REF);
+        case MsgType::DeleteOrder:       return layout( 0,  0, SOA_REF);
+        case MsgType::ReplaceOrder:      return layout(27, 31, SOA_REF | SOA_NEW_REF);
+        default:                         return layout( 0,  0, 0);
+    }
+}
+
+struct SoaLayoutTable { uint32_t v[256]; };
+alignas(64) static constexpr SoaLayoutTable soa_layout = [] {
+    SoaLayoutTable t{};
+    for (int i = 0; i < 256; ++i) t.v[i] = soa_layout_of(static_cast<uint8_t>(i));
+    return t;
+}();
+
+// ─── Phase 1: walk the message blocks ────────────────────────────────────────
+
+// Fills n, seqno, off[], type[], layout[]; layout[] is zeroed up to the next
+// multiple of 16 so the vector loops can run whole blocks with every padding
+// lane masked off.
+static inline void soa_walk(const uint8_t* pkt, const uint32_t len, ItchSoA& b) noexcept {
+    b.n = b.dropped = 0;
+    if (len < MOLD_HDR_LEN) return;
+
+    b.seqno = be64(pkt + 10);
+    uint16_t msg_count = be16(pkt + 18);
+
+    const uint8_t* cur = pkt + MOLD_HDR_LEN;
+    const uint8_t* end = pkt + len;
+    uint32_t n = 0;
+    while (msg_count && cur + 3 <= end) {
+        const uint16_t mlen = be16(cur);
+        if (mlen < 1 || cur + 2 + mlen > end) break;
+        if (n == ITCH_SOA_CAP) { b.dropped = msg_count; break; }
+        --msg_count;
+
+        const uint8_t type = cur[2];
+        const bool    whole = mlen >= itch_msg_len(type);
+        b.off[n]    = static_cast<uint32_t>(cur + 2 - pkt);
+        b.type[n]   = whole ? type : 0;
+        b.layout[n] = whole ? soa_layout.v[type] : 0;
+        ++n;
+        cur += 2 + mlen;
+    }
+    b.n = n;
+    for (uint32_t i = n; i < ((n + 15) & ~15u); ++i) {
+        b.layout[i] = 0;
+        b.off[i]    = 0;
+        b.type[i]   = 0;
+    }
+}
+
+// ─── Phase 2: the fields ─────────────────────────────────────────────────────
+
+static inline void soa_fields_scalar(const uint8_t* pkt, ItchSoA& b) noexcept {
+    for (uint32_t i = 0; i < b.n; ++i) {
+        const uint8_t* m = pkt + b.off[i];
+        const uint32_t l = b.layout[i];
+        const uint32_t shares_at = l & 0xFF, price_at = (l >> 8) & 0xFF;
+        b.locate[i]    = (l & SOA_HDR)     ? be16(m + 1)  : 0;
+        b.ts[i]        = (l & SOA_HDR)     ? be48(m + 5)  : 0;
+        b.order_ref[i] = (l & SOA_REF)     ? be64(m + 11) : 0;
+        b.new_ref[i]   = (l & SOA_NEW_REF) ? be64(m + 19) : 0;
+        b.side[i]      = (l & SOA_SIDE)    ? m[19]        : 0;
+        b.shares[i]    = shares_at ? be32(m + shares_at) : 0;
+        b.price[i]     = price_at  ? be32(m + price_at)  : 0;
+    }
+}
+
+// 8 messages per block.  The u64 fields need two 4-lane VPGATHERDQ each, the
+// u32 ones one 8-lane VPGATHERDD; the mask of the u64 gathers is the u32 mask
+// sign-extended.  (Helpers rather than lambdas: a lambda does not inherit the
+// enclosing function's [[gnu::target]].)
+
+[[gnu::target("avx2"), gnu::always_inline]]
+static inline __m256i soa_bswap32_avx2(const __m256i v) noexcept {
+    return _mm256_shuffle_epi8(v, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11,10, 9, 8, 15,14,13,12,
+                                                   3, 2, 1, 0, 7, 6, 5, 4, 11,10, 9, 8, 15,14,13,12));
+}
+
+[[gnu::target("avx2"), gnu::always_inline]]
+static inline __m256i soa_flag_mask_avx2(const __m256i layout, const uint32_t flag) noexcept {
+    const __m256i f = _mm256_set1_epi32(static_cast<int>(flag));
+    return _mm256_cmpeq_epi32(_mm256_and_si256(layout, f), f);
+}
+
+// 8 u32s at pkt + idx (masked lanes read as 0), byte-swapped
+[[gnu::target("avx2"), gnu::always_inline]]
+static inline __m256i soa_gather32_avx2(const uint8_t* pkt, const __m256i idx, const __m256i mask) noexcept {
+    return soa_bswap32_avx2(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(pkt),
+                                                         idx, mask, 1));
+}
+
+// 8 u64s at pkt + off + at, byte-swapped and shifted right, into dst[0..7]
+[[gnu::target("avx2"), gnu::always_inline]]
+static inline void soa_gather64_avx2(const uint8_t* pkt, const __m256i off, const __m256i mask, const int at,
+                                     uint64_t* dst, const int shift) noexcept {
+    const __m256i bswap64 = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15,14,13,12,11,10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0, 15,14,13,12,11,10, 9, 8);
+    const auto*   base = reinterpret_cast<const long long*>(pkt);
+    const __m256i idx  = _mm256_add_epi32(off, _mm256_set1_epi32(at));
+    const __m256i lo = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), base, _mm256_castsi256_si128(idx),
+                                                   _mm256_cvtepi32_epi64(_mm256_castsi256_si128(mask)), 1);
+    const __m256i hi = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), base, _mm256_extracti128_si256(idx, 1),
+                                                   _mm256_cvtepi32_epi64(_mm256_extracti128_si256(mask, 1)), 1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst),     _mm256_srli_epi64(_mm256_shuffle_epi8(lo, bswap64), shift));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 4), _mm256_srli_epi64(_mm256_shuffle_epi8(hi, bswap64), shift));
+}
+
+// 8 u32 lanes (each < 2^16) → 8 packed u16
+[[gnu::target("avx2"), gnu::always_inline]]
+static inline __m128i soa_pack16_avx2(const __m256i v) noexcept {
+    return _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+[[gnu::target("avx2")]]
+static inline void soa_fields_avx2(const uint8_t* pkt, ItchSoA& b) noexcept {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i xff  = _mm256_set1_epi32(0xFF);
+
+    for (uint32_t i = 0; i < b.n; i += 8) {
+        const __m256i layout = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.layout + i));
+        const __m256i off    = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.off + i));
+
+        const __m256i hdr = soa_flag_mask_avx2(layout, SOA_HDR);
+        // [1-4] = locate, tracking; after the bswap locate is the high half
+        const __m256i lt = soa_gather32_avx2(pkt, _mm256_add_epi32(off, _mm256_set1_epi32(1)), hdr);
+        _mm_store_si128(reinterpret_cast<__m128i*>(b.locate + i), soa_pack16_avx2(_mm256_srli_epi32(lt, 16)));
+        soa_gather64_avx2(pkt, off, hdr, 5, b.ts + i, 16);
+
+        soa_gather64_avx2(pkt, off, soa_flag_mask_avx2(layout, SOA_REF), 11, b.order_ref + i, 0);
+        soa_gather64_avx2(pkt, off, soa_flag_mask_avx2(layout, SOA_NEW_REF), 19, b.new_ref + i, 0);
+
+        const __m256i shares_at = _mm256_and_si256(layout, xff);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b.shares + i),
+                           soa_gather32_avx2(pkt, _mm256_add_epi32(off, shares_at), _mm256_cmpgt_epi32(shares_at, zero)));
+
+        const __m256i price_at = _mm256_and_si256(_mm256_srli_epi32(layout, 8), xff);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b.price + i),
+                           soa_gather32_avx2(pkt, _mm256_add_epi32(off, price_at), _mm256_cmpgt_epi32(price_at, zero)));
+
+        // side is byte 19: after the bswap it is the top byte of the lane
+        const __m256i side = _mm256_srli_epi32(soa_gather32_avx2(pkt, _mm256_add_epi32(off, _mm256_set1_epi32(19)),
+                                                                 soa_flag_mask_avx2(layout, SOA_SIDE)), 24);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(b.side + i), _mm_packus_epi16(soa_pack16_avx2(side), _mm_setzero_si128()));
+    }
+}
+
+// 16 messages per block; k-masks come straight from VPTESTMD and the narrow
+// fields are stored with VPMOVDW / VPMOVDB.  Shifts, narrows and extracts use
+// the all-ones maskz forms: GCC 12 builds the unmasked ones on
+// _mm512_undefined_*(), which trips -Wmaybe-uninitialized at every call site.
+
+[[gnu::target("avx512f,avx512bw,avx512vl"), gnu::always_inline]]
+static inline __m512i soa_gather32_avx512(const uint8_t* pkt, const __m512i idx, const __mmask16 k) noexcept {
+    const __m512i bswap32 = _mm512_set4_epi32(0x0C0D0E0F, 0x08090A0B, 0x04050607, 0x00010203);
+    return _mm512_shuffle_epi8(_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), k, idx, pkt, 1), bswap32);
+}
+
+[[gnu::target("avx512f,avx512bw,avx512vl"), gnu::always_inline]]
+static inline void soa_gather64_avx512(const uint8_t* pkt, const __m512i off, const __mmask16 k, const int at,
+                                       uint64_t* dst, const int shift) noexcept {
+    const __m512i bswap64 = _mm512_set4_epi32(0x08090A0B, 0x0C0D0E0F, 0x00010203, 0x04050607);
+    const __m512i idx = _mm512_add_epi32(off, _mm512_set1_epi32(at));
+    const __m512i lo = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), static_cast<__mmask8>(k),
+                                                   _mm512_maskz_extracti64x4_epi64(0xFF, idx, 0), pkt, 1);
+    const __m512i hi = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), static_cast<__mmask8>(k >> 8),
+                                                   _mm512_maskz_extracti64x4_epi64(0xFF, idx, 1), pkt, 1);
+    _mm512_store_si512(dst,     _mm512_maskz_srli_epi64(0xFF, _mm512_shuffle_epi8(lo, bswap64), shift));
+    _mm512_store_si512(dst + 8, _mm512_maskz_srli_epi64(0xFF, _mm512_shuffle_epi8(hi, bswap64), shift));
+}
+
+[[gnu::target("avx512f,avx512bw,avx512vl")]]
+static inline void soa_fields_avx512(const uint8_t* pkt, ItchSoA& b) noexcept {
+    const __m512i xff = _mm512_set1_epi32(0xFF);
+
+    for (uint32_t i = 0; i < b.n; i += 16) {
+        const __m512i layout = _mm512_load_si512(b.layout + i);
+        const __m512i off    = _mm512_load_si512(b.off + i);
+
+        const __mmask16 hdr = _mm512_test_epi32_mask(layout, _mm512_set1_epi32(SOA_HDR));
+        const __m512i lt = soa_gather32_avx512(pkt, _mm512_add_epi32(off, _mm512_set1_epi32(1)), hdr);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b.locate + i), _mm512_maskz_cvtepi32_epi16(0xFFFF, _mm512_maskz_srli_epi32(0xFFFF, lt, 16)));
+        soa_gather64_avx512(pkt, off, hdr, 5, b.ts + i, 16);
+
+        soa_gather64_avx512(pkt, off, _mm512_test_epi32_mask(layout, _mm512_set1_epi32(SOA_REF)), 11, b.order_ref + i, 0);
+        soa_gather64_avx512(pkt, off, _mm512_test_epi32_mask(layout, _mm512_set1_epi32(SOA_NEW_REF)), 19, b.new_ref + i, 0);
+
+        const __m512i shares_at = _mm512_and_si512(layout, xff);
+        _mm512_store_si512(b.shares + i, soa_gather32_avx512(pkt, _mm512_add_epi32(off, shares_at),
+                                                             _mm512_test_epi32_mask(shares_at, shares_at)));
+
+        const __m512i price_at = _mm512_and_si512(_mm512_maskz_srli_epi32(0xFFFF, layout, 8), xff);
+        _mm512_store_si512(b.price + i, soa_gather32_avx512(pkt, _mm512_add_epi32(off, price_at),
+                                                            _mm512_test_epi32_mask(price_at, price_at)));
+
+        const __m512i side = soa_gather32_avx512(pkt, _mm512_add_epi32(off, _mm512_set1_epi32(19)),
+                                                 _mm512_test_epi32_mask(layout, _mm512_set1_epi32(SOA_SIDE)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(b.side + i), _mm512_maskz_cvtepi32_epi8(0xFFFF, _mm512_maskz_srli_epi32(0xFFFF, side, 24)));
+    }
+}
+
+// ─── Per-ISA entry points ────────────────────────────────────────────────────
+//
+// Returns b.n.  There is no SSE4.2 variant (no gathers below AVX2); that level
+// falls back to the scalar one.
+
+static uint32_t decode_datagram_soa_scalar(const uint8_t* pkt, uint32_t len, ItchSoA& b) noexcept {
+    soa_walk(pkt, len, b);
+    soa_fields_scalar(pkt, b);
+    return b.n;
+}
+
+[[gnu::target("avx2")]]
+static uint32_t decode_datagram_soa_avx2(const uint8_t* pkt, uint32_t len, ItchSoA& b) noexcept {
+    soa_walk(pkt, len, b);
+    soa_fields_avx2(pkt, b);
+    return b.n;
+}
+
+[[gnu::target("avx512f,avx512bw,avx512vl")]]
+static uint32_t decode_datagram_soa_avx512(const uint8_t* pkt, uint32_t len, ItchSoA& b) noexcept {
+    soa_walk(pkt, len, b);
+    soa_fields_avx512(pkt, b);
+    return b.n;
+}
+
+using DecodeDatagramSoaFn = uint32_t(const uint8_t*, uint32_t, ItchSoA&) noexcept;
+
+static ISADISPATCH::IsaVariants<DecodeDatagramSoaFn> decode_datagram_soa_variants() noexcept {
+    return {{ decode_datagram_soa_scalar, nullptr, decode_datagram_soa_avx2, decode_datagram_soa_avx512 }};
+}
+
+[[maybe_unused]] static DecodeDatagramSoaFn* decode_datagram_soa_pick() noexcept {
+    return ISADISPATCH::isa_pick(decode_datagram_soa_variants());
+}
+
+#endif // ITCH5_SOA_H_INCLUDED
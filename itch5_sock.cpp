@@ -0,0 +1,688 @@
+/**
+ * itch5_sock.cpp
+ *
+ * ITCH 5.0 receiver on plain kernel sockets, for boxes without a Solarflare
+ * card and for the test lab.  Same ring, consumer thread and handlers as
+ * itch5_efvi.cpp (itch5_rx.h); only the receive side differs:
+ *
+ *   mmsg   UDP socket joined to the group, recvmmsg() batches of up to
+ *          RX_BATCH datagrams straight into 2 KB buffers.  One copy (kernel
+ *          to user) and lowest latency; the default.
+ *   tpv3   AF_PACKET TPACKET_V3 ring mmapped from the kernel: frames land in
+ *          RING_BLOCK_SIZE blocks and are parsed in place, a block goes back
+ *          to the kernel once the consumer has finished its last datagram.
+ *          No copy and fewer syscalls, but a block only reaches user space
+ *          when it is full or BLOCK_TIMEOUT_MS has passed, so it suits
+ *          throughput runs better than latency ones.  Needs CAP_NET_RAW.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 itch5_sock.cpp -o itch5_sock -lpthread
+ *
+ * Run:
+ *   ./itch5_sock eth1 239.192.0.1 26000 [mmsg|tpv3] [trace-file]
+ *   ./itch5_sock eth1 239.192.0.1,239.192.0.2 26000 [mmsg] [trace-file]
+ *   ./itch5_sock eth1 239.192.0.1+239.192.0.3@2/239.192.0.5@3 26000 [mmsg|tpv3]
+ *
+ * Two groups are the A and B lines of one feed (mmsg only): one socket and
+ * buffer pool per line, each feeding its own ring, and the consumer
+ * arbitrates between them (itch5_mold.h).
+ *
+ * The group argument is a queue map (itch5_rx.h, rx_parse_queues), one
+ * consumer thread per queue on the core given.  mmsg: a socket per queue
+ * and line, joined to that line's groups.  tpv3: a packet ring per queue,
+ * all of them members of one PACKET_FANOUT group whose classic BPF program
+ * steers each frame to the ring of the queue its destination group belongs
+ * to.  The poll loop services every queue's sockets.
+ *
+ * Loopback lab run on one machine (lo needs the multicast flag:
+ * `ip link set lo multicast on`):
+ *   ./itch5_sock lo 239.192.0.1 26000 mmsg &
+ *   ./itch5_sock lo 239.192.0.1 26000 send [msgs] [datagrams-per-second] [loss-%]
+ * `send` multicasts a synthetic feed (itch5_gen.h) out of the interface with
+ * loopback enabled, the same feed to every group of the queue map; the
+ * receiver's stats line should count every message once per line A group.
+ * Given two groups it sends every datagram on both lines, and loss-% drops
+ * that share of each line's datagrams at random, independently, to exercise
+ * the arbiter: only datagrams lost on both lines should show up as gaps.
+ *
+ * The sender doubles as the stand-in MoldUDP64 re-request server, on UDP
+ * port + 1: it answers each request out of the generated feed, for as long
+ * as it sends and a few seconds after.  Start the receiver with
+ * MOLD_REREQUEST=127.0.0.1:26001 (itch5_rx.h) and the gaps are recovered
+ * instead of declared.
+ *
+ * -DRX_LATENCY (itch5_latency.h): mmsg asks for SO_TIMESTAMPING receive
+ * stamps, hardware ones if the NIC has been told to stamp (hwstamp_ctl)
+ * and its clock is synced to the system's, else the kernel's software ones;
+ * tpv3 takes the block's per-frame stamp, hardware too where available.
+ *
+ * -DTRACE_PROBES, -DITCH_PRINT, -DITCH_SHARDS, -DRX_LATENCY and ISA_FORCE
+ * work as for itch5_efvi.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <atomic>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <random>
+#include <vector>
+#include <immintrin.h>          // _mm_pause
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>     // scm_timestamping
+#include <pthread.h>
+#include <unistd.h>
+
+#include "TraceProbe.h"
+#include "IsaDispatch.h"
+#include "itch5_rx.h"
+#include "itch5_frame.h"
+#include "itch5_gen.h"
+
+// ─── Constants ───────────────────────────────────────────────────────────────
+
+static constexpr int      PKT_BUF_SIZE     = 2048;      // per-buffer bytes (mmsg)
+static constexpr int      N_BUFS           = 1024;
+static constexpr unsigned RX_BATCH         = 64;        // datagrams per recvmmsg / ring push
+static constexpr uint32_t RING_BLOCK_SIZE  = 1u << 20;  // tpv3
+static constexpr uint32_t RING_BLOCKS      = 64;
+static constexpr uint32_t RING_FRAME_SIZE  = 2048;
+static constexpr uint32_t BLOCK_TIMEOUT_MS = 1;
+static constexpr int      SOCK_RCVBUF      = 64 << 20;
+
+enum class SockMode { Mmsg, Tpv3 };
+
+// ─── Socket state ────────────────────────────────────────────────────────────
+
+// One receive queue's sockets and buffers (itch5_rx.h).
+struct SockQueue {
+    int      fd[2]{-1, -1};     // mmsg: the UDP socket per line;  tpv3: fd[0], the packet socket
+    int      mcast_fd{-1};      // tpv3: UDP socket that only holds the group memberships
+    UdpFilter filter;
+
+    // mmsg: N_BUFS buffers per line, line B's ids follow line A's.  Buffer
+    // i of a line is reused for its datagram i + N_BUFS, once the consumer has
+    // released N_BUFS datagrams past it.  A line's datagrams are released in
+    // its ring's order, so a count per line is all the producer needs.
+    uint8_t*              pkt_mem{nullptr};
+    std::atomic<uint64_t> released[2]{};
+
+    // tpv3
+    uint8_t* ring{nullptr};
+    size_t   ring_len{0};
+
+    uint8_t* buf_ptr(int id) const {
+        return pkt_mem + (size_t)id * PKT_BUF_SIZE;
+    }
+    tpacket_block_desc* block(uint32_t b) const {
+        return reinterpret_cast<tpacket_block_desc*>(ring + (size_t)b * RING_BLOCK_SIZE);
+    }
+};
+
+struct SockState {
+    SockMode mode{SockMode::Mmsg};
+    std::array<SockQueue, RX_MAX_QUEUES> q;
+};
+
+static SockState g_sock;
+
+// Called by the consumer (itch5_rx.h) once a packet is parsed.
+//   mmsg: one more buffer free.
+//   tpv3: only the last datagram of a block carries the block number; the
+//         block goes back to the kernel with it.
+static void rx_release(const unsigned queue, const int buf_id) noexcept {
+    SockQueue& sq = g_sock.q[queue];
+    if (g_sock.mode == SockMode::Mmsg) {
+        std::atomic<uint64_t>& r = sq.released[buf_id >= N_BUFS];
+        r.store(r.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    } else if (buf_id >= 0) {
+        std::atomic_ref<uint32_t>(sq.block(buf_id)->hdr.bh1.block_status)
+            .store(TP_STATUS_KERNEL, std::memory_order_release);
+    }
+}
+
+// ─── Socket initialisation ───────────────────────────────────────────────────
+
+static unsigned iface_index(const char* iface) {
+    const unsigned idx = if_nametoindex(iface);
+    if (idx == 0) { perror(iface); exit(1); }
+    return idx;
+}
+
+// A UDP socket joined to groups on iface.  One group: bound to group:port,
+// so only that feed is delivered to it.  Several: bound to the port with
+// IP_MULTICAST_ALL off, so only the groups it joined are.
+static int mcast_socket(const char* iface, const char* const* groups, const unsigned n_groups, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) { perror("socket"); exit(1); }
+
+    int one = 1, zero = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    int rcvbuf = SOCK_RCVBUF;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));     // capped by net.core.rmem_max
+
+    struct ip_mreqn mreq{};
+    mreq.imr_ifindex = static_cast<int>(iface_index(iface));
+    for (unsigned i = 0; i < n_groups; ++i) {
+        if (inet_pton(AF_INET, groups[i], &mreq.imr_multiaddr) != 1) { fprintf(stderr, "bad mcast-group '%s'\n", groups[i]); exit(1); }
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) { perror("IP_ADD_MEMBERSHIP"); exit(1); }
+    }
+
+    struct sockaddr_in sin{};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    if (n_groups == 1) {
+        sin.sin_addr = mreq.imr_multiaddr;
+    } else {
+        sin.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &zero, sizeof(zero)) < 0) { perror("IP_MULTICAST_ALL"); exit(1); }
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&sin), sizeof(sin)) < 0) { perror("bind"); exit(1); }
+
+#ifdef RX_LATENCY
+    int ts_flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                   SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &ts_flags, sizeof(ts_flags)) < 0) perror("SO_TIMESTAMPING");
+#endif
+    return fd;
+}
+
+static void mmsg_init(const unsigned queue, const char* iface, uint16_t port) {
+    SockQueue& sq = g_sock.q[queue];
+    const RxQueue& rq = g_rxq[queue];
+    for (int l = 0; l < (rq.ab ? 2 : 1); ++l)
+        sq.fd[l] = mcast_socket(iface, rq.groups[l], rq.n_groups[l], port);
+    int rc = posix_memalign(reinterpret_cast<void**>(&sq.pkt_mem), 4096, (size_t)2 * N_BUFS * PKT_BUF_SIZE);
+    if (rc) { perror("posix_memalign"); exit(1); }
+    printf("[sock] queue %u: mmsg interface=%s port %u batch=%u\n", queue, iface, port, RX_BATCH);
+}
+
+static void tpv3_init(const unsigned queue, const char* iface, uint16_t port) {
+    SockQueue& sq = g_sock.q[queue];
+    const RxQueue& rq = g_rxq[queue];
+
+    // the packet socket sees whatever the interface receives, but the NIC only
+    // passes the groups up while someone is joined to them
+    sq.mcast_fd = mcast_socket(iface, rq.groups[0], rq.n_groups[0], port);
+    for (unsigned i = 0; i < rq.n_groups[0]; ++i) {
+        uint32_t group;
+        inet_pton(AF_INET, rq.groups[0][i], &group);
+        sq.filter.add_group(group);
+    }
+    sq.filter.port = port;
+
+    int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+    if (fd < 0) { perror("socket(AF_PACKET)"); exit(1); }
+
+    int ver = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) < 0) { perror("PACKET_VERSION"); exit(1); }
+#ifdef RX_LATENCY
+    // hardware stamps in tp_sec / tp_nsec where the NIC gives them, else the kernel's
+    int ts_flags = SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(fd, SOL_PACKET, PACKET_TIMESTAMP, &ts_flags, sizeof(ts_flags)) < 0) perror("PACKET_TIMESTAMP");
+#endif
+
+    tpacket_req3 req{};
+    req.tp_block_size = RING_BLOCK_SIZE;
+    req.tp_block_nr = RING_BLOCKS;
+    req.tp_frame_size = RING_FRAME_SIZE;
+    req.tp_frame_nr = RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCKS;
+    req.tp_retire_blk_tov = BLOCK_TIMEOUT_MS;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) { perror("PACKET_RX_RING"); exit(1); }
+
+    // The ring is mapped into a reservation one page longer, so the decoders'
+    // 32-byte overread past a datagram at the very end of the last block
+    // stays mapped.
+    sq.ring_len = (size_t)RING_BLOCK_SIZE * RING_BLOCKS;
+    void* base = mmap(nullptr, sq.ring_len + 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) { perror("mmap"); exit(1); }
+    if (mmap(base, sq.ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | MAP_LOCKED, fd, 0) == MAP_FAILED &&
+        mmap(base, sq.ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        perror("mmap(PACKET_RX_RING)"); exit(1);
+    }
+    sq.ring = static_cast<uint8_t*>(base);
+
+    struct sockaddr_ll sll{};
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex = static_cast<int>(iface_index(iface));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&sll), sizeof(sll)) < 0) { perror("bind(AF_PACKET)"); exit(1); }
+
+    // Several queues: one fanout group, so each frame reaches one member ring
+    // instead of a copy reaching every one; tpv3_steer() picks the member.
+    if (g_n_queues > 1) {
+        int fanout = (getpid() & 0xffff) | (PACKET_FANOUT_CBPF << 16);
+        if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0) { perror("PACKET_FANOUT"); exit(1); }
+    }
+
+    sq.fd[0] = fd;
+    printf("[sock] queue %u: tpv3 interface=%s port %u blocks=%u x %u KB timeout=%u ms\n",
+           queue, iface, port, RING_BLOCKS, RING_BLOCK_SIZE >> 10, BLOCK_TIMEOUT_MS);
+}
+
+// Fanout members are numbered in join order, which is queue order: a
+// classic BPF program on the IPv4 destination returns the queue of the
+// group, or queue 0 for anything else (where the frame filter drops it).
+static void tpv3_steer() {
+    std::vector<sock_filter> prog;
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF) + 16));
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        for (unsigned i = 0; i < g_sock.q[q].filter.n_groups; ++i) {
+            prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(g_sock.q[q].filter.group[i]), 0, 1));
+            prog.push_back(BPF_STMT(BPF_RET | BPF_K, q));
+        }
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+
+    sock_fprog fprog{static_cast<unsigned short>(prog.size()), prog.data()};
+    if (setsockopt(g_sock.q[0].fd[0], SOL_PACKET, PACKET_FANOUT_DATA, &fprog, sizeof(fprog)) < 0) {
+        perror("PACKET_FANOUT_DATA"); exit(1);
+    }
+}
+
+// ─── Main polling loops ──────────────────────────────────────────────────────
+
+static void push_batch(const unsigned queue, SPSCRing<PktDesc, RING_CAPACITY>& ring, PktDesc* batch, unsigned n) {
+    rx_stamp_enqueue(queue, batch, n);
+    while (n) {
+        const size_t k = ring.push_n(batch, n);     // back-pressure spin
+        batch += k;
+        n -= static_cast<unsigned>(k);
+        if (n) _mm_pause();
+    }
+    TRACE_MARK(RingPush, 0);
+}
+
+#ifdef RX_LATENCY
+
+// The SCM_TIMESTAMPING stamp of a received datagram in ns: the raw hardware
+// one if set, else the software one; 0 if it carries neither.
+static int64_t cmsg_rx_ns(msghdr& mh) {
+    for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING) continue;
+        scm_timestamping st;
+        memcpy(&st, CMSG_DATA(c), sizeof(st));
+        const timespec& ts = st.ts[2].tv_sec ? st.ts[2] : st.ts[0];
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+    return 0;
+}
+
+#endif // RX_LATENCY
+
+// One recvmmsg on the queue's line `line` into its free buffers, pushed to
+// its ring.
+static void mmsg_poll_line(const unsigned queue, const int line, uint64_t& seq) {
+    static mmsghdr msgs[RX_BATCH];
+    static iovec   iov[RX_BATCH];
+#ifdef RX_LATENCY
+    alignas(cmsghdr) static char ctrl[RX_BATCH][CMSG_SPACE(sizeof(scm_timestamping))];
+#endif
+    PktDesc batch[RX_BATCH];
+    SockQueue& sq = g_sock.q[queue];
+    const int base = line * N_BUFS;
+
+    const uint64_t in_use = seq - sq.released[line].load(std::memory_order_acquire);
+    const unsigned want = static_cast<unsigned>(std::min<uint64_t>(RX_BATCH, N_BUFS - in_use));
+    if (want == 0) { _mm_pause(); return; }
+
+    for (unsigned i = 0; i < want; ++i) {
+        const int id = base + static_cast<int>((seq + i) % N_BUFS);
+        iov[i] = { sq.buf_ptr(id), PKT_BUF_SIZE - 32 };     // 32 bytes left for the decoders' overread
+        msgs[i].msg_hdr = {};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+#ifdef RX_LATENCY
+        msgs[i].msg_hdr.msg_control = ctrl[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+#endif
+    }
+
+    const int n = recvmmsg(sq.fd[line], msgs, want, MSG_DONTWAIT, nullptr);
+    if (n <= 0) [[likely]] {
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) { perror("recvmmsg"); exit(1); }
+        _mm_pause();
+        return;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const int id = base + static_cast<int>((seq + i) % N_BUFS);
+        TRACE_MARK(RxPacket, msgs[i].msg_len);
+        batch[i] = { sq.buf_ptr(id), msgs[i].msg_len, id };
+#ifdef RX_LATENCY
+        batch[i].rx_ns = cmsg_rx_ns(msgs[i].msg_hdr);
+#endif
+    }
+    push_batch(queue, line ? g_rxq[queue].ring_b : g_rxq[queue].ring, batch, static_cast<unsigned>(n));
+    seq += static_cast<unsigned>(n);
+}
+
+static void mmsg_loop() {
+    uint64_t seq[RX_MAX_QUEUES][2]{};      // datagrams received so far, per queue and line
+
+#ifdef TRACE_PROBES
+    TRACEPROBE::trace_thread_init("poll");
+#endif
+
+    while (true) {
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            mmsg_poll_line(q, 0, seq[q][0]);
+            if (g_rxq[q].ab) mmsg_poll_line(q, 1, seq[q][1]);
+        }
+    }
+}
+
+// Hands block b of the queue's ring to its consumer if the kernel has filled
+// it; false if not yet.
+static bool tpv3_poll_block(const unsigned queue, const uint32_t b) {
+    PktDesc batch[RX_BATCH];
+    SockQueue& sq = g_sock.q[queue];
+    SPSCRing<PktDesc, RING_CAPACITY>& ring = g_rxq[queue].ring;
+
+    tpacket_block_desc* bd = sq.block(b);
+    std::atomic_ref<uint32_t> status(bd->hdr.bh1.block_status);
+    if (!(status.load(std::memory_order_acquire) & TP_STATUS_USER)) return false;
+
+    // The last accepted datagram is held back so it can go out carrying
+    // the block number: the consumer's release of it returns the block.
+    unsigned n = 0;
+    bool held = false;
+    PktDesc last{};
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bd) + bd->hdr.bh1.offset_to_first_pkt;
+    for (uint32_t i = 0; i < bd->hdr.bh1.num_pkts; ++i) {
+        const tpacket3_hdr* h = reinterpret_cast<const tpacket3_hdr*>(p);
+        const sockaddr_ll* sll = reinterpret_cast<const sockaddr_ll*>(p + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+        const uint8_t* payload;
+        uint32_t len;
+        // on lo the packet socket sees every frame twice, going out and coming in
+        if (sll->sll_pkttype != PACKET_OUTGOING &&
+            frame_udp(LINK_ETHERNET, p + h->tp_mac, h->tp_snaplen, sq.filter, payload, len) == FrameUdp::Ok) {
+            TRACE_MARK(RxPacket, len);
+            if (held) {
+                batch[n++] = last;
+                if (n == RX_BATCH) { push_batch(queue, ring, batch, n); n = 0; }
+            }
+            last = { payload, len, -1 };
+#ifdef RX_LATENCY
+            last.rx_ns = static_cast<int64_t>(h->tp_sec) * 1'000'000'000 + h->tp_nsec;
+#endif
+            held = true;
+        }
+        p += h->tp_next_offset;
+    }
+
+    if (held) {
+        last.buf_id = static_cast<int>(b);
+        batch[n++] = last;
+        push_batch(queue, ring, batch, n);
+    } else {
+        if (n) push_batch(queue, ring, batch, n);
+        status.store(TP_STATUS_KERNEL, std::memory_order_release);
+    }
+    return true;
+}
+
+static void tpv3_loop() {
+    uint32_t block[RX_MAX_QUEUES]{};       // next block to look at, per queue
+
+#ifdef TRACE_PROBES
+    TRACEPROBE::trace_thread_init("poll");
+#endif
+
+    while (true) {
+        bool any = false;
+        for (unsigned q = 0; q < g_n_queues; ++q) {
+            if (!tpv3_poll_block(q, block[q])) continue;
+            block[q] = (block[q] + 1) % RING_BLOCKS;
+            any = true;
+        }
+        if (!any) _mm_pause();
+    }
+}
+
+// ─── Loopback sender ─────────────────────────────────────────────────────────
+
+// Answers MoldUDP64 re-requests ([0-9] session [10-17] seqno [18-19] count)
+// from feed on UDP port `port` until stop is set.  An answer starts at the
+// requested seqno and carries as many of the requested messages as fit in
+// one datagram of max_payload.
+static void rerequest_server(const ItchFeed& feed, const uint16_t port, const std::atomic<bool>& stop) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) { perror("socket"); return; }
+    struct sockaddr_in sin{};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&sin), sizeof(sin)) < 0) { perror("bind(re-request)"); close(fd); return; }
+    struct timeval tv{0, 100'000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    const uint32_t max_payload = ItchGenConfig{}.max_payload;
+    uint64_t answered = 0, msgs = 0;
+    uint8_t req[64];
+    uint8_t out[2048];
+    while (!stop.load(std::memory_order_relaxed)) {
+        struct sockaddr_in from{};
+        socklen_t from_len = sizeof(from);
+        const ssize_t n = recvfrom(fd, req, sizeof(req), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+        // a request has the layout of the downstream header
+        MoldHeader h;
+        if (n < 0 || !mold_header(req, static_cast<uint32_t>(n), h)) continue;
+        // the datagram holding h.seqno: the last one starting at or before it
+        const auto it = std::upper_bound(feed.datagrams.begin(), feed.datagrams.end(), h.seqno,
+                                         [](uint64_t seq, const ItchDatagram& d) { return seq < d.seqno; });
+        if (it == feed.datagrams.begin()) continue;
+
+        uint32_t len = MOLD_HDR_LEN;
+        uint16_t count = 0;
+        for (auto d = it - 1; d != feed.datagrams.end() && count < h.count; ++d) {
+            const uint8_t* cur = feed.payload(*d) + MOLD_HDR_LEN;
+            for (uint64_t seq = d->seqno; seq < d->seqno + d->msg_count && count < h.count; ++seq) {
+                const uint32_t block = 2u + static_cast<uint32_t>(frame_be16(cur));
+                if (seq >= h.seqno) {
+                    if (len + block > max_payload) goto full;
+                    memcpy(out + len, cur, block);
+                    len += block;
+                    ++count;
+                }
+                cur += block;
+            }
+        }
+    full:
+        const uint64_t seq_be = __builtin_bswap64(h.seqno);
+        const uint16_t count_be = __builtin_bswap16(count);
+        memcpy(out, req, 10);
+        memcpy(out + 10, &seq_be, 8);
+        memcpy(out + 18, &count_be, 2);
+        sendto(fd, out, len, 0, reinterpret_cast<sockaddr*>(&from), from_len);
+        ++answered;
+        msgs += count;
+    }
+    printf("[send] re-request server answered %lu requests, %lu msgs\n",
+           static_cast<unsigned long>(answered), static_cast<unsigned long>(msgs));
+    close(fd);
+}
+
+// Multicasts a synthetic feed out of iface, looped back to local receivers:
+// the same feed to every group of the queue map, each line of an A/B queue
+// losing loss_pct % of its datagrams.
+static int send_feed(const char* iface, uint16_t port, uint64_t n_msgs, double pps, double loss_pct) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) { perror("socket"); return 1; }
+
+    struct ip_mreqn mreq{};
+    mreq.imr_ifindex = static_cast<int>(iface_index(iface));
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) < 0) { perror("IP_MULTICAST_IF"); return 1; }
+    unsigned char loop = 1, ttl = 0;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));        // never off the box
+
+    // The groups of one line are separate streams: all but the first get a
+    // session of their own (last byte + index), so a queue's arbiter does not
+    // take them for copies of one another.  The same index on lines A and B
+    // is the same stream.
+    struct Dest {
+        sockaddr_in sin;
+        int         line;
+        uint8_t     session_add;
+    };
+    std::vector<Dest> dst;
+    std::string groups;
+    for (unsigned q = 0; q < g_n_queues; ++q)
+        for (int l = 0; l < (g_rxq[q].ab ? 2 : 1); ++l)
+            for (unsigned i = 0; i < g_rxq[q].n_groups[l]; ++i) {
+                Dest d{};
+                d.sin.sin_family = AF_INET;
+                d.sin.sin_port = htons(port);
+                inet_pton(AF_INET, g_rxq[q].groups[l][i], &d.sin.sin_addr);
+                d.line = l;
+                d.session_add = static_cast<uint8_t>(i);
+                dst.push_back(d);
+                groups += groups.empty() ? "" : l ? " + B " : " ";
+                groups += g_rxq[q].groups[l][i];
+            }
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> pct(0.0, 100.0);
+    uint64_t dropped[2]{};
+
+    ItchFeed feed;
+    ItchGenerator(ItchGenConfig{}).generate(feed, n_msgs);
+    printf("[send] %lu msgs in %zu datagrams to %s:%u via %s, %s dgram/s, loss %.2f%%, re-requests on %u\n",
+           static_cast<unsigned long>(feed.msgs), feed.datagrams.size(), groups.c_str(), port, iface,
+           pps > 0.0 ? std::to_string(static_cast<uint64_t>(pps)).c_str() : "max", loss_pct, port + 1u);
+
+    std::atomic<bool> stop{false};
+    std::thread server(rerequest_server, std::cref(feed), static_cast<uint16_t>(port + 1), std::cref(stop));
+
+    static mmsghdr msgs[RX_BATCH];
+    static iovec   iov[RX_BATCH];
+    static uint8_t restamped[RX_BATCH][ITCH_GEN_SLOT];
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (next < feed.datagrams.size()) {
+        if (pps > 0.0) {
+            const auto due = t0 + std::chrono::nanoseconds(static_cast<int64_t>(next * 1e9 / pps));
+            while (std::chrono::steady_clock::now() < due) _mm_pause();
+        }
+        // paced: one datagram per send; unpaced: a batch per syscall
+        const size_t batch = std::max<size_t>(1, RX_BATCH / dst.size());
+        const unsigned k = static_cast<unsigned>(std::min<size_t>(pps > 0.0 ? 1 : batch, feed.datagrams.size() - next));
+        unsigned m = 0;
+        for (unsigned i = 0; i < k; ++i) {
+            const ItchDatagram& d = feed.datagrams[next + i];
+            for (Dest& to : dst) {
+                if (loss_pct > 0.0 && pct(rng) < loss_pct) { ++dropped[to.line]; continue; }
+                if (m == RX_BATCH) {
+                    fprintf(stderr, "more than %u groups\n", RX_BATCH);
+                    return 1;
+                }
+                iov[m] = { const_cast<uint8_t*>(feed.payload(d)), d.len };
+                if (to.session_add) {
+                    memcpy(restamped[m], feed.payload(d), d.len);
+                    restamped[m][9] = static_cast<uint8_t>(restamped[m][9] + to.session_add);
+                    iov[m].iov_base = restamped[m];
+                }
+                msgs[m].msg_hdr = {};
+                msgs[m].msg_hdr.msg_name = &to.sin;
+                msgs[m].msg_hdr.msg_namelen = sizeof(to.sin);
+                msgs[m].msg_hdr.msg_iov = &iov[m];
+                msgs[m].msg_hdr.msg_iovlen = 1;
+                ++m;
+            }
+        }
+        for (unsigned done = 0; done < m;) {
+            const int sent = sendmmsg(fd, msgs + done, m - done, 0);
+            if (sent < 0) {
+                if (errno == ENOBUFS || errno == EAGAIN) { _mm_pause(); continue; }
+                perror("sendmmsg");
+                return 1;
+            }
+            done += static_cast<unsigned>(sent);
+        }
+        next += k;
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("[send] done in %.3f s, dropped A=%lu B=%lu\n", secs,
+           static_cast<unsigned long>(dropped[0]), static_cast<unsigned long>(dropped[1]));
+    fflush(stdout);
+    sleep(3);                   // late re-requests
+    stop.store(true, std::memory_order_relaxed);
+    server.join();
+    close(fd);
+    return 0;
+}
+
+// ─── Entry point ─────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s <iface> <queue-map> <port> [mmsg|tpv3] [trace-file]\n"
+                        "       %s <iface> <queue-map> <port> send [msgs] [datagrams-per-second] [loss-%%]\n"
+                        "  queue-map: <group>[+<group>...][,<line-b-group>[+...]][@<core>][/<queue>...]\n",
+                argv[0], argv[0]);
+        return 1;
+    }
+
+    const char*      iface    = argv[1];
+    uint16_t         port     = static_cast<uint16_t>(atoi(argv[3]));
+    std::string_view mode     = argc > 4 ? argv[4] : "mmsg";
+
+    if (!rx_parse_queues(argv[2])) return 1;
+
+    if (mode == "send")
+        return send_feed(iface, port,
+                         argc > 5 ? strtoull(argv[5], nullptr, 10) : 1'000'000,
+                         argc > 6 ? atof(argv[6]) : 0.0,
+                         argc > 7 ? atof(argv[7]) : 0.0);
+    if (mode != "mmsg" && mode != "tpv3") {
+        fprintf(stderr, "unknown mode '%s' (mmsg, tpv3 or send)\n", argv[4]);
+        return 1;
+    }
+    g_sock.mode = mode == "tpv3" ? SockMode::Tpv3 : SockMode::Mmsg;
+    if (rx_any_ab() && g_sock.mode == SockMode::Tpv3) {
+        // a block would hold datagrams of both lines, released in no fixed order
+        fprintf(stderr, "A/B lines need mmsg mode\n");
+        return 1;
+    }
+
+#ifdef TRACE_PROBES
+    static TRACEPROBE::TraceDumper dumper;
+    dumper.start(argc > 5 ? argv[5] : "itch5_sock.trace");
+#endif
+
+    printf("[main] decoder isa=%s\n", ISADISPATCH::isa_name(ISADISPATCH::g_isa));
+
+    rx_print_queues("main");
+    for (unsigned q = 0; q < g_n_queues; ++q) {
+        if (g_sock.mode == SockMode::Tpv3) tpv3_init(q, iface, port);
+        else                               mmsg_init(q, iface, port);
+    }
+    if (g_sock.mode == SockMode::Tpv3 && g_n_queues > 1) tpv3_steer();
+
+    pthread_t tids[RX_MAX_QUEUES];
+    rx_start_consumers(tids);
+    for (unsigned q = 0; q < g_n_queues; ++q) pthread_detach(tids[q]);
+#ifndef ITCH_PRINT
+    pthread_t tid;
+    pthread_create(&tid, nullptr, stats_thread, nullptr);
+    pthread_detach(tid);
+#endif
+
+    printf("[main] entering poll loop\n");
+    if (g_sock.mode == SockMode::Tpv3) tpv3_loop();   // never returns
+    else                               mmsg_loop();
+}
@@ -0,0 +1,196 @@
+/**
+ * itch5_subscribe.h
+ *
+ * Subscription filter by stock_locate, checked by the parse loop right after
+ * the type byte (itch5_parse.h, h.subscribed()), so a message for a symbol
+ * nobody wants costs a 2-byte load and a bit test instead of a decode.
+ *
+ * The filter is a 65536-bit bitmap indexed by the locate as it sits in the
+ * message, big-endian bytes loaded as is: the bitmap is built byte-swapped
+ * once so the hot path never swaps.  Locate 0 (market-wide messages) is
+ * always in.  A subscription is a list of symbols ("AAPL,NVDA") or bare
+ * stock_locates ("17"), or "*" for everything, the default.  Symbols are
+ * resolved through the Stock Directory messages of the day: the readers
+ * learn every locate -> symbol they see and set a wanted symbol's bit as its
+ * directory entry goes past.
+ *
+ * Updates are RCU-style, for a handful of readers (the consumer threads) and
+ * one writer at a time:
+ *   reader   quiescent(r) between datagrams: reports the generation it has
+ *            seen and returns the bitmap to use until its next call;
+ *            offline(r) when it stops for good.  No locks; a reader
+ *            writes nothing shared but its own cache line.
+ *   writer   subscribe(list) builds a new bitmap, publishes it with one
+ *            pointer store, waits for every online reader to pass a
+ *            quiescent point (none can still hold the old one), frees the
+ *            old one, and picks up any wanted symbol whose directory entry
+ *            a reader learnt against the old bitmap meanwhile.
+ * Anything else (the stats thread) is not a reader and never touches a
+ * set: all() is a separate flag the writer keeps in step.
+ */
+
+#ifndef ITCH5_SUBSCRIBE_H_INCLUDED
+#define ITCH5_SUBSCRIBE_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "itch5_avx.h"
+
+static constexpr unsigned SUB_MAX_READERS = 16;
+static constexpr unsigned SUB_MAX_SYMBOLS = 4096;
+
+// ─── Subscription set ────────────────────────────────────────────────────────
+
+struct SubscriptionSet {
+    std::atomic<uint64_t> bits[65536 / 64];     // indexed by the raw (big-endian) locate
+    uint64_t symbols[SUB_MAX_SYMBOLS];          // wanted symbols, 8 bytes space-padded
+    unsigned n_symbols{0};
+    unsigned n_locates{0};                      // given as stock_locates
+    bool     all{false};
+
+    static unsigned index(const uint16_t locate) noexcept { return __builtin_bswap16(locate); }
+
+    // raw_locate: the two bytes at body + 1, as loaded
+    bool test(const uint16_t raw_locate) const noexcept {
+        return (bits[raw_locate >> 6].load(std::memory_order_relaxed) >> (raw_locate & 63)) & 1;
+    }
+
+    void set(const uint16_t locate) noexcept {
+        const unsigned i = index(locate);
+        bits[i >> 6].fetch_or(uint64_t{1} << (i & 63), std::memory_order_relaxed);
+    }
+
+    bool wants(const uint64_t symbol) const noexcept {
+        for (unsigned i = 0; i < n_symbols; ++i)
+            if (symbols[i] == symbol) return true;
+        return false;
+    }
+};
+
+// ─── Filter ──────────────────────────────────────────────────────────────────
+
+class SubscriptionFilter {
+public:
+    SubscriptionFilter() {
+        for (auto& r : m_seen) r.v.store(OFFLINE, std::memory_order_relaxed);
+    }
+
+    // Reader r: between datagrams.  The set returned stays valid until r's
+    // next quiescent() or offline().
+    [[gnu::always_inline]] SubscriptionSet* quiescent(const unsigned r) noexcept {
+        m_seen[r].v.store(m_gen.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        return m_live.load(std::memory_order_seq_cst);
+    }
+
+    void offline(const unsigned r) noexcept { m_seen[r].v.store(OFFLINE, std::memory_order_seq_cst); }
+
+    // Reader: a Stock Directory entry went past; set is the one it holds.
+    void learn(SubscriptionSet* set, const DecodedStockDirectory& m) noexcept {
+        uint64_t symbol;
+        memcpy(&symbol, m.stock, 8);
+        m_symbol[m.stock_locate].store(symbol, std::memory_order_relaxed);
+        if (set->wants(symbol)) set->set(m.stock_locate);
+    }
+
+    // Writer, before any subscribe(): a directory entry learnt elsewhere (a
+    // restored checkpoint), so a symbol named later resolves to its locate.
+    void know(const DecodedStockDirectory& m) noexcept {
+        uint64_t symbol;
+        memcpy(&symbol, m.stock, 8);
+        m_symbol[m.stock_locate].store(symbol, std::memory_order_relaxed);
+    }
+
+    // Writer: replaces the subscription with list; false (and nothing
+    // changed) if the list does not parse.  Blocks for one grace period.
+    bool subscribe(const char* list) {
+        SubscriptionSet* next = new SubscriptionSet;
+        if (!parse(list, *next)) { delete next; return false; }
+
+        if (next->all) {
+            for (auto& w : next->bits) w.store(~uint64_t{0}, std::memory_order_relaxed);
+        } else {
+            next->set(0);
+            for (uint32_t l = 1; l < 65536; ++l)
+                if (next->wants(m_symbol[l].load(std::memory_order_relaxed))) next->set(static_cast<uint16_t>(l));
+        }
+
+        SubscriptionSet* old = m_live.exchange(next, std::memory_order_seq_cst);
+        m_all.store(next->all, std::memory_order_relaxed);
+        synchronize();
+        delete old;
+
+        // directory entries learnt against the old set before the grace period ended
+        if (!next->all)
+            for (uint32_t l = 1; l < 65536; ++l)
+                if (next->wants(m_symbol[l].load(std::memory_order_relaxed))) next->set(static_cast<uint16_t>(l));
+        return true;
+    }
+
+    // Writer side only: the current set (not to be kept across a subscribe).
+    const SubscriptionSet* live() const noexcept { return m_live.load(std::memory_order_acquire); }
+
+    // Any thread (stats): whether every symbol is in.  A copy of the live
+    // set's flag, so it is read without holding a set a subscribe may free.
+    bool all() const noexcept { return m_all.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint64_t OFFLINE = ~uint64_t{0};
+
+    // "AAPL,NVDA,17" or "*"; a symbol is up to 8 characters, a locate all digits.
+    static bool parse(const char* list, SubscriptionSet& s) {
+        if (!list || strcmp(list, "*") == 0) { s.all = true; return true; }
+        for (const char* p = list; *p;) {
+            const char* comma = strchr(p, ',');
+            const size_t n = comma ? static_cast<size_t>(comma - p) : strlen(p);
+            if (n == 0 || n > 8) return false;
+            if (n == strspn(p, "0123456789") && n < 6) {
+                const unsigned long l = strtoul(p, nullptr, 10);
+                if (l == 0 || l > 65535) return false;
+                s.set(static_cast<uint16_t>(l));
+                ++s.n_locates;
+            } else {
+                if (s.n_symbols == SUB_MAX_SYMBOLS) return false;
+                char padded[8];
+                memset(padded, ' ', sizeof(padded));
+                memcpy(padded, p, n);
+                memcpy(&s.symbols[s.n_symbols++], padded, 8);
+            }
+            p = comma ? comma + 1 : p + n;
+        }
+        return true;
+    }
+
+    // Waits until every online reader has passed a quiescent point after
+    // the publish.
+    void synchronize() {
+        const uint64_t gen = m_gen.fetch_add(1, std::memory_order_seq_cst) + 1;
+        for (auto& r : m_seen)
+            while (true) {
+                const uint64_t seen = r.v.load(std::memory_order_seq_cst);
+                if (seen == OFFLINE || seen >= gen) break;
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+    }
+
+    struct alignas(64) Seen { std::atomic<uint64_t> v; };      // a line per reader
+
+    std::atomic<SubscriptionSet*> m_live{everything()};
+    std::atomic<bool>     m_all{true};                  // m_live->all
+    alignas(64) std::atomic<uint64_t> m_gen{0};
+    Seen                  m_seen[SUB_MAX_READERS];
+    std::atomic<uint64_t> m_symbol[65536]{};            // locate -> symbol, from the directory
+
+    static SubscriptionSet* everything() {
+        SubscriptionSet* s = new SubscriptionSet;
+        s->all = true;
+        for (auto& w : s->bits) w.store(~uint64_t{0}, std::memory_order_relaxed);
+        return s;
+    }
+};
+
+#endif // ITCH5_SUBSCRIBE_H_INCLUDED
@@ -0,0 +1,420 @@
+/**
+ * mpmc_bench.cpp
+ *
+ * Contention sweep for the multi-producer / multi-consumer queues:
+ *   ProdConsMPMCSlot<Msg, 4096>      (ProdConsMPMCSlot.h, fixed-size slots)
+ *   MtoNVariable_2025(256 KB)        (MtoNVariable_2025.h, variable records, readN)
+ *
+ * Every point of the sweep runs P producers and C consumers (1..max each) for
+ * a fixed time.  Producers push (producer id, sequence) messages as fast as
+ * the queue takes them; consumers pop until every produced message has been
+ * consumed.  Reported per point:
+ *   throughput   messages consumed per second inside the timed window
+ *   fairness     Jain's index over per-producer and per-consumer counts
+ *                (1.0 = perfectly even, 1/n = one thread did everything)
+ *   contention   spins per message while waiting for a slot / space
+ *                (producers) or for data / in-order release (consumers),
+ *                and CAS failures per CAS attempt on the shared indices;
+ *                counted by CONTENTION_COUNT (Useful.h), compiled in here
+ *   counters     hardware counters per message (PerfAnalysis.h
+ *                perf_counters), counted in every producer and consumer
+ *                from the start of the window until it stops (consumers
+ *                through the drain) and summed; printed under the row
+ * and checked: consumed == produced, per-producer order seen by each consumer,
+ * and a checksum of every sequence number.
+ *
+ * Threads are pinned by topology (sysfs):
+ *   same    producers and consumers on one socket, one thread per physical
+ *           core first, SMT siblings only once the cores run out
+ *   cross   producers on socket 0, consumers on socket 1
+ *   none    not pinned (hosts with fewer cpus than threads)
+ * Points that need more cpus than the placement has are skipped.
+ *
+ * Each point is printed as a table row and appended to a CSV file (header on
+ * the first line) for plotting.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 -DCONTENTION_STATS mpmc_bench.cpp -o mpmc_bench -pthread
+ *
+ * Run:
+ *   ./mpmc_bench [max_producers] [max_consumers] [ms_per_point] [same|cross|none|all] [csv]
+ *   ./mpmc_bench 8 8 200 all mpmc_sweep.csv
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <array>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+
+#include <immintrin.h>          // _mm_pause
+
+// the queue headers expect std in scope, as main.cpp provides
+using namespace std;
+
+#include "Useful.h"
+#include "ProdConsMPMCSlot.h"
+#include "MtoNVariable_2025.h"
+#include "PerfAnalysis.h"
+
+// ─── Topology ────────────────────────────────────────────────────────────────
+
+struct Cpu {
+    int id;
+    int socket;
+    int core;
+};
+
+static int read_sysfs_int(const int cpu, const char* leaf) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, leaf);
+    int v = -1;
+    if (FILE* f = fopen(path, "r")) {
+        if (fscanf(f, "%d", &v) != 1) v = -1;
+        fclose(f);
+    }
+    return v;
+}
+
+// cpus per socket, ordered so that distinct physical cores come before SMT siblings
+static vector<vector<int>> cpus_by_socket() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    vector<Cpu> cpus;
+    for (int c = 0; c < CPU_SETSIZE; ++c)
+        if (CPU_ISSET(c, &allowed))
+            cpus.push_back({c, max(0, read_sysfs_int(c, "physical_package_id")), read_sysfs_int(c, "core_id")});
+
+    vector<vector<int>> sockets;
+    for (const Cpu& c : cpus) {
+        if (c.socket >= static_cast<int>(sockets.size())) sockets.resize(c.socket + 1);
+        sockets[c.socket].push_back(c.id);
+    }
+    for (auto& s : sockets) {
+        vector<int> first, siblings, seen;
+        for (const int id : s) {
+            const int core = read_sysfs_int(id, "core_id");
+            if (core < 0 || find(seen.begin(), seen.end(), core) == seen.end()) {
+                first.push_back(id);
+                seen.push_back(core);
+            } else {
+                siblings.push_back(id);
+            }
+        }
+        first.insert(first.end(), siblings.begin(), siblings.end());
+        s = move(first);
+    }
+    sockets.erase(remove_if(sockets.begin(), sockets.end(), [](const auto& s) { return s.empty(); }), sockets.end());
+    return sockets;
+}
+
+enum class Placement { Same, Cross, None };
+
+static const char* placement_name(const Placement p) {
+    return p == Placement::Same ? "same" : p == Placement::Cross ? "cross" : "none";
+}
+
+// cpu per producer and per consumer, -1 = unpinned; false if the placement cannot host them
+static bool place(const vector<vector<int>>& sockets, const Placement pl, const int np, const int nc,
+                  vector<int>& prod_cpu, vector<int>& cons_cpu) {
+    prod_cpu.assign(np, -1);
+    cons_cpu.assign(nc, -1);
+    if (pl == Placement::None) return true;
+    if (pl == Placement::Same) {
+        const auto& s = *max_element(sockets.begin(), sockets.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+        if (static_cast<size_t>(np + nc) > s.size()) return false;
+        for (int i = 0; i < np; ++i) prod_cpu[i] = s[i];
+        for (int i = 0; i < nc; ++i) cons_cpu[i] = s[np + i];
+        return true;
+    }
+    if (sockets.size() < 2 || static_cast<size_t>(np) > sockets[0].size() || static_cast<size_t>(nc) > sockets[1].size()) return false;
+    for (int i = 0; i < np; ++i) prod_cpu[i] = sockets[0][i];
+    for (int i = 0; i < nc; ++i) cons_cpu[i] = sockets[1][i];
+    return true;
+}
+
+// ─── Queues under test ───────────────────────────────────────────────────────
+
+struct Msg {
+    uint32_t prod;
+    uint32_t pad;
+    uint64_t seq;
+};
+
+static atomic<bool> g_go{false};
+static atomic<bool> g_stop{false};      // producers stop pushing
+static atomic<bool> g_exit{false};      // everything consumed: blocked threads bail out
+
+inline constexpr auto bench_exit = [] { return g_exit.load(memory_order_relaxed); };
+
+// push blocks until the message is in or g_exit; pop returns false when nothing was taken
+struct SlotQueue {
+    static constexpr const char* name = "ProdConsMPMCSlot";
+    PRODCONSSPECIFIC::ProdConsMPMCSlot<Msg, 4096, bench_exit> q;
+
+    bool push(const Msg& m) noexcept { return q.prod(m); }
+    bool pop(Msg& m) noexcept { return q.cons(m); }
+};
+
+struct MtoNQueue {
+    static constexpr const char* name = "MtoNVariable_2025";
+    MKTDATASYSTEM::CONTAINERS::MtoNVariable_2025 q{256 * 1024};
+
+    bool push(const Msg& m) noexcept {
+        while (!q.write(reinterpret_cast<const char*>(&m), sizeof(m))) {
+            if (bench_exit()) return false;
+            _mm_pause();
+        }
+        return true;
+    }
+    bool pop(Msg& m) noexcept {
+        size_t len = 0;
+        q.readN(reinterpret_cast<char*>(&m), len);
+        return len == sizeof(m);
+    }
+};
+
+// ─── One point of the sweep ──────────────────────────────────────────────────
+
+struct alignas(128) ThreadResult {
+    atomic<uint64_t> count{0};
+    uint64_t         checksum{0};
+    uint64_t         order_errors{0};
+    contention_stats stats{};
+    uint64_t         perf[perf_counters::NUM_COUNTERS]{};
+};
+
+static constexpr int MAX_THREADS = 64;
+
+struct Point {
+    double   msgs_per_sec;
+    double   jain_prod;
+    double   jain_cons;
+    double   prod_spins;        // per message
+    double   cons_spins;        // per message
+    double   cas_fail_rate;     // failures / attempts
+    uint64_t produced;
+    uint64_t consumed;
+    bool     ok;
+};
+
+static double jain(const vector<uint64_t>& x) {
+    double s = 0, s2 = 0;
+    for (const uint64_t v : x) { s += v; s2 += static_cast<double>(v) * v; }
+    return s2 > 0 ? s * s / (x.size() * s2) : 1.0;
+}
+
+template<class Q>
+static Point run_point(const int np, const int nc, const vector<int>& prod_cpu, const vector<int>& cons_cpu, const int ms,
+                       perf_counters& perf) {
+    g_go = false;
+    g_stop = false;
+    g_exit = false;
+
+    auto q = make_unique<Q>();
+    vector<ThreadResult> prod(np), cons(nc);
+    atomic<int> ready{0};
+    vector<thread> pt, ct;
+
+    for (int c = 0; c < nc; ++c) {
+        ct.emplace_back([&, c] {
+            if (cons_cpu[c] >= 0) pin_this_thread(cons_cpu[c]);
+            tl_contention_stats = {};
+            array<uint64_t, MAX_THREADS> last{};     // per producer: last seq + 1
+            ThreadResult& r = cons[c];
+            perf_counters pc;
+            ready.fetch_add(1);
+            while (!g_go.load(memory_order_acquire)) _mm_pause();
+
+            pc.start();
+            Msg m{};
+            uint64_t n = 0;
+            while (!g_exit.load(memory_order_relaxed)) {
+                if (!q->pop(m)) continue;
+                r.order_errors += (m.seq + 1 <= last[m.prod]);
+                last[m.prod] = m.seq + 1;
+                r.checksum += m.seq + 1;
+                r.count.store(++n, memory_order_relaxed);
+            }
+            pc.stop();
+            copy(begin(pc.totals), end(pc.totals), r.perf);
+            r.stats = tl_contention_stats;
+        });
+    }
+    for (int p = 0; p < np; ++p) {
+        pt.emplace_back([&, p] {
+            if (prod_cpu[p] >= 0) pin_this_thread(prod_cpu[p]);
+            tl_contention_stats = {};
+            ThreadResult& r = prod[p];
+            perf_counters pc;
+            ready.fetch_add(1);
+            while (!g_go.load(memory_order_acquire)) _mm_pause();
+
+            pc.start();
+            uint64_t seq = 0;
+            while (!g_stop.load(memory_order_relaxed)) {
+                if (!q->push(Msg{static_cast<uint32_t>(p), 0, seq})) break;
+                r.checksum += ++seq;
+            }
+            pc.stop();
+            r.count.store(seq, memory_order_relaxed);
+            copy(begin(pc.totals), end(pc.totals), r.perf);
+            r.stats = tl_contention_stats;
+        });
+    }
+
+    while (ready.load() < np + nc) this_thread::yield();
+    const auto t0 = chrono::steady_clock::now();
+    g_go.store(true, memory_order_release);
+    this_thread::sleep_for(chrono::milliseconds(ms));
+    g_stop.store(true);
+    const auto t1 = chrono::steady_clock::now();
+    uint64_t consumed_in_window = 0;
+    for (auto& r : cons) consumed_in_window += r.count.load(memory_order_relaxed);
+
+    for (auto& t : pt) t.join();
+    uint64_t produced = 0;
+    for (auto& r : prod) produced += r.count.load();
+
+    // drain: wait (bounded) until every produced message has been consumed
+    uint64_t consumed = 0;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    do {
+        consumed = 0;
+        for (auto& r : cons) consumed += r.count.load(memory_order_relaxed);
+        if (consumed >= produced) break;
+        this_thread::yield();
+    } while (chrono::steady_clock::now() < deadline);
+    g_exit.store(true);
+    for (auto& t : ct) t.join();
+
+    Point pt_res{};
+    const double secs = chrono::duration<double>(t1 - t0).count();
+    pt_res.msgs_per_sec = consumed_in_window / secs;
+    pt_res.produced = produced;
+    pt_res.consumed = consumed;
+
+    vector<uint64_t> pc, cc;
+    uint64_t prod_sum = 0, cons_sum = 0, order_errors = 0;
+    contention_stats tot{};
+    for (auto& r : prod) {
+        pc.push_back(r.count.load());
+        prod_sum += r.checksum;
+        tot.prod_spins += r.stats.prod_spins;
+        tot.cas_attempts += r.stats.cas_attempts;
+        tot.cas_failures += r.stats.cas_failures;
+        for (int i = 0; i < perf_counters::NUM_COUNTERS; ++i) perf.totals[i] += r.perf[i];
+    }
+    for (auto& r : cons) {
+        cc.push_back(r.count.load());
+        cons_sum += r.checksum;
+        order_errors += r.order_errors;
+        tot.cons_spins += r.stats.cons_spins;
+        tot.cas_attempts += r.stats.cas_attempts;
+        tot.cas_failures += r.stats.cas_failures;
+        for (int i = 0; i < perf_counters::NUM_COUNTERS; ++i) perf.totals[i] += r.perf[i];
+    }
+    pt_res.jain_prod = jain(pc);
+    pt_res.jain_cons = jain(cc);
+    const double n = produced ? static_cast<double>(produced) : 1.0;
+    pt_res.prod_spins = tot.prod_spins / n;
+    pt_res.cons_spins = tot.cons_spins / n;
+    pt_res.cas_fail_rate = tot.cas_attempts ? static_cast<double>(tot.cas_failures) / tot.cas_attempts : 0.0;
+    pt_res.ok = consumed == produced && cons_sum == prod_sum && order_errors == 0;
+    if (!pt_res.ok)
+        printf("  CHECK FAILED: produced %lu consumed %lu checksum %s order errors %lu\n",
+               static_cast<unsigned long>(produced), static_cast<unsigned long>(consumed),
+               cons_sum == prod_sum ? "ok" : "BAD", static_cast<unsigned long>(order_errors));
+    return pt_res;
+}
+
+// ─── Sweep ───────────────────────────────────────────────────────────────────
+
+template<class Q>
+static void sweep(const vector<vector<int>>& sockets, const Placement pl, const int max_p, const int max_c,
+                  const int ms, FILE* csv) {
+    printf("%s  placement=%s\n", Q::name, placement_name(pl));
+    printf("  %3s %3s %12s %9s %9s %12s %12s %9s  %s\n", "P", "C", "Mmsg/s", "jain(P)", "jain(C)",
+           "pspin/msg", "cspin/msg", "casfail", "check");
+    for (int np = 1; np <= max_p; ++np) {
+        for (int nc = 1; nc <= max_c; ++nc) {
+            vector<int> prod_cpu, cons_cpu;
+            if (!place(sockets, pl, np, nc, prod_cpu, cons_cpu)) continue;
+
+            // this group only says which counters open here; the counts are the workers' sums
+            perf_counters perf;
+            const Point r = run_point<Q>(np, nc, prod_cpu, cons_cpu, ms, perf);
+            printf("  %3d %3d %12.2f %9.3f %9.3f %12.2f %12.2f %9.4f  %s\n", np, nc, r.msgs_per_sec / 1e6,
+                   r.jain_prod, r.jain_cons, r.prod_spins, r.cons_spins, r.cas_fail_rate, r.ok ? "ok" : "FAIL");
+            fflush(stdout);
+            perf.print(cout, "         ", r.consumed);
+            if (csv) {
+                fprintf(csv, "%s,%s,%d,%d,%.0f,%.4f,%.4f,%.3f,%.3f,%.5f,%lu,%lu,%d\n", Q::name, placement_name(pl), np, nc,
+                        r.msgs_per_sec, r.jain_prod, r.jain_cons, r.prod_spins, r.cons_spins, r.cas_fail_rate,
+                        static_cast<unsigned long>(r.produced), static_cast<unsigned long>(r.consumed), r.ok ? 1 : 0);
+                fflush(csv);
+            }
+        }
+    }
+    printf("\n");
+}
+
+// ─── Main ────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    const int max_p = min(argc > 1 ? atoi(argv[1]) : 4, MAX_THREADS);
+    const int max_c = min(argc > 2 ? atoi(argv[2]) : 4, MAX_THREADS);
+    const int ms    = argc > 3 ? atoi(argv[3]) : 200;
+    const string_view mode = argc > 4 ? argv[4] : "all";
+    const char* csv_path = argc > 5 ? argv[5] : "mpmc_sweep.csv";
+
+#ifndef CONTENTION_STATS
+    printf("built without -DCONTENTION_STATS: spin and CAS columns read 0\n");
+#endif
+
+    const auto sockets = cpus_by_socket();
+    printf("topology: %zu socket(s):", sockets.size());
+    for (const auto& s : sockets) printf(" %zu", s.size());
+    printf(" cpus\n\n");
+
+    vector<Placement> placements;
+    if (mode == "same" || mode == "all") placements.push_back(Placement::Same);
+    if (mode == "cross" || mode == "all") placements.push_back(Placement::Cross);
+    if (mode == "none") placements.push_back(Placement::None);
+
+    FILE* csv = fopen(csv_path, "w");
+    if (csv) fprintf(csv, "queue,placement,producers,consumers,msgs_per_sec,jain_prod,jain_cons,"
+                          "prod_spins_per_msg,cons_spins_per_msg,cas_fail_rate,produced,consumed,ok\n");
+
+    for (const Placement pl : placements) {
+        if (pl == Placement::Cross && sockets.size() < 2) {
+            printf("cross: single socket host, skipped\n\n");
+            continue;
+        }
+        sweep<SlotQueue>(sockets, pl, max_p, max_c, ms, csv);
+        sweep<MtoNQueue>(sockets, pl, max_p, max_c, ms, csv);
+    }
+
+    if (csv) {
+        fclose(csv);
+        printf("csv: %s\n", csv_path);
+    }
+    return 0;
+}
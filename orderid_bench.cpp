@@ -0,0 +1,416 @@
+/**
+ * orderid_bench.cpp
+ *
+ * Order-reference map at tens of millions of live orders:
+ *   ChunkyBucketMap                    (ChunkyBucketMap_1)
+ *   std::unordered_map<uint64_t, Order> (reserved up front)
+ *   direct-indexed array               (ref - base, 64K-order pages, freed once dead)
+ *
+ * Order refs are issued the way an ITCH 5.0 feed issues them: strictly
+ * increasing, with small gaps for orders of symbols this process does not
+ * keep.  Every order gets a lifetime when it is added: most are cancelled or
+ * filled within a few hundred messages, the rest rest in the book until a
+ * later replace takes them out.  The resting orders are what makes the live
+ * set grow, so the run steps through live-set milestones and at each one
+ * times a window of steady churn:
+ *   add    try_emplace of the next ref
+ *   find   execute / replace lookup: a young order or a random resting one
+ *   erase  cancel / delete when an order's lifetime ends
+ *
+ * Every op in a window is timed on its own (lfence + rdtsc), so the reported
+ * p50 / p90 / p99 / p99.9 / max include ~20 cycles of timer overhead.  Next to
+ * the percentiles: hardware counters per op over the window (PerfAnalysis.h
+ * perf_counters), process RSS, RSS per live order, and for ChunkyBucketMap
+ * arena_utilization() / arena_capacity().
+ *
+ * The op stream depends only on the seed, never on the container, so all
+ * three see identical work.  Each container runs in a forked child so the RSS
+ * column is not polluted by the previous container's freed pages.
+ *
+ * Build:
+ *   g++ -O3 -std=c++20 orderid_bench.cpp -o orderid_bench
+ *
+ * Run:
+ *   ./orderid_bench [max_live] [window_ops] [chunky|unordered|direct]
+ *   ./orderid_bench 40000000 4000000
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <string_view>
+#include <unordered_map>
+
+#include <immintrin.h>          // __m256i, _mm_malloc
+#include <unistd.h>             // fork, sysconf
+#include <sys/wait.h>
+
+#include "PerfAnalysis.h"
+#include "IsaDispatch.h"
+
+// ─── Containers ──────────────────────────────────────────────────────────────
+
+// ChunkyBucketMap_1 defines side / Order / PriceLevel at global scope
+namespace chunky {
+#include "ChunkyBucketMap_1"
+}
+
+using chunky::Order;
+
+// ITCH order refs start at 1, so oid == 0 marks a free slot
+class DirectOrderArray {
+public:
+    static constexpr size_t PAGE_SHIFT = 16;
+    static constexpr size_t PAGE_SIZE  = size_t{1} << PAGE_SHIFT;
+
+    explicit DirectOrderArray(const uint64_t base) : m_base(base) {}
+
+    Order* find(const uint64_t ref) {
+        const uint64_t i = ref - m_base;
+        const size_t p = i >> PAGE_SHIFT;
+        if (__builtin_expect(p >= m_pages.size() || !m_pages[p], 0)) return nullptr;
+        Order* o = &m_pages[p]->orders[i & (PAGE_SIZE - 1)];
+        return o->oid ? o : nullptr;
+    }
+
+    template<typename... Args>
+    std::pair<Order*, bool> try_emplace(const uint64_t ref, Args&&... args) {
+        const uint64_t i = ref - m_base;
+        const size_t p = i >> PAGE_SHIFT;
+        if (__builtin_expect(p >= m_pages.size(), 0)) m_pages.resize(p + 1);
+        if (__builtin_expect(!m_pages[p], 0)) m_pages[p] = std::make_unique<Page>();
+        Page& pg = *m_pages[p];
+        Order* o = &pg.orders[i & (PAGE_SIZE - 1)];
+        if (o->oid) return {o, false};
+        *o = Order(std::forward<Args>(args)...);
+        ++pg.live;
+        return {o, true};
+    }
+
+    bool erase(const uint64_t ref) {
+        Order* o = find(ref);
+        if (!o) return false;
+        *o = Order();
+        const size_t p = (ref - m_base) >> PAGE_SHIFT;
+        // refs only grow, so a page with nothing live that is not the newest one never refills
+        if (--m_pages[p]->live == 0 && p + 1 < m_pages.size()) m_pages[p].reset();
+        return true;
+    }
+
+    size_t pages() const {
+        return static_cast<size_t>(std::count_if(m_pages.begin(), m_pages.end(), [](const auto& p) { return p != nullptr; }));
+    }
+
+private:
+    struct Page {
+        Order    orders[PAGE_SIZE];
+        uint32_t live{0};
+    };
+
+    uint64_t                           m_base;
+    std::vector<std::unique_ptr<Page>> m_pages;
+};
+
+// ─── Container adapters ──────────────────────────────────────────────────────
+//
+// add(ref) / find(ref) / erase(ref) plus a one-line status for the report.
+
+struct ChunkySide {
+    chunky::ChunkyBucketMap map;
+    uint64_t failed{0};
+
+    // ~4 orders per bucket at max_live: one index chunk per bucket most of the time
+    ChunkySide(const uint64_t max_live, uint64_t)
+        : map(std::max<uint64_t>(max_live / 4, 16), max_live / 2 + max_live / 8) {}
+
+    bool add(const uint64_t ref) {
+        const auto [o, inserted] = map.try_emplace(ref, ref, ref & 0xFFFF, 100, chunky::side::BUY, nullptr, nullptr);
+        failed += (o == nullptr);
+        return inserted;
+    }
+    Order* find(const uint64_t ref) { return map.find(ref); }
+    bool erase(const uint64_t ref) { return map.erase(ref); }
+
+    void status(char* buf, const size_t n) const {
+        snprintf(buf, n, "arena %lu/%lu chunks (%.1f%%)%s", static_cast<unsigned long>(map.arena_utilization()),
+                 static_cast<unsigned long>(map.arena_capacity()),
+                 100.0 * static_cast<double>(map.arena_utilization()) / static_cast<double>(map.arena_capacity()),
+                 failed ? "  ARENA FULL" : "");
+    }
+};
+
+struct UnorderedSide {
+    std::unordered_map<uint64_t, Order> map;
+
+    UnorderedSide(const uint64_t max_live, uint64_t) { map.reserve(max_live + max_live / 8); }
+
+    bool add(const uint64_t ref) {
+        return map.try_emplace(ref, ref, ref & 0xFFFF, 100, chunky::side::BUY, nullptr, nullptr).second;
+    }
+    Order* find(const uint64_t ref) {
+        const auto it = map.find(ref);
+        return it == map.end() ? nullptr : &it->second;
+    }
+    bool erase(const uint64_t ref) { return map.erase(ref) != 0; }
+
+    void status(char* buf, const size_t n) const {
+        snprintf(buf, n, "%lu buckets, load %.2f", static_cast<unsigned long>(map.bucket_count()), map.load_factor());
+    }
+};
+
+struct DirectSide {
+    DirectOrderArray map;
+
+    DirectSide(uint64_t, const uint64_t base) : map(base) {}
+
+    bool add(const uint64_t ref) {
+        return map.try_emplace(ref, ref, ref & 0xFFFF, 100, chunky::side::BUY, nullptr, nullptr).second;
+    }
+    Order* find(const uint64_t ref) { return map.find(ref); }
+    bool erase(const uint64_t ref) { return map.erase(ref); }
+
+    void status(char* buf, const size_t n) const {
+        snprintf(buf, n, "%lu pages of %lu orders", static_cast<unsigned long>(map.pages()),
+                 static_cast<unsigned long>(DirectOrderArray::PAGE_SIZE));
+    }
+};
+
+// ─── Order flow ──────────────────────────────────────────────────────────────
+//
+// Generates the op stream one op at a time; the container is driven by the
+// caller, so generation stays outside the per-op timing.
+
+enum class OpType : uint8_t { Add, Find, Erase };
+
+struct Op {
+    uint64_t ref;
+    OpType   type;
+};
+
+class OrderFlow {
+public:
+    static constexpr uint64_t BASE_REF = 1'000'000;
+
+    OrderFlow(const uint64_t seed) : m_rng(seed) {}
+
+    // RESTING_SHARE of adds rest; in steady state each resting add replaces a random
+    // resting order, so the live set holds, while during a fill they accumulate
+    Op next(const bool fill) {
+        if (!m_short.empty() && m_short.front().death <= m_t) {
+            std::pop_heap(m_short.begin(), m_short.end(), later);
+            const uint64_t ref = m_short.back().ref;
+            m_short.pop_back();
+            ++m_t;
+            return {ref, OpType::Erase};
+        }
+        if (m_pending_erase) {
+            const uint64_t ref = m_pending_erase;
+            m_pending_erase = 0;
+            return {ref, OpType::Erase};
+        }
+        ++m_t;
+        const double u = m_u01(m_rng);
+
+        if (!fill && u < FIND_SHARE && !m_resting.empty()) {
+            // executes / replaces hit young orders most of the time
+            if (!m_short.empty() && m_u01(m_rng) < 0.7)
+                return {m_short[m_rng() % m_short.size()].ref, OpType::Find};
+            return {m_resting[m_rng() % m_resting.size()], OpType::Find};
+        }
+
+        m_ref += 1 + (m_rng() & 3);     // refs of other symbols' orders are skipped
+        if (m_u01(m_rng) < (fill ? FILL_RESTING_SHARE : RESTING_SHARE)) {
+            if (fill || m_resting.empty()) {
+                m_resting.push_back(m_ref);
+            } else {
+                uint64_t& slot = m_resting[m_rng() % m_resting.size()];
+                m_pending_erase = slot;
+                slot = m_ref;
+            }
+        } else {
+            m_short.push_back({m_t + 1 + static_cast<uint64_t>(m_life(m_rng)), m_ref});
+            std::push_heap(m_short.begin(), m_short.end(), later);
+        }
+        return {m_ref, OpType::Add};
+    }
+
+    uint64_t live() const { return m_resting.size() + m_short.size(); }
+
+private:
+    static constexpr double FIND_SHARE         = 0.35;
+    static constexpr double RESTING_SHARE      = 0.05;
+    static constexpr double FILL_RESTING_SHARE = 0.5;
+    static constexpr double SHORT_LIFE_MEAN    = 400.0;   // in messages
+
+    struct Pending {
+        uint64_t death;
+        uint64_t ref;
+    };
+    static bool later(const Pending& a, const Pending& b) { return a.death > b.death; }
+
+    std::mt19937_64                       m_rng;
+    std::uniform_real_distribution<double> m_u01{0.0, 1.0};
+    std::exponential_distribution<double> m_life{1.0 / SHORT_LIFE_MEAN};
+    std::vector<Pending>                  m_short;      // min-heap on death
+    std::vector<uint64_t>                 m_resting;
+    uint64_t                              m_ref{BASE_REF};
+    uint64_t                              m_t{0};
+    uint64_t                              m_pending_erase{0};
+};
+
+// ─── Measurement ─────────────────────────────────────────────────────────────
+
+static double tsc_per_ns() {
+    using clk = std::chrono::steady_clock;
+    const auto c0 = clk::now();
+    const uint64_t t0 = __rdtsc();
+    while (clk::now() - c0 < std::chrono::milliseconds(50)) {}
+    const uint64_t t1 = __rdtsc();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - c0).count();
+    return static_cast<double>(t1 - t0) / static_cast<double>(ns);
+}
+
+static size_t rss_bytes() {
+    long pages_total = 0, pages_res = 0;
+    if (FILE* f = fopen("/proc/self/statm", "r")) {
+        if (fscanf(f, "%ld %ld", &pages_total, &pages_res) != 2) pages_res = 0;
+        fclose(f);
+    }
+    return static_cast<size_t>(pages_res) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+template<class S>
+[[gnu::noinline]] static uint32_t timed_op(S& s, const Op op, uint64_t& sink) {
+    _mm_lfence();
+    const uint64_t t0 = __rdtsc();
+    _mm_lfence();
+    switch (op.type) {
+        case OpType::Add:   sink += s.add(op.ref);                                    break;
+        case OpType::Find:  { const Order* o = s.find(op.ref); sink += o ? o->sz : 1; break; }
+        case OpType::Erase: sink += s.erase(op.ref);                                  break;
+    }
+    _mm_lfence();
+    const uint64_t t1 = __rdtsc();
+    return static_cast<uint32_t>(std::min<uint64_t>(t1 - t0, UINT32_MAX));
+}
+
+template<class S>
+static uint64_t apply(S& s, const Op op) {
+    switch (op.type) {
+        case OpType::Add:   return s.add(op.ref);
+        case OpType::Find:  { const Order* o = s.find(op.ref); return o ? o->sz : 1; }
+        case OpType::Erase: return s.erase(op.ref);
+    }
+    return 0;
+}
+
+static void print_percentiles(const char* what, std::vector<uint32_t>& lat, const double tpn) {
+    if (lat.empty()) return;
+    std::sort(lat.begin(), lat.end());
+    const auto at = [&](const double q) {
+        return static_cast<double>(lat[std::min(lat.size() - 1, static_cast<size_t>(q * lat.size()))]) / tpn;
+    };
+    printf("    %-6s %9lu ops  p50 %7.1f  p90 %7.1f  p99 %7.1f  p99.9 %8.1f  max %9.1f ns\n", what,
+           static_cast<unsigned long>(lat.size()), at(0.50), at(0.90), at(0.99), at(0.999),
+           static_cast<double>(lat.back()) / tpn);
+}
+
+template<class S>
+static void run_container(const char* name, const std::vector<uint64_t>& milestones, const uint64_t window,
+                          const double tpn) {
+    printf("%s\n", name);
+    const size_t rss0 = rss_bytes();
+    auto side = std::make_unique<S>(milestones.back(), OrderFlow::BASE_REF);
+    OrderFlow flow(42);
+    uint64_t sink = 0;
+    std::vector<uint32_t> lat[3];
+    for (auto& l : lat) l.reserve(window);
+
+    for (const uint64_t target : milestones) {
+        stopwatch<> fill_sw;
+        uint64_t fill_ops = 0;
+        fill_sw.start();
+        while (flow.live() < target) {
+            sink += apply(*side, flow.next(true));
+            ++fill_ops;
+        }
+        fill_sw.stop();
+
+        for (auto& l : lat) l.clear();
+        perf_counters pc;
+        pc.start();
+        for (uint64_t i = 0; i < window; ++i) {
+            const Op op = flow.next(false);
+            lat[static_cast<int>(op.type)].push_back(timed_op(*side, op, sink));
+        }
+        pc.stop();
+
+        const size_t rss = rss_bytes() - rss0;
+        char status[96];
+        side->status(status, sizeof(status));
+        printf("  live %9lu  fill %6.1f ns/op  RSS %8.1f MB  %6.1f B/order  %s\n",
+               static_cast<unsigned long>(flow.live()),
+               fill_ops ? static_cast<double>(fill_sw.total_time) / fill_ops : 0.0,
+               static_cast<double>(rss) / (1 << 20), static_cast<double>(rss) / flow.live(), status);
+        print_percentiles("add", lat[0], tpn);
+        print_percentiles("find", lat[1], tpn);
+        print_percentiles("erase", lat[2], tpn);
+        fflush(stdout);
+        pc.print(std::cout, "    ", window);
+    }
+    printf("  (sink %lx)\n\n", static_cast<unsigned long>(sink));
+    fflush(stdout);
+}
+
+// Runs fn in a child so every container starts from the same RSS
+template<class F>
+static void isolated(F&& fn) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid < 0) { fn(); return; }
+    int st = 0;
+    waitpid(pid, &st, 0);
+    if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) printf("  child exited abnormally (status %d)\n\n", st);
+}
+
+// ─── Main ────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    const uint64_t max_live = argc > 1 ? strtoull(argv[1], nullptr, 10) : 8'000'000ULL;
+    const uint64_t window   = argc > 2 ? strtoull(argv[2], nullptr, 10) : 2'000'000ULL;
+    const std::string_view only = argc > 3 ? argv[3] : "";
+
+    // live-set milestones: 1, 2, 5 × 10^k up to max_live
+    std::vector<uint64_t> milestones;
+    for (uint64_t m = 1'000'000; m < max_live; m *= 10)
+        for (const uint64_t f : {1u, 2u, 5u})
+            if (m * f < max_live) milestones.push_back(m * f);
+    milestones.push_back(max_live);
+
+    const double tpn = tsc_per_ns();
+    printf("order-id map: max_live=%lu window=%lu ops  tsc %.2f GHz  isa=%s\n\n",
+           static_cast<unsigned long>(max_live), static_cast<unsigned long>(window), tpn,
+           ISADISPATCH::isa_name(ISADISPATCH::g_isa));
+
+    if (only.empty() || only == "chunky")
+        isolated([&] { run_container<ChunkySide>("ChunkyBucketMap", milestones, window, tpn); });
+    if (only.empty() || only == "unordered")
+        isolated([&] { run_container<UnorderedSide>("std::unordered_map", milestones, window, tpn); });
+    if (only.empty() || only == "direct")
+        isolated([&] { run_container<DirectSide>("direct array", milestones, window, tpn); });
+    return 0;
+}
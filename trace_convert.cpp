@@ -0,0 +1,22 @@
+/**
+ * trace_convert.cpp
+ *
+ * Offline converter for TraceProbe.h binary traces → Chrome trace event JSON
+ * (open in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Build:
+ *   g++ -O2 -std=c++20 trace_convert.cpp -o trace_convert -lpthread
+ *
+ * Run:
+ *   ./trace_convert itch5.trace itch5.json
+ */
+
+#include "TraceProbe.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <trace.bin> <trace.json>\n", argv[0]);
+        return 1;
+    }
+    return TRACEPROBE::trace_export_chrome(argv[1], argv[2]) ? 0 : 1;
+}